@@ -0,0 +1,412 @@
+#ifndef CURSOR_COMPOSITE_H
+#define CURSOR_COMPOSITE_H
+
+#include "cursor_shape.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CURSOR_COMPOSITE_X86 1
+#endif
+
+/**
+ * @brief 把光标画到 32bpp 桌面帧上
+ *
+ * - blendImage()：把已转换的 ARGB 光标图像（ConvertPointerShapeToQImage 的输出，非预乘）
+ *   按 Alpha 混合到帧上
+ * - compositeShape()：直接使用原始光标形状，按 Windows 的语义绘制：
+ *   COLOR 按 Alpha 混合；MONOCHROME 先 AND 再 XOR（可以真正反色）；
+ *   MASKED_COLOR 在 Alpha 为 0 时替换 RGB，为 0xFF 时与屏幕 RGB 做 XOR
+ *
+ * 光标左上角位于 (position - hotSpot)，超出帧边界的部分被裁剪。
+ * 帧像素的 Alpha 保持不变。每种操作都有标量、SSE2、AVX2 三个行内核，结果逐字节一致，
+ * 运行时按 CPUID 选择。
+ */
+namespace CursorComposite {
+
+enum class Isa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+inline const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+/**
+ * @brief 一组行内核
+ *
+ * monochromeRow 的 andBits / xorBits 指向掩码行的起始字节，bit 是该行中第一个像素的位序号（高位在前）。
+ */
+struct Kernels
+{
+    Isa isa;
+    void (*blendRow)(const uint8_t *src, uint8_t *dst, size_t pixels);
+    void (*maskedColorRow)(const uint8_t *src, uint8_t *dst, size_t pixels);
+    void (*monochromeRow)(const uint8_t *andBits, const uint8_t *xorBits, size_t bit, uint8_t *dst, size_t pixels);
+};
+
+namespace detail {
+
+constexpr uint32_t kAlpha = 0xFF000000u;
+constexpr uint32_t kRgb = 0x00FFFFFFu;
+
+// ==================== 标量实现 ====================
+
+inline uint32_t load32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16
+           | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+// round((s * a + d * (255 - a)) / 255)
+inline uint8_t blendChannel(uint32_t s, uint32_t d, uint32_t a)
+{
+    uint32_t t = s * a + d * (255 - a) + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+inline void blendRowScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, src += 4, dst += 4) {
+        uint32_t a = src[3];
+        if (a == 0) {
+            continue;
+        }
+        dst[0] = blendChannel(src[0], dst[0], a);
+        dst[1] = blendChannel(src[1], dst[1], a);
+        dst[2] = blendChannel(src[2], dst[2], a);
+    }
+}
+
+inline void maskedColorRowScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, src += 4, dst += 4) {
+        uint32_t s = load32(src);
+        uint32_t d = load32(dst);
+        uint32_t rgb = (s & kAlpha) == kAlpha ? (d ^ s) : s;
+        store32(dst, (rgb & kRgb) | (d & kAlpha));
+    }
+}
+
+inline bool testBit(const uint8_t *bits, size_t bit)
+{
+    return bits[bit >> 3] & (0x80 >> (bit & 7));
+}
+
+inline void monochromeRowScalar(const uint8_t *andBits, const uint8_t *xorBits, size_t bit, uint8_t *dst,
+                                size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, ++bit, dst += 4) {
+        uint32_t d = load32(dst);
+        uint32_t andMask = testBit(andBits, bit) ? 0xFFFFFFFFu : kAlpha;
+        uint32_t xorMask = testBit(xorBits, bit) ? kRgb : 0;
+        store32(dst, (d & andMask) ^ xorMask);
+    }
+}
+
+// 从 bit 开始取 n（<= 8）位，高位在前；只读取实际覆盖到的字节
+inline uint32_t extractBits(const uint8_t *bits, size_t bit, unsigned n)
+{
+    size_t byte = bit >> 3;
+    unsigned shift = bit & 7;
+    uint32_t value = static_cast<uint32_t>(bits[byte]) << 8;
+    if (shift + n > 8) {
+        value |= bits[byte + 1];
+    }
+    return (value >> (16 - shift - n)) & ((1u << n) - 1);
+}
+
+#ifdef CURSOR_COMPOSITE_X86
+
+// ==================== SSE2 ====================
+
+__attribute__((target("sse2"))) inline __m128i blendHalfSse2(__m128i s, __m128i d)
+{
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    __m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inv)), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse2"))) inline void blendRowSse2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(kAlpha));
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+        __m128i alpha = _mm_and_si128(s, alphaMask);
+        // 光标大部分像素完全透明
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + 4 * i));
+        __m128i lo = blendHalfSse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blendHalfSse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        __m128i result = _mm_packus_epi16(lo, hi);
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(d, alphaMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), result);
+    }
+    blendRowScalar(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("sse2"))) inline __m128i maskedColorSse2(__m128i s, __m128i d)
+{
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(kAlpha));
+    __m128i xorLanes = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask);
+    // xorLanes ? d ^ s : s  ==  s ^ (d & xorLanes)
+    __m128i rgb = _mm_xor_si128(s, _mm_and_si128(d, xorLanes));
+    return _mm_or_si128(_mm_andnot_si128(alphaMask, rgb), _mm_and_si128(d, alphaMask));
+}
+
+__attribute__((target("sse2"))) inline void maskedColorRowSse2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), maskedColorSse2(s, d));
+    }
+    maskedColorRowScalar(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+// 4 位掩码展开成 4 个 32 位通道的全 1 / 全 0
+__attribute__((target("sse2"))) inline __m128i expandBits4Sse2(uint32_t bits)
+{
+    const __m128i select = _mm_setr_epi32(8, 4, 2, 1);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), select), select);
+}
+
+__attribute__((target("sse2"))) inline void monochromeRowSse2(const uint8_t *andBits, const uint8_t *xorBits,
+                                                               size_t bit, uint8_t *dst, size_t pixels)
+{
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(kAlpha));
+    const __m128i rgbMask = _mm_set1_epi32(static_cast<int>(kRgb));
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i andMask = _mm_or_si128(expandBits4Sse2(extractBits(andBits, bit + i, 4)), alphaMask);
+        __m128i xorMask = _mm_and_si128(expandBits4Sse2(extractBits(xorBits, bit + i, 4)), rgbMask);
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_xor_si128(_mm_and_si128(d, andMask), xorMask));
+    }
+    monochromeRowScalar(andBits, xorBits, bit + i, dst + 4 * i, pixels - i);
+}
+
+// ==================== AVX2 ====================
+
+__attribute__((target("avx2"))) inline __m256i blendHalfAvx2(__m256i s, __m256i d)
+{
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    __m256i t = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, inv)),
+                                 _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2"))) inline void blendRowAvx2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(kAlpha));
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i));
+        __m256i alpha = _mm256_and_si256(s, alphaMask);
+        if (_mm256_testz_si256(alpha, alpha)) {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + 4 * i));
+        __m256i lo = blendHalfAvx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = blendHalfAvx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        __m256i result = _mm256_packus_epi16(lo, hi);
+        result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(d, alphaMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), result);
+    }
+    blendRowSse2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx2"))) inline void maskedColorRowAvx2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(kAlpha));
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + 4 * i));
+        __m256i xorLanes = _mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask), alphaMask);
+        __m256i rgb = _mm256_xor_si256(s, _mm256_and_si256(d, xorLanes));
+        __m256i result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, rgb), _mm256_and_si256(d, alphaMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), result);
+    }
+    maskedColorRowSse2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i expandBits8Avx2(uint32_t bits)
+{
+    const __m256i select = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), select), select);
+}
+
+__attribute__((target("avx2"))) inline void monochromeRowAvx2(const uint8_t *andBits, const uint8_t *xorBits,
+                                                               size_t bit, uint8_t *dst, size_t pixels)
+{
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(kAlpha));
+    const __m256i rgbMask = _mm256_set1_epi32(static_cast<int>(kRgb));
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i andMask = _mm256_or_si256(expandBits8Avx2(extractBits(andBits, bit + i, 8)), alphaMask);
+        __m256i xorMask = _mm256_and_si256(expandBits8Avx2(extractBits(xorBits, bit + i, 8)), rgbMask);
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + 4 * i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i),
+                            _mm256_xor_si256(_mm256_and_si256(d, andMask), xorMask));
+    }
+    monochromeRowSse2(andBits, xorBits, bit + i, dst + 4 * i, pixels - i);
+}
+
+#endif // CURSOR_COMPOSITE_X86
+
+// 光标矩形与帧的交集，坐标相对光标左上角
+struct Clip
+{
+    uint32_t srcX = 0, srcY = 0;
+    uint32_t dstX = 0, dstY = 0;
+    uint32_t width = 0, height = 0;
+};
+
+inline Clip clip(const PixelSurface &frame, int x, int y, uint32_t width, uint32_t height)
+{
+    Clip c;
+    int64_t left = std::max<int64_t>(x, 0);
+    int64_t top = std::max<int64_t>(y, 0);
+    int64_t right = std::min<int64_t>(static_cast<int64_t>(x) + width, frame.width);
+    int64_t bottom = std::min<int64_t>(static_cast<int64_t>(y) + height, frame.height);
+    if (right <= left || bottom <= top) {
+        return c;
+    }
+    c.srcX = static_cast<uint32_t>(left - x);
+    c.srcY = static_cast<uint32_t>(top - y);
+    c.dstX = static_cast<uint32_t>(left);
+    c.dstY = static_cast<uint32_t>(top);
+    c.width = static_cast<uint32_t>(right - left);
+    c.height = static_cast<uint32_t>(bottom - top);
+    return c;
+}
+
+} // namespace detail
+
+inline bool isaSupported(Isa isa)
+{
+#ifdef CURSOR_COMPOSITE_X86
+    switch (isa) {
+    case Isa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    default:
+        return true;
+    }
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+inline const Kernels &kernels(Isa isa)
+{
+    static const Kernels scalar{Isa::Scalar, detail::blendRowScalar, detail::maskedColorRowScalar,
+                                detail::monochromeRowScalar};
+#ifdef CURSOR_COMPOSITE_X86
+    static const Kernels sse2{Isa::SSE2, detail::blendRowSse2, detail::maskedColorRowSse2, detail::monochromeRowSse2};
+    static const Kernels avx2{Isa::AVX2, detail::blendRowAvx2, detail::maskedColorRowAvx2, detail::monochromeRowAvx2};
+    if (isa == Isa::AVX2) {
+        return avx2;
+    }
+    if (isa == Isa::SSE2) {
+        return sse2;
+    }
+#endif
+    (void)isa;
+    return scalar;
+}
+
+// 按 CPUID 选出的最优内核，首次调用时检测
+inline const Kernels &kernels()
+{
+    static const Kernels &best = isaSupported(Isa::AVX2)   ? kernels(Isa::AVX2)
+                                 : isaSupported(Isa::SSE2) ? kernels(Isa::SSE2)
+                                                           : kernels(Isa::Scalar);
+    return best;
+}
+
+/**
+ * @brief 把非预乘 ARGB32 图像按 Alpha 混合到帧上
+ * @param x, y 图像左上角在帧中的位置，即 position - hotSpot
+ */
+inline void blendImage(const PixelSurface &frame, const uint8_t *image, uint32_t width, uint32_t height, size_t stride,
+                       int x, int y, const Kernels &k = kernels())
+{
+    detail::Clip c = detail::clip(frame, x, y, width, height);
+    for (uint32_t row = 0; row < c.height; ++row) {
+        const uint8_t *src = image + static_cast<size_t>(c.srcY + row) * stride + static_cast<size_t>(c.srcX) * 4;
+        k.blendRow(src, frame.row(c.dstY + row) + static_cast<size_t>(c.dstX) * 4, c.width);
+    }
+}
+
+/**
+ * @brief 按光标类型的原始语义把光标形状画到帧上
+ * @param positionX, positionY 光标热点在帧中的位置
+ * @return 形状描述与缓冲不匹配或类型未知时返回 false，完全在帧外时返回 true
+ */
+inline bool compositeShape(const PixelSurface &frame, const CursorShapeInfo &info, const uint8_t *shape,
+                           size_t shapeSize, int positionX, int positionY, const Kernels &k = kernels())
+{
+    if (!shape || !info.valid(shapeSize)) {
+        return false;
+    }
+    int x = positionX - info.hotSpotX;
+    int y = positionY - info.hotSpotY;
+    detail::Clip c = detail::clip(frame, x, y, info.width, info.imageHeight());
+
+    for (uint32_t row = 0; row < c.height; ++row) {
+        uint8_t *dst = frame.row(c.dstY + row) + static_cast<size_t>(c.dstX) * 4;
+        const uint8_t *src = shape + static_cast<size_t>(c.srcY + row) * info.pitch;
+        switch (info.type) {
+        case CursorShapeColor:
+            k.blendRow(src + static_cast<size_t>(c.srcX) * 4, dst, c.width);
+            break;
+        case CursorShapeMaskedColor:
+            k.maskedColorRow(src + static_cast<size_t>(c.srcX) * 4, dst, c.width);
+            break;
+        case CursorShapeMonochrome: {
+            // 缓冲上半部分是 AND 掩码，下半部分是 XOR 掩码
+            const uint8_t *xorBits = src + static_cast<size_t>(info.imageHeight()) * info.pitch;
+            k.monochromeRow(src, xorBits, c.srcX, dst, c.width);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace CursorComposite
+
+#endif // CURSOR_COMPOSITE_H
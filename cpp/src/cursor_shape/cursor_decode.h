@@ -0,0 +1,450 @@
+#ifndef CURSOR_DECODE_H
+#define CURSOR_DECODE_H
+
+#include "cursor_shape.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CURSOR_DECODE_X86 1
+#endif
+
+/**
+ * @brief 把原始光标形状解码为 ARGB32 图像（内存顺序 B G R A，即 QImage::Format_ARGB32）
+ *
+ * 单色光标的解码规则与 PointerInfo::ConvertPointerShapeToQImage 原来的逐位实现相同：
+ *
+ *   AND XOR  结果
+ *    0   0   黑色 0xFF000000
+ *    0   1   白色 0xFFFFFFFF
+ *    1   0   透明 0x00000000
+ *    1   1   反色，图像中无法表达，按黑色 0xFF000000
+ *
+ * 即 Alpha = !(AND && !XOR)，RGB 为白色当且仅当 !AND && XOR。每个掩码字节先算出
+ * 这两个 8 位掩码，再一次展开 8 个像素：查表版本每次写 8 个像素，SSE2 / AVX2 版本
+ * 每次循环处理 32 个像素。运行时按 CPUID 选择，结果与逐位的标量参考实现完全一致。
+ *
+ * 带掩码的彩色光标只允许 Alpha 为 0x00 或 0xFF，转换规则：
+ *
+ *   Alpha  RGB     结果
+ *   0x00   任意    RGB 不透明显示 0xFF000000 | RGB
+ *   0xFF   0       XOR 黑色不改变屏幕，按透明 0x00000000
+ *   0xFF   非 0    反色，按黑色 0xFF000000
+ *   其他           非法像素，输出透明，并计入返回的非法像素数
+ *
+ * SIMD 版本同时算出各种情况的结果再按掩码选择，循环内没有分支；非法像素只计数，
+ * 整张图转换完后由调用方统一处理。
+ */
+namespace CursorDecode {
+
+enum class Isa {
+    Scalar, // 逐位参考实现
+    Table,  // 256 项查表，不依赖 SIMD
+    SSE2,
+    AVX2,
+};
+
+inline const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Table:
+        return "Table";
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+/**
+ * @brief 单色行内核：把一行 AND / XOR 掩码展开为 width 个 ARGB32 像素
+ */
+using MonochromeRowFn = void (*)(const uint8_t *andBits, const uint8_t *xorBits, uint32_t *dst, size_t width);
+
+/**
+ * @brief 带掩码彩色行内核：转换 width 个像素，返回非法 Alpha 的像素数。src 与 dst 可以相同
+ */
+using MaskedColorRowFn = size_t (*)(const uint32_t *src, uint32_t *dst, size_t width);
+
+namespace detail {
+
+constexpr uint32_t kAlpha = 0xFF000000u;
+constexpr uint32_t kRgb = 0x00FFFFFFu;
+
+// ==================== 标量参考实现 ====================
+
+inline uint32_t monochromePixel(bool andBit, bool xorBit)
+{
+    if (!andBit && !xorBit) {
+        return 0xFF000000; // 黑色
+    }
+    if (!andBit && xorBit) {
+        return 0xFFFFFFFF; // 白色
+    }
+    if (andBit && !xorBit) {
+        return 0x00000000; // 透明
+    }
+    return 0xFF000000; // 反色按黑色
+}
+
+// 逐位处理 [begin, width) 的像素，也用于 SIMD 版本不足 8 个像素的尾部
+inline void monochromeTail(const uint8_t *andBits, const uint8_t *xorBits, uint32_t *dst, size_t begin, size_t width)
+{
+    for (size_t col = begin; col < width; ++col) {
+        uint8_t mask = 0x80 >> (col % 8);
+        dst[col] = monochromePixel(andBits[col / 8] & mask, xorBits[col / 8] & mask);
+    }
+}
+
+inline void monochromeRowScalar(const uint8_t *andBits, const uint8_t *xorBits, uint32_t *dst, size_t width)
+{
+    monochromeTail(andBits, xorBits, dst, 0, width);
+}
+
+inline uint32_t maskedColorPixel(uint32_t pixel, bool &invalid)
+{
+    uint8_t alpha = pixel >> 24;
+    invalid = false;
+    if (alpha == 0x00) {
+        return (pixel & kRgb) | kAlpha; // 替换屏幕像素
+    }
+    if (alpha == 0xFF) {
+        return (pixel & kRgb) ? kAlpha : 0x00000000; // XOR：黑色不改变屏幕，其余按黑色
+    }
+    invalid = true;
+    return 0x00000000;
+}
+
+inline size_t maskedColorTail(const uint32_t *src, uint32_t *dst, size_t begin, size_t width)
+{
+    size_t invalid = 0;
+    for (size_t col = begin; col < width; ++col) {
+        bool bad;
+        dst[col] = maskedColorPixel(src[col], bad);
+        invalid += bad;
+    }
+    return invalid;
+}
+
+inline size_t maskedColorRowScalar(const uint32_t *src, uint32_t *dst, size_t width)
+{
+    return maskedColorTail(src, dst, 0, width);
+}
+
+// ==================== 查表 ====================
+
+// lanes[b][i] 为 b 的第 i 位（高位在前）展开的 32 位全 1 / 全 0
+struct ExpandTable
+{
+    uint32_t lanes[256][8];
+
+    ExpandTable()
+    {
+        for (int b = 0; b < 256; ++b) {
+            for (int i = 0; i < 8; ++i) {
+                lanes[b][i] = (b & (0x80 >> i)) ? 0xFFFFFFFFu : 0;
+            }
+        }
+    }
+};
+
+inline const ExpandTable &expandTable()
+{
+    static const ExpandTable table;
+    return table;
+}
+
+inline void monochromeRowTable(const uint8_t *andBits, const uint8_t *xorBits, uint32_t *dst, size_t width)
+{
+    const ExpandTable &table = expandTable();
+    size_t bytes = width / 8;
+    for (size_t i = 0; i < bytes; ++i) {
+        uint8_t a = andBits[i];
+        uint8_t x = xorBits[i];
+        const uint32_t *alpha = table.lanes[static_cast<uint8_t>(~(a & ~x))];
+        const uint32_t *white = table.lanes[static_cast<uint8_t>(~a & x)];
+        uint32_t *out = dst + 8 * i;
+        for (int j = 0; j < 8; ++j) {
+            out[j] = (alpha[j] & kAlpha) | (white[j] & kRgb);
+        }
+    }
+    monochromeTail(andBits, xorBits, dst, bytes * 8, width);
+}
+
+#ifdef CURSOR_DECODE_X86
+
+// ==================== SSE2 ====================
+
+// 把掩码字节 b 的高 4 位（high = true）或低 4 位展开为 4 个 32 位通道
+__attribute__((target("sse2"))) inline __m128i expandNibbleSse2(uint32_t b, bool high)
+{
+    const __m128i select = high ? _mm_setr_epi32(0x80, 0x40, 0x20, 0x10) : _mm_setr_epi32(8, 4, 2, 1);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(b)), select), select);
+}
+
+__attribute__((target("sse2"))) inline void expandByteSse2(uint8_t a, uint8_t x, uint32_t *out)
+{
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(kAlpha));
+    const __m128i rgbMask = _mm_set1_epi32(static_cast<int>(kRgb));
+    uint32_t alpha = static_cast<uint8_t>(~(a & ~x));
+    uint32_t white = static_cast<uint8_t>(~a & x);
+    for (int half = 0; half < 2; ++half) {
+        bool high = half == 0;
+        __m128i pixels = _mm_or_si128(_mm_and_si128(expandNibbleSse2(alpha, high), alphaMask),
+                                      _mm_and_si128(expandNibbleSse2(white, high), rgbMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * half), pixels);
+    }
+}
+
+__attribute__((target("sse2"))) inline void monochromeRowSse2(const uint8_t *andBits, const uint8_t *xorBits,
+                                                               uint32_t *dst, size_t width)
+{
+    size_t bytes = width / 8;
+    size_t i = 0;
+    for (; i + 4 <= bytes; i += 4) {
+        expandByteSse2(andBits[i], xorBits[i], dst + 8 * i);
+        expandByteSse2(andBits[i + 1], xorBits[i + 1], dst + 8 * i + 8);
+        expandByteSse2(andBits[i + 2], xorBits[i + 2], dst + 8 * i + 16);
+        expandByteSse2(andBits[i + 3], xorBits[i + 3], dst + 8 * i + 24);
+    }
+    for (; i < bytes; ++i) {
+        expandByteSse2(andBits[i], xorBits[i], dst + 8 * i);
+    }
+    monochromeTail(andBits, xorBits, dst, bytes * 8, width);
+}
+
+// 4 个像素：zero / opaque 为 Alpha 是 0x00 / 0xFF 的通道，invalid 累加非法通道（每个非法通道减 -1）
+__attribute__((target("sse2"))) inline __m128i maskedColorSse2(__m128i pixel, __m128i &invalid)
+{
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(kAlpha));
+    const __m128i rgbMask = _mm_set1_epi32(static_cast<int>(kRgb));
+    __m128i alpha = _mm_srli_epi32(pixel, 24);
+    __m128i rgb = _mm_and_si128(pixel, rgbMask);
+    __m128i zero = _mm_cmpeq_epi32(alpha, _mm_setzero_si128());
+    __m128i opaque = _mm_cmpeq_epi32(alpha, _mm_set1_epi32(0xFF));
+    __m128i black = _mm_cmpeq_epi32(rgb, _mm_setzero_si128());
+    __m128i replaced = _mm_and_si128(zero, _mm_or_si128(rgb, alphaMask));
+    __m128i xored = _mm_and_si128(opaque, _mm_andnot_si128(black, alphaMask));
+    invalid = _mm_sub_epi32(invalid, _mm_cmpeq_epi32(_mm_or_si128(zero, opaque), _mm_setzero_si128()));
+    return _mm_or_si128(replaced, xored);
+}
+
+__attribute__((target("sse2"))) inline size_t horizontalSumSse2(__m128i v)
+{
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("sse2"))) inline size_t maskedColorRowSse2(const uint32_t *src, uint32_t *dst, size_t width)
+{
+    __m128i invalid = _mm_setzero_si128();
+    size_t col = 0;
+    for (; col + 8 <= width; col += 8) {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + col));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + col + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + col), maskedColorSse2(p0, invalid));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + col + 4), maskedColorSse2(p1, invalid));
+    }
+    for (; col + 4 <= width; col += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + col));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + col), maskedColorSse2(p, invalid));
+    }
+    return horizontalSumSse2(invalid) + maskedColorTail(src, dst, col, width);
+}
+
+// ==================== AVX2 ====================
+
+__attribute__((target("avx2"))) inline __m256i expandByteAvx2(uint32_t b)
+{
+    const __m256i select = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(b)), select), select);
+}
+
+__attribute__((target("avx2"))) inline void monochromeRowAvx2(const uint8_t *andBits, const uint8_t *xorBits,
+                                                               uint32_t *dst, size_t width)
+{
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(kAlpha));
+    const __m256i rgbMask = _mm256_set1_epi32(static_cast<int>(kRgb));
+    size_t bytes = width / 8;
+    size_t i = 0;
+    // 每次 32 个像素：一次读取 4 个掩码字节，按字节的位运算同时算出 4 组 Alpha / 白色掩码
+    for (; i + 4 <= bytes; i += 4) {
+        uint32_t a, x;
+        std::memcpy(&a, andBits + i, 4);
+        std::memcpy(&x, xorBits + i, 4);
+        uint32_t alpha = ~(a & ~x);
+        uint32_t white = ~a & x;
+        for (int j = 0; j < 4; ++j) {
+            __m256i pixels = _mm256_or_si256(_mm256_and_si256(expandByteAvx2((alpha >> (8 * j)) & 0xFF), alphaMask),
+                                             _mm256_and_si256(expandByteAvx2((white >> (8 * j)) & 0xFF), rgbMask));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 8 * (i + j)), pixels);
+        }
+    }
+    for (; i < bytes; ++i) {
+        uint32_t alpha = static_cast<uint8_t>(~(andBits[i] & ~xorBits[i]));
+        uint32_t white = static_cast<uint8_t>(~andBits[i] & xorBits[i]);
+        __m256i pixels = _mm256_or_si256(_mm256_and_si256(expandByteAvx2(alpha), alphaMask),
+                                         _mm256_and_si256(expandByteAvx2(white), rgbMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 8 * i), pixels);
+    }
+    monochromeTail(andBits, xorBits, dst, bytes * 8, width);
+}
+
+__attribute__((target("avx2"))) inline __m256i maskedColorAvx2(__m256i pixel, __m256i &invalid)
+{
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(kAlpha));
+    const __m256i rgbMask = _mm256_set1_epi32(static_cast<int>(kRgb));
+    __m256i alpha = _mm256_srli_epi32(pixel, 24);
+    __m256i rgb = _mm256_and_si256(pixel, rgbMask);
+    __m256i zero = _mm256_cmpeq_epi32(alpha, _mm256_setzero_si256());
+    __m256i opaque = _mm256_cmpeq_epi32(alpha, _mm256_set1_epi32(0xFF));
+    __m256i black = _mm256_cmpeq_epi32(rgb, _mm256_setzero_si256());
+    __m256i replaced = _mm256_and_si256(zero, _mm256_or_si256(rgb, alphaMask));
+    __m256i xored = _mm256_and_si256(opaque, _mm256_andnot_si256(black, alphaMask));
+    invalid = _mm256_sub_epi32(invalid, _mm256_cmpeq_epi32(_mm256_or_si256(zero, opaque), _mm256_setzero_si256()));
+    return _mm256_or_si256(replaced, xored);
+}
+
+__attribute__((target("avx2"))) inline size_t maskedColorRowAvx2(const uint32_t *src, uint32_t *dst, size_t width)
+{
+    __m256i invalid = _mm256_setzero_si256();
+    size_t col = 0;
+    for (; col + 16 <= width; col += 16) {
+        __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + col));
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + col + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + col), maskedColorAvx2(p0, invalid));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + col + 8), maskedColorAvx2(p1, invalid));
+    }
+    for (; col + 8 <= width; col += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + col));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + col), maskedColorAvx2(p, invalid));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(invalid), _mm256_extracti128_si256(invalid, 1));
+    return horizontalSumSse2(sum) + maskedColorTail(src, dst, col, width);
+}
+
+#endif // CURSOR_DECODE_X86
+
+} // namespace detail
+
+inline bool isaSupported(Isa isa)
+{
+#ifdef CURSOR_DECODE_X86
+    switch (isa) {
+    case Isa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    default:
+        return true;
+    }
+#else
+    return isa == Isa::Scalar || isa == Isa::Table;
+#endif
+}
+
+inline MonochromeRowFn monochromeRow(Isa isa)
+{
+    switch (isa) {
+    case Isa::Table:
+        return detail::monochromeRowTable;
+#ifdef CURSOR_DECODE_X86
+    case Isa::SSE2:
+        return detail::monochromeRowSse2;
+    case Isa::AVX2:
+        return detail::monochromeRowAvx2;
+#endif
+    default:
+        return detail::monochromeRowScalar;
+    }
+}
+
+// 按 CPUID 选出的最优行内核，首次调用时检测
+inline MonochromeRowFn monochromeRow()
+{
+    static const MonochromeRowFn best = isaSupported(Isa::AVX2)   ? monochromeRow(Isa::AVX2)
+                                        : isaSupported(Isa::SSE2) ? monochromeRow(Isa::SSE2)
+                                                                  : monochromeRow(Isa::Table);
+    return best;
+}
+
+// 带掩码彩色光标没有查表版本，Isa::Table 使用标量实现
+inline MaskedColorRowFn maskedColorRow(Isa isa)
+{
+    switch (isa) {
+#ifdef CURSOR_DECODE_X86
+    case Isa::SSE2:
+        return detail::maskedColorRowSse2;
+    case Isa::AVX2:
+        return detail::maskedColorRowAvx2;
+#endif
+    default:
+        return detail::maskedColorRowScalar;
+    }
+}
+
+inline MaskedColorRowFn maskedColorRow()
+{
+    static const MaskedColorRowFn best = isaSupported(Isa::AVX2)   ? maskedColorRow(Isa::AVX2)
+                                         : isaSupported(Isa::SSE2) ? maskedColorRow(Isa::SSE2)
+                                                                   : maskedColorRow(Isa::Scalar);
+    return best;
+}
+
+/**
+ * @brief 把单色光标解码为 ARGB32 图像
+ * @param info 形状描述，height 是缓冲行数（实际高度的两倍）
+ * @param shape 原始缓冲：上半部分 AND 掩码，下半部分 XOR 掩码
+ * @param dst 输出图像，至少 info.imageHeight() 行，每行 dstStride 字节，按 4 字节对齐
+ * @return 形状描述与缓冲不匹配时返回 false
+ */
+inline bool decodeMonochrome(const CursorShapeInfo &info, const uint8_t *shape, size_t shapeSize, uint8_t *dst,
+                             size_t dstStride, MonochromeRowFn row = monochromeRow())
+{
+    if (info.type != CursorShapeMonochrome || !shape || !dst || !info.valid(shapeSize)) {
+        return false;
+    }
+    uint32_t realHeight = info.imageHeight();
+    for (uint32_t y = 0; y < realHeight; ++y) {
+        const uint8_t *andBits = shape + static_cast<size_t>(y) * info.pitch;
+        const uint8_t *xorBits = shape + static_cast<size_t>(realHeight + y) * info.pitch;
+        row(andBits, xorBits, reinterpret_cast<uint32_t *>(dst + static_cast<size_t>(y) * dstStride), info.width);
+    }
+    return true;
+}
+
+/**
+ * @brief 把带掩码的彩色光标转换为 ARGB32 图像
+ * @param dst 输出图像，至少 info.height 行，每行 dstStride 字节；可以与 shape 是同一块缓冲（原地转换）
+ * @param invalidPixels 非空时写入 Alpha 既不是 0x00 也不是 0xFF 的像素数，这些像素输出为透明
+ * @return 形状描述与缓冲不匹配，或存在非法像素时返回 false；后一种情况下整张图仍已转换
+ */
+inline bool decodeMaskedColor(const CursorShapeInfo &info, const uint8_t *shape, size_t shapeSize, uint8_t *dst,
+                              size_t dstStride, size_t *invalidPixels = nullptr,
+                              MaskedColorRowFn row = maskedColorRow())
+{
+    if (invalidPixels) {
+        *invalidPixels = 0;
+    }
+    if (info.type != CursorShapeMaskedColor || !shape || !dst || !info.valid(shapeSize)) {
+        return false;
+    }
+    size_t invalid = 0;
+    for (uint32_t y = 0; y < info.height; ++y) {
+        invalid += row(reinterpret_cast<const uint32_t *>(shape + static_cast<size_t>(y) * info.pitch),
+                       reinterpret_cast<uint32_t *>(dst + static_cast<size_t>(y) * dstStride), info.width);
+    }
+    if (invalidPixels) {
+        *invalidPixels = invalid;
+    }
+    return invalid == 0;
+}
+
+} // namespace CursorDecode
+
+#endif // CURSOR_DECODE_H
@@ -0,0 +1,604 @@
+#ifndef CURSOR_ENCODE_H
+#define CURSOR_ENCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CURSOR_ENCODE_X86 1
+#endif
+
+/**
+ * @brief 光标图像的快速编码，替代 QImage::save("PNG")
+ *
+ * 光标最大只有 256x256，完整的 zlib 压缩（以及 Qt 的滤波器选择）对它来说太慢。这里提供三种
+ * 可选的 cursorData 格式，用几 KB 的体积换更低的编码延迟：
+ *
+ * - Raw：32 字节的 RawHeader（尺寸、热点、像素格式）后跟紧密排列的 ARGB32 像素，几乎只是一次复制
+ * - Qoi：QOI 格式（https://qoiformat.org），无损，单遍编码，通常比原始数据小很多
+ * - StoredPng：标准 PNG，IDAT 使用不压缩的 deflate 存储块，任何 PNG 解码器都能读取，
+ *   编码只需复制像素并计算 Adler-32 和 CRC-32
+ *
+ * StoredPng 的开销主要是两个校验和：支持时 CRC-32 用 PCLMULQDQ 折叠计算，Adler-32 用 AVX2，
+ * 否则回退到 slice-by-8 查表和标量循环。
+ *
+ * 输入是 ARGB32（内存顺序 B G R A，即 QImage::Format_ARGB32，非预乘）。编码器写入调用方提供的
+ * 缓冲，大小由 maxEncodedSize() 给出，返回实际写入的字节数，失败时返回 0。
+ */
+namespace CursorEncode {
+
+enum class Encoding : uint32_t {
+    Raw = 1,
+    Qoi = 2,
+    StoredPng = 3,
+};
+
+inline const char *encodingName(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Raw:
+        return "Raw";
+    case Encoding::Qoi:
+        return "QOI";
+    case Encoding::StoredPng:
+        return "StoredPng";
+    default:
+        return "Unknown";
+    }
+}
+
+/**
+ * @brief 待编码的图像，data 指向第一行，每行 stride 字节
+ */
+struct Image
+{
+    const uint8_t *data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+
+    const uint8_t *row(uint32_t y) const { return data + static_cast<size_t>(y) * stride; }
+};
+
+/**
+ * @brief Raw 编码的头部，所有字段小端
+ */
+struct RawHeader
+{
+    static constexpr uint32_t kMagic = 0x41525543; // "CURA"
+    static constexpr uint16_t kVersion = 1;
+    static constexpr uint32_t kFormatArgb32 = 1; // 内存顺序 B G R A，非预乘
+
+    uint32_t magic = kMagic;
+    uint16_t version = kVersion;
+    uint16_t headerSize = sizeof(RawHeader);
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    uint32_t format = kFormatArgb32;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(RawHeader) == 32, "RawHeader must stay 32 bytes");
+
+// PNG 每行 1 字节滤波类型，整行必须放进一个存储块
+constexpr uint32_t kMaxPngWidth = (65535 - 1) / 4;
+
+namespace detail {
+
+// ==================== 校验和 ====================
+
+// CRC-32（PNG / zlib 使用的多项式 0xEDB88320），slice-by-8 查表
+struct CrcTable
+{
+    uint32_t table[8][256];
+
+    CrcTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+inline const CrcTable &crcTable()
+{
+    static const CrcTable table;
+    return table;
+}
+
+inline uint32_t loadLe32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16
+           | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline void storeBe32(uint8_t *p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+inline uint32_t loadBe32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8
+           | static_cast<uint32_t>(p[3]);
+}
+
+inline uint32_t crc32Table(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const auto &t = crcTable().table;
+    crc = ~crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint32_t lo = loadLe32(data) ^ crc;
+        uint32_t hi = loadLe32(data + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^ t[3][hi & 0xFF]
+              ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; size > 0; ++data, --size) {
+        crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// 5552 是保证 32 位累加不溢出的最大块长度
+constexpr size_t kAdlerBlock = 5552;
+constexpr uint32_t kAdlerMod = 65521;
+
+inline uint32_t adler32Scalar(uint32_t adler, const uint8_t *data, size_t size)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        size_t n = size < kAdlerBlock ? size : kAdlerBlock;
+        size -= n;
+        for (; n > 0; --n) {
+            a += *data++;
+            b += a;
+        }
+        a %= kAdlerMod;
+        b %= kAdlerMod;
+    }
+    return b << 16 | a;
+}
+
+#ifdef CURSOR_ENCODE_X86
+
+__attribute__((target("sse2"))) inline __m128i load128(const uint8_t *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// 把 x 向前折叠 128 位（k 为对应距离的常数对）后与 next 合并
+__attribute__((target("pclmul,sse4.1"))) inline __m128i crc32FoldStep(__m128i x, __m128i k, __m128i next)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+}
+
+/**
+ * PCLMULQDQ 折叠计算 CRC-32（Intel《Fast CRC Computation for Generic Polynomials Using PCLMULQDQ》），
+ * 4 路并行每次折叠 64 字节，再折叠到 128 位，最后 Barrett 约减。size 必须是 16 的倍数且至少 64，
+ * crc 为取反后的中间值
+ */
+__attribute__((target("pclmul,sse4.1"))) inline uint32_t crc32Fold(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163CD6124);
+    const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+    const __m128i low32 = _mm_setr_epi32(-1, 0, -1, 0);
+
+    __m128i x1 = _mm_xor_si128(load128(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = load128(data + 16);
+    __m128i x3 = load128(data + 32);
+    __m128i x4 = load128(data + 48);
+    data += 64;
+    size -= 64;
+    for (; size >= 64; data += 64, size -= 64) {
+        x1 = crc32FoldStep(x1, k1k2, load128(data));
+        x2 = crc32FoldStep(x2, k1k2, load128(data + 16));
+        x3 = crc32FoldStep(x3, k1k2, load128(data + 32));
+        x4 = crc32FoldStep(x4, k1k2, load128(data + 48));
+    }
+    x1 = crc32FoldStep(x1, k3k4, x2);
+    x1 = crc32FoldStep(x1, k3k4, x3);
+    x1 = crc32FoldStep(x1, k3k4, x4);
+    for (; size >= 16; data += 16, size -= 16) {
+        x1 = crc32FoldStep(x1, k3k4, load128(data));
+    }
+
+    // 128 位折叠到 64 位
+    __m128i x = _mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x10), _mm_srli_si128(x1, 8));
+    x = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x, low32), k5, 0x00), _mm_srli_si128(x, 4));
+    // Barrett 约减到 32 位
+    __m128i t = _mm_clmulepi64_si128(_mm_and_si128(x, low32), poly, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, low32), poly, 0x00);
+    return static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x, t), 1));
+}
+
+/**
+ * AVX2 计算 Adler-32：每 32 字节 a 加上字节和（SAD），b 加上按 32..1 加权的字节和，
+ * 再加上块开始时 a 的 32 倍（累计到 prefix，最后左移 5 位）
+ */
+__attribute__((target("avx2"))) inline uint32_t adler32Avx2(uint32_t adler, const uint8_t *data, size_t size)
+{
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15,
+                                             14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i ones = _mm256_set1_epi16(1);
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size >= 32) {
+        size_t blocks = size / 32 < kAdlerBlock / 32 ? size / 32 : kAdlerBlock / 32;
+        size -= blocks * 32;
+        uint64_t bb = b + static_cast<uint64_t>(a) * 32 * blocks;
+        __m256i sum = _mm256_setzero_si256();
+        __m256i weighted = _mm256_setzero_si256();
+        __m256i prefix = _mm256_setzero_si256();
+        for (size_t i = 0; i < blocks; ++i, data += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+            prefix = _mm256_add_epi32(prefix, sum);
+            sum = _mm256_add_epi32(sum, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+            weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+        }
+        alignas(32) uint32_t lanes[3][8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[0]), sum);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[1]), weighted);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[2]), prefix);
+        uint64_t aa = a;
+        for (int i = 0; i < 8; ++i) {
+            aa += lanes[0][i];
+            bb += lanes[1][i] + (static_cast<uint64_t>(lanes[2][i]) << 5);
+        }
+        a = static_cast<uint32_t>(aa % kAdlerMod);
+        b = static_cast<uint32_t>(bb % kAdlerMod);
+    }
+    return adler32Scalar(b << 16 | a, data, size);
+}
+
+#endif // CURSOR_ENCODE_X86
+
+} // namespace detail
+
+/**
+ * @brief 增量计算 CRC-32，初始值为 0
+ */
+inline uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+#ifdef CURSOR_ENCODE_X86
+    static const bool folding = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    if (folding && size >= 64) {
+        size_t head = size & ~static_cast<size_t>(15);
+        crc = ~detail::crc32Fold(~crc, data, head);
+        return detail::crc32Table(crc, data + head, size - head);
+    }
+#endif
+    return detail::crc32Table(crc, data, size);
+}
+
+/**
+ * @brief 增量计算 Adler-32，初始值为 1
+ */
+inline uint32_t adler32(uint32_t adler, const uint8_t *data, size_t size)
+{
+#ifdef CURSOR_ENCODE_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        return detail::adler32Avx2(adler, data, size);
+    }
+#endif
+    return detail::adler32Scalar(adler, data, size);
+}
+
+// ==================== 编码器 ====================
+
+/**
+ * @brief 编码 width x height 图像所需的最大缓冲字节数，不支持的尺寸返回 0
+ */
+inline size_t maxEncodedSize(Encoding encoding, uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0) {
+        return 0;
+    }
+    size_t pixels = static_cast<size_t>(width) * height;
+    switch (encoding) {
+    case Encoding::Raw:
+        return sizeof(RawHeader) + pixels * 4;
+    case Encoding::Qoi:
+        return 14 + pixels * 5 + 8; // 最坏情况每个像素一个 QOI_OP_RGBA
+    case Encoding::StoredPng: {
+        if (width > kMaxPngWidth) {
+            return 0;
+        }
+        size_t rowBytes = 1 + static_cast<size_t>(width) * 4;
+        size_t rowsPerBlock = 65535 / rowBytes;
+        size_t blocks = (height + rowsPerBlock - 1) / rowsPerBlock;
+        size_t idat = 2 + blocks * 5 + rowBytes * height + 4;
+        return 8 + (12 + 13) + (12 + idat) + 12;
+    }
+    default:
+        return 0;
+    }
+}
+
+inline size_t encodeRaw(const Image &image, uint8_t *out, size_t capacity)
+{
+    size_t required = maxEncodedSize(Encoding::Raw, image.width, image.height);
+    if (!image.data || required == 0 || capacity < required) {
+        return 0;
+    }
+    RawHeader header;
+    header.width = image.width;
+    header.height = image.height;
+    header.hotSpotX = image.hotSpotX;
+    header.hotSpotY = image.hotSpotY;
+    std::memcpy(out, &header, sizeof(header));
+    size_t rowBytes = static_cast<size_t>(image.width) * 4;
+    uint8_t *dst = out + sizeof(header);
+    if (image.stride == rowBytes) {
+        std::memcpy(dst, image.data, rowBytes * image.height);
+    } else {
+        for (uint32_t y = 0; y < image.height; ++y) {
+            std::memcpy(dst + y * rowBytes, image.row(y), rowBytes);
+        }
+    }
+    return required;
+}
+
+/**
+ * @brief QOI 编码，4 通道 sRGB；QOI 的像素顺序是 R G B A，编码时交换 B / R
+ */
+inline size_t encodeQoi(const Image &image, uint8_t *out, size_t capacity)
+{
+    if (!image.data || capacity < maxEncodedSize(Encoding::Qoi, image.width, image.height)) {
+        return 0;
+    }
+    std::memcpy(out, "qoif", 4);
+    detail::storeBe32(out + 4, image.width);
+    detail::storeBe32(out + 8, image.height);
+    out[12] = 4; // channels
+    out[13] = 0; // sRGB
+    uint8_t *p = out + 14;
+
+    uint32_t index[64] = {};
+    uint32_t previous = 0xFF000000; // QOI 的初始像素 r=g=b=0, a=255，这里按 A R G B 打包
+    int run = 0;
+    for (uint32_t y = 0; y < image.height; ++y) {
+        const uint8_t *src = image.row(y);
+        for (uint32_t x = 0; x < image.width; ++x, src += 4) {
+            uint32_t px;
+            std::memcpy(&px, src, 4);
+            if (px == previous) {
+                if (++run == 62) {
+                    *p++ = static_cast<uint8_t>(0xC0 | (run - 1)); // QOI_OP_RUN
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                *p++ = static_cast<uint8_t>(0xC0 | (run - 1));
+                run = 0;
+            }
+            uint8_t b = src[0], g = src[1], r = src[2], a = src[3];
+            uint32_t slot = (r * 3u + g * 5u + b * 7u + a * 11u) % 64;
+            if (index[slot] == px) {
+                *p++ = static_cast<uint8_t>(slot); // QOI_OP_INDEX
+            } else {
+                index[slot] = px;
+                uint8_t pb = static_cast<uint8_t>(previous), pg = static_cast<uint8_t>(previous >> 8),
+                        pr = static_cast<uint8_t>(previous >> 16), pa = static_cast<uint8_t>(previous >> 24);
+                if (a == pa) {
+                    int8_t dr = static_cast<int8_t>(r - pr);
+                    int8_t dg = static_cast<int8_t>(g - pg);
+                    int8_t db = static_cast<int8_t>(b - pb);
+                    int8_t drdg = static_cast<int8_t>(dr - dg);
+                    int8_t dbdg = static_cast<int8_t>(db - dg);
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                        *p++ = static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)); // QOI_OP_DIFF
+                    } else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7) {
+                        *p++ = static_cast<uint8_t>(0x80 | (dg + 32)); // QOI_OP_LUMA
+                        *p++ = static_cast<uint8_t>((drdg + 8) << 4 | (dbdg + 8));
+                    } else {
+                        p[0] = 0xFE; // QOI_OP_RGB
+                        p[1] = r;
+                        p[2] = g;
+                        p[3] = b;
+                        p += 4;
+                    }
+                } else {
+                    p[0] = 0xFF; // QOI_OP_RGBA
+                    p[1] = r;
+                    p[2] = g;
+                    p[3] = b;
+                    p[4] = a;
+                    p += 5;
+                }
+            }
+            previous = px;
+        }
+    }
+    if (run > 0) {
+        *p++ = static_cast<uint8_t>(0xC0 | (run - 1));
+    }
+    static const uint8_t kEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    std::memcpy(p, kEnd, 8);
+    return static_cast<size_t>(p + 8 - out);
+}
+
+/**
+ * @brief PNG 编码（8 位 RGBA，无滤波，deflate 存储块），每个存储块放整数行
+ */
+inline size_t encodeStoredPng(const Image &image, uint8_t *out, size_t capacity)
+{
+    size_t required = maxEncodedSize(Encoding::StoredPng, image.width, image.height);
+    if (!image.data || required == 0 || capacity < required) {
+        return 0;
+    }
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t *p = out;
+    std::memcpy(p, kSignature, 8);
+    p += 8;
+
+    auto writeChunk = [&p](const char *type, size_t length, auto &&fill) {
+        detail::storeBe32(p, static_cast<uint32_t>(length));
+        std::memcpy(p + 4, type, 4);
+        fill(p + 8);
+        detail::storeBe32(p + 8 + length, crc32(0, p + 4, length + 4));
+        p += 12 + length;
+    };
+
+    writeChunk("IHDR", 13, [&](uint8_t *d) {
+        detail::storeBe32(d, image.width);
+        detail::storeBe32(d + 4, image.height);
+        d[8] = 8;  // 位深
+        d[9] = 6;  // RGBA
+        d[10] = 0; // deflate
+        d[11] = 0; // 自适应滤波
+        d[12] = 0; // 无隔行
+    });
+
+    size_t rowBytes = 1 + static_cast<size_t>(image.width) * 4;
+    uint32_t rowsPerBlock = static_cast<uint32_t>(65535 / rowBytes);
+    size_t idatLength = required - 8 - 25 - 12 - 12;
+    writeChunk("IDAT", idatLength, [&](uint8_t *d) {
+        d[0] = 0x78; // zlib 头：deflate，32K 窗口，最快压缩级别
+        d[1] = 0x01;
+        d += 2;
+        uint32_t adler = 1;
+        for (uint32_t y = 0; y < image.height; y += rowsPerBlock) {
+            uint32_t rows = image.height - y < rowsPerBlock ? image.height - y : rowsPerBlock;
+            uint16_t length = static_cast<uint16_t>(rows * rowBytes);
+            d[0] = y + rows == image.height ? 1 : 0; // BFINAL，BTYPE = 00 存储
+            d[1] = static_cast<uint8_t>(length);
+            d[2] = static_cast<uint8_t>(length >> 8);
+            d[3] = static_cast<uint8_t>(~length);
+            d[4] = static_cast<uint8_t>(~length >> 8);
+            d += 5;
+            for (uint32_t r = 0; r < rows; ++r) {
+                const uint8_t *src = image.row(y + r);
+                uint8_t *line = d;
+                *d++ = 0; // 滤波类型 None
+                for (uint32_t x = 0; x < image.width; ++x, src += 4, d += 4) {
+                    d[0] = src[2];
+                    d[1] = src[1];
+                    d[2] = src[0];
+                    d[3] = src[3];
+                }
+                adler = adler32(adler, line, rowBytes);
+            }
+        }
+        detail::storeBe32(d, adler);
+    });
+
+    writeChunk("IEND", 0, [](uint8_t *) {});
+    return static_cast<size_t>(p - out);
+}
+
+inline size_t encode(Encoding encoding, const Image &image, uint8_t *out, size_t capacity)
+{
+    switch (encoding) {
+    case Encoding::Raw:
+        return encodeRaw(image, out, capacity);
+    case Encoding::Qoi:
+        return encodeQoi(image, out, capacity);
+    case Encoding::StoredPng:
+        return encodeStoredPng(image, out, capacity);
+    default:
+        return 0;
+    }
+}
+
+// 编码到 vector，结果大小即为编码长度；失败时清空
+inline bool encode(Encoding encoding, const Image &image, std::vector<uint8_t> &out)
+{
+    out.resize(maxEncodedSize(encoding, image.width, image.height));
+    out.resize(out.empty() ? 0 : encode(encoding, image, out.data(), out.size()));
+    return !out.empty();
+}
+
+// ==================== 解码器 ====================
+
+/**
+ * @brief 解码 QOI 为 ARGB32（内存顺序 B G R A），供接收端和测试使用
+ */
+inline bool decodeQoi(const uint8_t *data, size_t size, std::vector<uint8_t> &pixels, uint32_t &width,
+                      uint32_t &height)
+{
+    if (size < 14 + 8 || std::memcmp(data, "qoif", 4) != 0) {
+        return false;
+    }
+    width = detail::loadBe32(data + 4);
+    height = detail::loadBe32(data + 8);
+    size_t count = static_cast<size_t>(width) * height;
+    if (width == 0 || height == 0 || count > (size - 14) * 62) {
+        return false;
+    }
+    pixels.resize(count * 4);
+
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = {0, 0, 0, 255}; // R G B A
+    const uint8_t *p = data + 14;
+    const uint8_t *end = data + size - 8;
+    int run = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (run > 0) {
+            --run;
+        } else {
+            if (p >= end) {
+                return false;
+            }
+            uint8_t op = *p++;
+            if (op == 0xFE || op == 0xFF) {
+                size_t n = op == 0xFE ? 3 : 4;
+                if (static_cast<size_t>(end - p) < n) {
+                    return false;
+                }
+                std::memcpy(px, p, n);
+                p += n;
+            } else if ((op & 0xC0) == 0x00) {
+                std::memcpy(px, index[op], 4);
+            } else if ((op & 0xC0) == 0x40) {
+                px[0] = static_cast<uint8_t>(px[0] + ((op >> 4) & 3) - 2);
+                px[1] = static_cast<uint8_t>(px[1] + ((op >> 2) & 3) - 2);
+                px[2] = static_cast<uint8_t>(px[2] + (op & 3) - 2);
+            } else if ((op & 0xC0) == 0x80) {
+                if (p >= end) {
+                    return false;
+                }
+                int dg = (op & 0x3F) - 32;
+                uint8_t next = *p++;
+                px[0] = static_cast<uint8_t>(px[0] + dg - 8 + (next >> 4));
+                px[1] = static_cast<uint8_t>(px[1] + dg);
+                px[2] = static_cast<uint8_t>(px[2] + dg - 8 + (next & 0x0F));
+            } else {
+                run = op & 0x3F;
+            }
+            std::memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+        uint8_t *dst = pixels.data() + i * 4;
+        dst[0] = px[2];
+        dst[1] = px[1];
+        dst[2] = px[0];
+        dst[3] = px[3];
+    }
+    return true;
+}
+
+} // namespace CursorEncode
+
+#endif // CURSOR_ENCODE_H
@@ -0,0 +1,203 @@
+#ifndef CURSOR_RECORDING_H
+#define CURSOR_RECORDING_H
+
+#include "cursor_shape.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief 光标事件录制格式，记录 getPointerInfo 每次看到的内容，供 Linux 上回放和基准测试
+ *
+ * 文件布局（小端）：
+ *
+ *   RecordingHeader
+ *   EventRecord + shapeSize 字节的形状数据（没有新形状时 shapeSize = 0）
+ *   EventRecord + ...
+ *
+ * 每条记录以自身长度开头，读取时可以跳过未知的扩展字段。形状只在 DXGI 报告形状更新时写入，
+ * 与 PointerShapeBufferSize 非 0 的语义一致，因此移动光标的记录只有 56 字节。
+ * 录制中途崩溃留下的不完整尾记录在读取时被忽略。
+ */
+namespace CursorRecording {
+
+struct RecordingHeader
+{
+    static constexpr uint32_t kMagic = 0x43455243; // "CREC"
+    static constexpr uint16_t kVersion = 1;
+
+    uint32_t magic = kMagic;
+    uint16_t version = kVersion;
+    uint16_t headerSize = sizeof(RecordingHeader);
+    uint64_t ticksPerSecond = 0; // 时间戳的频率（Windows 上是 QueryPerformanceFrequency）
+    uint64_t reserved = 0;
+};
+static_assert(sizeof(RecordingHeader) == 24, "RecordingHeader must stay 24 bytes");
+
+enum EventFlags : uint32_t {
+    EventVisible = 1,
+    EventHasShape = 2,
+};
+
+/**
+ * @brief 一次指针更新，字段对应 DXGI_OUTDUPL_FRAME_INFO / DXGI_OUTDUPL_POINTER_SHAPE_INFO
+ */
+struct EventRecord
+{
+    uint32_t recordSize = sizeof(EventRecord); // 本条记录的总长度，包括形状数据
+    uint32_t flags = 0;
+    int64_t timestamp = 0; // LastMouseUpdateTime
+    int32_t x = 0;         // 光标位置（物理坐标）
+    int32_t y = 0;
+    int32_t displayIndex = -1;
+    uint32_t shapeType = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pitch = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    uint32_t shapeSize = 0;
+
+    bool visible() const { return flags & EventVisible; }
+    bool hasShape() const { return flags & EventHasShape; }
+
+    CursorShapeInfo shapeInfo() const
+    {
+        CursorShapeInfo info;
+        info.type = shapeType;
+        info.width = width;
+        info.height = height;
+        info.pitch = pitch;
+        info.hotSpotX = hotSpotX;
+        info.hotSpotY = hotSpotY;
+        return info;
+    }
+
+    void setShapeInfo(const CursorShapeInfo &info)
+    {
+        shapeType = info.type;
+        width = info.width;
+        height = info.height;
+        pitch = info.pitch;
+        hotSpotX = info.hotSpotX;
+        hotSpotY = info.hotSpotY;
+    }
+};
+static_assert(sizeof(EventRecord) == 56, "EventRecord must stay 56 bytes");
+
+/**
+ * @brief 读回内存中的事件
+ */
+struct CursorEvent
+{
+    EventRecord record;
+    std::vector<uint8_t> shape;
+};
+
+/**
+ * @brief 录制写入器，单线程使用
+ */
+class Writer
+{
+public:
+    Writer() = default;
+    ~Writer() { close(); }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    bool open(const char *path, uint64_t ticksPerSecond)
+    {
+        close();
+        m_file = std::fopen(path, "wb");
+        if (!m_file) {
+            return false;
+        }
+        RecordingHeader header;
+        header.ticksPerSecond = ticksPerSecond;
+        if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+            close();
+            return false;
+        }
+        m_events = 0;
+        m_bytes = sizeof(header);
+        return true;
+    }
+
+    /**
+     * @brief 追加一条记录；shape 非空时设置 EventHasShape，recordSize 和 shapeSize 由这里填写
+     */
+    bool write(EventRecord record, const uint8_t *shape, size_t shapeSize)
+    {
+        if (!m_file) {
+            return false;
+        }
+        record.shapeSize = shape ? static_cast<uint32_t>(shapeSize) : 0;
+        record.recordSize = static_cast<uint32_t>(sizeof(EventRecord) + record.shapeSize);
+        record.flags = shape ? (record.flags | EventHasShape) : (record.flags & ~EventHasShape);
+        if (std::fwrite(&record, sizeof(record), 1, m_file) != 1
+            || (record.shapeSize && std::fwrite(shape, record.shapeSize, 1, m_file) != 1)) {
+            return false;
+        }
+        ++m_events;
+        m_bytes += record.recordSize;
+        return true;
+    }
+
+    void close()
+    {
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+    uint64_t events() const { return m_events; }
+    uint64_t bytes() const { return m_bytes; }
+
+private:
+    std::FILE *m_file = nullptr;
+    uint64_t m_events = 0;
+    uint64_t m_bytes = 0;
+};
+
+/**
+ * @brief 把整个录制读入内存，回放时不包含文件读取的开销
+ * @return 文件无法打开、头部无效或版本未知时返回 false；不完整的尾记录被忽略
+ */
+inline bool readRecording(const char *path, RecordingHeader &header, std::vector<CursorEvent> &events)
+{
+    events.clear();
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == RecordingHeader::kMagic
+              && header.version == RecordingHeader::kVersion && header.headerSize >= sizeof(RecordingHeader)
+              && std::fseek(file, static_cast<long>(header.headerSize), SEEK_SET) == 0;
+    while (ok) {
+        CursorEvent event;
+        if (std::fread(&event.record, sizeof(EventRecord), 1, file) != 1
+            || event.record.recordSize < sizeof(EventRecord) + event.record.shapeSize) {
+            break;
+        }
+        event.shape.resize(event.record.shapeSize);
+        if (event.record.shapeSize && std::fread(event.shape.data(), event.shape.size(), 1, file) != 1) {
+            break;
+        }
+        // 跳过新版本追加的字段
+        size_t extra = event.record.recordSize - sizeof(EventRecord) - event.record.shapeSize;
+        if (extra && std::fseek(file, static_cast<long>(extra), SEEK_CUR) != 0) {
+            break;
+        }
+        events.push_back(std::move(event));
+    }
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace CursorRecording
+
+#endif // CURSOR_RECORDING_H
@@ -0,0 +1,223 @@
+#ifndef CURSOR_REPLAY_H
+#define CURSOR_REPLAY_H
+
+#include "cursor_decode.h"
+#include "cursor_encode.h"
+#include "cursor_recording.h"
+#include "cursor_state.h"
+#include "shape_cache.h"
+#include "shape_fingerprint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief 把录制的光标事件按最快速度送过与 DxgiPointerMonitor 相同的处理路径
+ *
+ * 每个事件依次经过：
+ *   hash     ShapeFingerprint 判断形状是否变化（只有带形状的事件），热点变化也算形状变化
+ *   cache    形状变化时按 (哈希, 形状描述) 查 ShapeCache
+ *   convert  未命中时转换为 ARGB32（单色 / 带掩码彩色解码，彩色直接使用原缓冲）
+ *   encode   按所选格式编码并放入缓存
+ *   publish  发布到 CursorStatePublisher（每个事件）
+ *
+ * 与 DXGI 一样，只有带形状的事件才更新热点，移动事件沿用上一个形状的热点。
+ * 每个阶段记录每次调用的耗时，报告总吞吐量（事件/秒）和各阶段的平均值、p50、p99、最大值。
+ * 吞吐量包含计时本身的开销（每个事件最多 5 次读时钟）。
+ */
+namespace CursorReplay {
+
+using Encoded = std::shared_ptr<const std::vector<uint8_t>>;
+
+struct Options
+{
+    CursorEncode::Encoding encoding = CursorEncode::Encoding::Qoi;
+    size_t cacheCapacity = 16;
+    bool verify = true; // ShapeFingerprint 逐字节校验
+    int passes = 1;     // 重复回放整个录制的次数，缓存和指纹在各次之间保留
+};
+
+/**
+ * @brief 一个阶段的耗时统计，单位纳秒
+ */
+struct StageStats
+{
+    explicit StageStats(const char *stageName = "")
+        : name(stageName)
+    {
+    }
+
+    const char *name;
+    std::vector<uint32_t> samples;
+    double totalNs = 0;
+
+    void add(double ns)
+    {
+        samples.push_back(static_cast<uint32_t>(std::min(ns, 4.0e9)));
+        totalNs += ns;
+    }
+
+    size_t count() const { return samples.size(); }
+    double averageNs() const { return samples.empty() ? 0 : totalNs / samples.size(); }
+
+    // p 取 0..100；会对样本排序
+    double percentileNs(double p)
+    {
+        if (samples.empty()) {
+            return 0;
+        }
+        std::sort(samples.begin(), samples.end());
+        size_t index = static_cast<size_t>(p / 100 * (samples.size() - 1) + 0.5);
+        return samples[std::min(index, samples.size() - 1)];
+    }
+};
+
+struct Report
+{
+    uint64_t events = 0;
+    uint64_t shapeEvents = 0;  // 带形状的事件
+    uint64_t shapeChanges = 0; // 形状确实变化的次数
+    uint64_t cacheHits = 0;
+    uint64_t encodes = 0;
+    uint64_t failures = 0; // 形状无效、转换或编码失败
+    uint64_t encodedBytes = 0;
+    double seconds = 0;
+    StageStats hash{"hash"};
+    StageStats cache{"cache"};
+    StageStats convert{"convert"};
+    StageStats encode{"encode"};
+    StageStats publish{"publish"};
+    CursorState lastState; // 最后发布的状态
+
+    double eventsPerSecond() const { return seconds > 0 ? events / seconds : 0; }
+};
+
+namespace detail {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedNs(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+}
+
+// 把形状转换为 ARGB32 图像；彩色光标不需要转换，直接引用原缓冲
+inline bool convertShape(const CursorShapeInfo &info, const std::vector<uint8_t> &shape, std::vector<uint8_t> &pixels,
+                         CursorEncode::Image &image)
+{
+    if (!info.valid(shape.size())) {
+        return false;
+    }
+    image.width = info.width;
+    image.height = info.imageHeight();
+    image.hotSpotX = info.hotSpotX;
+    image.hotSpotY = info.hotSpotY;
+    if (info.type == CursorShapeColor) {
+        image.data = shape.data();
+        image.stride = info.pitch;
+        return true;
+    }
+    image.stride = static_cast<size_t>(info.width) * 4;
+    pixels.resize(image.stride * image.height);
+    image.data = pixels.data();
+    if (info.type == CursorShapeMonochrome) {
+        return CursorDecode::decodeMonochrome(info, shape.data(), shape.size(), pixels.data(), image.stride);
+    }
+    return CursorDecode::decodeMaskedColor(info, shape.data(), shape.size(), pixels.data(), image.stride);
+}
+
+} // namespace detail
+
+inline Report replay(const std::vector<CursorRecording::CursorEvent> &events, const Options &options = Options())
+{
+    using detail::Clock;
+    using detail::elapsedNs;
+
+    Report report;
+    ShapeFingerprint fingerprint(options.verify);
+    ShapeCache<Encoded> cache(options.cacheCapacity);
+    CursorStatePublisher<Encoded> publisher;
+    std::vector<uint8_t> pixels;
+    Encoded current;
+    uint64_t shapeId = 0;
+    int32_t hotSpotX = 0; // 最近一次形状事件的热点
+    int32_t hotSpotY = 0;
+    for (StageStats *stage : {&report.hash, &report.cache, &report.convert, &report.encode, &report.publish}) {
+        stage->samples.reserve(events.size() * std::max(options.passes, 1));
+    }
+
+    auto start = Clock::now();
+    for (int pass = 0; pass < std::max(options.passes, 1); ++pass) {
+        for (const CursorRecording::CursorEvent &event : events) {
+            ++report.events;
+            const CursorRecording::EventRecord &record = event.record;
+            if (record.hasShape() && !event.shape.empty()) {
+                ++report.shapeEvents;
+                CursorShapeInfo info = record.shapeInfo();
+
+                auto begin = Clock::now();
+                bool changed = fingerprint.update(info, event.shape.data(), event.shape.size());
+                report.hash.add(elapsedNs(begin));
+                // 指纹不含热点；Raw 编码把热点写在头部，热点变化时必须重新查缓存
+                changed = changed || info.hotSpotX != hotSpotX || info.hotSpotY != hotSpotY;
+                hotSpotX = info.hotSpotX;
+                hotSpotY = info.hotSpotY;
+
+                if (changed) {
+                    ++report.shapeChanges;
+                    bool withHotSpot = options.encoding == CursorEncode::Encoding::Raw;
+                    auto key = ShapeCache<Encoded>::keyOf(info, fingerprint.hash(), withHotSpot);
+                    begin = Clock::now();
+                    bool hit = cache.lookup(key, current);
+                    report.cache.add(elapsedNs(begin));
+
+                    if (hit) {
+                        ++report.cacheHits;
+                    } else {
+                        CursorEncode::Image image;
+                        begin = Clock::now();
+                        bool converted = detail::convertShape(info, event.shape, pixels, image);
+                        report.convert.add(elapsedNs(begin));
+
+                        current.reset();
+                        if (converted) {
+                            begin = Clock::now();
+                            auto encoded = std::make_shared<std::vector<uint8_t>>();
+                            if (CursorEncode::encode(options.encoding, image, *encoded)) {
+                                ++report.encodes;
+                                report.encodedBytes += encoded->size();
+                                current = std::move(encoded);
+                                cache.insert(key, current);
+                            }
+                            report.encode.add(elapsedNs(begin));
+                        }
+                        if (!current) {
+                            ++report.failures;
+                        }
+                    }
+                    shapeId = current ? publisher.publishShape(current) : 0;
+                }
+            }
+
+            CursorState state;
+            state.shapeId = shapeId;
+            state.x = record.x;
+            state.y = record.y;
+            state.hotSpotX = hotSpotX;
+            state.hotSpotY = hotSpotY;
+            state.visible = record.visible() ? 1 : 0;
+            auto begin = Clock::now();
+            publisher.publish(state);
+            report.publish.add(elapsedNs(begin));
+            report.lastState = state;
+        }
+    }
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return report;
+}
+
+} // namespace CursorReplay
+
+#endif // CURSOR_REPLAY_H
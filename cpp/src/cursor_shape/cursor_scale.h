@@ -0,0 +1,462 @@
+#ifndef CURSOR_SCALE_H
+#define CURSOR_SCALE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CURSOR_SCALE_X86 1
+#endif
+
+/**
+ * @brief 缩放 ARGB32 光标图像（内存顺序 B G R A，非预乘），供 125% / 150% / 200% 等缩放比例的客户端使用
+ *
+ * 可分离的两趟重采样：每个源行先预乘 Alpha 转为 float，水平滤波到目标宽度；
+ * 每个目标行再由若干中间行加权求和，最后去预乘、四舍五入回 ARGB32。
+ * 在预乘空间滤波，透明像素的 RGB 不会渗到边缘形成黑边。
+ *
+ * 滤波核按缩放比例展开（缩小时支撑域按比例放大，相当于面积平均），边缘像素重复。
+ * 每个目标像素的抽头数固定，权重预先展开为 4 份（每通道一份），内核里没有分支。
+ * 标量、SSE2、AVX2 三组内核的运算顺序相同，结果逐字节一致，运行时按 CPUID 选择。
+ */
+namespace CursorScale {
+
+enum class Isa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+inline const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+enum class Filter {
+    Bilinear,   // 三角核，半径 1
+    CatmullRom, // 三次卷积核，半径 2，放大时边缘更锐利
+};
+
+/**
+ * @brief 一个方向上的滤波器：目标位置 i 取源位置 start[i] 起的 taps 个像素
+ *
+ * weights 长度为 size * taps * 4，每个抽头的权重重复 4 次，对应 B G R A 四个通道。
+ */
+struct Filter1D
+{
+    size_t taps = 0;
+    std::vector<int32_t> start;
+    std::vector<float> weights;
+};
+
+/**
+ * @brief 一组行内核
+ *
+ * premultiplyRow 把 width 个 ARGB32 像素转为预乘的 float BGRA；
+ * horizontalRow 按 filter 把一行 float 像素重采样到 filter.start.size() 个像素；
+ * verticalRow 对 taps 行各 count 个 float 加权求和；storeRow 去预乘并转回 ARGB32。
+ */
+struct Kernels
+{
+    Isa isa;
+    void (*premultiplyRow)(const uint32_t *src, float *dst, size_t width);
+    void (*horizontalRow)(const float *src, float *dst, const Filter1D &filter);
+    void (*verticalRow)(const float *const *rows, const float *weights, size_t taps, float *dst, size_t count);
+    void (*storeRow)(const float *src, uint32_t *dst, size_t width);
+};
+
+namespace detail {
+
+inline double filterRadius(Filter filter) { return filter == Filter::CatmullRom ? 2.0 : 1.0; }
+
+inline double filterWeight(Filter filter, double x)
+{
+    x = std::fabs(x);
+    if (filter == Filter::Bilinear) {
+        return x < 1.0 ? 1.0 - x : 0.0;
+    }
+    if (x < 1.0) {
+        return (1.5 * x - 2.5) * x * x + 1.0;
+    }
+    if (x < 2.0) {
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    }
+    return 0.0;
+}
+
+constexpr float kInv255 = 1.0f / 255.0f;
+
+// ==================== 标量实现 ====================
+
+inline void premultiplyRowScalar(const uint32_t *src, float *dst, size_t width)
+{
+    for (size_t i = 0; i < width; ++i) {
+        uint32_t p = src[i];
+        float a = static_cast<float>(p >> 24);
+        float f = a * kInv255;
+        dst[4 * i + 0] = static_cast<float>(p & 0xFF) * f;
+        dst[4 * i + 1] = static_cast<float>((p >> 8) & 0xFF) * f;
+        dst[4 * i + 2] = static_cast<float>((p >> 16) & 0xFF) * f;
+        dst[4 * i + 3] = a;
+    }
+}
+
+inline void horizontalRowScalar(const float *src, float *dst, const Filter1D &filter)
+{
+    const size_t taps = filter.taps;
+    for (size_t x = 0; x < filter.start.size(); ++x) {
+        const float *s = src + 4 * static_cast<size_t>(filter.start[x]);
+        const float *w = filter.weights.data() + x * taps * 4;
+        float acc[4] = {0, 0, 0, 0};
+        for (size_t t = 0; t < taps; ++t) {
+            for (int c = 0; c < 4; ++c) {
+                acc[c] = acc[c] + w[4 * t + c] * s[4 * t + c];
+            }
+        }
+        for (int c = 0; c < 4; ++c) {
+            dst[4 * x + c] = acc[c];
+        }
+    }
+}
+
+inline void verticalRowScalar(const float *const *rows, const float *weights, size_t taps, float *dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        float acc = 0;
+        for (size_t t = 0; t < taps; ++t) {
+            acc = acc + weights[t] * rows[t][i];
+        }
+        dst[i] = acc;
+    }
+}
+
+inline uint32_t clampRound(float v) { return static_cast<uint32_t>(std::lrintf(std::min(std::max(v, 0.0f), 255.0f))); }
+
+inline void storeRowScalar(const float *src, uint32_t *dst, size_t width)
+{
+    for (size_t i = 0; i < width; ++i) {
+        const float *p = src + 4 * i;
+        float a = std::min(std::max(p[3], 0.0f), 255.0f);
+        float inv = a > 0.5f ? 255.0f / a : 0.0f;
+        dst[i] = clampRound(p[0] * inv) | clampRound(p[1] * inv) << 8 | clampRound(p[2] * inv) << 16
+                 | clampRound(a) << 24;
+    }
+}
+
+#ifdef CURSOR_SCALE_X86
+
+// ==================== SSE2 实现 ====================
+
+__attribute__((target("sse2"))) inline __m128 premultiplySse2(__m128 v)
+{
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    __m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 p = _mm_mul_ps(v, _mm_mul_ps(a, _mm_set1_ps(kInv255)));
+    return _mm_or_ps(_mm_andnot_ps(alphaMask, p), _mm_and_ps(alphaMask, v));
+}
+
+__attribute__((target("sse2"))) inline void premultiplyRowSse2(const uint32_t *src, float *dst, size_t width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t i = 0; i < width; ++i) {
+        __m128i p = _mm_cvtsi32_si128(static_cast<int>(src[i]));
+        p = _mm_unpacklo_epi16(_mm_unpacklo_epi8(p, zero), zero);
+        _mm_storeu_ps(dst + 4 * i, premultiplySse2(_mm_cvtepi32_ps(p)));
+    }
+}
+
+__attribute__((target("sse2"))) inline void horizontalRowSse2(const float *src, float *dst, const Filter1D &filter)
+{
+    const size_t taps = filter.taps;
+    for (size_t x = 0; x < filter.start.size(); ++x) {
+        const float *s = src + 4 * static_cast<size_t>(filter.start[x]);
+        const float *w = filter.weights.data() + x * taps * 4;
+        __m128 acc = _mm_setzero_ps();
+        for (size_t t = 0; t < taps; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + 4 * t), _mm_loadu_ps(s + 4 * t)));
+        }
+        _mm_storeu_ps(dst + 4 * x, acc);
+    }
+}
+
+__attribute__((target("sse2"))) inline void verticalRowSse2(const float *const *rows, const float *weights, size_t taps,
+                                                            float *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (size_t t = 0; t < taps; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + i)));
+        }
+        _mm_storeu_ps(dst + i, acc);
+    }
+    for (; i < count; ++i) {
+        float acc = 0;
+        for (size_t t = 0; t < taps; ++t) {
+            acc = acc + weights[t] * rows[t][i];
+        }
+        dst[i] = acc;
+    }
+}
+
+__attribute__((target("sse2"))) inline uint32_t storePixelSse2(__m128 v)
+{
+    const __m128 alphaMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max = _mm_set1_ps(255.0f);
+    __m128 a = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), zero), max);
+    __m128 inv = _mm_and_ps(_mm_cmpgt_ps(a, _mm_set1_ps(0.5f)), _mm_div_ps(max, a));
+    __m128 c = _mm_or_ps(_mm_andnot_ps(alphaMask, _mm_mul_ps(v, inv)), _mm_and_ps(alphaMask, a));
+    __m128i i = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(c, zero), max));
+    i = _mm_packs_epi32(i, i);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(i, i)));
+}
+
+__attribute__((target("sse2"))) inline void storeRowSse2(const float *src, uint32_t *dst, size_t width)
+{
+    for (size_t i = 0; i < width; ++i) {
+        dst[i] = storePixelSse2(_mm_loadu_ps(src + 4 * i));
+    }
+}
+
+// ==================== AVX2 实现 ====================
+
+// 每次处理两个像素，每个像素占 256 位寄存器的一个 128 位通道
+
+__attribute__((target("avx2"))) inline void premultiplyRowAvx2(const uint32_t *src, float *dst, size_t width)
+{
+    const __m256 inv255 = _mm256_set1_ps(kInv255);
+    size_t i = 0;
+    for (; i + 2 <= width; i += 2) {
+        __m128i p = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+        __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(p));
+        __m256 a = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+        __m256 c = _mm256_mul_ps(v, _mm256_mul_ps(a, inv255));
+        _mm256_storeu_ps(dst + 4 * i, _mm256_blend_ps(c, v, 0x88));
+    }
+    premultiplyRowSse2(src + i, dst + 4 * i, width - i);
+}
+
+__attribute__((target("avx2"))) inline __m256 load2x128(const float *lo, const float *hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+__attribute__((target("avx2"))) inline void horizontalRowAvx2(const float *src, float *dst, const Filter1D &filter)
+{
+    const size_t taps = filter.taps;
+    const size_t width = filter.start.size();
+    size_t x = 0;
+    for (; x + 2 <= width; x += 2) {
+        const float *s0 = src + 4 * static_cast<size_t>(filter.start[x]);
+        const float *s1 = src + 4 * static_cast<size_t>(filter.start[x + 1]);
+        const float *w0 = filter.weights.data() + x * taps * 4;
+        const float *w1 = w0 + taps * 4;
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t t = 0; t < taps; ++t) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(load2x128(w0 + 4 * t, w1 + 4 * t), load2x128(s0 + 4 * t, s1 + 4 * t)));
+        }
+        _mm256_storeu_ps(dst + 4 * x, acc);
+    }
+    for (; x < width; ++x) {
+        const float *s = src + 4 * static_cast<size_t>(filter.start[x]);
+        const float *w = filter.weights.data() + x * taps * 4;
+        __m128 acc = _mm_setzero_ps();
+        for (size_t t = 0; t < taps; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + 4 * t), _mm_loadu_ps(s + 4 * t)));
+        }
+        _mm_storeu_ps(dst + 4 * x, acc);
+    }
+}
+
+__attribute__((target("avx2"))) inline void verticalRowAvx2(const float *const *rows, const float *weights, size_t taps,
+                                                            float *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t t = 0; t < taps; ++t) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[t]), _mm256_loadu_ps(rows[t] + i)));
+        }
+        _mm256_storeu_ps(dst + i, acc);
+    }
+    for (; i < count; ++i) {
+        float acc = 0;
+        for (size_t t = 0; t < taps; ++t) {
+            acc = acc + weights[t] * rows[t][i];
+        }
+        dst[i] = acc;
+    }
+}
+
+__attribute__((target("avx2"))) inline void storeRowAvx2(const float *src, uint32_t *dst, size_t width)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 2 <= width; i += 2) {
+        __m256 v = _mm256_loadu_ps(src + 4 * i);
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), zero), max);
+        __m256 inv = _mm256_and_ps(_mm256_cmp_ps(a, half, _CMP_GT_OQ), _mm256_div_ps(max, a));
+        __m256 c = _mm256_blend_ps(_mm256_mul_ps(v, inv), a, 0x88);
+        __m256i n = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(c, zero), max));
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(n), _mm256_extracti128_si256(n, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(packed, packed));
+    }
+    storeRowSse2(src + 4 * i, dst + i, width - i);
+}
+
+#endif // CURSOR_SCALE_X86
+
+} // namespace detail
+
+inline bool isaSupported(Isa isa)
+{
+#ifdef CURSOR_SCALE_X86
+    switch (isa) {
+    case Isa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    default:
+        return true;
+    }
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+inline const Kernels &kernels(Isa isa)
+{
+    static const Kernels scalar{Isa::Scalar, detail::premultiplyRowScalar, detail::horizontalRowScalar,
+                                detail::verticalRowScalar, detail::storeRowScalar};
+#ifdef CURSOR_SCALE_X86
+    static const Kernels sse2{Isa::SSE2, detail::premultiplyRowSse2, detail::horizontalRowSse2, detail::verticalRowSse2,
+                              detail::storeRowSse2};
+    static const Kernels avx2{Isa::AVX2, detail::premultiplyRowAvx2, detail::horizontalRowAvx2, detail::verticalRowAvx2,
+                              detail::storeRowAvx2};
+    if (isa == Isa::AVX2) {
+        return avx2;
+    }
+    if (isa == Isa::SSE2) {
+        return sse2;
+    }
+#endif
+    return scalar;
+}
+
+// 按 CPUID 选出的最优内核，首次调用时检测
+inline const Kernels &kernels()
+{
+    static const Kernels &best = isaSupported(Isa::AVX2)   ? kernels(Isa::AVX2)
+                                 : isaSupported(Isa::SSE2) ? kernels(Isa::SSE2)
+                                                           : kernels(Isa::Scalar);
+    return best;
+}
+
+// 按百分比缩放后的尺寸，四舍五入，至少为 1
+inline uint32_t scaledSize(uint32_t size, int scalePercent)
+{
+    uint64_t scaled = (static_cast<uint64_t>(size) * static_cast<uint64_t>(std::max(scalePercent, 1)) + 50) / 100;
+    return static_cast<uint32_t>(std::max<uint64_t>(scaled, 1));
+}
+
+// 热点按像素中心缩放
+inline int32_t scaledHotSpot(int32_t hotSpot, int scalePercent)
+{
+    return static_cast<int32_t>((2 * static_cast<int64_t>(hotSpot) + 1) * std::max(scalePercent, 1) / 200);
+}
+
+/**
+ * @brief 生成从 srcSize 到 dstSize 的一维滤波器
+ */
+inline Filter1D makeFilter(uint32_t srcSize, uint32_t dstSize, Filter filter)
+{
+    Filter1D result;
+    const double scale = static_cast<double>(dstSize) / srcSize;
+    const double stretch = std::min(scale, 1.0); // 缩小时把核拉宽
+    const double support = detail::filterRadius(filter) / stretch;
+    result.taps = std::min<size_t>(static_cast<size_t>(std::ceil(2 * support)) + 1, srcSize);
+    result.start.resize(dstSize);
+    result.weights.assign(static_cast<size_t>(dstSize) * result.taps * 4, 0.0f);
+
+    std::vector<double> weights(srcSize);
+    for (uint32_t i = 0; i < dstSize; ++i) {
+        const double center = (i + 0.5) / scale - 0.5;
+        const int64_t first = static_cast<int64_t>(std::floor(center - support)) + 1;
+        const int64_t last = static_cast<int64_t>(std::floor(center + support));
+        // 超出边界的抽头并到边缘像素上；j 递增时 clamp 后的下标单调不减
+        const int64_t lo = std::min<int64_t>(std::max<int64_t>(first, 0), srcSize - 1);
+        const int64_t hi = std::min<int64_t>(std::max<int64_t>(last, 0), srcSize - 1);
+        std::fill(weights.begin() + lo, weights.begin() + hi + 1, 0.0);
+        double sum = 0;
+        for (int64_t j = first; j <= last; ++j) {
+            double w = detail::filterWeight(filter, (j - center) * stretch);
+            weights[std::min<int64_t>(std::max<int64_t>(j, 0), srcSize - 1)] += w;
+            sum += w;
+        }
+        const int64_t start = std::min<int64_t>(lo, srcSize - static_cast<int64_t>(result.taps));
+        result.start[i] = static_cast<int32_t>(start);
+        float *out = result.weights.data() + static_cast<size_t>(i) * result.taps * 4;
+        for (int64_t k = lo; k <= hi; ++k) {
+            float w = static_cast<float>(weights[k] / sum);
+            for (int c = 0; c < 4; ++c) {
+                out[4 * (k - start) + c] = w;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 把 ARGB32 图像缩放到 dstWidth x dstHeight
+ * @return 尺寸为 0 时返回 false
+ */
+inline bool scaleImage(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, size_t srcStride, uint8_t *dst,
+                       uint32_t dstWidth, uint32_t dstHeight, size_t dstStride, Filter filter = Filter::CatmullRom,
+                       const Kernels &k = kernels())
+{
+    if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) {
+        return false;
+    }
+    const Filter1D horizontal = makeFilter(srcWidth, dstWidth, filter);
+    const Filter1D vertical = makeFilter(srcHeight, dstHeight, filter);
+
+    // 所有源行先做水平滤波，光标最大 256 x 256，中间结果最多几 MB
+    const size_t rowFloats = static_cast<size_t>(dstWidth) * 4;
+    std::vector<float> line(static_cast<size_t>(srcWidth) * 4);
+    std::vector<float> rows(rowFloats * srcHeight);
+    for (uint32_t y = 0; y < srcHeight; ++y) {
+        k.premultiplyRow(reinterpret_cast<const uint32_t *>(src + y * srcStride), line.data(), srcWidth);
+        k.horizontalRow(line.data(), rows.data() + y * rowFloats, horizontal);
+    }
+
+    std::vector<const float *> taps(vertical.taps);
+    std::vector<float> weights(vertical.taps);
+    std::vector<float> out(rowFloats);
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        for (size_t t = 0; t < vertical.taps; ++t) {
+            taps[t] = rows.data() + (vertical.start[y] + t) * rowFloats;
+            weights[t] = vertical.weights[(y * vertical.taps + t) * 4];
+        }
+        k.verticalRow(taps.data(), weights.data(), vertical.taps, out.data(), rowFloats);
+        k.storeRow(out.data(), reinterpret_cast<uint32_t *>(dst + y * dstStride), dstWidth);
+    }
+    return true;
+}
+
+} // namespace CursorScale
+
+#endif // CURSOR_SCALE_H
@@ -0,0 +1,64 @@
+#ifndef CURSOR_SHAPE_H
+#define CURSOR_SHAPE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 光标形状类型，数值与 DXGI_OUTDUPL_POINTER_SHAPE_TYPE_* 一致
+ */
+enum CursorShapeType : uint32_t {
+    CursorShapeMonochrome = 1, // 1bpp AND 掩码 + 1bpp XOR 掩码，缓冲高度是实际高度的两倍
+    CursorShapeColor = 2,      // 32bpp ARGB，按 Alpha 混合
+    CursorShapeMaskedColor = 4, // 32bpp，Alpha 为 0 时替换，为 0xFF 时与屏幕像素 XOR
+};
+
+/**
+ * @brief 与平台无关的光标形状描述，字段对应 DXGI_OUTDUPL_POINTER_SHAPE_INFO
+ */
+struct CursorShapeInfo
+{
+    uint32_t type = 0;
+    uint32_t width = 0;  // 像素宽度
+    uint32_t height = 0; // 缓冲中的行数（单色光标是实际高度的两倍）
+    uint32_t pitch = 0;  // 每行字节数
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+
+    // 实际显示的行数
+    uint32_t imageHeight() const { return type == CursorShapeMonochrome ? height / 2 : height; }
+
+    // 缓冲区至少需要的字节数
+    size_t requiredBytes() const { return static_cast<size_t>(pitch) * height; }
+
+    bool valid(size_t bufferSize) const
+    {
+        if (width == 0 || height == 0) {
+            return false;
+        }
+        switch (type) {
+        case CursorShapeMonochrome:
+            return pitch >= (width + 7) / 8 && height % 2 == 0 && bufferSize >= requiredBytes();
+        case CursorShapeColor:
+        case CursorShapeMaskedColor:
+            return pitch >= width * 4 && bufferSize >= requiredBytes();
+        default:
+            return false;
+        }
+    }
+};
+
+/**
+ * @brief 32bpp 像素缓冲（内存顺序 B G R A，即 QImage::Format_ARGB32）
+ */
+struct PixelSurface
+{
+    uint8_t *data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0; // 每行字节数
+
+    uint8_t *row(uint32_t y) const { return data + static_cast<size_t>(y) * stride; }
+};
+
+#endif // CURSOR_SHAPE_H
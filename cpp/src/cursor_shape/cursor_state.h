@@ -0,0 +1,84 @@
+#ifndef CURSOR_STATE_H
+#define CURSOR_STATE_H
+
+#include "seqlock_snapshot.h"
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief 光标状态快照：位置、可见性、热点和当前形状编号
+ */
+struct CursorState
+{
+    uint64_t shapeId = 0; // 0 表示还没有形状
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    uint32_t visible = 0;
+    uint32_t reserved = 0;
+};
+
+/**
+ * @brief 采集线程发布光标状态，任意数量的读者线程随时读取最新状态
+ *
+ * 状态本身放在 SeqlockSnapshot 中，读取不加锁，读者用版本号判断自上次读取后是否有变化。
+ * 编码后的形状不是可平凡复制的类型（QByteArray 等隐式共享句柄），单独保存：
+ * 采集线程先 publishShape() 得到新的形状编号，再 publish() 引用该编号的状态。
+ * 读者只在 shapeId 变化时调用 shape() 取形状，这一步持有互斥锁复制一次句柄，不复制形状数据。
+ *
+ * @tparam Shape 编码后的形状，复制代价应当很低（隐式共享或 shared_ptr）
+ */
+template <typename Shape>
+class CursorStatePublisher
+{
+public:
+    /**
+     * @brief 发布状态，只能由采集线程调用
+     * @return 新的版本号
+     */
+    uint64_t publish(const CursorState &state) { return m_state.publish(state); }
+
+    /**
+     * @brief 保存新形状，只能由采集线程调用
+     * @return 新形状的编号，从 1 开始递增
+     */
+    uint64_t publishShape(Shape shape)
+    {
+        std::lock_guard<std::mutex> lock(m_shapeMutex);
+        m_shape = std::move(shape);
+        return ++m_shapeId;
+    }
+
+    // 读取最新状态，返回版本号
+    uint64_t read(CursorState &state) const { return m_state.read(state); }
+
+    // 自 lastVersion 之后有新状态时读取并更新 lastVersion
+    bool readIfNewer(uint64_t &lastVersion, CursorState &state) const { return m_state.readIfNewer(lastVersion, state); }
+
+    /**
+     * @brief 取编号为 shapeId 的形状
+     * @return 该形状已被更新的形状替换时返回 false，读者应重新读取状态
+     */
+    bool shape(uint64_t shapeId, Shape &shape) const
+    {
+        std::lock_guard<std::mutex> lock(m_shapeMutex);
+        if (shapeId == 0 || shapeId != m_shapeId) {
+            return false;
+        }
+        shape = m_shape;
+        return true;
+    }
+
+    uint64_t version() const { return m_state.version(); }
+    uint64_t retries() const { return m_state.retries(); }
+
+private:
+    SeqlockSnapshot<CursorState> m_state;
+    mutable std::mutex m_shapeMutex;
+    Shape m_shape{};
+    uint64_t m_shapeId = 0;
+};
+
+#endif // CURSOR_STATE_H
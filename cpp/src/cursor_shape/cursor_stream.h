@@ -0,0 +1,357 @@
+#ifndef CURSOR_STREAM_H
+#define CURSOR_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 远程会话用的紧凑光标更新流
+ *
+ * 采集端每次轮询调用 Encoder::move() / setVisible() / setShape() 更新待发送状态，
+ * 到发送间隔时 flush() 一次：期间的多次移动合并为一条位置记录，只发送最终状态。
+ *
+ * 记录以 1 字节标签开头，低 2 位为类型，其余位为标志：
+ *
+ *   State        [kPosition: zigzag varint dx, dy] [kHotSpot: varint hx, hy]，kVisible 为当前可见性
+ *   DefineShape  varint slot, varint size, size 字节形状数据（编码后的光标，格式由调用方决定）
+ *   UseShape     varint slot，切换到对端已有的形状
+ *   Reset        清空字典和位置基准，新连接的第一批记录总是以它开头
+ *
+ * 位置是相对上一次发送的位置的差值，普通移动每条 State 记录 3 字节左右。
+ * 形状按调用方给出的键（ShapeFingerprint 哈希或 CursorStatePublisher 的形状编号）放入
+ * 固定容量的字典，对端已有的形状只发送槽位号；字典满时淘汰最久未使用的槽位，
+ * 两端按相同记录维护字典，不需要额外同步。
+ */
+namespace CursorStream {
+
+enum RecordKind : uint8_t {
+    RecordState = 0,
+    RecordDefineShape = 1,
+    RecordUseShape = 2,
+    RecordReset = 3,
+};
+
+enum StateFlags : uint8_t {
+    kPosition = 0x04,
+    kVisible = 0x08,
+    kHotSpot = 0x10,
+};
+
+constexpr uint8_t kKindMask = 0x03;
+constexpr uint32_t kMaxSlots = 256;
+constexpr uint32_t kMaxShapeSize = 16 * 1024 * 1024;
+
+namespace detail {
+
+inline void putVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// 越界或超过 10 字节时返回 false
+inline bool getVarint(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace detail
+
+/**
+ * @brief 发送端，单线程使用
+ */
+class Encoder
+{
+public:
+    explicit Encoder(uint32_t dictionaryCapacity = 32)
+        : m_slots(dictionaryCapacity == 0 ? 1 : (dictionaryCapacity > kMaxSlots ? kMaxSlots : dictionaryCapacity))
+    {
+    }
+
+    // 记录最新位置，flush() 之前的多次调用只保留最后一次
+    void move(int32_t x, int32_t y)
+    {
+        m_x = x;
+        m_y = y;
+        ++m_moves;
+    }
+
+    void setVisible(bool visible) { m_visible = visible; }
+
+    /**
+     * @brief 设置当前形状
+     * @param key 形状内容的唯一标识，相同键的形状只发送一次
+     * @param data 编码后的形状，只在 flush() 需要定义新槽位时读取，调用方保证届时仍然有效
+     */
+    void setShape(uint64_t key, const uint8_t *data, size_t size, int32_t hotSpotX, int32_t hotSpotY)
+    {
+        m_shapeKey = key;
+        m_shapeData = data;
+        m_shapeSize = size;
+        m_hotSpotX = hotSpotX;
+        m_hotSpotY = hotSpotY;
+        m_hasShape = true;
+    }
+
+    // 对端重新连接：下一次 flush() 以 Reset 开头，重新发送形状和绝对位置
+    void reset() { m_needReset = true; }
+
+    /**
+     * @brief 把待发送状态追加到 out
+     * @return 追加的字节数，状态没有变化时为 0
+     */
+    size_t flush(std::vector<uint8_t> &out)
+    {
+        size_t begin = out.size();
+        if (m_needReset) {
+            out.push_back(RecordReset);
+            for (Slot &slot : m_slots) {
+                slot.used = false;
+            }
+            m_sentX = m_sentY = 0;
+            m_sentHotSpotX = m_sentHotSpotY = 0;
+            m_sentVisible = false;
+            m_sentSlot = kNoSlot;
+            m_needReset = false;
+            m_forceState = true;
+        }
+
+        if (m_hasShape) {
+            flushShape(out);
+        }
+
+        uint8_t tag = RecordState | (m_visible ? kVisible : 0);
+        bool moved = m_x != m_sentX || m_y != m_sentY;
+        bool hotSpotChanged = m_hasShape && (m_hotSpotX != m_sentHotSpotX || m_hotSpotY != m_sentHotSpotY);
+        if (moved || hotSpotChanged || m_visible != m_sentVisible || m_forceState) {
+            tag |= moved ? kPosition : 0;
+            tag |= hotSpotChanged ? kHotSpot : 0;
+            out.push_back(tag);
+            if (moved) {
+                detail::putVarint(out, detail::zigzag(int64_t(m_x) - m_sentX));
+                detail::putVarint(out, detail::zigzag(int64_t(m_y) - m_sentY));
+                m_sentX = m_x;
+                m_sentY = m_y;
+            }
+            if (hotSpotChanged) {
+                detail::putVarint(out, detail::zigzag(m_hotSpotX));
+                detail::putVarint(out, detail::zigzag(m_hotSpotY));
+                m_sentHotSpotX = m_hotSpotX;
+                m_sentHotSpotY = m_hotSpotY;
+            }
+            m_sentVisible = m_visible;
+            m_forceState = false;
+            ++m_stateRecords;
+        }
+
+        m_coalesced += m_moves > 1 ? m_moves - 1 : 0;
+        m_moves = 0;
+        m_bytes += out.size() - begin;
+        return out.size() - begin;
+    }
+
+    uint32_t dictionaryCapacity() const { return static_cast<uint32_t>(m_slots.size()); }
+
+    uint64_t stateRecords() const { return m_stateRecords; }
+    uint64_t coalescedMoves() const { return m_coalesced; } // 被合并掉、没有单独发送的移动
+    uint64_t shapeDefines() const { return m_defines; }
+    uint64_t shapeUses() const { return m_uses; }
+    uint64_t bytes() const { return m_bytes; }
+
+private:
+    static constexpr uint32_t kNoSlot = ~0u;
+
+    struct Slot
+    {
+        uint64_t key = 0;
+        uint64_t lastUse = 0;
+        bool used = false;
+    };
+
+    void flushShape(std::vector<uint8_t> &out)
+    {
+        uint32_t found = kNoSlot;
+        uint32_t victim = 0;
+        for (uint32_t i = 0; i < m_slots.size(); ++i) {
+            const Slot &slot = m_slots[i];
+            if (slot.used && slot.key == m_shapeKey) {
+                found = i;
+                break;
+            }
+            if (!slot.used || (m_slots[victim].used && slot.lastUse < m_slots[victim].lastUse)) {
+                victim = i;
+            }
+        }
+
+        if (found != kNoSlot) {
+            m_slots[found].lastUse = ++m_clock;
+            if (found != m_sentSlot) {
+                out.push_back(RecordUseShape);
+                detail::putVarint(out, found);
+                m_sentSlot = found;
+                ++m_uses;
+            }
+            return;
+        }
+
+        if (!m_shapeData || m_shapeSize > kMaxShapeSize) {
+            return;
+        }
+        Slot &slot = m_slots[victim];
+        slot.key = m_shapeKey;
+        slot.lastUse = ++m_clock;
+        slot.used = true;
+        out.push_back(RecordDefineShape);
+        detail::putVarint(out, victim);
+        detail::putVarint(out, m_shapeSize);
+        out.insert(out.end(), m_shapeData, m_shapeData + m_shapeSize);
+        m_sentSlot = victim;
+        ++m_defines;
+    }
+
+    std::vector<Slot> m_slots;
+    uint64_t m_clock = 0;
+
+    // 待发送状态
+    int32_t m_x = 0;
+    int32_t m_y = 0;
+    bool m_visible = false;
+    bool m_hasShape = false;
+    uint64_t m_shapeKey = 0;
+    const uint8_t *m_shapeData = nullptr;
+    size_t m_shapeSize = 0;
+    int32_t m_hotSpotX = 0;
+    int32_t m_hotSpotY = 0;
+    uint64_t m_moves = 0;
+
+    // 对端已知的状态
+    int32_t m_sentX = 0;
+    int32_t m_sentY = 0;
+    int32_t m_sentHotSpotX = 0;
+    int32_t m_sentHotSpotY = 0;
+    bool m_sentVisible = false;
+    uint32_t m_sentSlot = kNoSlot;
+    bool m_needReset = true;
+    bool m_forceState = true;
+
+    uint64_t m_stateRecords = 0;
+    uint64_t m_coalesced = 0;
+    uint64_t m_defines = 0;
+    uint64_t m_uses = 0;
+    uint64_t m_bytes = 0;
+};
+
+/**
+ * @brief 接收端解码后的光标状态
+ */
+struct State
+{
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    bool visible = false;
+    int32_t slot = -1;          // 当前形状槽位，-1 表示还没有形状
+    bool shapeChanged = false;  // 本次 decode() 是否切换了形状
+};
+
+/**
+ * @brief 接收端，单线程使用
+ */
+class Decoder
+{
+public:
+    Decoder()
+        : m_shapes(kMaxSlots)
+    {
+    }
+
+    /**
+     * @brief 应用一批记录（一次或多次 flush() 的输出）
+     * @return 记录格式错误或被截断时返回 false，state 保留出错前已应用的部分
+     */
+    bool decode(const uint8_t *data, size_t size, State &state)
+    {
+        const uint8_t *end = data + size;
+        state.shapeChanged = false;
+        uint64_t a = 0;
+        uint64_t b = 0;
+        while (data < end) {
+            uint8_t tag = *data++;
+            switch (tag & kKindMask) {
+            case RecordState:
+                if (tag & kPosition) {
+                    if (!detail::getVarint(data, end, a) || !detail::getVarint(data, end, b)) {
+                        return false;
+                    }
+                    state.x = static_cast<int32_t>(state.x + detail::unzigzag(a));
+                    state.y = static_cast<int32_t>(state.y + detail::unzigzag(b));
+                }
+                if (tag & kHotSpot) {
+                    if (!detail::getVarint(data, end, a) || !detail::getVarint(data, end, b)) {
+                        return false;
+                    }
+                    state.hotSpotX = static_cast<int32_t>(detail::unzigzag(a));
+                    state.hotSpotY = static_cast<int32_t>(detail::unzigzag(b));
+                }
+                state.visible = (tag & kVisible) != 0;
+                break;
+            case RecordDefineShape:
+                if (!detail::getVarint(data, end, a) || a >= kMaxSlots || !detail::getVarint(data, end, b)
+                    || b > kMaxShapeSize || b > static_cast<uint64_t>(end - data)) {
+                    return false;
+                }
+                m_shapes[a].assign(data, data + b);
+                data += b;
+                state.slot = static_cast<int32_t>(a);
+                state.shapeChanged = true;
+                break;
+            case RecordUseShape:
+                if (!detail::getVarint(data, end, a) || a >= kMaxSlots) {
+                    return false;
+                }
+                state.slot = static_cast<int32_t>(a);
+                state.shapeChanged = true;
+                break;
+            case RecordReset:
+                if (tag != RecordReset) {
+                    return false;
+                }
+                for (std::vector<uint8_t> &shape : m_shapes) {
+                    shape.clear();
+                }
+                state = State();
+                break;
+            }
+        }
+        return true;
+    }
+
+    // 槽位中的形状数据，槽位无效时返回 nullptr
+    const std::vector<uint8_t> *shape(int32_t slot) const
+    {
+        return slot >= 0 && static_cast<uint32_t>(slot) < kMaxSlots ? &m_shapes[slot] : nullptr;
+    }
+
+private:
+    std::vector<std::vector<uint8_t>> m_shapes;
+};
+
+} // namespace CursorStream
+
+#endif // CURSOR_STREAM_H
@@ -0,0 +1,1701 @@
+#include "cursor_composite.h"
+#include "cursor_decode.h"
+#include "cursor_encode.h"
+#include "cursor_recording.h"
+#include "cursor_replay.h"
+#include "cursor_scale.h"
+#include "cursor_shape.h"
+#include "cursor_state.h"
+#include "cursor_stream.h"
+#include "scaled_shape_cache.h"
+#include "shape_cache.h"
+#include "shape_fingerprint.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+// ==================== Test Helper Functions ====================
+
+void printSection(const std::string &title)
+{
+    std::cout << "\n========== " << title << " ==========\n";
+}
+
+void printTestResult(bool passed, const std::string &name)
+{
+    std::cout << "[" << (passed ? "PASS" : "FAIL") << "] " << name << "\n";
+    if (!passed) {
+        exit(1);
+    }
+}
+
+// ==================== Benchmarks ====================
+// 基准测试耗时十余秒，默认跳过；传入 --bench 或设置 CURSOR_SHAPE_BENCH=1 后运行
+bool benchmarksEnabled(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--bench") == 0) {
+            return true;
+        }
+    }
+    const char *env = std::getenv("CURSOR_SHAPE_BENCH");
+    return env && std::strcmp(env, "0") != 0;
+}
+
+// 带保护边框的测试帧，用来检查裁剪不会越界写
+struct TestFrame
+{
+    static constexpr uint32_t kGuard = 16;
+
+    TestFrame(uint32_t width, uint32_t height, uint32_t fill)
+        : width(width)
+        , height(height)
+        , stride(static_cast<size_t>(width + 2 * kGuard) * 4)
+        , buffer(stride * (height + 2 * kGuard))
+    {
+        for (size_t i = 0; i < buffer.size() / 4; ++i) {
+            std::memcpy(&buffer[4 * i], &kSentinel, 4);
+        }
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                set(x, y, fill);
+            }
+        }
+    }
+
+    PixelSurface surface() { return {buffer.data() + kGuard * stride + kGuard * 4, width, height, stride}; }
+
+    uint32_t at(uint32_t x, uint32_t y) const
+    {
+        uint32_t v;
+        std::memcpy(&v, &buffer[(y + kGuard) * stride + (x + kGuard) * 4], 4);
+        return v;
+    }
+
+    void set(uint32_t x, uint32_t y, uint32_t v) { std::memcpy(&buffer[(y + kGuard) * stride + (x + kGuard) * 4], &v, 4); }
+
+    // 帧外的保护区域没有被改写
+    bool guardIntact() const
+    {
+        for (size_t y = 0; y < height + 2 * kGuard; ++y) {
+            for (size_t x = 0; x < width + 2 * kGuard; ++x) {
+                bool inside = y >= kGuard && y < kGuard + height && x >= kGuard && x < kGuard + width;
+                uint32_t v;
+                std::memcpy(&v, &buffer[y * stride + x * 4], 4);
+                if (!inside && v != kSentinel) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static constexpr uint32_t kSentinel = 0xA5A5A5A5u;
+    uint32_t width;
+    uint32_t height;
+    size_t stride;
+    std::vector<uint8_t> buffer;
+};
+
+// 构造单色光标：AND / XOR 位由 andBit(x, y)、xorBit(x, y) 决定
+template <typename AndFn, typename XorFn>
+std::vector<uint8_t> makeMonochrome(CursorShapeInfo &info, uint32_t width, uint32_t height, AndFn andBit, XorFn xorBit)
+{
+    info.type = CursorShapeMonochrome;
+    info.width = width;
+    info.height = height * 2;
+    info.pitch = (width + 7) / 8 + 1; // 多一个字节，检查 pitch 与宽度不一致的情况
+    std::vector<uint8_t> shape(info.requiredBytes(), 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            if (andBit(x, y)) {
+                shape[y * info.pitch + x / 8] |= 0x80 >> (x % 8);
+            }
+            if (xorBit(x, y)) {
+                shape[(height + y) * info.pitch + x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+    }
+    return shape;
+}
+
+// ==================== Test: Row Kernels ====================
+void testRowKernels()
+{
+    printSection("Test: Row Kernels");
+
+    using namespace CursorComposite;
+    std::mt19937 rng(42);
+    const size_t MAX_PIXELS = 131;
+    std::vector<uint8_t> src(MAX_PIXELS * 4), background(MAX_PIXELS * 4), andBits(64), xorBits(64);
+    for (auto &b : background) b = static_cast<uint8_t>(rng());
+    for (auto &b : andBits) b = static_cast<uint8_t>(rng());
+    for (auto &b : xorBits) b = static_cast<uint8_t>(rng());
+    for (size_t i = 0; i < MAX_PIXELS; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            src[4 * i + c] = static_cast<uint8_t>(rng());
+        }
+        // Alpha 混合透明、不透明和半透明
+        const uint8_t alphas[] = {0, 0, 255, 0xFF, 1, 128, 254, static_cast<uint8_t>(rng())};
+        src[4 * i + 3] = alphas[rng() % 8];
+    }
+
+    const Kernels &scalar = kernels(Isa::Scalar);
+    for (Isa isa : {Isa::SSE2, Isa::AVX2}) {
+        if (!isaSupported(isa)) {
+            std::cout << "  " << isaName(isa) << " not supported, skipped\n";
+            continue;
+        }
+        const Kernels &k = kernels(isa);
+        bool same = true;
+        for (size_t pixels = 0; pixels <= MAX_PIXELS && same; ++pixels) {
+            for (int op = 0; op < 3; ++op) {
+                std::vector<uint8_t> expect = background, actual = background;
+                size_t bit = pixels % 13; // 任意起始位
+                switch (op) {
+                case 0:
+                    scalar.blendRow(src.data(), expect.data(), pixels);
+                    k.blendRow(src.data(), actual.data(), pixels);
+                    break;
+                case 1:
+                    scalar.maskedColorRow(src.data(), expect.data(), pixels);
+                    k.maskedColorRow(src.data(), actual.data(), pixels);
+                    break;
+                default:
+                    scalar.monochromeRow(andBits.data(), xorBits.data(), bit, expect.data(), pixels);
+                    k.monochromeRow(andBits.data(), xorBits.data(), bit, actual.data(), pixels);
+                    break;
+                }
+                same = same && expect == actual;
+            }
+        }
+        printTestResult(same, std::string(isaName(isa)) + " row kernels bit-exact with scalar");
+    }
+}
+
+// ==================== Test: Color Blend ====================
+void testColorBlend()
+{
+    printSection("Test: Color Blend");
+
+    TestFrame frame(40, 30, 0xFF204060);
+    CursorShapeInfo info;
+    info.type = CursorShapeColor;
+    info.width = 4;
+    info.height = 1;
+    info.pitch = 16;
+    info.hotSpotX = 1;
+    info.hotSpotY = 0;
+    // 透明、不透明白色、半透明红色、1/4 不透明黑色
+    const uint32_t pixels[4] = {0x00FFFFFF, 0xFFFFFFFF, 0x80FF0000, 0x40000000};
+    CursorComposite::compositeShape(frame.surface(), info, reinterpret_cast<const uint8_t *>(pixels), sizeof(pixels),
+                                    11, 5);
+
+    bool ok = frame.at(10, 5) == 0xFF204060 && frame.at(11, 5) == 0xFFFFFFFF;
+    // R: round((255 * 128 + 0x20 * 127) / 255) = 144, G: round(0x40 * 127 / 255) = 32, B: round(0x60 * 127 / 255) = 48
+    ok = ok && frame.at(12, 5) == 0xFF902030;
+    ok = ok && frame.at(13, 5) == 0xFF183048 && frame.at(14, 5) == 0xFF204060;
+    printTestResult(ok, "Straight alpha blend keeps frame alpha");
+
+    // blendImage 使用左上角坐标，结果与 COLOR 形状一致
+    TestFrame other(40, 30, 0xFF204060);
+    CursorComposite::blendImage(other.surface(), reinterpret_cast<const uint8_t *>(pixels), 4, 1, sizeof(pixels), 10,
+                                5);
+    printTestResult(other.buffer == frame.buffer, "blendImage matches COLOR shape compositing");
+}
+
+// ==================== Test: Monochrome ====================
+void testMonochrome()
+{
+    printSection("Test: Monochrome");
+
+    // 四列分别是 AND/XOR = 00 黑、01 白、10 透明、11 反色
+    CursorShapeInfo info;
+    auto shape = makeMonochrome(info, 4, 2, [](uint32_t x, uint32_t) { return x >= 2; },
+                                [](uint32_t x, uint32_t) { return x % 2 == 1; });
+    TestFrame frame(8, 8, 0xFF123456);
+    bool ok = CursorComposite::compositeShape(frame.surface(), info, shape.data(), shape.size(), 2, 3);
+    for (uint32_t y = 3; y < 5; ++y) {
+        ok = ok && frame.at(2, y) == 0xFF000000 && frame.at(3, y) == 0xFFFFFFFF && frame.at(4, y) == 0xFF123456
+             && frame.at(5, y) == 0xFFEDCBA9;
+    }
+    ok = ok && frame.at(2, 2) == 0xFF123456 && frame.at(2, 5) == 0xFF123456;
+    printTestResult(ok, "AND/XOR truth table with true invert");
+
+    // 同样的反色光标画两次恢复原状
+    CursorShapeInfo invertInfo;
+    auto invert = makeMonochrome(invertInfo, 37, 20, [](uint32_t, uint32_t) { return true; },
+                                 [](uint32_t x, uint32_t y) { return (x + y) % 3 != 0; });
+    TestFrame background(64, 64, 0);
+    std::mt19937 rng(5);
+    for (uint32_t y = 0; y < 64; ++y) {
+        for (uint32_t x = 0; x < 64; ++x) {
+            background.set(x, y, rng());
+        }
+    }
+    TestFrame twice = background;
+    CursorComposite::compositeShape(twice.surface(), invertInfo, invert.data(), invert.size(), 13, 9);
+    bool changed = twice.buffer != background.buffer;
+    CursorComposite::compositeShape(twice.surface(), invertInfo, invert.data(), invert.size(), 13, 9);
+    printTestResult(changed && twice.buffer == background.buffer, "XOR cursor drawn twice restores the frame");
+}
+
+// ==================== Test: Masked Color ====================
+void testMaskedColor()
+{
+    printSection("Test: Masked Color");
+
+    CursorShapeInfo info;
+    info.type = CursorShapeMaskedColor;
+    info.width = 3;
+    info.height = 1;
+    info.pitch = 12;
+    const uint32_t pixels[3] = {0x00112233, 0xFF00FF00, 0xFF000000};
+    TestFrame frame(4, 1, 0x80A0B0C0);
+    bool ok = CursorComposite::compositeShape(frame.surface(), info, reinterpret_cast<const uint8_t *>(pixels),
+                                              sizeof(pixels), 0, 0);
+    ok = ok && frame.at(0, 0) == 0x80112233 && frame.at(1, 0) == 0x80A04FC0 && frame.at(2, 0) == 0x80A0B0C0
+         && frame.at(3, 0) == 0x80A0B0C0;
+    printTestResult(ok, "Mask 0 replaces RGB, mask 0xFF XORs RGB");
+
+    printTestResult(!CursorComposite::compositeShape(frame.surface(), info, reinterpret_cast<const uint8_t *>(pixels),
+                                                     sizeof(pixels) - 1, 0, 0),
+                    "Short shape buffer is rejected");
+    info.type = 3;
+    printTestResult(!CursorComposite::compositeShape(frame.surface(), info, reinterpret_cast<const uint8_t *>(pixels),
+                                                     sizeof(pixels), 0, 0),
+                    "Unknown shape type is rejected");
+}
+
+// ==================== Test: Clipping ====================
+void testClipping()
+{
+    printSection("Test: Clipping");
+
+    const uint32_t W = 50, H = 40, CW = 32, CH = 32;
+    std::vector<uint32_t> cursor(CW * CH, 0xFFFFFFFF);
+    CursorShapeInfo info;
+    info.type = CursorShapeColor;
+    info.width = CW;
+    info.height = CH;
+    info.pitch = CW * 4;
+    info.hotSpotX = 3;
+    info.hotSpotY = 5;
+
+    // 四个角、完全在帧外、比帧还大的覆盖
+    const int positions[][2] = {{-10, -10}, {45, -3}, {-20, 35}, {48, 38}, {0, 0}, {-100, 10}, {10, 200}};
+    bool ok = true;
+    for (const auto &pos : positions) {
+        TestFrame frame(W, H, 0xFF000000);
+        ok = ok && CursorComposite::compositeShape(frame.surface(), info, reinterpret_cast<const uint8_t *>(cursor.data()),
+                                                   cursor.size() * 4, pos[0], pos[1]);
+        int left = pos[0] - info.hotSpotX, top = pos[1] - info.hotSpotY;
+        for (uint32_t y = 0; y < H; ++y) {
+            for (uint32_t x = 0; x < W; ++x) {
+                bool covered = static_cast<int>(x) >= left && static_cast<int>(x) < left + static_cast<int>(CW)
+                               && static_cast<int>(y) >= top && static_cast<int>(y) < top + static_cast<int>(CH);
+                ok = ok && frame.at(x, y) == (covered ? 0xFFFFFFFF : 0xFF000000);
+            }
+        }
+        ok = ok && frame.guardIntact();
+    }
+    printTestResult(ok, "Color cursor is clipped at every edge");
+
+    // 单色光标被左边裁剪时位偏移正确
+    CursorShapeInfo monoInfo;
+    auto mono = makeMonochrome(monoInfo, 29, 7, [](uint32_t, uint32_t) { return false; },
+                               [](uint32_t x, uint32_t y) { return (x * 7 + y) % 5 == 0; });
+    TestFrame frame(20, 10, 0xFF000000);
+    ok = CursorComposite::compositeShape(frame.surface(), monoInfo, mono.data(), mono.size(), -11, 4);
+    for (uint32_t y = 0; y < 10 && ok; ++y) {
+        for (uint32_t x = 0; x < 20; ++x) {
+            uint32_t sx = x + 11, sy = y - 4;
+            bool inside = y >= 4 && sx < 29 && sy < 7;
+            uint32_t expect = inside ? ((sx * 7 + sy) % 5 == 0 ? 0xFFFFFFFF : 0xFF000000) : 0xFF000000;
+            ok = ok && frame.at(x, y) == expect;
+        }
+    }
+    printTestResult(ok && frame.guardIntact(), "Monochrome cursor clipped on the left keeps bit alignment");
+}
+
+// ==================== Test: Monochrome Decode ====================
+void testMonochromeDecode()
+{
+    printSection("Test: Monochrome Decode");
+
+    using namespace CursorDecode;
+    const uint32_t truthTable[4] = {0xFF000000, 0xFFFFFFFF, 0x00000000, 0xFF000000};
+    bool ok = true;
+    for (int andBit = 0; andBit < 2; ++andBit) {
+        for (int xorBit = 0; xorBit < 2; ++xorBit) {
+            ok = ok && detail::monochromePixel(andBit, xorBit) == truthTable[andBit * 2 + xorBit];
+        }
+    }
+    printTestResult(ok, "Scalar reference follows the AND/XOR truth table");
+
+    // 穷举所有 (AND 字节, XOR 字节) 组合：每行 AND 字节固定，XOR 字节取 0..255
+    const size_t ROW_PIXELS = 256 * 8;
+    std::vector<uint8_t> andRow(256), xorRow(256);
+    for (int b = 0; b < 256; ++b) {
+        xorRow[b] = static_cast<uint8_t>(b);
+    }
+    std::vector<uint32_t> expect(ROW_PIXELS), actual(ROW_PIXELS);
+    for (Isa isa : {Isa::Table, Isa::SSE2, Isa::AVX2}) {
+        if (!isaSupported(isa)) {
+            std::cout << "  " << isaName(isa) << " not supported, skipped\n";
+            continue;
+        }
+        bool same = true;
+        for (int a = 0; a < 256 && same; ++a) {
+            std::fill(andRow.begin(), andRow.end(), static_cast<uint8_t>(a));
+            monochromeRow(Isa::Scalar)(andRow.data(), xorRow.data(), expect.data(), ROW_PIXELS);
+            monochromeRow(isa)(andRow.data(), xorRow.data(), actual.data(), ROW_PIXELS);
+            same = expect == actual;
+        }
+        printTestResult(same, std::string(isaName(isa)) + " matches scalar for all 65536 byte pairs");
+    }
+
+    // 随机形状：宽度 1..256，行尾有多余字节，输出行跨度大于宽度
+    std::mt19937 rng(36);
+    bool shapesMatch = true;
+    for (uint32_t width = 1; width <= 256 && shapesMatch; width += (width < 40 ? 1 : 17)) {
+        CursorShapeInfo info{CursorShapeMonochrome, width, 2 * (width % 7 + 1), (width + 7) / 8 + width % 3, 0, 0};
+        std::vector<uint8_t> shape(info.requiredBytes());
+        for (auto &b : shape) b = static_cast<uint8_t>(rng());
+        size_t stride = (width + 3) * 4;
+        std::vector<uint8_t> reference(stride * info.imageHeight(), 0xEE);
+        decodeMonochrome(info, shape.data(), shape.size(), reference.data(), stride, monochromeRow(Isa::Scalar));
+        for (Isa isa : {Isa::Table, Isa::SSE2, Isa::AVX2}) {
+            if (!isaSupported(isa)) {
+                continue;
+            }
+            std::vector<uint8_t> image(reference.size(), 0xEE);
+            shapesMatch = shapesMatch
+                          && decodeMonochrome(info, shape.data(), shape.size(), image.data(), stride, monochromeRow(isa))
+                          && image == reference;
+        }
+    }
+    printTestResult(shapesMatch, "Odd widths, padded pitch and stride match scalar");
+
+    CursorShapeInfo info{CursorShapeMonochrome, 32, 64, 4, 0, 0};
+    std::vector<uint8_t> shape(info.requiredBytes()), image(32 * 32 * 4);
+    ok = !decodeMonochrome(info, shape.data(), shape.size() - 1, image.data(), 128);
+    info.height = 63;
+    ok = ok && !decodeMonochrome(info, shape.data(), shape.size(), image.data(), 128);
+    info.height = 64;
+    info.type = CursorShapeColor;
+    ok = ok && !decodeMonochrome(info, shape.data(), shape.size(), image.data(), 128);
+    printTestResult(ok, "Invalid monochrome shapes are rejected");
+}
+
+// ==================== Benchmark: Monochrome Decode ====================
+void benchmarkMonochromeDecode()
+{
+    printSection("Benchmark: Monochrome Decode");
+
+    using namespace CursorDecode;
+    std::mt19937 rng(4);
+    for (uint32_t size : {32u, 64u, 256u}) {
+        CursorShapeInfo info{CursorShapeMonochrome, size, size * 2, size / 8, 0, 0};
+        std::vector<uint8_t> shape(info.requiredBytes());
+        for (auto &b : shape) b = static_cast<uint8_t>(rng());
+        std::vector<uint8_t> image(static_cast<size_t>(size) * size * 4);
+        const int iterations = static_cast<int>((4u << 20) / (size * size));
+
+        std::cout << "  " << size << "x" << size << " (" << iterations << " iterations)\n";
+        for (Isa isa : {Isa::Scalar, Isa::Table, Isa::SSE2, Isa::AVX2}) {
+            if (!isaSupported(isa)) {
+                continue;
+            }
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                decodeMonochrome(info, shape.data(), shape.size(), image.data(), size * 4, monochromeRow(isa));
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                        / iterations;
+            std::cout << "    " << std::left << std::setw(7) << isaName(isa) << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(9) << ns << " ns/shape, " << std::setprecision(2)
+                      << size * size / ns << " px/ns\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+// ==================== Benchmark: Composite ====================
+void benchmarkComposite()
+{
+    printSection("Benchmark: Composite");
+
+    using namespace CursorComposite;
+    const uint32_t W = 1920, H = 1080;
+    const int ITERATIONS = 20000;
+    std::vector<uint8_t> frameBuffer(static_cast<size_t>(W) * H * 4, 0x40);
+    PixelSurface frame{frameBuffer.data(), W, H, static_cast<size_t>(W) * 4};
+
+    std::mt19937 rng(9);
+    for (uint32_t size : {32u, 64u}) {
+        std::vector<uint8_t> color(static_cast<size_t>(size) * size * 4);
+        for (size_t i = 0; i < color.size(); ++i) {
+            color[i] = static_cast<uint8_t>(rng());
+        }
+        CursorShapeInfo colorInfo{CursorShapeColor, size, size, size * 4, 0, 0};
+        CursorShapeInfo maskedInfo{CursorShapeMaskedColor, size, size, size * 4, 0, 0};
+        CursorShapeInfo monoInfo;
+        auto mono = makeMonochrome(monoInfo, size, size, [](uint32_t x, uint32_t) { return x % 3 == 0; },
+                                   [](uint32_t, uint32_t y) { return y % 2 == 0; });
+
+        std::cout << "  " << size << "x" << size << " cursor\n";
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2}) {
+            if (!isaSupported(isa)) {
+                continue;
+            }
+            const Kernels &k = kernels(isa);
+            auto measure = [&](const CursorShapeInfo &info, const uint8_t *shape, size_t shapeSize) {
+                auto begin = std::chrono::steady_clock::now();
+                for (int i = 0; i < ITERATIONS; ++i) {
+                    compositeShape(frame, info, shape, shapeSize, (i * 37) % W, (i * 17) % H, k);
+                }
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                       / ITERATIONS;
+            };
+            double blend = measure(colorInfo, color.data(), color.size());
+            double masked = measure(maskedInfo, color.data(), color.size());
+            double monochrome = measure(monoInfo, mono.data(), mono.size());
+            std::cout << "    " << std::left << std::setw(7) << isaName(isa) << std::right << std::fixed
+                      << std::setprecision(0) << " color " << std::setw(6) << blend << " ns, masked " << std::setw(6)
+                      << masked << " ns, monochrome " << std::setw(6) << monochrome << " ns\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+// ==================== Test: Masked Color Decode ====================
+void testMaskedColorDecode()
+{
+    printSection("Test: Masked Color Decode");
+
+    using namespace CursorDecode;
+    bool bad = false;
+    bool ok = detail::maskedColorPixel(0x00123456, bad) == 0xFF123456 && !bad;
+    ok = ok && detail::maskedColorPixel(0xFF000000, bad) == 0x00000000 && !bad;
+    ok = ok && detail::maskedColorPixel(0xFF010000, bad) == 0xFF000000 && !bad;
+    ok = ok && detail::maskedColorPixel(0x80FFFFFF, bad) == 0x00000000 && bad;
+    printTestResult(ok, "Scalar reference follows the alpha 0x00/0xFF rules");
+
+    // 穷举所有 Alpha，RGB 取黑色、单个通道和随机值；宽度不是 8 的倍数以覆盖尾部
+    std::mt19937 rng(37);
+    std::vector<uint32_t> src;
+    for (uint32_t alpha = 0; alpha < 256; ++alpha) {
+        for (uint32_t rgb : {0x000000u, 0x000001u, 0x010000u, 0xFFFFFFu, static_cast<uint32_t>(rng()) & 0xFFFFFF}) {
+            src.push_back(alpha << 24 | rgb);
+        }
+    }
+    src.push_back(0x00ABCDEF);
+    src.push_back(0x7F000000);
+    src.push_back(0xFF00FF00);
+    std::vector<uint32_t> expect(src.size());
+    size_t expectInvalid = maskedColorRow(Isa::Scalar)(src.data(), expect.data(), src.size());
+    printTestResult(expectInvalid == 254 * 5 + 1, "Scalar counts every alpha other than 0x00/0xFF");
+    for (Isa isa : {Isa::SSE2, Isa::AVX2}) {
+        if (!isaSupported(isa)) {
+            std::cout << "  " << isaName(isa) << " not supported, skipped\n";
+            continue;
+        }
+        bool same = true;
+        for (size_t width = 0; width <= src.size() && same; width += (width < 40 ? 1 : 61)) {
+            std::vector<uint32_t> reference(width), actual(width);
+            size_t referenceInvalid = maskedColorRow(Isa::Scalar)(src.data(), reference.data(), width);
+            size_t invalid = maskedColorRow(isa)(src.data(), actual.data(), width);
+            same = invalid == referenceInvalid && actual == reference;
+        }
+        std::vector<uint32_t> inPlace = src;
+        same = same && maskedColorRow(isa)(inPlace.data(), inPlace.data(), inPlace.size()) == expectInvalid
+               && inPlace == expect;
+        printTestResult(same, std::string(isaName(isa)) + " matches scalar for all alpha values, in place too");
+    }
+
+    // 合法形状：行尾有填充，输出写入调用方提供的缓冲
+    CursorShapeInfo info{CursorShapeMaskedColor, 37, 23, 37 * 4 + 12, 0, 0};
+    std::vector<uint8_t> shape(info.requiredBytes());
+    for (uint32_t y = 0; y < info.height; ++y) {
+        auto row = reinterpret_cast<uint32_t *>(shape.data() + y * info.pitch);
+        for (uint32_t x = 0; x < info.width; ++x) {
+            row[x] = (rng() & 1 ? 0xFF000000u : 0u) | ((x * y) % 3 ? static_cast<uint32_t>(rng()) & 0xFFFFFF : 0);
+        }
+    }
+    size_t stride = 40 * 4;
+    std::vector<uint8_t> reference(stride * info.height, 0xEE), image(reference.size(), 0xEE);
+    size_t invalid = 99;
+    ok = decodeMaskedColor(info, shape.data(), shape.size(), reference.data(), stride, &invalid,
+                           maskedColorRow(Isa::Scalar))
+         && invalid == 0;
+    ok = ok && decodeMaskedColor(info, shape.data(), shape.size(), image.data(), stride, &invalid) && invalid == 0
+         && image == reference;
+    printTestResult(ok, "Valid shape converts into caller buffer with padded pitch and stride");
+
+    // 非法像素只在结束时报告一次，整张图仍然转换完
+    reinterpret_cast<uint32_t *>(shape.data())[3] = 0x80FFFFFF;
+    reinterpret_cast<uint32_t *>(shape.data() + 22 * info.pitch)[36] = 0x01000000;
+    ok = !decodeMaskedColor(info, shape.data(), shape.size(), image.data(), stride, &invalid) && invalid == 2;
+    reinterpret_cast<uint32_t *>(reference.data())[3] = 0;
+    reinterpret_cast<uint32_t *>(reference.data() + 22 * stride)[36] = 0;
+    ok = ok && image == reference;
+    printTestResult(ok, "Invalid alpha is reported once with a count, rest of image converted");
+
+    info.type = CursorShapeColor;
+    ok = !decodeMaskedColor(info, shape.data(), shape.size(), image.data(), stride, &invalid) && invalid == 0;
+    info.type = CursorShapeMaskedColor;
+    ok = ok && !decodeMaskedColor(info, shape.data(), shape.size() - 1, image.data(), stride);
+    printTestResult(ok, "Mismatched masked color shapes are rejected");
+}
+
+// ==================== Benchmark: Masked Color Decode ====================
+void benchmarkMaskedColorDecode()
+{
+    printSection("Benchmark: Masked Color Decode");
+
+    using namespace CursorDecode;
+    std::mt19937 rng(5);
+    for (uint32_t size : {32u, 64u, 256u}) {
+        CursorShapeInfo info{CursorShapeMaskedColor, size, size, size * 4, 0, 0};
+        std::vector<uint8_t> shape(info.requiredBytes());
+        for (size_t i = 0; i < shape.size(); i += 4) {
+            uint32_t pixel = (rng() & 1 ? 0xFF000000u : 0u) | (static_cast<uint32_t>(rng()) & 0xFFFFFF);
+            std::memcpy(shape.data() + i, &pixel, 4);
+        }
+        std::vector<uint8_t> image(shape.size());
+        const int iterations = static_cast<int>((4u << 20) / (size * size));
+
+        std::cout << "  " << size << "x" << size << " (" << iterations << " iterations)\n";
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2}) {
+            if (!isaSupported(isa)) {
+                continue;
+            }
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                decodeMaskedColor(info, shape.data(), shape.size(), image.data(), size * 4, nullptr,
+                                  maskedColorRow(isa));
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                        / iterations;
+            std::cout << "    " << std::left << std::setw(7) << isaName(isa) << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(9) << ns << " ns/shape, " << std::setprecision(2)
+                      << size * size / ns << " px/ns\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+// ==================== Test: Shape Cache ====================
+void testShapeCache()
+{
+    printSection("Test: Shape Cache");
+
+    using Encoded = std::shared_ptr<const std::vector<uint8_t>>;
+    using Cache = ShapeCache<Encoded>;
+    auto encode = [](uint8_t tag) { return std::make_shared<const std::vector<uint8_t>>(64, tag); };
+
+    Cache cache(3);
+    CursorShapeInfo arrow{CursorShapeColor, 32, 32, 128, 0, 0};
+    Cache::Key key = Cache::keyOf(arrow, 0x1234);
+    Encoded value;
+    bool ok = !cache.lookup(key, value) && !value;
+    Encoded stored = encode(1);
+    cache.insert(key, stored);
+    ok = ok && cache.lookup(key, value) && value.get() == stored.get() && stored.use_count() == 3;
+    printTestResult(ok, "Hit returns the shared encoded bytes without copying");
+
+    // 热点不同仍然命中；哈希相同但尺寸、pitch 或类型不同都不命中
+    CursorShapeInfo moved = arrow;
+    moved.hotSpotX = 7;
+    ok = cache.lookup(Cache::keyOf(moved, 0x1234), value) && !cache.lookup(Cache::keyOf(moved, 0x1234, true), value);
+    CursorShapeInfo other = arrow;
+    other.pitch = 132;
+    ok = ok && !cache.lookup(Cache::keyOf(other, 0x1234), value);
+    other = arrow;
+    other.height = 64;
+    ok = ok && !cache.lookup(Cache::keyOf(other, 0x1234), value);
+    other = arrow;
+    other.type = CursorShapeMaskedColor;
+    ok = ok && !cache.lookup(Cache::keyOf(other, 0x1234), value);
+    ok = ok && !cache.lookup(Cache::keyOf(arrow, 0x1235), value);
+    printTestResult(ok, "Key covers hash, type and geometry but not hotspot");
+
+    // 容量 3：访问 a 后插入 d，应淘汰最久未使用的 b
+    cache.clear();
+    Cache::Key a = Cache::keyOf(arrow, 1), b = Cache::keyOf(arrow, 2), c = Cache::keyOf(arrow, 3),
+               d = Cache::keyOf(arrow, 4);
+    cache.insert(a, encode(1));
+    cache.insert(b, encode(2));
+    cache.insert(c, encode(3));
+    cache.lookup(a, value);
+    cache.insert(d, encode(4));
+    ok = cache.size() == 3 && cache.evictions() == 1 && !cache.lookup(b, value);
+    ok = ok && cache.lookup(a, value) && (*value)[0] == 1 && cache.lookup(c, value) && cache.lookup(d, value);
+    cache.insert(c, encode(5));
+    ok = ok && cache.size() == 3 && cache.evictions() == 1 && cache.lookup(c, value) && (*value)[0] == 5;
+    printTestResult(ok, "Least recently used entry is evicted, reinsertion replaces in place");
+
+    // 四种光标循环切换：只在第一次出现时编码
+    Cache cycling(16);
+    int encodes = 0;
+    for (int event = 0; event < 1000; ++event) {
+        Cache::Key key = Cache::keyOf(arrow, static_cast<uint64_t>(event % 4) * 0x9E3779B97F4A7C15ull);
+        if (!cycling.lookup(key, value)) {
+            ++encodes;
+            cycling.insert(key, encode(static_cast<uint8_t>(event % 4)));
+        }
+    }
+    printTestResult(encodes == 4 && cycling.hits() == 996 && cycling.misses() == 4,
+                    "Cycling through 4 cursors encodes each shape once");
+
+    Encoded kept = encode(9);
+    cycling.insert(Cache::keyOf(arrow, 99), kept);
+    cycling.clear();
+    printTestResult(cycling.size() == 0 && kept.use_count() == 1 && !cycling.lookup(Cache::keyOf(arrow, 99), value),
+                    "clear() drops cached values");
+}
+
+// ==================== Test: Cursor Encode ====================
+// 类似箭头光标的 ARGB32 图像：背景透明，三角形内部白色渐变，边缘黑色
+std::vector<uint8_t> makeCursorImage(uint32_t width, uint32_t height, size_t stride)
+{
+    std::vector<uint8_t> image(stride * height, 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x <= y && x < width; ++x) {
+            uint32_t pixel = (x == 0 || x == y || y + 1 == height) ? 0xFF000000u
+                                                                   : 0xFF000000u | (0x010101u * (0xFF - (x + y) % 64));
+            std::memcpy(&image[y * stride + x * 4], &pixel, 4);
+        }
+    }
+    return image;
+}
+
+// 用 zlib 独立检查 PNG：签名、各块 CRC、IHDR，解压 IDAT 后与输入像素比较
+bool verifyPng(const std::vector<uint8_t> &png, const CursorEncode::Image &image)
+{
+    if (png.size() < 8 || std::memcmp(png.data(), "\x89PNG\r\n\x1A\n", 8) != 0) {
+        return false;
+    }
+    auto be32 = [&](size_t at) {
+        return uint32_t(png[at]) << 24 | uint32_t(png[at + 1]) << 16 | uint32_t(png[at + 2]) << 8 | png[at + 3];
+    };
+    std::vector<uint8_t> idat;
+    bool ihdr = false, iend = false;
+    for (size_t at = 8; at + 12 <= png.size() && !iend;) {
+        uint32_t length = be32(at);
+        if (at + 12 + length > png.size()
+            || ::crc32(0, png.data() + at + 4, length + 4) != be32(at + 8 + length)) {
+            return false;
+        }
+        const uint8_t *data = png.data() + at + 8;
+        if (std::memcmp(png.data() + at + 4, "IHDR", 4) == 0) {
+            ihdr = length == 13 && be32(at + 8) == image.width && be32(at + 12) == image.height && data[8] == 8
+                   && data[9] == 6;
+        } else if (std::memcmp(png.data() + at + 4, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), data, data + length);
+        } else if (std::memcmp(png.data() + at + 4, "IEND", 4) == 0) {
+            iend = at + 12 == png.size();
+        }
+        at += 12 + length;
+    }
+    size_t rowBytes = 1 + static_cast<size_t>(image.width) * 4;
+    std::vector<uint8_t> raw(rowBytes * image.height + 1);
+    uLongf rawSize = raw.size();
+    if (!ihdr || !iend || uncompress(raw.data(), &rawSize, idat.data(), idat.size()) != Z_OK
+        || rawSize != rowBytes * image.height) {
+        return false;
+    }
+    for (uint32_t y = 0; y < image.height; ++y) {
+        const uint8_t *line = raw.data() + y * rowBytes;
+        const uint8_t *src = image.row(y);
+        if (line[0] != 0) {
+            return false;
+        }
+        for (uint32_t x = 0; x < image.width; ++x) {
+            const uint8_t *p = line + 1 + x * 4;
+            if (p[0] != src[4 * x + 2] || p[1] != src[4 * x + 1] || p[2] != src[4 * x] || p[3] != src[4 * x + 3]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void testCursorEncode()
+{
+    printSection("Test: Cursor Encode");
+
+    using namespace CursorEncode;
+    const uint8_t check[] = "123456789";
+    const uint8_t wiki[] = "Wikipedia";
+    std::vector<uint8_t> big(100000);
+    std::mt19937 rng(39);
+    for (auto &b : big) b = static_cast<uint8_t>(rng());
+    bool ok = CursorEncode::crc32(0, check, 9) == 0xCBF43926u && CursorEncode::adler32(1, wiki, 9) == 0x11E60398u;
+    ok = ok && CursorEncode::crc32(0, big.data(), big.size()) == ::crc32(0, big.data(), big.size())
+         && CursorEncode::crc32(CursorEncode::crc32(0, big.data(), 777), big.data() + 777, big.size() - 777)
+                == ::crc32(0, big.data(), big.size())
+         && CursorEncode::adler32(CursorEncode::adler32(1, big.data(), 6000), big.data() + 6000, big.size() - 6000)
+                == ::adler32(1, big.data(), big.size());
+    // 覆盖 SIMD 路径的各种长度和不对齐的起始位置
+    for (size_t length = 0; length < 300 && ok; ++length) {
+        const uint8_t *p = big.data() + length % 13;
+        ok = CursorEncode::crc32(0, p, length) == ::crc32(0, p, length)
+             && CursorEncode::adler32(1, p, length) == ::adler32(1, p, length);
+    }
+    printTestResult(ok, "CRC-32 and Adler-32 match known vectors and zlib, incrementally");
+
+    // 行跨度大于宽度，检查所有编码器只读取有效像素
+    struct Case
+    {
+        uint32_t width, height;
+        bool random;
+    };
+    bool rawOk = true, qoiOk = true, pngOk = true;
+    for (Case c : {Case{1, 1, false}, Case{37, 23, false}, Case{37, 23, true}, Case{64, 64, false},
+                   Case{256, 256, false}, Case{256, 300, true}}) {
+        size_t stride = (c.width + 5) * 4;
+        std::vector<uint8_t> pixels = makeCursorImage(c.width, c.height, stride);
+        if (c.random) {
+            // 随机像素夹杂重复段，覆盖 QOI 的所有操作码（包括超过 62 的游程）
+            for (size_t i = 0; i < pixels.size(); i += 4) {
+                if (rng() % 4 == 0) {
+                    uint32_t pixel = rng() % 2 ? static_cast<uint32_t>(rng()) : (0xFF000000u | (rng() % 4) * 0x010101u);
+                    std::memcpy(&pixels[i], &pixel, 4);
+                }
+            }
+        }
+        Image image{pixels.data(), c.width, c.height, stride, 3, 5};
+
+        std::vector<uint8_t> raw;
+        RawHeader header;
+        rawOk = rawOk && encode(Encoding::Raw, image, raw) && raw.size() == sizeof(RawHeader) + c.width * c.height * 4;
+        std::memcpy(&header, raw.data(), sizeof(header));
+        rawOk = rawOk && header.magic == RawHeader::kMagic && header.headerSize == sizeof(RawHeader)
+                && header.width == c.width && header.height == c.height && header.hotSpotX == 3 && header.hotSpotY == 5
+                && header.format == RawHeader::kFormatArgb32;
+        for (uint32_t y = 0; y < c.height && rawOk; ++y) {
+            rawOk = std::memcmp(raw.data() + sizeof(header) + y * c.width * 4, image.row(y), c.width * 4) == 0;
+        }
+
+        std::vector<uint8_t> qoi, decoded;
+        uint32_t width = 0, height = 0;
+        qoiOk = qoiOk && encode(Encoding::Qoi, image, qoi) && decodeQoi(qoi.data(), qoi.size(), decoded, width, height)
+                && width == c.width && height == c.height;
+        for (uint32_t y = 0; y < c.height && qoiOk; ++y) {
+            qoiOk = std::memcmp(decoded.data() + y * c.width * 4, image.row(y), c.width * 4) == 0;
+        }
+
+        std::vector<uint8_t> png;
+        pngOk = pngOk && encode(Encoding::StoredPng, image, png) && verifyPng(png, image);
+    }
+    printTestResult(rawOk, "Raw output carries header and tightly packed pixels");
+    printTestResult(qoiOk, "QOI round-trips cursor-like and random images");
+    printTestResult(pngOk, "Stored PNG passes CRC checks and inflates to the input pixels with zlib");
+
+    uint8_t tiny[16];
+    Image image{tiny, 2, 2, 8, 0, 0};
+    ok = encode(Encoding::Raw, image, tiny, sizeof(tiny)) == 0 && encode(Encoding::Qoi, image, tiny, sizeof(tiny)) == 0
+         && maxEncodedSize(Encoding::StoredPng, kMaxPngWidth + 1, 1) == 0
+         && maxEncodedSize(Encoding::Qoi, 0, 32) == 0;
+    printTestResult(ok, "Undersized buffers and unsupported sizes fail");
+}
+
+// ==================== Benchmark: Cursor Encode ====================
+void benchmarkCursorEncode()
+{
+    printSection("Benchmark: Cursor Encode");
+
+    using namespace CursorEncode;
+    for (uint32_t size : {32u, 64u, 256u}) {
+        std::vector<uint8_t> pixels = makeCursorImage(size, size, size * 4);
+        Image image{pixels.data(), size, size, size * 4, 0, 0};
+        const int iterations = static_cast<int>((1u << 20) / (size * size)) + 8;
+
+        auto report = [&](const char *name, double ns, size_t bytes) {
+            std::cout << "    " << std::left << std::setw(12) << name << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(10) << ns / 1000 << " us, " << std::setw(7) << bytes
+                      << " bytes\n";
+            std::cout.unsetf(std::ios::floatfield);
+        };
+
+        std::cout << "  " << size << "x" << size << " (" << iterations << " iterations)\n";
+        std::vector<uint8_t> out(maxEncodedSize(Encoding::Qoi, size, size));
+        for (Encoding encoding : {Encoding::Raw, Encoding::Qoi, Encoding::StoredPng}) {
+            size_t bytes = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                bytes = encode(encoding, image, out.data(), out.size());
+            }
+            report(encodingName(encoding),
+                   std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                       / iterations,
+                   bytes);
+        }
+
+        // 对照：现有路径 QImage::save("PNG") 的主要开销是 zlib 默认级别压缩，这里用 compress2 近似
+        std::vector<uint8_t> filtered(static_cast<size_t>(size) * (size * 4 + 1));
+        std::vector<uint8_t> compressed(compressBound(filtered.size()));
+        uLongf compressedSize = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (uint32_t y = 0; y < size; ++y) {
+                uint8_t *line = filtered.data() + y * (size * 4 + 1);
+                line[0] = 0;
+                std::memcpy(line + 1, image.row(y), size * 4);
+            }
+            compressedSize = compressed.size();
+            compress2(compressed.data(), &compressedSize, filtered.data(), filtered.size(), Z_DEFAULT_COMPRESSION);
+        }
+        report("zlib (PNG)",
+               std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations,
+               compressedSize);
+    }
+}
+
+// ==================== Test: Shape Fingerprint ====================
+// 合成的光标样本：单色 32x32、彩色 32x32 / 48x48 / 256x256、带掩码彩色 32x32
+struct ShapeSample
+{
+    const char *name;
+    CursorShapeInfo info;
+    std::vector<uint8_t> shape;
+};
+
+std::vector<ShapeSample> makeShapeSamples()
+{
+    std::vector<ShapeSample> samples;
+    CursorShapeInfo mono;
+    auto monoShape = makeMonochrome(mono, 32, 32, [](uint32_t x, uint32_t y) { return x > y; },
+                                    [](uint32_t x, uint32_t y) { return x == y; });
+    samples.push_back({"mono 32", mono, monoShape});
+    for (uint32_t size : {32u, 48u, 256u}) {
+        CursorShapeInfo info{CursorShapeColor, size, size, size * 4, 0, 0};
+        samples.push_back({size == 32 ? "color 32" : size == 48 ? "color 48" : "color 256", info,
+                           makeCursorImage(size, size, size * 4)});
+    }
+    CursorShapeInfo masked{CursorShapeMaskedColor, 32, 32, 128, 0, 0};
+    samples.push_back({"masked 32", masked, makeCursorImage(32, 32, 128)});
+    return samples;
+}
+
+void testShapeFingerprint()
+{
+    printSection("Test: Shape Fingerprint");
+
+    auto samples = makeShapeSamples();
+    const ShapeSample &arrow = samples[1];
+    for (bool verify : {false, true}) {
+        ShapeFingerprint fp(verify);
+        std::string mode = verify ? " (verify)" : " (hash)";
+        std::vector<uint8_t> shape = arrow.shape;
+        bool ok = fp.update(arrow.info, shape.data(), shape.size());
+        uint64_t first = fp.hash();
+        ok = ok && first == StripeHash::hash(shape.data(), shape.size()) && !fp.update(arrow.info, shape.data(), shape.size());
+        printTestResult(ok, "First shape reports a change, repeat does not" + mode);
+
+        // 只改一个字节
+        shape[shape.size() / 2] ^= 1;
+        ok = fp.update(arrow.info, shape.data(), shape.size()) && fp.hash() != first;
+        shape[shape.size() / 2] ^= 1;
+        ok = ok && fp.update(arrow.info, shape.data(), shape.size()) && fp.hash() == first;
+        printTestResult(ok, "Single byte change is detected and reverting restores the hash" + mode);
+
+        // 内容相同，描述不同：不比较内容直接判定变化
+        uint64_t geometry = fp.geometryChanges();
+        CursorShapeInfo other = arrow.info;
+        other.type = CursorShapeMaskedColor;
+        ok = fp.update(other, shape.data(), shape.size()) && fp.geometryChanges() == geometry + 1;
+        other.width = 16;
+        ok = ok && fp.update(other, shape.data(), shape.size()) && fp.geometryChanges() == geometry + 2;
+        ok = ok && fp.update(other, shape.data(), shape.size() - 64) && fp.geometryChanges() == geometry + 3;
+        // 热点不参与比较
+        other.hotSpotX = 5;
+        ok = ok && !fp.update(other, shape.data(), shape.size() - 64);
+        printTestResult(ok, "Type, size and length changes short-circuit, hotspot is ignored" + mode);
+
+        ok = verify ? fp.compares() > 0 && fp.hashCompares() == 0 : fp.compares() == 0 && fp.hashCompares() > 0;
+        fp.reset();
+        ok = ok && fp.update(other, shape.data(), shape.size() - 64);
+        printTestResult(ok, "Comparison path matches the mode, reset() forces a change" + mode);
+    }
+
+    // 随机序列：两种模式与逐字节比较的结论一致
+    std::mt19937 rng(40);
+    ShapeFingerprint hashed(false), verified(true);
+    std::vector<uint8_t> previous;
+    const ShapeSample *last = nullptr;
+    bool agree = true;
+    for (int i = 0; i < 2000 && agree; ++i) {
+        const ShapeSample &sample = samples[rng() % samples.size()];
+        std::vector<uint8_t> shape = sample.shape;
+        if (rng() % 3 == 0) {
+            shape[rng() % shape.size()] ^= static_cast<uint8_t>(1 + rng() % 255);
+        }
+        bool expect = !last || last->info.type != sample.info.type || last->info.width != sample.info.width
+                      || last->info.height != sample.info.height || last->info.pitch != sample.info.pitch
+                      || shape != previous;
+        agree = hashed.update(sample.info, shape.data(), shape.size()) == expect
+                && verified.update(sample.info, shape.data(), shape.size()) == expect
+                && hashed.hash() == verified.hash();
+        previous = shape;
+        last = &sample;
+    }
+    printTestResult(agree, "Hash and verify modes agree with byte comparison on random updates");
+}
+
+// ==================== Benchmark: Shape Fingerprint ====================
+void benchmarkShapeFingerprint()
+{
+    printSection("Benchmark: Shape Fingerprint");
+
+    // 对照：通用的字符串哈希（libstdc++ 的 std::hash，MurmurHash2 64 位），代替原来的 qHash
+    auto genericHash = [](const std::vector<uint8_t> &shape) {
+        return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(shape.data()), shape.size()));
+    };
+    volatile uint64_t sink = 0;
+    for (const ShapeSample &sample : makeShapeSamples()) {
+        const int iterations = static_cast<int>((64u << 20) / sample.shape.size());
+        std::vector<uint8_t> changed = sample.shape;
+        changed.back() ^= 1;
+        auto measure = [&](auto &&body) {
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                body(i);
+            }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                   / iterations;
+        };
+
+        double generic = measure([&](int) { sink = sink + genericHash(sample.shape); });
+        double scalar = measure([&](int) {
+            sink = sink + StripeHash::hash(sample.shape.data(), sample.shape.size(), StripeHash::detail::accumulateScalar);
+        });
+        double simd = measure([&](int) { sink = sink + StripeHash::hash(sample.shape.data(), sample.shape.size()); });
+
+        // 同一形状重复上报 / 交替变化时 update() 的代价
+        ShapeFingerprint hashed(false), verified(true);
+        const uint8_t *data = sample.shape.data();
+        size_t size = sample.shape.size();
+        hashed.update(sample.info, data, size);
+        verified.update(sample.info, data, size);
+        double hashSame = measure([&](int) { sink = sink + hashed.update(sample.info, data, size); });
+        double verifySame = measure([&](int) { sink = sink + verified.update(sample.info, data, size); });
+        double verifyFlip = measure([&](int i) {
+            sink = sink + verified.update(sample.info, i % 2 ? changed.data() : data, size);
+        });
+
+        std::cout << "  " << std::left << std::setw(10) << sample.name << std::right << std::setw(7) << size
+                  << " bytes: " << std::fixed << std::setprecision(0) << "generic " << generic << " ns, stripe scalar "
+                  << scalar << " ns, stripe " << simd << " ns\n"
+                  << std::setw(20) << "" << "update: unchanged hash " << hashSame << " ns, unchanged verify "
+                  << verifySame << " ns, alternating verify " << verifyFlip << " ns\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+// ==================== Test: Cursor State ====================
+void testCursorState()
+{
+    printSection("Test: Cursor State");
+
+    using Shape = std::shared_ptr<const std::vector<uint8_t>>;
+    CursorStatePublisher<Shape> publisher;
+    CursorState state;
+    uint64_t last = 0;
+    Shape shape;
+    bool ok = publisher.read(state) == 0 && state.shapeId == 0 && !publisher.readIfNewer(last, state)
+              && !publisher.shape(0, shape);
+
+    auto arrow = std::make_shared<const std::vector<uint8_t>>(16, 1);
+    CursorState published;
+    published.shapeId = publisher.publishShape(arrow);
+    published.x = 100;
+    published.y = 200;
+    published.hotSpotX = 3;
+    published.visible = 1;
+    ok = ok && publisher.publish(published) == 1 && publisher.readIfNewer(last, state) && last == 1 && state.x == 100
+         && state.y == 200 && state.hotSpotX == 3 && state.visible == 1;
+    ok = ok && publisher.shape(state.shapeId, shape) && shape.get() == arrow.get();
+    printTestResult(ok, "Published state and shape are visible to readers");
+
+    // 新形状发布后，旧编号取不到形状
+    uint64_t oldId = state.shapeId;
+    published.shapeId = publisher.publishShape(std::make_shared<const std::vector<uint8_t>>(16, 2));
+    publisher.publish(published);
+    ok = publisher.readIfNewer(last, state) && state.shapeId != oldId && !publisher.shape(oldId, shape)
+         && publisher.shape(state.shapeId, shape) && (*shape)[0] == 2;
+    printTestResult(ok, "Superseded shape IDs are rejected");
+
+    // 并发：采集线程高频移动光标、偶尔换形状；读者只在形状编号变化时取形状
+    const int EVENTS = 100000;
+    const int READERS = 3;
+    published.x = published.y = published.hotSpotX = 0;
+    publisher.publish(published);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> bad{0}, fetched{0}, superseded{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([&]() {
+            uint64_t version = 0, shapeId = 0;
+            CursorState s;
+            Shape current;
+            while (!done.load(std::memory_order_acquire)) {
+                if (!publisher.readIfNewer(version, s)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // 位置和热点由同一个事件序号推导
+                if (s.y != s.x * 2 || s.hotSpotX != s.x % 7)
+                    bad.fetch_add(1, std::memory_order_relaxed);
+                if (s.shapeId != shapeId) {
+                    if (publisher.shape(s.shapeId, current)) {
+                        fetched.fetch_add(1, std::memory_order_relaxed);
+                        if ((*current)[0] != static_cast<uint8_t>(s.shapeId))
+                            bad.fetch_add(1, std::memory_order_relaxed);
+                        shapeId = s.shapeId;
+                    } else {
+                        superseded.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    }
+    for (int event = 0; event < EVENTS; ++event) {
+        if (event % 1000 == 0) {
+            // 编号从 1 依次递增，形状内容写入下一个编号，读者据此核对
+            auto bytes = std::make_shared<std::vector<uint8_t>>(64);
+            (*bytes)[0] = static_cast<uint8_t>(published.shapeId + 1);
+            published.shapeId = publisher.publishShape(std::move(bytes));
+        }
+        published.x = event;
+        published.y = event * 2;
+        published.hotSpotX = event % 7;
+        publisher.publish(published);
+        if (event % 100 == 0)
+            std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers)
+        t.join();
+
+    std::cout << "  versions=" << publisher.version() << " shapeFetches=" << fetched.load()
+              << " superseded=" << superseded.load() << " retries=" << publisher.retries() << "\n";
+    printTestResult(bad.load() == 0 && fetched.load() > 0, "Concurrent readers see consistent state and matching shapes");
+}
+
+// ==================== Test: Cursor Recording ====================
+// 合成的录制：光标移动，偶尔在箭头 / I 形 / 手形 / 忙碌之间切换形状，偶尔隐藏
+std::vector<CursorRecording::CursorEvent> makeSession(size_t count)
+{
+    using namespace CursorRecording;
+    auto samples = makeShapeSamples();
+    std::vector<CursorEvent> events;
+    std::mt19937 rng(42);
+    size_t shape = 0;
+    for (size_t i = 0; i < count; ++i) {
+        CursorEvent event;
+        event.record.timestamp = static_cast<int64_t>(i) * 10000;
+        event.record.x = static_cast<int32_t>(i % 1920);
+        event.record.y = static_cast<int32_t>((i * 7) % 1080);
+        event.record.displayIndex = static_cast<int32_t>(i / 500 % 2);
+        event.record.flags = rng() % 50 ? uint32_t(EventVisible) : 0;
+        // 每 40 个事件换一次形状；DXGI 有时会重复上报相同的形状
+        if (i % 40 == 0 || rng() % 100 == 0) {
+            if (i % 40 == 0)
+                shape = rng() % 4;
+            const ShapeSample &sample = samples[shape == 3 ? 4 : shape];
+            event.record.setShapeInfo(sample.info);
+            event.record.flags |= EventHasShape;
+            event.record.shapeSize = static_cast<uint32_t>(sample.shape.size());
+            event.record.recordSize += event.record.shapeSize;
+            event.shape = sample.shape;
+        }
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+void printReplayReport(CursorReplay::Report &report)
+{
+    std::cout << "  events=" << report.events << " shapeEvents=" << report.shapeEvents
+              << " shapeChanges=" << report.shapeChanges << " cacheHits=" << report.cacheHits
+              << " encodes=" << report.encodes << " failures=" << report.failures
+              << " encodedBytes=" << report.encodedBytes << "\n"
+              << "  " << std::fixed << std::setprecision(0) << report.eventsPerSecond() << " events/s\n";
+    for (CursorReplay::StageStats *stage :
+         {&report.hash, &report.cache, &report.convert, &report.encode, &report.publish}) {
+        if (stage->count() == 0) {
+            continue;
+        }
+        std::cout << "    " << std::left << std::setw(8) << stage->name << std::right << std::setw(8) << stage->count()
+                  << " calls, avg " << std::setw(8) << stage->averageNs() << " ns, p50 " << std::setw(8)
+                  << stage->percentileNs(50) << " ns, p99 " << std::setw(8) << stage->percentileNs(99)
+                  << " ns, max " << std::setw(8) << stage->percentileNs(100) << " ns\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+void testCursorRecording()
+{
+    printSection("Test: Cursor Recording");
+
+    using namespace CursorRecording;
+    auto session = makeSession(2000);
+    std::string path = (std::filesystem::temp_directory_path() / "cursor_shape_test.crec").string();
+
+    Writer writer;
+    bool ok = writer.open(path.c_str(), 10000000);
+    for (const CursorEvent &event : session) {
+        ok = ok && writer.write(event.record, event.shape.empty() ? nullptr : event.shape.data(), event.shape.size());
+    }
+    uint64_t bytes = writer.bytes();
+    writer.close();
+    std::cout << "  events=" << session.size() << " bytes=" << bytes << "\n";
+
+    RecordingHeader header;
+    std::vector<CursorEvent> loaded;
+    ok = ok && readRecording(path.c_str(), header, loaded) && header.ticksPerSecond == 10000000
+         && loaded.size() == session.size() && std::filesystem::file_size(path) == bytes;
+    for (size_t i = 0; i < loaded.size() && ok; ++i) {
+        ok = std::memcmp(&loaded[i].record, &session[i].record, sizeof(EventRecord)) == 0
+             && loaded[i].shape == session[i].shape;
+    }
+    printTestResult(ok, "Recorded session reads back identically");
+
+    // 截断在最后一条记录中间：前面的记录仍然可用
+    std::filesystem::resize_file(path, bytes - 3);
+    ok = readRecording(path.c_str(), header, loaded) && loaded.size() == session.size() - 1;
+    std::filesystem::remove(path);
+    ok = ok && !readRecording(path.c_str(), header, loaded);
+    printTestResult(ok, "Truncated tail record is ignored, missing file fails");
+
+    // 回放：4 种形状各编码一次，之后的切换都命中缓存
+    for (auto encoding : {CursorEncode::Encoding::Raw, CursorEncode::Encoding::Qoi, CursorEncode::Encoding::StoredPng}) {
+        CursorReplay::Options options;
+        options.encoding = encoding;
+        CursorReplay::Report report = CursorReplay::replay(session, options);
+        std::cout << "  " << CursorEncode::encodingName(encoding) << "\n";
+        printReplayReport(report);
+        bool consistent = report.events == session.size() && report.encodes == 4 && report.failures == 0
+                          && report.cacheHits + report.encodes == report.shapeChanges
+                          && report.shapeChanges < report.shapeEvents && report.publish.count() == session.size();
+        printTestResult(consistent,
+                        std::string("Replay encodes each shape once and reuses the cache (") + CursorEncode::encodingName(encoding) + ")");
+    }
+
+    // 移动事件的热点字段为 0，回放沿用最近一次形状事件的热点；
+    // 像素相同、只有热点变化的形状算作形状变化，Raw 编码把热点写在头部，需要重新编码
+    {
+        auto samples = makeShapeSamples();
+        const ShapeSample &sample = samples[1];
+        std::vector<CursorEvent> events(3);
+        CursorShapeInfo info = sample.info;
+        info.hotSpotX = 3;
+        info.hotSpotY = 4;
+        events[0].record.setShapeInfo(info);
+        events[0].record.flags = EventVisible | EventHasShape;
+        events[0].shape = sample.shape;
+        events[1].record.flags = EventVisible;
+        events[1].record.x = 10;
+        info.hotSpotX = 9;
+        events[2] = events[0];
+        events[2].record.setShapeInfo(info);
+        events[2].record.x = 20;
+
+        CursorReplay::Options options;
+        options.encoding = CursorEncode::Encoding::Raw;
+        std::vector<CursorEvent> firstTwo(events.begin(), events.begin() + 2);
+        CursorReplay::Report moved = CursorReplay::replay(firstTwo, options);
+        CursorReplay::Report raw = CursorReplay::replay(events, options);
+        options.encoding = CursorEncode::Encoding::Qoi;
+        CursorReplay::Report qoi = CursorReplay::replay(events, options);
+        ok = moved.lastState.x == 10 && moved.lastState.hotSpotX == 3 && moved.lastState.hotSpotY == 4
+             && raw.shapeChanges == 2 && raw.encodes == 2 && raw.lastState.hotSpotX == 9
+             && qoi.shapeChanges == 2 && qoi.encodes == 1 && qoi.cacheHits == 1;
+        printTestResult(ok, "Replay keeps the shape hot spot across moves and treats a new hot spot as a change");
+    }
+
+    // 未知版本的录制被拒绝
+    {
+        Writer versioned;
+        ok = versioned.open(path.c_str(), 1000);
+        versioned.close();
+        RecordingHeader future;
+        future.version = RecordingHeader::kVersion + 1;
+        std::FILE *file = std::fopen(path.c_str(), "r+b");
+        ok = ok && file && std::fwrite(&future, sizeof(future), 1, file) == 1;
+        if (file)
+            std::fclose(file);
+        ok = ok && !readRecording(path.c_str(), header, loaded);
+        std::filesystem::remove(path);
+        printTestResult(ok, "Recording with an unknown version is rejected");
+    }
+}
+
+// 命令行回放：cursor_shape replay <file> [raw|qoi|png] [passes]
+int replayMain(int argc, char **argv)
+{
+    CursorRecording::RecordingHeader header;
+    std::vector<CursorRecording::CursorEvent> events;
+    if (!CursorRecording::readRecording(argv[2], header, events)) {
+        std::cerr << "Failed to read recording: " << argv[2] << "\n";
+        return 1;
+    }
+    CursorReplay::Options options;
+    if (argc > 3) {
+        std::string encoding = argv[3];
+        options.encoding = encoding == "raw"   ? CursorEncode::Encoding::Raw
+                           : encoding == "png" ? CursorEncode::Encoding::StoredPng
+                                               : CursorEncode::Encoding::Qoi;
+    }
+    if (argc > 4) {
+        options.passes = std::max(1, std::atoi(argv[4]));
+    }
+    std::cout << "Replaying " << events.size() << " events from " << argv[2] << " ("
+              << CursorEncode::encodingName(options.encoding) << ", " << options.passes << " passes)\n";
+    CursorReplay::Report report = CursorReplay::replay(events, options);
+    printReplayReport(report);
+    return 0;
+}
+
+// ==================== Test: Cursor Stream ====================
+// 按录制事件驱动 Encoder，每 flushEvery 个事件 flush 一次，返回总字节数
+struct StreamResult
+{
+    size_t bytes = 0;
+    size_t flushes = 0;
+    bool consistent = true;
+};
+
+StreamResult streamSession(const std::vector<CursorRecording::CursorEvent> &session, CursorStream::Encoder &encoder,
+                           size_t flushEvery, bool verify)
+{
+    StreamResult result;
+    CursorStream::Decoder decoder;
+    CursorStream::State state;
+    std::vector<uint8_t> out;
+    const std::vector<uint8_t> *expectedShape = nullptr;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    for (size_t i = 0; i < session.size(); ++i) {
+        const CursorRecording::CursorEvent &event = session[i];
+        encoder.move(event.record.x, event.record.y);
+        encoder.setVisible(event.record.visible());
+        if (event.record.hasShape()) {
+            // 彩色和带掩码彩色的样本内容相同，键里加上类型
+            uint64_t key = StripeHash::hash(event.shape.data(), event.shape.size()) ^ event.record.shapeType;
+            encoder.setShape(key, event.shape.data(), event.shape.size(), event.record.hotSpotX, event.record.hotSpotY);
+            expectedShape = &event.shape;
+            hotSpotX = event.record.hotSpotX;
+            hotSpotY = event.record.hotSpotY;
+        }
+        if ((i + 1) % flushEvery != 0 && i + 1 != session.size()) {
+            continue;
+        }
+        out.clear();
+        result.bytes += encoder.flush(out);
+        ++result.flushes;
+        if (verify) {
+            bool ok = decoder.decode(out.data(), out.size(), state) && state.x == event.record.x
+                      && state.y == event.record.y && state.visible == event.record.visible();
+            if (expectedShape) {
+                ok = ok && state.hotSpotX == hotSpotX && state.hotSpotY == hotSpotY
+                     && *decoder.shape(state.slot) == *expectedShape;
+            }
+            result.consistent = result.consistent && ok;
+        }
+    }
+    return result;
+}
+
+void testCursorStream()
+{
+    printSection("Test: Cursor Stream");
+
+    using namespace CursorStream;
+    bool ok = true;
+    for (int64_t value : {int64_t(0), int64_t(-1), int64_t(1), int64_t(63), int64_t(-64), int64_t(64),
+                          int64_t(INT32_MAX) - INT32_MIN, int64_t(INT32_MIN) - INT32_MAX}) {
+        std::vector<uint8_t> buffer;
+        detail::putVarint(buffer, detail::zigzag(value));
+        const uint8_t *data = buffer.data();
+        uint64_t decoded = 0;
+        ok = ok && detail::getVarint(data, buffer.data() + buffer.size(), decoded)
+             && detail::unzigzag(decoded) == value && data == buffer.data() + buffer.size();
+    }
+    std::vector<uint8_t> small;
+    detail::putVarint(small, detail::zigzag(-3));
+    printTestResult(ok && small.size() == 1, "Zigzag varints round-trip, small deltas take one byte");
+
+    auto session = makeSession(2000);
+    size_t shapeBytes = 0;
+    for (const auto &event : session) {
+        shapeBytes += event.shape.size();
+    }
+    for (size_t flushEvery : {size_t(1), size_t(4)}) {
+        Encoder encoder;
+        StreamResult result = streamSession(session, encoder, flushEvery, true);
+        std::cout << "  flush every " << flushEvery << " events: " << result.bytes << " bytes ("
+                  << std::fixed << std::setprecision(2) << double(result.bytes) / session.size()
+                  << " bytes/event), defines=" << encoder.shapeDefines() << " uses=" << encoder.shapeUses()
+                  << " coalesced=" << encoder.coalescedMoves() << ", raw shape bytes " << shapeBytes << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+        printTestResult(result.consistent && encoder.shapeDefines() == 4 && result.bytes < shapeBytes / 4,
+                        "Decoder tracks encoder state, each shape is sent once (flush every " + std::to_string(flushEvery) + ")");
+    }
+
+    // 字典容量小于形状数：被淘汰的形状重新定义，两端字典保持一致
+    {
+        Encoder encoder(2);
+        StreamResult result = streamSession(session, encoder, 1, true);
+        printTestResult(result.consistent && encoder.shapeDefines() > 4, "Evicted shapes are redefined consistently");
+    }
+
+    // 新的接收端在 reset() 之后加入
+    {
+        Encoder encoder;
+        std::vector<uint8_t> out;
+        std::vector<uint8_t> shape(64, 7);
+        encoder.setShape(1, shape.data(), shape.size(), 3, 4);
+        encoder.move(-100, 2000);
+        encoder.setVisible(true);
+        encoder.flush(out);
+        encoder.move(-90, 2001);
+        encoder.reset();
+        out.clear();
+        encoder.flush(out);
+        Decoder decoder;
+        State state;
+        ok = out[0] == RecordReset && decoder.decode(out.data(), out.size(), state) && state.x == -90 && state.y == 2001
+             && state.visible && state.hotSpotX == 3 && state.hotSpotY == 4 && *decoder.shape(state.slot) == shape;
+
+        // 没有变化时不产生任何字节；截断的记录被拒绝
+        std::vector<uint8_t> empty;
+        ok = ok && encoder.flush(empty) == 0;
+        Decoder fresh;
+        State partial;
+        ok = ok && !fresh.decode(out.data(), out.size() - 1, partial);
+        printTestResult(ok, "Reset resynchronizes a new receiver, truncated input is rejected");
+    }
+}
+
+// ==================== Benchmark: Cursor Stream ====================
+// 对比每个事件发送绝对坐标、形状变化时发送整个形状的朴素序列化
+struct EventRecordView
+{
+    int32_t x, y, hotSpotX, hotSpotY;
+    uint32_t visible, shapeSize;
+};
+
+size_t naiveSerialize(const std::vector<CursorRecording::CursorEvent> &session, std::vector<uint8_t> &out)
+{
+    size_t total = 0;
+    for (const auto &event : session) {
+        out.clear();
+        const EventRecordView view{event.record.x, event.record.y, event.record.hotSpotX, event.record.hotSpotY,
+                                   event.record.visible() ? 1u : 0u, static_cast<uint32_t>(event.shape.size())};
+        out.resize(sizeof(view));
+        std::memcpy(out.data(), &view, sizeof(view));
+        out.insert(out.end(), event.shape.begin(), event.shape.end());
+        total += out.size();
+    }
+    return total;
+}
+
+void benchmarkCursorStream()
+{
+    printSection("Benchmark: Cursor Stream");
+
+    auto session = makeSession(100000);
+    std::vector<uint8_t> out;
+    out.reserve(1 << 20);
+
+    auto begin = std::chrono::steady_clock::now();
+    size_t naiveBytes = naiveSerialize(session, out);
+    double naiveNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "  naive             " << std::setw(10) << naiveBytes << " bytes, " << std::fixed
+              << std::setprecision(1) << naiveNs / session.size() << " ns/event\n";
+
+    for (size_t flushEvery : {size_t(1), size_t(4), size_t(16)}) {
+        CursorStream::Encoder encoder;
+        begin = std::chrono::steady_clock::now();
+        StreamResult result = streamSession(session, encoder, flushEvery, false);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "  stream, flush/" << std::setw(2) << flushEvery << " " << std::setw(10) << result.bytes
+                  << " bytes, " << ns / session.size() << " ns/event (incl. shape hashing), "
+                  << 100.0 * result.bytes / naiveBytes << "% of naive\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+// ==================== Test: Cursor Scale ====================
+std::vector<uint8_t> makeRandomImage(uint32_t width, uint32_t height, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < image.size(); i += 4) {
+        uint32_t pixel = rng();
+        // 光标大多是全透明或全不透明，边缘才有半透明
+        uint32_t alpha = pixel >> 24;
+        pixel = (pixel & 0x00FFFFFF) | (alpha < 64 ? 0u : alpha < 192 ? 0xFFu : alpha) << 24;
+        std::memcpy(&image[i], &pixel, 4);
+    }
+    return image;
+}
+
+void testCursorScale()
+{
+    printSection("Test: Cursor Scale");
+
+    using namespace CursorScale;
+    struct Case
+    {
+        uint32_t srcWidth, srcHeight, dstWidth, dstHeight;
+    };
+    const Case cases[] = {{32, 32, 40, 40}, {32, 32, 48, 48}, {32, 32, 64, 64}, {48, 48, 24, 24},
+                          {7, 5, 13, 3},    {1, 1, 3, 3},     {256, 256, 320, 320}};
+
+    for (Isa isa : {Isa::SSE2, Isa::AVX2}) {
+        if (!isaSupported(isa)) {
+            std::cout << "  " << isaName(isa) << " not supported, skipped\n";
+            continue;
+        }
+        bool ok = true;
+        for (Filter filter : {Filter::Bilinear, Filter::CatmullRom}) {
+            for (const Case &c : cases) {
+                auto src = makeRandomImage(c.srcWidth, c.srcHeight, c.dstWidth * 31 + c.srcWidth);
+                std::vector<uint8_t> expected(static_cast<size_t>(c.dstWidth) * c.dstHeight * 4);
+                std::vector<uint8_t> actual(expected.size(), 0xCD);
+                ok = ok
+                     && scaleImage(src.data(), c.srcWidth, c.srcHeight, c.srcWidth * 4, expected.data(), c.dstWidth,
+                                   c.dstHeight, c.dstWidth * 4, filter, kernels(Isa::Scalar))
+                     && scaleImage(src.data(), c.srcWidth, c.srcHeight, c.srcWidth * 4, actual.data(), c.dstWidth,
+                                   c.dstHeight, c.dstWidth * 4, filter, kernels(isa))
+                     && actual == expected;
+            }
+        }
+        printTestResult(ok, std::string(isaName(isa)) + " scaling matches scalar byte for byte");
+    }
+
+    // 同尺寸是恒等变换；纯色图缩放后颜色不变
+    bool ok = true;
+    auto src = makeRandomImage(32, 32, 7);
+    for (Filter filter : {Filter::Bilinear, Filter::CatmullRom}) {
+        std::vector<uint8_t> same(src.size());
+        scaleImage(src.data(), 32, 32, 128, same.data(), 32, 32, 128, filter);
+        // 全透明像素输出为 0，RGB 不保留
+        for (size_t i = 0; i < src.size(); i += 4) {
+            ok = ok && (src[i + 3] == 0 ? std::memcmp(&same[i], "\0\0\0\0", 4) == 0
+                                        : std::memcmp(&same[i], &src[i], 4) == 0);
+        }
+        std::vector<uint8_t> solid(32 * 32 * 4);
+        for (size_t i = 0; i < solid.size(); i += 4) {
+            std::memcpy(&solid[i], "\x30\x80\xC0\xFF", 4);
+        }
+        std::vector<uint8_t> scaled(48 * 48 * 4);
+        scaleImage(solid.data(), 32, 32, 128, scaled.data(), 48, 48, 192, filter);
+        for (size_t i = 0; i < scaled.size(); i += 4) {
+            ok = ok && std::memcmp(&scaled[i], "\x30\x80\xC0\xFF", 4) == 0;
+        }
+    }
+    printTestResult(ok, "Same-size scaling is identity, solid colors stay exact");
+
+    // 预乘空间滤波：透明像素的 RGB（红色）不能渗到不透明的蓝色区域边缘
+    {
+        std::vector<uint8_t> image(16 * 16 * 4);
+        for (uint32_t y = 0; y < 16; ++y) {
+            for (uint32_t x = 0; x < 16; ++x) {
+                uint32_t pixel = x < 8 ? 0x00FF0000u : 0xFF0000FFu;
+                std::memcpy(&image[(y * 16 + x) * 4], &pixel, 4);
+            }
+        }
+        std::vector<uint8_t> scaled(24 * 24 * 4);
+        scaleImage(image.data(), 16, 16, 64, scaled.data(), 24, 24, 96, Filter::CatmullRom);
+        bool clean = true;
+        size_t edge = 0;
+        for (size_t i = 0; i < scaled.size(); i += 4) {
+            clean = clean && scaled[i + 2] == 0 && scaled[i + 1] == 0;
+            edge += scaled[i + 3] != 0 && scaled[i + 3] != 0xFF;
+        }
+        printTestResult(clean && edge > 0, "Transparent color does not bleed into edges");
+    }
+
+    // 缓存：按需生成、命中、后台生成、未知形状
+    {
+        auto keyFor = [](uint64_t hash, int32_t hotSpotX, int32_t hotSpotY) {
+            CursorShapeInfo info;
+            info.type = CursorShapeColor;
+            info.width = 32;
+            info.height = 32;
+            info.pitch = 128;
+            info.hotSpotX = hotSpotX;
+            info.hotSpotY = hotSpotY;
+            return ScaledShapeCache::keyOf(info, hash);
+        };
+        const auto first = keyFor(1, 4, 6);
+        const auto second = keyFor(2, 0, 0);
+        auto image = makeCursorImage(32, 32, 128);
+        ScaledShapeCache cache(4, 8);
+        ok = cache.variant(first, 150) == nullptr && !cache.select(first);
+        cache.setShape(first, image.data(), 32, 32, 128);
+        ScaledCursorPtr a = cache.currentVariant(150);
+        ScaledCursorPtr b = cache.variant(first, 150);
+        ScaledCursorPtr base = cache.variant(first, 100);
+        ok = ok && a && a == b && a->width == 48 && a->height == 48 && a->hotSpotX == 6 && a->hotSpotY == 9
+             && base->width == 32 && std::equal(image.begin(), image.end(), base->pixels.begin())
+             && cache.lazyBuilds() == 1 && cache.hits() == 1;
+
+        cache.setBackgroundScales({125, 200});
+        auto other = makeRandomImage(32, 32, 3);
+        cache.setShape(second, other.data(), 32, 32, 128);
+        cache.waitIdle();
+        ScaledCursorPtr big = cache.currentVariant(200);
+        ok = ok && cache.backgroundBuilds() == 2 && cache.lazyBuilds() == 1 && big && big->width == 64;
+        // 切回已保存的形状只切换当前形状，不产生后台任务，缺少的比例按需生成
+        ok = ok && cache.select(first);
+        cache.waitIdle();
+        ok = ok && cache.backgroundBuilds() == 2 && cache.currentVariant(125)->width == 40 && cache.lazyBuilds() == 2;
+        printTestResult(ok, "Scaled variants are built lazily or in the background and shared");
+    }
+
+    // 像素相同、热点不同的形状各自缓存，不会返回旧热点
+    {
+        auto image = makeCursorImage(32, 32, 128);
+        CursorShapeInfo info;
+        info.type = CursorShapeColor;
+        info.width = 32;
+        info.height = 32;
+        info.pitch = 128;
+        info.hotSpotX = 2;
+        info.hotSpotY = 2;
+        const auto nearKey = ScaledShapeCache::keyOf(info, 7);
+        info.hotSpotX = 20;
+        info.hotSpotY = 10;
+        const auto farKey = ScaledShapeCache::keyOf(info, 7);
+        ScaledShapeCache cache(4, 8);
+        cache.setShape(nearKey, image.data(), 32, 32, 128);
+        ok = !cache.select(farKey);
+        cache.setShape(farKey, image.data(), 32, 32, 128);
+        ScaledCursorPtr farScaled = cache.currentVariant(200);
+        ok = ok && cache.select(nearKey);
+        ScaledCursorPtr nearScaled = cache.currentVariant(200);
+        ok = ok && farScaled && nearScaled && farScaled != nearScaled && farScaled->hotSpotX == 41
+             && farScaled->hotSpotY == 21 && nearScaled->hotSpotX == 5 && nearScaled->hotSpotY == 5;
+        printTestResult(ok, "Same pixels with a different hot spot keep separate variants");
+    }
+
+    // 超出范围的缩放比例被拒绝，不会生成巨大的图像或与其他比例的键冲突
+    {
+        auto image = makeCursorImage(32, 32, 128);
+        CursorShapeInfo info;
+        info.type = CursorShapeColor;
+        info.width = 32;
+        info.height = 32;
+        info.pitch = 128;
+        const auto key = ScaledShapeCache::keyOf(info, 9);
+        ScaledShapeCache cache(4, 8);
+        cache.setBackgroundScales({-150, 0, 150, 65536 + 150, 100000});
+        cache.setShape(key, image.data(), 32, 32, 128);
+        cache.waitIdle();
+        ok = cache.backgroundBuilds() == 1;
+        for (int scale : {-150, 0, 24, 401, 65536 + 150, 100000}) {
+            ok = ok && cache.variant(key, scale) == nullptr && cache.currentVariant(scale) == nullptr;
+        }
+        ScaledCursorPtr low = cache.variant(key, ScaledShapeCache::kMinScalePercent);
+        ScaledCursorPtr high = cache.currentVariant(ScaledShapeCache::kMaxScalePercent);
+        ScaledCursorPtr scaled = cache.variant(key, 150);
+        ok = ok && low && low->width == 8 && high && high->width == 128 && scaled && scaled->width == 48
+             && cache.lazyBuilds() == 2 && cache.hits() == 1;
+        printTestResult(ok, "Out-of-range scale percentages rejected");
+    }
+}
+
+// ==================== Benchmark: Cursor Scale ====================
+void benchmarkCursorScale()
+{
+    printSection("Benchmark: Cursor Scale");
+
+    using namespace CursorScale;
+    for (uint32_t size : {32u, 64u, 128u}) {
+        auto src = makeRandomImage(size, size, size);
+        std::cout << "  " << size << "x" << size << "\n";
+        for (int percent : {125, 150, 200}) {
+            uint32_t dstSize = scaledSize(size, percent);
+            std::vector<uint8_t> dst(static_cast<size_t>(dstSize) * dstSize * 4);
+            const int iterations = static_cast<int>((1u << 22) / (dstSize * dstSize)) + 4;
+            std::cout << "    " << percent << "% ->" << std::setw(4) << dstSize;
+            for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2}) {
+                if (!isaSupported(isa)) {
+                    continue;
+                }
+                auto begin = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) {
+                    scaleImage(src.data(), size, size, size * 4, dst.data(), dstSize, dstSize, dstSize * 4,
+                               Filter::CatmullRom, kernels(isa));
+                }
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count()
+                            / iterations;
+                std::cout << "  " << isaName(isa) << std::fixed << std::setprecision(1) << std::setw(8) << us << " us";
+                std::cout.unsetf(std::ios::floatfield);
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+// ==================== Main ====================
+int main(int argc, char **argv)
+{
+    if (argc > 2 && std::string(argv[1]) == "replay") {
+        return replayMain(argc, argv);
+    }
+
+    std::cout << "========== Running All Tests ==========\n";
+
+    // 单元测试
+    testRowKernels();
+    testColorBlend();
+    testMonochrome();
+    testMaskedColor();
+    testClipping();
+    testMonochromeDecode();
+    testMaskedColorDecode();
+    testShapeCache();
+    testCursorEncode();
+    testShapeFingerprint();
+    testCursorState();
+    testCursorRecording();
+    testCursorStream();
+    testCursorScale();
+
+    // 基准测试
+    if (benchmarksEnabled(argc, argv)) {
+        benchmarkComposite();
+        benchmarkMonochromeDecode();
+        benchmarkMaskedColorDecode();
+        benchmarkCursorEncode();
+        benchmarkShapeFingerprint();
+        benchmarkCursorStream();
+        benchmarkCursorScale();
+    } else {
+        std::cout << "\n(benchmarks skipped, pass --bench or set CURSOR_SHAPE_BENCH=1)\n";
+    }
+
+    std::cout << "\n========== All Tests Finished ==========\n";
+    return 0;
+}
@@ -0,0 +1,294 @@
+#ifndef SCALED_SHAPE_CACHE_H
+#define SCALED_SHAPE_CACHE_H
+
+#include "cursor_scale.h"
+#include "shape_cache.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 一个缩放比例下的光标图像，ARGB32，行宽 width * 4
+ */
+struct ScaledCursor
+{
+    int scalePercent = 100;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int32_t hotSpotX = 0;
+    int32_t hotSpotY = 0;
+    std::vector<uint8_t> pixels;
+};
+
+using ScaledCursorPtr = std::shared_ptr<const ScaledCursor>;
+
+/**
+ * @brief 按形状键缓存光标的多种缩放版本，供不同 DPI 的客户端直接取用
+ *
+ * 键是 keyOf() 得到的完整形状键（哈希、类型、尺寸、行宽和热点），
+ * 像素相同但热点不同、或哈希相同但几何不同的形状互不混淆。
+ *
+ * 采集线程只在形状真正变化时调用：新形状用 setShape() 保存 100% 的原图，
+ * 已经缓存过的形状用 select() 切换，不需要重新转换。客户端用 variant() / currentVariant()
+ * 按缩放百分比取图：第一次请求时在调用线程上生成并缓存，之后直接返回共享的结果。
+ * setBackgroundScales() 指定常用比例后，setShape() 保存的新形状的这些版本由后台线程提前生成；
+ * select() 只切换当前形状，不产生后台任务，被淘汰的版本在下次请求时按需生成。
+ *
+ * 缩放百分比必须在 [kMinScalePercent, kMaxScalePercent] 之内，超出范围的请求返回空指针，
+ * setBackgroundScales() 中超出范围的比例被忽略。
+ *
+ * 原图和缩放结果分别放在两个 ShapeCache 中（缩放结果的键在 type 字段的高 16 位存放百分比），
+ * 都按最久未使用淘汰。所有方法线程安全；缩放在锁外进行，同一版本被并发请求时
+ * 可能重复生成一次，结果相同。
+ */
+class ScaledShapeCache
+{
+public:
+    using Key = ShapeCache<ScaledCursorPtr>::Key;
+
+    static constexpr int kMinScalePercent = 25;
+    static constexpr int kMaxScalePercent = 400;
+
+    static bool validScale(int scalePercent)
+    {
+        return scalePercent >= kMinScalePercent && scalePercent <= kMaxScalePercent;
+    }
+
+    // 带热点的完整形状键
+    static Key keyOf(const CursorShapeInfo &info, uint64_t hash)
+    {
+        return ShapeCache<ScaledCursorPtr>::keyOf(info, hash, true);
+    }
+
+    explicit ScaledShapeCache(size_t shapeCapacity = 16, size_t variantCapacity = 64,
+                              CursorScale::Filter filter = CursorScale::Filter::CatmullRom)
+        : m_bases(shapeCapacity)
+        , m_variants(variantCapacity)
+        , m_filter(filter)
+    {
+    }
+
+    ~ScaledShapeCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    ScaledShapeCache(const ScaledShapeCache &) = delete;
+    ScaledShapeCache &operator=(const ScaledShapeCache &) = delete;
+
+    /**
+     * @brief 设置每个新形状在后台预先生成的缩放比例，非空时启动后台线程
+     *
+     * 超出 [kMinScalePercent, kMaxScalePercent] 的比例被丢弃。
+     */
+    void setBackgroundScales(std::vector<int> scalePercents)
+    {
+        scalePercents.erase(std::remove_if(scalePercents.begin(), scalePercents.end(),
+                                           [](int scale) { return !validScale(scale); }),
+                            scalePercents.end());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_backgroundScales = std::move(scalePercents);
+        if (!m_backgroundScales.empty() && !m_worker.joinable()) {
+            m_worker = std::thread([this] { backgroundLoop(); });
+        }
+    }
+
+    /**
+     * @brief 保存新形状的原图（ARGB32）并设为当前形状，热点取自 key
+     * @param width 转换后的图像尺寸（单色光标的图像高度是 key.height 的一半）
+     */
+    void setShape(const Key &key, const uint8_t *pixels, uint32_t width, uint32_t height, size_t stride)
+    {
+        auto base = std::make_shared<ScaledCursor>();
+        base->width = width;
+        base->height = height;
+        base->hotSpotX = key.hotSpotX;
+        base->hotSpotY = key.hotSpotY;
+        base->pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (uint32_t y = 0; y < height; ++y) {
+            std::copy(pixels + y * stride, pixels + y * stride + width * 4, base->pixels.begin() + y * width * 4);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bases.insert(key, std::move(base));
+        m_current = key;
+        m_hasCurrent = true;
+        enqueueLocked(key);
+    }
+
+    /**
+     * @brief 切换到已保存的形状
+     * @return 原图不在缓存中时返回 false，调用方应转换后调用 setShape()
+     */
+    bool select(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ScaledCursorPtr base;
+        if (!m_bases.lookup(key, base)) {
+            return false;
+        }
+        m_current = key;
+        m_hasCurrent = true;
+        return true;
+    }
+
+    /**
+     * @brief 取形状 key 的 scalePercent 版本，不存在时在调用线程上生成
+     * @return 原图不在缓存中或 scalePercent 超出范围时返回空指针
+     */
+    ScaledCursorPtr variant(const Key &key, int scalePercent) { return variant(key, scalePercent, false); }
+
+    // 当前形状的 scalePercent 版本，还没有形状或 scalePercent 超出范围时返回空指针
+    ScaledCursorPtr currentVariant(int scalePercent)
+    {
+        if (!validScale(scalePercent)) {
+            return nullptr;
+        }
+        Key key;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_hasCurrent) {
+                return nullptr;
+            }
+            key = m_current;
+        }
+        return variant(key, scalePercent);
+    }
+
+    // 等待后台队列处理完毕
+    void waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    }
+
+    uint64_t hits() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+
+    uint64_t lazyBuilds() const // 在请求线程上生成的次数
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lazyBuilds;
+    }
+
+    uint64_t backgroundBuilds() const // 由后台线程生成的次数
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_backgroundBuilds;
+    }
+
+private:
+    // 形状类型只用到低位，百分比放在 type 的高 16 位（已由 validScale() 限制在 16 位以内）
+    static Key variantKey(const Key &key, int scalePercent)
+    {
+        Key variant = key;
+        variant.type = (key.type & 0xFFFFu) | (static_cast<uint32_t>(scalePercent) << 16);
+        return variant;
+    }
+
+    ScaledCursorPtr variant(const Key &key, int scalePercent, bool background)
+    {
+        if (!validScale(scalePercent)) {
+            return nullptr;
+        }
+        ScaledCursorPtr base;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_bases.lookup(key, base)) {
+                return nullptr;
+            }
+            if (scalePercent == 100) {
+                return base;
+            }
+            ScaledCursorPtr scaled;
+            if (m_variants.lookup(variantKey(key, scalePercent), scaled)) {
+                m_hits += background ? 0 : 1;
+                return scaled;
+            }
+        }
+
+        auto scaled = std::make_shared<ScaledCursor>();
+        scaled->scalePercent = scalePercent;
+        scaled->width = CursorScale::scaledSize(base->width, scalePercent);
+        scaled->height = CursorScale::scaledSize(base->height, scalePercent);
+        scaled->hotSpotX = std::min<int32_t>(CursorScale::scaledHotSpot(base->hotSpotX, scalePercent), scaled->width - 1);
+        scaled->hotSpotY = std::min<int32_t>(CursorScale::scaledHotSpot(base->hotSpotY, scalePercent), scaled->height - 1);
+        scaled->pixels.resize(static_cast<size_t>(scaled->width) * scaled->height * 4);
+        CursorScale::scaleImage(base->pixels.data(), base->width, base->height, base->width * 4, scaled->pixels.data(),
+                                scaled->width, scaled->height, scaled->width * 4, m_filter);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_variants.insert(variantKey(key, scalePercent), scaled);
+        ++(background ? m_backgroundBuilds : m_lazyBuilds);
+        return scaled;
+    }
+
+    void enqueueLocked(const Key &key)
+    {
+        if (m_backgroundScales.empty()) {
+            return;
+        }
+        for (int scale : m_backgroundScales) {
+            m_queue.emplace_back(key, scale);
+        }
+        m_wake.notify_one();
+    }
+
+    void backgroundLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) {
+                return;
+            }
+            auto job = m_queue.front();
+            m_queue.pop_front();
+            m_busy = true;
+            lock.unlock();
+            variant(job.first, job.second, true);
+            lock.lock();
+            m_busy = false;
+            if (m_queue.empty()) {
+                m_idle.notify_all();
+            }
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    ShapeCache<ScaledCursorPtr> m_bases;
+    ShapeCache<ScaledCursorPtr> m_variants;
+    CursorScale::Filter m_filter;
+    Key m_current;
+    bool m_hasCurrent = false;
+
+    std::vector<int> m_backgroundScales;
+    std::deque<std::pair<Key, int>> m_queue;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::thread m_worker;
+    bool m_busy = false;
+    bool m_stop = false;
+
+    uint64_t m_hits = 0;
+    uint64_t m_lazyBuilds = 0;
+    uint64_t m_backgroundBuilds = 0;
+};
+
+#endif // SCALED_SHAPE_CACHE_H
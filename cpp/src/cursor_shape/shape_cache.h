@@ -0,0 +1,136 @@
+#ifndef SHAPE_CACHE_H
+#define SHAPE_CACHE_H
+
+#include "cursor_shape.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 按形状内容寻址的光标编码缓存，容量固定，满了淘汰最久未使用的项
+ *
+ * 光标通常只在几种形状之间切换（箭头、I 形、手形、忙碌），而且只改变可见性或
+ * 所在显示器时形状哈希不变。用 (哈希, 类型, 宽, 高, pitch) 作为键缓存编码结果，
+ * 形状切换就从一次 PNG 编码变成一次查找。
+ *
+ * Value 应当是隐式共享的类型（QByteArray、std::shared_ptr<const std::vector<uint8_t>> 等），
+ * lookup() 只复制句柄，不复制编码数据。容量通常只有十几项，线性查找比哈希表更快，
+ * 所有项在构造时分配。非线程安全，由采集线程独占使用。
+ */
+template <typename Value>
+class ShapeCache
+{
+public:
+    struct Key
+    {
+        uint64_t hash = 0;
+        uint32_t type = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t pitch = 0;
+        int32_t hotSpotX = 0;
+        int32_t hotSpotY = 0;
+
+        bool operator==(const Key &other) const
+        {
+            return hash == other.hash && type == other.type && width == other.width && height == other.height
+                   && pitch == other.pitch && hotSpotX == other.hotSpotX && hotSpotY == other.hotSpotY;
+        }
+    };
+
+    // 热点通常不影响编码结果，不参与键；编码中带有热点时（如 Raw 头部）传 withHotSpot = true
+    static Key keyOf(const CursorShapeInfo &info, uint64_t hash, bool withHotSpot = false)
+    {
+        return Key{hash,
+                   info.type,
+                   info.width,
+                   info.height,
+                   info.pitch,
+                   withHotSpot ? info.hotSpotX : 0,
+                   withHotSpot ? info.hotSpotY : 0};
+    }
+
+    explicit ShapeCache(size_t capacity = 16)
+        : m_entries(capacity ? capacity : 1)
+    {
+    }
+
+    /**
+     * @brief 查找键对应的编码结果，命中时刷新为最近使用
+     * @return 未命中时返回 false，value 不变
+     */
+    bool lookup(const Key &key, Value &value)
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            if (m_entries[i].key == key) {
+                m_entries[i].lastUse = ++m_clock;
+                value = m_entries[i].value;
+                ++m_hits;
+                return true;
+            }
+        }
+        ++m_misses;
+        return false;
+    }
+
+    // 插入或替换；缓存已满时淘汰最久未使用的项
+    void insert(const Key &key, Value value)
+    {
+        size_t slot = m_size;
+        for (size_t i = 0; i < m_size; ++i) {
+            if (m_entries[i].key == key) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == m_size) {
+            if (m_size < m_entries.size()) {
+                ++m_size;
+            } else {
+                slot = 0;
+                for (size_t i = 1; i < m_size; ++i) {
+                    if (m_entries[i].lastUse < m_entries[slot].lastUse) {
+                        slot = i;
+                    }
+                }
+                ++m_evictions;
+            }
+        }
+        m_entries[slot].key = key;
+        m_entries[slot].value = std::move(value);
+        m_entries[slot].lastUse = ++m_clock;
+    }
+
+    // 清空所有项，释放缓存的编码数据
+    void clear()
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            m_entries[i].value = Value();
+        }
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_entries.size(); }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+    uint64_t evictions() const { return m_evictions; }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+        uint64_t lastUse = 0;
+    };
+
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+    uint64_t m_clock = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_evictions = 0;
+};
+
+#endif // SHAPE_CACHE_H
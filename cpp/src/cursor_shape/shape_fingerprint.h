@@ -0,0 +1,98 @@
+#ifndef SHAPE_FINGERPRINT_H
+#define SHAPE_FINGERPRINT_H
+
+#include "cursor_shape.h"
+#include "stripe_hash.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief 光标形状变化检测，替代对整个形状缓冲的 qHash
+ *
+ * 每次收到形状更新时调用 update()，按代价从低到高判断：
+ * 1. 类型、宽、高、pitch 或缓冲长度不同 → 一定变化，不需要比较内容
+ * 2. 开启 verify 时直接与保存的上一份缓冲 memcmp：相同则未变化，连哈希都不用算；
+ *    不同才计算哈希。结果精确，没有碰撞
+ * 3. 未开启 verify 时比较 StripeHash（XXH3 风格的 64 位向量化哈希），碰撞概率约 2^-64
+ *
+ * hash() 是当前形状的内容哈希，可与形状描述一起作为 ShapeCache 的键。
+ * verify 模式额外保存一份形状缓冲（最大 256 KB），只在形状变化时复制。非线程安全。
+ */
+class ShapeFingerprint
+{
+public:
+    explicit ShapeFingerprint(bool verify = false, StripeHash::AccumulateFn accumulate = StripeHash::bestAccumulate())
+        : m_verify(verify)
+        , m_accumulate(accumulate)
+    {
+    }
+
+    /**
+     * @brief 记录新的形状
+     * @return 与上一次记录的形状不同时返回 true；第一次调用和 reset() 之后总是返回 true
+     */
+    bool update(const CursorShapeInfo &info, const uint8_t *shape, size_t size)
+    {
+        bool sameGeometry = m_valid && info.type == m_info.type && info.width == m_info.width
+                            && info.height == m_info.height && info.pitch == m_info.pitch && size == m_size;
+        if (!sameGeometry) {
+            ++m_geometryChanges;
+            record(info, shape, size, StripeHash::hash(shape, size, m_accumulate));
+            return true;
+        }
+
+        if (m_verify) {
+            ++m_compares;
+            if (size == 0 || std::memcmp(m_previous.data(), shape, size) == 0) {
+                return false;
+            }
+            record(info, shape, size, StripeHash::hash(shape, size, m_accumulate));
+            return true;
+        }
+
+        ++m_hashCompares;
+        uint64_t hash = StripeHash::hash(shape, size, m_accumulate);
+        if (hash == m_hash) {
+            return false;
+        }
+        record(info, shape, size, hash);
+        return true;
+    }
+
+    // 丢弃记录的形状，下一次 update() 报告变化
+    void reset() { m_valid = false; }
+
+    uint64_t hash() const { return m_hash; }
+    bool verify() const { return m_verify; }
+
+    uint64_t geometryChanges() const { return m_geometryChanges; } // 由形状描述直接判定变化的次数
+    uint64_t compares() const { return m_compares; }               // verify 模式下逐字节比较的次数
+    uint64_t hashCompares() const { return m_hashCompares; }       // 只比较哈希的次数
+
+private:
+    void record(const CursorShapeInfo &info, const uint8_t *shape, size_t size, uint64_t hash)
+    {
+        m_info = info;
+        m_size = size;
+        m_hash = hash;
+        m_valid = true;
+        if (m_verify) {
+            m_previous.assign(shape, shape + size);
+        }
+    }
+
+    bool m_verify;
+    StripeHash::AccumulateFn m_accumulate;
+    bool m_valid = false;
+    CursorShapeInfo m_info;
+    size_t m_size = 0;
+    uint64_t m_hash = 0;
+    std::vector<uint8_t> m_previous;
+    uint64_t m_geometryChanges = 0;
+    uint64_t m_compares = 0;
+    uint64_t m_hashCompares = 0;
+};
+
+#endif // SHAPE_FINGERPRINT_H
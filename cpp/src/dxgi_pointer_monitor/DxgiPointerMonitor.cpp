@@ -1,6 +1,9 @@
 #include "DxgiPointerMonitor.h"
 #include "DxgiPointerMonitor_p.h"
 
+#include "cursor_decode.h"
+#include "cursor_encode.h"
+
 #include <QPoint>
 #include <QStringView>
 #include <QDir>
@@ -180,6 +183,174 @@ void DxgiPointerMonitorPrivate::resetDisplayDuplications()
     qCInfo(lcPointerMonitor, "Display count: %lld", displayDuplications.size());
 }
 
+void DxgiPointerMonitor::setCursorEncoding(CursorEncoding encoding)
+{
+    Q_D(DxgiPointerMonitor);
+    if (d->cursorEncoding != encoding) {
+        d->cursorEncoding = encoding;
+        d->shapeCache.clear();
+    }
+}
+
+DxgiPointerMonitor::CursorEncoding DxgiPointerMonitor::cursorEncoding() const
+{
+    Q_D(const DxgiPointerMonitor);
+    return d->cursorEncoding;
+}
+
+void DxgiPointerMonitor::setCursorScales(const QList<int>& scalePercents)
+{
+    Q_D(DxgiPointerMonitor);
+    d->scaledShapes.setBackgroundScales(std::vector<int>(scalePercents.begin(), scalePercents.end()));
+}
+
+QImage DxgiPointerMonitor::scaledCursor(int scalePercent, QPoint* hotSpot)
+{
+    Q_D(DxgiPointerMonitor);
+    if (!ScaledShapeCache::validScale(scalePercent)) {
+        return QImage();
+    }
+    ScaledCursorPtr scaled = d->scaledShapes.currentVariant(scalePercent);
+    if (!scaled) {
+        return QImage();
+    }
+    if (hotSpot) {
+        *hotSpot = QPoint(scaled->hotSpotX, scaled->hotSpotY);
+    }
+    // QImage 直接引用缓存中的像素，由 cleanup 函数释放持有的引用
+    auto* holder = new ScaledCursorPtr(scaled);
+    return QImage(scaled->pixels.data(), static_cast<int>(scaled->width), static_cast<int>(scaled->height),
+                  static_cast<qsizetype>(scaled->width) * 4, QImage::Format_ARGB32,
+                  [](void* info) { delete static_cast<ScaledCursorPtr*>(info); }, holder);
+}
+
+bool DxgiPointerMonitorPrivate::encodeCursor(const QImage& image, QByteArray& cursorData) const
+{
+    cursorData = QByteArray();
+    if (cursorEncoding == DxgiPointerMonitor::CursorEncoding::Png) {
+        // Convert QImage to PNG QByteArray
+        QBuffer buffer(&cursorData);
+        buffer.open(QIODevice::WriteOnly);
+        return image.save(&buffer, "PNG");
+    }
+
+    CursorEncode::Encoding encoding = CursorEncode::Encoding::Raw;
+    if (cursorEncoding == DxgiPointerMonitor::CursorEncoding::Qoi) {
+        encoding = CursorEncode::Encoding::Qoi;
+    } else if (cursorEncoding == DxgiPointerMonitor::CursorEncoding::StoredPng) {
+        encoding = CursorEncode::Encoding::StoredPng;
+    }
+    if (image.format() != QImage::Format_ARGB32) {
+        return false;
+    }
+    CursorEncode::Image view;
+    view.data = image.constBits();
+    view.width = static_cast<uint32_t>(image.width());
+    view.height = static_cast<uint32_t>(image.height());
+    view.stride = static_cast<size_t>(image.bytesPerLine());
+    view.hotSpotX = static_cast<int32_t>(pointerInfo.hotSpotX());
+    view.hotSpotY = static_cast<int32_t>(pointerInfo.hotSpotY());
+
+    // 按最坏情况分配后截断到实际长度
+    size_t capacity = CursorEncode::maxEncodedSize(encoding, view.width, view.height);
+    cursorData.resize(static_cast<qsizetype>(capacity));
+    size_t written = CursorEncode::encode(encoding, view, reinterpret_cast<uint8_t*>(cursorData.data()), capacity);
+    cursorData.truncate(static_cast<qsizetype>(written));
+    return written > 0;
+}
+
+void DxgiPointerMonitorPrivate::publishCursor(bool visible, const QPoint& position, const QPoint& hotSpot, const QByteArray& cursorData)
+{
+    // 缓存命中时得到的是同一个共享数据块，只有数据块变化时才发布新形状，并且要先于引用它的状态发布
+    if (cursorData.constData() != publishedShape.constData() || cursorData.size() != publishedShape.size()) {
+        publishedShape = cursorData;
+        publishedShapeId = cursorData.isEmpty() ? 0 : cursorState.publishShape(cursorData);
+    }
+
+    CursorState state;
+    state.shapeId = publishedShapeId;
+    state.x = position.x();
+    state.y = position.y();
+    state.hotSpotX = hotSpot.x();
+    state.hotSpotY = hotSpot.y();
+    state.visible = visible ? 1 : 0;
+    cursorState.publish(state);
+}
+
+void DxgiPointerMonitorPrivate::recordPointerUpdate(const DXGI_OUTDUPL_FRAME_INFO* frameInfo, const POINT& cursorPos,
+                                                    int displayIndex, const QByteArray* shape)
+{
+    if (!recorder.isOpen()) {
+        return;
+    }
+    CursorRecording::EventRecord record;
+    record.timestamp = frameInfo->LastMouseUpdateTime.QuadPart;
+    record.x = cursorPos.x;
+    record.y = cursorPos.y;
+    record.displayIndex = displayIndex;
+    record.flags = frameInfo->PointerPosition.Visible ? CursorRecording::EventVisible : 0;
+    if (shape) {
+        record.setShapeInfo(pointerInfo.portableShapeInfo());
+    }
+    const uint8_t* data = shape ? reinterpret_cast<const uint8_t*>(shape->constData()) : nullptr;
+    if (!recorder.write(record, data, shape ? static_cast<size_t>(shape->size()) : 0)) {
+        qCWarning(lcPointerMonitor, "Failed to write cursor recording, stop recording after %llu events",
+                  static_cast<unsigned long long>(recorder.events()));
+        recorder.close();
+    }
+}
+
+bool DxgiPointerMonitor::startRecording(const QString& path)
+{
+    Q_D(DxgiPointerMonitor);
+    LARGE_INTEGER frequency{};
+    QueryPerformanceFrequency(&frequency);
+    if (!d->recorder.open(QDir::toNativeSeparators(path).toLocal8Bit().constData(), frequency.QuadPart)) {
+        qCWarning(lcPointerMonitor, "Failed to open cursor recording %s", qPrintable(path));
+        return false;
+    }
+    qCInfo(lcPointerMonitor, "Recording cursor events to %s", qPrintable(path));
+    return true;
+}
+
+void DxgiPointerMonitor::stopRecording()
+{
+    Q_D(DxgiPointerMonitor);
+    if (d->recorder.isOpen()) {
+        qCInfo(lcPointerMonitor, "Cursor recording stopped, %llu events, %llu bytes",
+               static_cast<unsigned long long>(d->recorder.events()), static_cast<unsigned long long>(d->recorder.bytes()));
+        d->recorder.close();
+    }
+}
+
+bool DxgiPointerMonitor::latestCursor(CursorSnapshot& snapshot) const
+{
+    Q_D(const DxgiPointerMonitor);
+    CursorState state;
+    quint64 version = snapshot.version;
+    if (!d->cursorState.readIfNewer(version, state)) {
+        return false;
+    }
+    // 取形状失败说明形状刚被替换，引用新形状的状态随后就会发布，重新读取
+    while (state.shapeId != snapshot.shapeId) {
+        if (state.shapeId == 0) {
+            snapshot.cursorData = QByteArray();
+            break;
+        }
+        if (d->cursorState.shape(state.shapeId, snapshot.cursorData)) {
+            break;
+        }
+        version = d->cursorState.read(state);
+    }
+
+    snapshot.version = version;
+    snapshot.visible = state.visible != 0;
+    snapshot.position = QPoint(state.x, state.y);
+    snapshot.hotSpot = QPoint(state.hotSpotX, state.hotSpotY);
+    snapshot.shapeId = state.shapeId;
+    return true;
+}
+
 bool DxgiPointerMonitor::capture(bool& visible, QPoint& position, QPoint& hotSpot, QByteArray& cursorData, bool& changed)
 {
     Q_D(DxgiPointerMonitor);
@@ -197,6 +368,7 @@ bool DxgiPointerMonitor::capture(bool& visible, QPoint& position, QPoint& hotSpo
             position = QPoint(w / 2, h / 2);
         }
         qCInfo(lcPointerMonitor, "First poll, set visible to false and put to screen middle");
+        d->publishCursor(visible, position, hotSpot, QByteArray());
         return true;
     }
 
@@ -279,24 +451,47 @@ bool DxgiPointerMonitor::capture(bool& visible, QPoint& position, QPoint& hotSpo
         hotSpot = QPoint(static_cast<int>(d->pointerInfo.hotSpotX()), static_cast<int>(d->pointerInfo.hotSpotY()));
         changed = d->pointerInfo.changed;
 
-        // Convert the pointer shape data to PNG format
+        // Convert the pointer shape data to the selected encoding (PNG by default)
+        // 形状哈希和尺寸相同的编码结果直接从缓存取出（QByteArray 隐式共享，不复制数据）
         if (!d->pointerInfo.shapeBuffer.isEmpty()) {
+            // Raw 头部带有热点，热点也要参与键
+            const bool withHotSpot = d->cursorEncoding == CursorEncoding::Raw;
+            const auto key = ShapeCache<QByteArray>::keyOf(d->pointerInfo.portableShapeInfo(), d->pointerInfo.hash, withHotSpot);
             QImage image;
-            if (d->pointerInfo.ConvertPointerShapeToQImage(image)) {
-                // Convert QImage to PNG QByteArray
-                QBuffer buffer(&cursorData);
-                buffer.open(QIODevice::WriteOnly);
-                if (!image.save(&buffer, "PNG")) {
-                    qCWarning(lcPointerMonitor, "Failed to convert cursor image to PNG format");
-                    cursorData = QByteArray(); // Set to empty if save fails
+            bool converted = false;
+            if (!d->shapeCache.lookup(key, cursorData)) {
+                converted = d->pointerInfo.ConvertPointerShapeToQImage(image);
+                if (converted) {
+                    if (d->encodeCursor(image, cursorData)) {
+                        d->shapeCache.insert(key, cursorData);
+                    } else {
+                        qCWarning(lcPointerMonitor, "Failed to encode cursor image");
+                        cursorData = QByteArray(); // Set to empty if encoding fails
+                    }
+                } else {
+                    qCWarning(lcPointerMonitor, "Failed to convert pointer shape to QImage");
+                    cursorData = QByteArray();
+                }
+            }
+            // 只在形状真正变化时切换缩放缓存，单纯移动不碰缓存的锁和后台队列；
+            // 缩放缓存中没有原图时才需要转换（编码缓存命中时 image 为空）
+            if (d->pointerInfo.shapeChanged) {
+                d->pointerInfo.shapeChanged = false;
+                const auto scaledKey = ScaledShapeCache::keyOf(d->pointerInfo.portableShapeInfo(), d->pointerInfo.hash);
+                if (!d->scaledShapes.select(scaledKey)) {
+                    if (!converted) {
+                        converted = d->pointerInfo.ConvertPointerShapeToQImage(image);
+                    }
+                    if (converted && image.format() == QImage::Format_ARGB32) {
+                        d->scaledShapes.setShape(scaledKey, image.constBits(), static_cast<uint32_t>(image.width()),
+                                                 static_cast<uint32_t>(image.height()), static_cast<size_t>(image.bytesPerLine()));
+                    }
                 }
-            } else {
-                qCWarning(lcPointerMonitor, "Failed to convert pointer shape to QImage");
-                cursorData = QByteArray();
             }
         } else {
             cursorData = QByteArray(); // No cursor data
         }
+        d->publishCursor(visible, position, hotSpot, cursorData);
         break;
     }
     return true;
@@ -350,6 +545,7 @@ bool DisplayDuplication::getPointerInfo(DXGI_OUTDUPL_FRAME_INFO* frameInfo) cons
 
     // No new shape
     if (frameInfo->PointerShapeBufferSize == 0) {
+        monitor->recordPointerUpdate(frameInfo, cursorPos, displayIndex, nullptr);
         if (monitor->pointerInfo.visible) {
             return false;
         }
@@ -381,13 +577,24 @@ bool DisplayDuplication::getPointerInfo(DXGI_OUTDUPL_FRAME_INFO* frameInfo) cons
 
     // Resize to actual required size
     monitor->pointerInfo.shapeBuffer.resize(bufferSizeRequired);
-
-    size_t hash = 0;
-    if (!monitor->pointerInfo.shapeBuffer.isEmpty()) {
-        hash = qHash(monitor->pointerInfo.shapeBuffer);
-        if (hash != monitor->pointerInfo.hash) {
-            monitor->pointerInfo.hash = hash;
-            monitor->pointerInfo.changed = true;
+    monitor->recordPointerUpdate(frameInfo, cursorPos, displayIndex, &monitor->pointerInfo.shapeBuffer);
+
+    // 先比较形状描述，再与上一份形状逐字节比较，只有形状真正变化时才计算哈希
+    PointerInfo& pointerInfo = monitor->pointerInfo;
+    if (!pointerInfo.shapeBuffer.isEmpty()) {
+        if (pointerInfo.fingerprint.update(pointerInfo.portableShapeInfo(),
+                                           reinterpret_cast<const uint8_t*>(pointerInfo.shapeBuffer.constData()),
+                                           static_cast<size_t>(pointerInfo.shapeBuffer.size()))) {
+            pointerInfo.hash = pointerInfo.fingerprint.hash();
+            pointerInfo.changed = true;
+            pointerInfo.shapeChanged = true;
+        }
+        // 指纹不比较热点，热点单独检查
+        const QPoint shapeHotSpot(static_cast<int>(pointerInfo.hotSpotX()), static_cast<int>(pointerInfo.hotSpotY()));
+        if (pointerInfo.shapeHotSpot != shapeHotSpot) {
+            pointerInfo.shapeHotSpot = shapeHotSpot;
+            pointerInfo.changed = true;
+            pointerInfo.shapeChanged = true;
         }
     }
 
@@ -445,34 +652,13 @@ bool PointerInfo::ConvertPointerShapeToQImage(QImage& image)
         int realHeight = static_cast<int>(height()) / 2;
         image = QImage(static_cast<int>(width()), realHeight, QImage::Format_ARGB32);
 
-        for (int row = 0; row < realHeight; ++row) {
-            auto dst = reinterpret_cast<quint32*>(image.scanLine(row));
-
-            for (quint32 col = 0; col < width(); ++col) {
-                uint8_t mask = 0x80 >> (col % 8);
-                // AND mask
-                bool andBit = (shapeBuffer[row * pitch() + col / 8] & mask);
-                // XOR mask
-                bool xorBit = (shapeBuffer[(realHeight + row) * pitch() + col / 8] & mask);
-
-                quint32 pixel = 0x00000000; // 默认 alpha = 255
-
-                if (!andBit && !xorBit) {
-                    // Case 1: AND=0 XOR=0 → 黑色
-                    pixel = 0xFF000000;
-                } else if (!andBit && xorBit) {
-                    // Case 2: AND=0 XOR=1 → 白色
-                    pixel = 0xFFFFFFFF;
-                } else if (andBit && !xorBit) {
-                    // Case 3: AND=1 XOR=0 → 显示桌面背景 => 算作透明
-                    pixel = 0x00000000;
-                } else { // (andBit && xorBit)
-                    // Case 4: AND=1 XOR=1 → 反色 => 算作黑色
-                    pixel = 0xFF000000;
-                }
-
-                dst[col] = pixel;
-            }
+        // 按字节展开 AND / XOR 掩码，规则见 cursor_decode.h：
+        // AND=0 XOR=0 → 黑色，AND=0 XOR=1 → 白色，AND=1 XOR=0 → 透明，AND=1 XOR=1 → 反色，算作黑色
+        if (!CursorDecode::decodeMonochrome(portableShapeInfo(), reinterpret_cast<const uint8_t*>(shapeBuffer.constData()),
+                                            static_cast<size_t>(shapeBuffer.size()), image.bits(),
+                                            static_cast<size_t>(image.bytesPerLine()))) {
+            qCWarning(lcPointerMonitor, "Invalid monochrome pointer shape");
+            return false;
         }
 
         return true;
@@ -483,32 +669,20 @@ bool PointerInfo::ConvertPointerShapeToQImage(QImage& image)
         // The only allowed mask values are 0 and 0xFF.
         // When the mask value is 0, the RGB value should replace the screen pixel.
         // When the mask value is 0xFF, an XOR operation is performed on the RGB value and the screen pixel; the result replaces the screen pixel.
-        image = QImage(reinterpret_cast<const uchar*>(shapeBuffer.constData()), static_cast<int>(width()), static_cast<int>(height()), static_cast<qsizetype>(pitch()), QImage::Format_ARGB32);
-        // 遍历每行每列修改 alpha 为 0xFF 的像素
-        for (quint32 row = 0; row < height(); ++row) {
-            auto dst = reinterpret_cast<quint32*>(image.scanLine(static_cast<int>(row)));
-            for (quint32 col = 0; col < width(); ++col) {
-                quint32 pixel = dst[col];
-                uint8_t alpha = pixel >> 24;
-                if (alpha == 0xFF) {
-                    // alpha = 0xFF → 将 RGB 值与桌面值进行 XOR 运算
-                    // 因为我们不处理反色，
-                    // 如果 RGB 是黑色，则可认为是透明
-                    // 其他情况认为是黑色
-                    if ((pixel & 0x00FFFFFF) == 0x00000000) {
-                        dst[col] = 0x00000000; // 透明
-                    } else {
-                        dst[col] = 0xFF000000; // 黑色
-                    }
-                } else if (alpha == 0x00) {
-                    // alpha = 0x00 → 修改为不透明，保留 RGB
-                    dst[col] = (pixel & 0x00FFFFFF) | 0xFF000000;
-                } else {
-                    qCInfo(lcPointerMonitor, "Alpha value unexpected: %u", alpha);
-                    Q_ASSERT(false);
-                    return false;
-                }
+        // 直接转换到输出图像：alpha = 0x00 → 不透明并保留 RGB；alpha = 0xFF → XOR，
+        // 因为我们不处理反色，RGB 为黑色时算作透明，其他情况算作黑色。
+        // 非法 alpha 不在循环中中断，转换完成后统一报告
+        image = QImage(static_cast<int>(width()), static_cast<int>(height()), QImage::Format_ARGB32);
+        size_t invalidPixels = 0;
+        if (!CursorDecode::decodeMaskedColor(portableShapeInfo(), reinterpret_cast<const uint8_t*>(shapeBuffer.constData()),
+                                             static_cast<size_t>(shapeBuffer.size()), image.bits(),
+                                             static_cast<size_t>(image.bytesPerLine()), &invalidPixels)) {
+            if (invalidPixels) {
+                qCWarning(lcPointerMonitor, "Masked color pointer shape has %zu pixels with unexpected alpha", invalidPixels);
+            } else {
+                qCWarning(lcPointerMonitor, "Invalid masked color pointer shape");
             }
+            return false;
         }
         return true;
     }
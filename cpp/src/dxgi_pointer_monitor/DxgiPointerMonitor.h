@@ -1,7 +1,12 @@
 #ifndef TPOINTERMONITOR_H
 #define TPOINTERMONITOR_H
 
+#include <QByteArray>
+#include <QImage>
+#include <QList>
 #include <QObject>
+#include <QPoint>
+#include <QString>
 
 class DxgiPointerMonitorPrivate;
 class DxgiPointerMonitor : public QObject
@@ -16,6 +21,43 @@ protected:
     QScopedPointer<DxgiPointerMonitorPrivate> d_ptr;
 
 public:
+    // cursorData 的编码格式：Png 为 QImage::save 输出，其余见 cursor_encode.h，用体积换编码延迟
+    enum class CursorEncoding {
+        Png,       // zlib 压缩的 PNG，体积最小，编码最慢
+        Raw,       // 32 字节头部 + ARGB32 像素
+        Qoi,       // QOI 无损格式
+        StoredPng, // 不压缩的 PNG，任何 PNG 解码器都可读取
+    };
+    Q_ENUM(CursorEncoding)
+
+    // 切换编码格式会清空已缓存的形状编码
+    void setCursorEncoding(CursorEncoding encoding);
+    CursorEncoding cursorEncoding() const;
+
+    // capture() 每次得到新状态后发布的快照，任意线程都可以读取，不需要在采集线程上轮询
+    struct CursorSnapshot
+    {
+        quint64 version = 0; // 0 表示还没有读到过状态
+        bool visible = false;
+        QPoint position;
+        QPoint hotSpot;
+        quint64 shapeId = 0;   // 形状编号，变化时 cursorData 才会更新
+        QByteArray cursorData; // 编码后的形状，隐式共享
+    };
+
+    // 以 snapshot.version 为上次读取的版本，有更新时刷新 snapshot 并返回 true。线程安全，状态读取不加锁
+    bool latestCursor(CursorSnapshot &snapshot) const;
+
+    // 每个新形状在后台预先生成的缩放比例（百分比），例如 {125, 150, 200}，超出 [25, 400] 的比例被忽略
+    void setCursorScales(const QList<int> &scalePercents);
+    // 当前形状按 scalePercent 缩放后的 ARGB32 图像，首次请求某个比例时在调用线程上生成。线程安全，与缓存共享像素。
+    // scalePercent 超出 [25, 400] 时返回空图像
+    QImage scaledCursor(int scalePercent, QPoint *hotSpot = nullptr);
+
+    // 把之后每次指针更新（位置、可见性、形状）录制到 path，格式见 cursor_recording.h
+    bool startRecording(const QString &path);
+    void stopRecording();
+
     // 注意 Windows 开启某些优化项之后，指针调整到 10 及以上，指针层会总是隐藏，指针在桌面图像层绘制
     bool capture(bool &visible, QPoint &position, QPoint &hotSpot, QByteArray &cursorData, bool &changed);
 };
@@ -6,7 +6,15 @@
 #include <wrl/client.h>
 
 #include "DxgiPointerMonitor.h"
-
+#include "cursor_recording.h"
+#include "cursor_shape.h"
+#include "cursor_state.h"
+#include "scaled_shape_cache.h"
+#include "shape_cache.h"
+#include "shape_fingerprint.h"
+
+#include <QByteArray>
+#include <QImage>
 #include <QList>
 #include <QPoint>
 
@@ -27,6 +35,11 @@ public:
 
     quint64 hash = 0;
     bool changed = false;
+    // 形状或热点真正变化（不含单纯移动），capture() 据此更新缩放缓存后清除
+    bool shapeChanged = false;
+    QPoint shapeHotSpot;
+    // 形状变化检测，hash 取自这里；开启逐字节校验，排除哈希碰撞
+    ShapeFingerprint fingerprint{true};
 
     // Getter methods for shape info fields
     // The width in pixels of the mouse cursor.
@@ -40,6 +53,19 @@ public:
     // The width in bytes of the mouse cursor.
     UINT pitch() const { return shapeInfo.Pitch; }
 
+    // 与平台无关的形状描述，供 cursor_shape 中的内核使用
+    CursorShapeInfo portableShapeInfo() const
+    {
+        CursorShapeInfo info;
+        info.type = shapeInfo.Type;
+        info.width = shapeInfo.Width;
+        info.height = shapeInfo.Height;
+        info.pitch = shapeInfo.Pitch;
+        info.hotSpotX = shapeInfo.HotSpot.x;
+        info.hotSpotY = shapeInfo.HotSpot.y;
+        return info;
+    }
+
     bool SavePointerToPNG(const QString &filename);
     bool ConvertPointerShapeToQImage(QImage &image);
 };
@@ -84,9 +110,27 @@ public:
 protected:
     void resetDisplayDuplications();
 public:
+    // 按 cursorEncoding 把 ARGB32 图像编码为 cursorData
+    bool encodeCursor(const QImage &image, QByteArray &cursorData) const;
+    // 把 capture() 的输出发布到 cursorState
+    void publishCursor(bool visible, const QPoint &position, const QPoint &hotSpot, const QByteArray &cursorData);
+    // 录制开启时把一次 getPointerInfo 看到的内容写入 recorder；shape 为空表示没有新形状
+    void recordPointerUpdate(const DXGI_OUTDUPL_FRAME_INFO *frameInfo, const POINT &cursorPos, int displayIndex,
+                             const QByteArray *shape);
+
     PointerInfo pointerInfo;
     QList<DisplayDuplication *> displayDuplications;
     qint64 lastHash = 0;
+    // 已编码的光标形状，按形状哈希和尺寸查找
+    ShapeCache<QByteArray> shapeCache{16};
+    DxgiPointerMonitor::CursorEncoding cursorEncoding = DxgiPointerMonitor::CursorEncoding::Png;
+    CursorStatePublisher<QByteArray> cursorState;
+    // 当前形状的原图和各缩放比例版本，供不同 DPI 的客户端取用
+    ScaledShapeCache scaledShapes;
+    QByteArray publishedShape;
+    quint64 publishedShapeId = 0;
+    // 光标事件录制，供 Linux 上的 cursor_shape replay 回放
+    CursorRecording::Writer recorder;
     int imageCounter = 0;
     bool isFirst = true;
 };
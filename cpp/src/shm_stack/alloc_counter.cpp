@@ -0,0 +1,123 @@
+#include "alloc_counter.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#define SHM_STACK_SANITIZED
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define SHM_STACK_SANITIZED
+#endif
+
+#if defined(SHM_STACK_ALLOC_COUNTER) && !defined(SHM_STACK_SANITIZED)
+#define SHM_STACK_COUNT_ALLOCATIONS
+#endif
+
+namespace {
+// 必须是无需动态初始化的 thread_local，malloc 可能在线程启动早期被调用
+thread_local uint64_t t_allocations = 0;
+} // namespace
+
+bool AllocCounter::enabled()
+{
+#if defined(SHM_STACK_COUNT_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t AllocCounter::threadAllocations()
+{
+    return t_allocations;
+}
+
+#if !defined(SHM_STACK_COUNT_ALLOCATIONS)
+// 不替换任何分配函数
+#elif defined(__GLIBC__)
+// glibc 提供 __libc_* 入口，可执行文件中定义的 malloc 会覆盖 libc 的符号，
+// libstdc++ 的 operator new 也会走到这里
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+    ++t_allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    ++t_allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++t_allocations;
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    ++t_allocations;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    ++t_allocations;
+    void *p = __libc_memalign(alignment, size);
+    if (!p) {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+}
+#else
+// 非 glibc 平台只统计 operator new
+void *operator new(size_t size)
+{
+    ++t_allocations;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
@@ -0,0 +1,26 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+/**
+ * @brief 按线程统计堆分配次数
+ *
+ * 定义 SHM_STACK_ALLOC_COUNTER 时（xmake 选项 alloc_counter），alloc_counter.cpp
+ * 替换 malloc 系列函数（glibc 下 operator new 也经由 malloc），每次分配都会累加
+ * 当前线程的计数器。测试用它来断言热路径在预热之后不再产生任何堆分配。
+ *
+ * 未定义该宏或启用了 ASan/TSan（它们自己拦截分配函数）时不做任何替换，
+ * enabled() 返回 false，计数始终为 0，依赖计数的断言应当跳过。
+ */
+namespace AllocCounter {
+
+// 是否编译了分配计数
+bool enabled();
+
+// 当前线程累计的堆分配次数
+uint64_t threadAllocations();
+
+} // namespace AllocCounter
+
+#endif // ALLOC_COUNTER_H
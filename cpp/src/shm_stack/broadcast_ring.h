@@ -0,0 +1,180 @@
+#ifndef BROADCAST_RING_H
+#define BROADCAST_RING_H
+
+#include "fixed_stack.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 一个生产者、多个消费者的广播环（Disruptor 风格）
+ *
+ * 每一帧发布到环上后，每个消费者都会拿到同一个池元素（只增加引用计数，
+ * 不拷贝帧数据），例如解码后的帧同时送给渲染器和录制器。
+ *
+ * - 生产者维护发布序号，每个消费者维护自己的游标
+ * - 槽位上的待读计数在最后一个消费者读走（或被跳过）时归零，
+ *   此时槽位放弃对元素的引用；所有消费者也释放各自的引用后，元素才回到池中
+ * - 环满时，按每个消费者的策略处理：Block 的消费者让生产者等待，
+ *   Drop 的消费者被生产者跳过最旧的一帧，并累计丢帧数
+ *
+ * 消费者在读取槽位期间会在游标上设置 busy 位，生产者不会跳过正在读取的消费者，
+ * 这段时间只是一次 shared_ptr 拷贝，不包括消费者处理帧的时间。
+ *
+ * @tparam T 池中存储的帧类型
+ */
+template <typename T>
+class BroadcastRing
+{
+public:
+    using ElementPtr = std::shared_ptr<typename FixedStack<T>::Element>;
+
+    enum class SlowConsumerPolicy {
+        Block, // 生产者等待该消费者读完
+        Drop,  // 环满时跳过该消费者最旧的一帧
+    };
+
+    explicit BroadcastRing(size_t capacity)
+        : m_slots(capacity ? capacity : 1)
+    {
+    }
+
+    BroadcastRing(const BroadcastRing &) = delete;
+    BroadcastRing &operator=(const BroadcastRing &) = delete;
+
+    /**
+     * @brief 注册消费者，必须在第一次 publish() 之前调用
+     * @return 消费者编号，用于 tryNext()/dropped()
+     */
+    size_t addConsumer(SlowConsumerPolicy policy)
+    {
+        m_consumers.emplace_back(std::make_unique<Consumer>());
+        m_consumers.back()->policy = policy;
+        return m_consumers.size() - 1;
+    }
+
+    /**
+     * @brief 发布一帧，只能由单个生产者线程调用
+     *
+     * 如果需要复用的槽位还有 Block 消费者没有读走，则等待。
+     */
+    void publish(ElementPtr element)
+    {
+        if (m_consumers.empty()) {
+            // 没有消费者，帧直接归还到池中
+            return;
+        }
+        uint64_t sequence = m_next;
+        Slot &slot = m_slots[sequence % m_slots.size()];
+
+        if (sequence >= m_slots.size()) {
+            uint64_t old = sequence - m_slots.size();
+            unsigned spins = 0;
+            while (slot.released.load(std::memory_order_acquire) != old + 1) {
+                skipDropConsumers(slot, old);
+                if (slot.released.load(std::memory_order_acquire) == old + 1) {
+                    break;
+                }
+                if (++spins > 64) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        slot.element = std::move(element);
+        slot.pending.store(m_consumers.size(), std::memory_order_relaxed);
+        m_next = sequence + 1;
+        m_published.store(sequence + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 取下一帧，没有新帧时立即返回 nullptr
+     *
+     * 每个消费者编号只能由一个线程调用。
+     */
+    ElementPtr tryNext(size_t consumer)
+    {
+        Consumer &c = *m_consumers[consumer];
+        uint64_t cursor = c.cursor.load(std::memory_order_acquire);
+        while (true) {
+            if (cursor >= m_published.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            // 设置 busy 位后生产者不会跳过这一帧
+            if (c.cursor.compare_exchange_weak(cursor, cursor | kBusy, std::memory_order_acq_rel)) {
+                break;
+            }
+        }
+
+        Slot &slot = m_slots[cursor % m_slots.size()];
+        ElementPtr element = slot.element;
+        releaseSlot(slot, cursor);
+        c.cursor.store(cursor + 1, std::memory_order_release);
+        return element;
+    }
+
+    // 生产者结束后调用，消费者据此判断是否已经读完
+    void close() { m_closed.store(true, std::memory_order_release); }
+
+    // 已关闭且该消费者已读完所有帧
+    bool finished(size_t consumer) const
+    {
+        return m_closed.load(std::memory_order_acquire)
+               && m_consumers[consumer]->cursor.load(std::memory_order_acquire) >= m_published.load(std::memory_order_acquire);
+    }
+
+    uint64_t dropped(size_t consumer) const { return m_consumers[consumer]->dropped.load(std::memory_order_relaxed); }
+
+    uint64_t published() const { return m_published.load(std::memory_order_acquire); }
+
+private:
+    static constexpr uint64_t kBusy = 1ull << 63;
+
+    struct Slot
+    {
+        ElementPtr element;
+        std::atomic<size_t> pending{0};    // 还没读走这一帧的消费者数
+        std::atomic<uint64_t> released{0}; // 槽位放弃引用后写入 序号 + 1
+    };
+
+    struct alignas(64) Consumer
+    {
+        std::atomic<uint64_t> cursor{0}; // 下一个要读的序号，最高位为 busy
+        std::atomic<uint64_t> dropped{0};
+        SlowConsumerPolicy policy = SlowConsumerPolicy::Block;
+    };
+
+    // 最后一个读走（或跳过）的一方放弃槽位的引用并通知生产者
+    void releaseSlot(Slot &slot, uint64_t sequence)
+    {
+        if (slot.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            slot.element.reset();
+            slot.released.store(sequence + 1, std::memory_order_release);
+        }
+    }
+
+    // 环满时把还停在 old 上的 Drop 消费者向前推进一帧
+    void skipDropConsumers(Slot &slot, uint64_t old)
+    {
+        for (auto &consumer : m_consumers) {
+            if (consumer->policy != SlowConsumerPolicy::Drop) {
+                continue;
+            }
+            uint64_t expected = old;
+            if (consumer->cursor.compare_exchange_strong(expected, old + 1, std::memory_order_acq_rel)) {
+                consumer->dropped.fetch_add(1, std::memory_order_relaxed);
+                releaseSlot(slot, old);
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<std::unique_ptr<Consumer>> m_consumers;
+    uint64_t m_next = 0; // 仅生产者访问
+    alignas(64) std::atomic<uint64_t> m_published{0};
+    std::atomic<bool> m_closed{false};
+};
+
+#endif // BROADCAST_RING_H
@@ -0,0 +1,379 @@
+#ifndef CORO_POOL_H
+#define CORO_POOL_H
+
+#include "fixed_stack.h"
+#include "mpmc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 运行协程的小型调度器
+ *
+ * 固定数量的线程从无锁队列中取出协程句柄并恢复执行。
+ * 被唤醒的协程通过 post() 回到调度器线程，而不是在归还元素或 push 的线程上
+ * 内联恢复，这样几百个逻辑流可以只占用少数几个线程。
+ */
+class CoroScheduler
+{
+public:
+    explicit CoroScheduler(size_t threads, size_t capacity = 1024)
+        : m_ready(capacity)
+    {
+        threads = threads ? threads : 1;
+        for (size_t i = 0; i < threads; ++i) {
+            m_workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~CoroScheduler()
+    {
+        m_stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_sleepCv.notify_all();
+        }
+        for (auto &worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    CoroScheduler(const CoroScheduler &) = delete;
+    CoroScheduler &operator=(const CoroScheduler &) = delete;
+
+    size_t threadCount() const { return m_workers.size(); }
+
+    void post(std::coroutine_handle<> handle)
+    {
+        while (!m_ready.tryPush(std::move(handle))) {
+            std::this_thread::yield();
+        }
+        if (m_sleepers.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_sleepCv.notify_one();
+        }
+    }
+
+    // co_await scheduler.schedule() 把当前协程切换到调度器线程上继续执行
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            CoroScheduler *scheduler;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { scheduler->post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+private:
+    void run()
+    {
+        unsigned idleRounds = 0;
+        while (true) {
+            std::coroutine_handle<> handle;
+            if (m_ready.tryPop(handle)) {
+                handle.resume();
+                idleRounds = 0;
+                continue;
+            }
+            if (m_stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (++idleRounds < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepers.fetch_add(1, std::memory_order_acq_rel);
+            m_sleepCv.wait_for(lock, std::chrono::milliseconds(1));
+            m_sleepers.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    MpmcQueue<std::coroutine_handle<>> m_ready;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<int> m_sleepers{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+};
+
+/**
+ * @brief 立即开始执行、结束后自行销毁的协程返回类型
+ */
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * @brief FixedStack 的协程接口
+ *
+ * co_await pool.acquire() 在池中有空闲元素时立即返回，否则挂起当前协程，
+ * 直到其他线程归还元素：FixedStack 的归还回调会替等待者获取元素并恢复它
+ * （有调度器时投递到调度器，否则在归还线程上内联恢复）。
+ *
+ * tryAcquire() 本身仍然无锁，互斥锁只保护等待者链表，只在池耗尽时才会用到。
+ * 等待者节点就是 awaiter 本身，位于协程帧中，挂起不会产生堆分配。
+ *
+ * @tparam T 池中存储的对象类型
+ */
+template <typename T>
+class AsyncFixedStack
+{
+public:
+    using ElementPtr = std::shared_ptr<typename FixedStack<T>::Element>;
+
+    class AcquireAwaiter
+    {
+    public:
+        explicit AcquireAwaiter(AsyncFixedStack *pool)
+            : m_pool(pool)
+        {
+        }
+
+        bool await_ready()
+        {
+            m_result = m_pool->m_stack.tryAcquire();
+            return m_result != nullptr;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(m_pool->m_mutex);
+            // 加锁后再试一次，避免和归还回调之间丢失唤醒
+            m_result = m_pool->m_stack.tryAcquire();
+            if (m_result) {
+                return false;
+            }
+            m_handle = handle;
+            if (m_pool->m_tail) {
+                m_pool->m_tail->m_next = this;
+            } else {
+                m_pool->m_head = this;
+            }
+            m_pool->m_tail = this;
+            return true;
+        }
+
+        ElementPtr await_resume() { return std::move(m_result); }
+
+    private:
+        AsyncFixedStack *m_pool;
+        ElementPtr m_result;
+        std::coroutine_handle<> m_handle;
+        AcquireAwaiter *m_next = nullptr;
+        friend class AsyncFixedStack;
+    };
+
+    explicit AsyncFixedStack(FixedStack<T> &stack, CoroScheduler *scheduler = nullptr)
+        : m_stack(stack)
+        , m_scheduler(scheduler)
+    {
+        m_stack.setReleaseHook(&AsyncFixedStack::onRelease, this);
+    }
+
+    ~AsyncFixedStack() { m_stack.setReleaseHook(nullptr, nullptr); }
+
+    AsyncFixedStack(const AsyncFixedStack &) = delete;
+    AsyncFixedStack &operator=(const AsyncFixedStack &) = delete;
+
+    AcquireAwaiter acquire() { return AcquireAwaiter(this); }
+
+private:
+    static void onRelease(void *context) { static_cast<AsyncFixedStack *>(context)->wakeOne(); }
+
+    void wakeOne()
+    {
+        AcquireAwaiter *waiter = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_head) {
+                return;
+            }
+            ElementPtr element = m_stack.tryAcquire();
+            if (!element) {
+                // 已被其他线程抢先获取
+                return;
+            }
+            waiter = m_head;
+            m_head = waiter->m_next;
+            if (!m_head) {
+                m_tail = nullptr;
+            }
+            waiter->m_result = std::move(element);
+        }
+        if (m_scheduler) {
+            m_scheduler->post(waiter->m_handle);
+        } else {
+            waiter->m_handle.resume();
+        }
+    }
+
+    FixedStack<T> &m_stack;
+    CoroScheduler *m_scheduler;
+    std::mutex m_mutex;
+    AcquireAwaiter *m_head = nullptr;
+    AcquireAwaiter *m_tail = nullptr;
+};
+
+/**
+ * @brief 支持 co_await pop() 的有界队列
+ *
+ * push() 时如果有协程在等待，直接把元素交给最早的等待者并恢复它，
+ * 否则存入预先分配的环形缓冲区。close() 之后等待者收到默认构造的 T
+ * （对 shared_ptr 即 nullptr）。
+ *
+ * @tparam T 元素类型，需要可默认构造和移动
+ */
+template <typename T>
+class AsyncQueue
+{
+public:
+    class PopAwaiter
+    {
+    public:
+        explicit PopAwaiter(AsyncQueue *queue)
+            : m_queue(queue)
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+            if (m_queue->m_size > 0) {
+                m_result = m_queue->takeLocked();
+                return false;
+            }
+            if (m_queue->m_closed) {
+                return false;
+            }
+            m_handle = handle;
+            if (m_queue->m_tail) {
+                m_queue->m_tail->m_next = this;
+            } else {
+                m_queue->m_head = this;
+            }
+            m_queue->m_tail = this;
+            return true;
+        }
+
+        T await_resume() { return std::move(m_result); }
+
+    private:
+        AsyncQueue *m_queue;
+        T m_result{};
+        std::coroutine_handle<> m_handle;
+        PopAwaiter *m_next = nullptr;
+        friend class AsyncQueue;
+    };
+
+    explicit AsyncQueue(size_t capacity, CoroScheduler *scheduler = nullptr)
+        : m_slots(capacity ? capacity : 1)
+        , m_scheduler(scheduler)
+    {
+    }
+
+    AsyncQueue(const AsyncQueue &) = delete;
+    AsyncQueue &operator=(const AsyncQueue &) = delete;
+
+    /**
+     * @brief 入队，有等待者时直接交给它
+     * @return 队列已满或已关闭返回 false
+     */
+    bool push(T value)
+    {
+        PopAwaiter *waiter = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            if (m_head) {
+                waiter = m_head;
+                m_head = waiter->m_next;
+                if (!m_head) {
+                    m_tail = nullptr;
+                }
+                waiter->m_result = std::move(value);
+            } else {
+                if (m_size == m_slots.size()) {
+                    return false;
+                }
+                m_slots[(m_first + m_size) % m_slots.size()] = std::move(value);
+                ++m_size;
+                return true;
+            }
+        }
+        resume(waiter->m_handle);
+        return true;
+    }
+
+    PopAwaiter pop() { return PopAwaiter(this); }
+
+    // 关闭队列并唤醒所有等待者，已入队的元素仍然可以取出
+    void close()
+    {
+        PopAwaiter *waiters = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            waiters = m_head;
+            m_head = nullptr;
+            m_tail = nullptr;
+        }
+        while (waiters) {
+            PopAwaiter *next = waiters->m_next;
+            resume(waiters->m_handle);
+            waiters = next;
+        }
+    }
+
+private:
+    T takeLocked()
+    {
+        T value = std::move(m_slots[m_first]);
+        m_slots[m_first] = T{};
+        m_first = (m_first + 1) % m_slots.size();
+        --m_size;
+        return value;
+    }
+
+    void resume(std::coroutine_handle<> handle)
+    {
+        if (m_scheduler) {
+            m_scheduler->post(handle);
+        } else {
+            handle.resume();
+        }
+    }
+
+    std::vector<T> m_slots;
+    size_t m_first = 0;
+    size_t m_size = 0;
+    bool m_closed = false;
+    CoroScheduler *m_scheduler;
+    std::mutex m_mutex;
+    PopAwaiter *m_head = nullptr;
+    PopAwaiter *m_tail = nullptr;
+};
+
+#endif // CORO_POOL_H
@@ -0,0 +1,208 @@
+#ifndef DIRTY_REGION_H
+#define DIRTY_REGION_H
+
+#include "shm_frame.h"
+#include "stripe_hash.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 基于 tile 哈希的脏区域检测
+ *
+ * 把帧切成 tileSize x tileSize 的 tile，对每个 tile 计算 StripeHash，
+ * 与同一个检测器上一次看到的帧的哈希比较。只保存哈希，不需要保留上一帧，
+ * 因此上一帧可以立刻归还到池中。
+ *
+ * 输出：
+ * - dirtyRects()：合并后的脏矩形（同一行相邻 tile 合并为一段，上下两行完全相同的段再合并），
+ *   已裁剪到帧边界
+ * - changedTiles()：变化的 tile 编号（ty * tilesX + tx）及其新哈希，可作为编码缓存的键
+ *
+ * 没有任何变化时 detect() 返回 false，调用方可以跳过整帧编码。
+ * 给定 WorkStealingPool 时 tile 哈希并行计算。所有缓冲在构造时分配，检测过程本身不分配内存
+ * （WorkStealingPool::parallelFor 的任务对象除外）。哈希碰撞会漏报变化，概率约为 2^-64。
+ */
+class DirtyRegionDetector
+{
+public:
+    struct Rect
+    {
+        uint32_t x, y, width, height;
+    };
+
+    struct TileHash
+    {
+        uint32_t index;
+        uint64_t hash;
+    };
+
+    DirtyRegionDetector(uint32_t width, uint32_t height, uint32_t bytesPerPixel = 4, uint32_t tileSize = 64,
+                        WorkStealingPool *pool = nullptr)
+        : m_width(width)
+        , m_height(height)
+        , m_bytesPerPixel(bytesPerPixel)
+        , m_tileSize(tileSize ? tileSize : 64)
+        , m_tilesX((width + m_tileSize - 1) / m_tileSize)
+        , m_tilesY((height + m_tileSize - 1) / m_tileSize)
+        , m_pool(pool)
+        , m_accumulate(StripeHash::bestAccumulate())
+        , m_previous(static_cast<size_t>(m_tilesX) * m_tilesY)
+        , m_current(m_previous.size())
+    {
+        m_rects.reserve(m_previous.size());
+        m_changed.reserve(m_previous.size());
+        m_openRects.resize(m_tilesX);
+    }
+
+    /**
+     * @brief 与上一帧比较，更新脏矩形和变化的 tile
+     * @return 有任何 tile 变化时返回 true；第一帧和 reset() 之后整帧都是脏的
+     *
+     * 平面的尺寸或每像素字节数与构造时不同（或没有数据）时不做检测：清空结果、
+     * 丢弃上一帧的哈希并返回 false。尺寸变化后调用方应按新尺寸重建检测器。
+     */
+    bool detect(const PlaneView &plane)
+    {
+        if (!matches(plane)) {
+            m_rects.clear();
+            m_changed.clear();
+            reset();
+            return false;
+        }
+        hashTiles(plane);
+
+        m_rects.clear();
+        m_changed.clear();
+        std::fill(m_openRects.begin(), m_openRects.end(), kNone);
+        for (uint32_t ty = 0; ty < m_tilesY; ++ty) {
+            uint32_t tx = 0;
+            while (tx < m_tilesX) {
+                if (!tileChanged(ty, tx)) {
+                    m_openRects[tx] = kNone;
+                    ++tx;
+                    continue;
+                }
+                uint32_t begin = tx;
+                while (tx < m_tilesX && tileChanged(ty, tx)) {
+                    uint32_t index = ty * m_tilesX + tx;
+                    m_changed.push_back({index, m_current[index]});
+                    ++tx;
+                }
+                addRun(ty, begin, tx);
+            }
+        }
+
+        std::swap(m_previous, m_current);
+        m_hasPrevious = true;
+
+        // tile 坐标转换为像素，裁剪到帧边界
+        for (Rect &rect : m_rects) {
+            rect.x *= m_tileSize;
+            rect.y *= m_tileSize;
+            rect.width = std::min(rect.width * m_tileSize, m_width - rect.x);
+            rect.height = std::min(rect.height * m_tileSize, m_height - rect.y);
+        }
+        return !m_changed.empty();
+    }
+
+    bool detect(const ShmFrame &frame) { return detect(frame.plane(0)); }
+
+    const std::vector<Rect> &dirtyRects() const { return m_rects; }
+    const std::vector<TileHash> &changedTiles() const { return m_changed; }
+
+    // 丢弃上一帧的哈希，下一次 detect() 报告整帧
+    void reset() { m_hasPrevious = false; }
+
+    // 平面是否与构造时的尺寸和像素格式一致
+    bool matches(const PlaneView &plane) const
+    {
+        return plane.data && plane.width == m_width && plane.height == m_height
+               && plane.bytesPerPixel == m_bytesPerPixel
+               && plane.stride >= static_cast<size_t>(m_width) * m_bytesPerPixel;
+    }
+
+    uint32_t tilesX() const { return m_tilesX; }
+    uint32_t tilesY() const { return m_tilesY; }
+    uint32_t tileSize() const { return m_tileSize; }
+
+private:
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+
+    bool tileChanged(uint32_t ty, uint32_t tx) const
+    {
+        size_t index = static_cast<size_t>(ty) * m_tilesX + tx;
+        return !m_hasPrevious || m_current[index] != m_previous[index];
+    }
+
+    // 把第 ty 行的 [begin, end) 段并入上一行完全相同的矩形，否则新建矩形
+    void addRun(uint32_t ty, uint32_t begin, uint32_t end)
+    {
+        size_t open = m_openRects[begin];
+        if (open != kNone && m_rects[open].width == end - begin && m_rects[open].y + m_rects[open].height == ty) {
+            m_rects[open].height++;
+        } else {
+            open = m_rects.size();
+            m_rects.push_back({begin, ty, end - begin, 1});
+        }
+        for (uint32_t tx = begin; tx < end; ++tx) {
+            m_openRects[tx] = tx == begin ? open : kNone;
+        }
+    }
+
+    uint64_t hashTile(const PlaneView &plane, size_t index) const
+    {
+        uint32_t tx = static_cast<uint32_t>(index % m_tilesX);
+        uint32_t ty = static_cast<uint32_t>(index / m_tilesX);
+        uint32_t x0 = tx * m_tileSize;
+        uint32_t y0 = ty * m_tileSize;
+        uint32_t rows = std::min(m_tileSize, m_height - y0);
+        size_t rowBytes = static_cast<size_t>(std::min(m_tileSize, m_width - x0)) * m_bytesPerPixel;
+
+        StripeHash::State state;
+        StripeHash::init(state);
+        for (uint32_t y = 0; y < rows; ++y) {
+            StripeHash::update(state, plane.row(y0 + y) + static_cast<size_t>(x0) * m_bytesPerPixel, rowBytes,
+                               m_accumulate);
+        }
+        return StripeHash::finalize(state);
+    }
+
+    void hashTiles(const PlaneView &plane)
+    {
+        size_t tiles = m_current.size();
+        if (!m_pool || m_pool->threadCount() <= 1 || tiles < 2) {
+            for (size_t i = 0; i < tiles; ++i) {
+                m_current[i] = hashTile(plane, i);
+            }
+            return;
+        }
+        // 每个线程分几段连续的 tile，减少任务数量
+        size_t chunks = std::min(tiles, m_pool->threadCount() * 4);
+        m_pool->parallelFor(chunks, [&](size_t chunk) {
+            size_t begin = tiles * chunk / chunks;
+            size_t end = tiles * (chunk + 1) / chunks;
+            for (size_t i = begin; i < end; ++i) {
+                m_current[i] = hashTile(plane, i);
+            }
+        });
+    }
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_bytesPerPixel;
+    uint32_t m_tileSize;
+    uint32_t m_tilesX;
+    uint32_t m_tilesY;
+    WorkStealingPool *m_pool;
+    StripeHash::AccumulateFn m_accumulate;
+    bool m_hasPrevious = false;
+    std::vector<uint64_t> m_previous;
+    std::vector<uint64_t> m_current;
+    std::vector<Rect> m_rects;
+    std::vector<TileHash> m_changed;
+    std::vector<size_t> m_openRects; // 上一行在每个起始 tile 上仍可向下延伸的矩形
+};
+
+#endif // DIRTY_REGION_H
@@ -1,10 +1,18 @@
 // clang-format off
-// Compile & Run: g++ -std=c++17 -pthread fixed_stack.cpp -o /tmp/fixed_stack.out && /tmp/fixed_stack.out
+// Compile & Run: g++ -std=c++20 -pthread fixed_stack.cpp -o /tmp/fixed_stack.out && /tmp/fixed_stack.out
 // clang-format on
+#ifndef FIXED_STACK_H
+#define FIXED_STACK_H
+
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 /**
@@ -12,6 +20,9 @@
  *
  * FixedStack 是一个线程安全的对象池，管理固定数量的对象实例。
  * 它使用 CAS (Compare-And-Swap) 原子操作实现无锁的对象获取和释放。
+ * 可以通过 setPriorityClasses() 为高优先级的获取者（例如关键帧）预留元素。
+ * 每个元素带有代数（generation），每次被获取时加一，
+ * Descriptor 据此判断持有的槽位是否已被重新获取（见 readOptimistic()）。
  *
  * @tparam T 池中存储的对象类型
  */
@@ -20,16 +31,33 @@ template <typename T> class FixedStack {
    * @brief 元素状态枚举
    *
    * 元素在其生命周期中会经历以下状态转换：
-   * Available -> Acquired -> Available (正常使用流程)
+   * Available -> Acquired -> Releasing -> Available (正常使用流程)
    * Acquired -> Destroyed (栈被销毁时，元素正在使用)
    */
   enum class ElementState {
     Available, // 元素可用，可以被获取
     Acquired,  // 元素已被获取，正在使用中
+    Releasing, // 正在归还，栈的析构函数等待其变回 Available
     Destroyed, // 栈已被销毁，元素需要自行清理
   };
 
+  // shared_ptr 控制块的内联存储大小，足以容纳带空 deleter 和
+  // ControlBlockAllocator 的控制块
+  static constexpr size_t kControlBlockSize = 64;
+
+  template <typename U> class ControlBlockAllocator;
+
 public:
+  /**
+   * @brief 不持有引用的元素描述：槽位编号和发放时的代数
+   *
+   * 可以按值放进队列或共享内存传给读者，元素被重新获取后自动失效。
+   */
+  struct Descriptor {
+    uint32_t index = 0;
+    uint64_t generation = 0;
+  };
+
   /**
    * @brief 池元素的包装类
    *
@@ -44,22 +72,37 @@ public:
      */
     inline const T *value() const { return m_value.get(); }
 
+    /**
+     * @brief 当前持有者的描述，应在持有期间调用
+     *
+     * 持有者写完帧数据后再发布描述，此后到下一次被获取之前帧内容视为不变。
+     */
+    Descriptor descriptor() const {
+      return {m_index, m_generation.load(std::memory_order_relaxed)};
+    }
+
   private:
     /**
      * @brief 构造函数
      * @param value 要管理的对象，通过移动语义转移所有权
      */
-    explicit Element(std::unique_ptr<T> value)
-        : m_state{ElementState::Available}, m_value(std::move(value)) {}
+    Element(FixedStack *owner, uint32_t index, std::unique_ptr<T> value)
+        : m_state{ElementState::Available}, m_value(std::move(value)),
+          m_owner(owner), m_index(index) {}
 
   private:
     // 禁止拷贝构造和拷贝赋值
     Element(const Element &) = delete;
     Element &operator=(const Element &) = delete;
 
-    std::atomic<ElementState> m_state; // 元素的原子状态
-    const std::unique_ptr<T> m_value;  // 实际存储的对象
-    friend class FixedStack<T>;        // 允许 FixedStack 访问私有成员
+    std::atomic<ElementState> m_state;     // 元素的原子状态
+    const std::unique_ptr<T> m_value;      // 实际存储的对象
+    FixedStack *const m_owner;             // 所属的池，用于归还时通知
+    const uint32_t m_index;                // 在池中的槽位编号
+    std::atomic<uint64_t> m_generation{0}; // 每次被获取时加一
+    // shared_ptr 控制块就地构造在这里，tryAcquire() 不再堆分配
+    alignas(std::max_align_t) unsigned char m_controlBlock[kControlBlockSize];
+    friend class FixedStack<T>; // 允许 FixedStack 访问私有成员
   };
 
 public:
@@ -71,7 +114,8 @@ public:
    */
   explicit FixedStack(std::vector<std::unique_ptr<T>> &&values) {
     for (auto &value : values) {
-      m_elements.emplace_back(new Element(std::move(value)));
+      m_elements.emplace_back(new Element(
+          this, static_cast<uint32_t>(m_elements.size()), std::move(value)));
     }
   }
 
@@ -89,14 +133,24 @@ public:
   ~FixedStack() {
     for (Element *element : m_elements) {
       ElementState expected = ElementState::Acquired;
-      if (!element->m_state.compare_exchange_strong(
-              expected, ElementState::Destroyed, std::memory_order_acq_rel)) {
-        // 元素未被获取（状态不是 Acquired），直接删除
-        delete element;
+      while (!element->m_state.compare_exchange_weak(
+          expected, ElementState::Destroyed, std::memory_order_acq_rel)) {
+        if (expected == ElementState::Available) {
+          // 元素未被获取，直接删除
+          delete element;
+          break;
+        }
+        // 正在归还：等它变回 Available，归还线程随后会钉住整个池
+        std::this_thread::yield();
+        expected = ElementState::Acquired;
       }
-      // 否则，状态改为 Destroyed，元素会在 shared_ptr deleter 中被删除
+      // 状态改为 Destroyed 的元素会在 shared_ptr 控制块释放时被删除
     }
     m_elements.clear();
+    // 等待已经把元素放回池中、但还在做计数和回调的归还线程
+    while (m_releasing.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
   }
 
   /**
@@ -106,41 +160,312 @@ public:
    * 工作原理：
    * 1. 遍历所有元素，寻找状态为 Available 的元素
    * 2. 使用 CAS 原子操作将状态从 Available 改为 Acquired
-   * 3. 如果成功，返回一个带有自定义 deleter 的 shared_ptr
+   * 3. 如果成功，返回一个控制块位于元素内联存储中的 shared_ptr
    * 4. 如果失败（元素不可用），继续尝试下一个元素
    *
-   * 自定义 deleter：
-   * - 当 shared_ptr 的引用计数归零时调用
-   * - 尝试将元素状态从 Acquired 改回 Available
+   * 归还时机：
+   * - 控制块由 ControlBlockAllocator 分配在 Element::m_controlBlock 中，
+   *   整个获取/释放过程没有堆分配
+   * - 元素必须等控制块销毁（引用计数和弱引用计数都归零）之后才能归还，
+   *   否则下一次 tryAcquire() 会覆盖仍在使用的控制块，
+   *   因此归还逻辑放在 allocator 的 deallocate 中，deleter 什么也不做
    * - 如果当前状态是 Destroyed（栈已被销毁），则删除元素
-   * - 如果 CAS 失败（其他线程修改了状态），也删除元素（异常情况）
+   *
+   * 设置了优先级类别后，等价于 tryAcquire(0)，即按最低优先级获取。
    */
   std::shared_ptr<Element> tryAcquire() {
+    return m_limits.empty() ? acquireAny() : tryAcquire(0);
+  }
+
+  /**
+   * @brief 按优先级类别获取元素
+   * @param priority 类别编号，越大优先级越高，超出范围时按最高类别处理
+   * @return 可用元素只剩更高类别的预留量时立即返回 nullptr，并计入该类别的丢弃数
+   *
+   * 先用 CAS 把占用计数加一（不超过本类别的上限），再扫描可用元素。
+   * 计数不小于实际被占用的元素数，所以计数成功后一定有可用元素，
+   * 扫描只可能因为并发竞争而重试。未设置优先级类别时等价于 tryAcquire()。
+   */
+  std::shared_ptr<Element> tryAcquire(size_t priority) {
+    if (m_limits.empty()) {
+      return acquireAny();
+    }
+    priority = std::min(priority, m_limits.size() - 1);
+    size_t limit = m_limits[priority];
+    size_t used = m_inUse.load(std::memory_order_relaxed);
+    do {
+      if (used >= limit) {
+        m_drops[priority].fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    } while (!m_inUse.compare_exchange_weak(used, used + 1,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed));
+    while (true) {
+      if (auto element = acquireAny()) {
+        return element;
+      }
+    }
+  }
+
+  /**
+   * @brief 设置优先级类别及每个类别的预留元素数
+   * @param reserved reserved[c] 是类别 c 预留的元素数，低于 c 的类别不能使用
+   * @return 预留总数超过池大小、为空或仍有元素被占用时返回 false，不做修改
+   *
+   * 类别 c 最多能让池中同时有 size - sum(reserved[c+1..]) 个元素被占用，
+   * 因此 reserved[0] 没有实际作用。
+   *
+   * 必须在没有元素被占用时设置：占用计数从 0 开始，之前获取的元素不在计数中，
+   * 计数会低于实际占用数，tryAcquire(priority) 计数成功后的扫描可能永远找不到元素。
+   * 调试构建中违反时触发断言。
+   */
+  bool setPriorityClasses(const std::vector<size_t> &reserved) {
+    size_t total = 0;
+    for (size_t count : reserved) {
+      total += count;
+    }
+    bool idle = availableApprox() == m_elements.size();
+    assert(idle && "setPriorityClasses() called with elements outstanding");
+    if (reserved.empty() || total > m_elements.size() || !idle) {
+      return false;
+    }
+    m_limits.assign(reserved.size(), 0);
+    size_t above = 0;
+    for (size_t c = reserved.size(); c-- > 0;) {
+      m_limits[c] = m_elements.size() - above;
+      above += reserved[c];
+    }
+    m_drops.reset(new std::atomic<uint64_t>[reserved.size()]());
+    return true;
+  }
+
+  size_t priorityClasses() const { return m_limits.size(); }
+
+  // 类别 priority 因为只剩预留元素或池耗尽而获取失败的次数，
+  // 超出范围时与 tryAcquire() 一样按最高类别处理；未设置优先级类别时为 0
+  uint64_t drops(size_t priority) const {
+    if (m_limits.empty()) {
+      return 0;
+    }
+    priority = std::min(priority, m_limits.size() - 1);
+    return m_drops[priority].load(std::memory_order_relaxed);
+  }
+
+  // 被占用的元素数（含正在扫描的获取者），只在设置了优先级类别时统计
+  size_t inUse() const { return m_inUse.load(std::memory_order_relaxed); }
+
+  size_t size() const { return m_elements.size(); }
+
+  // 描述的槽位自发放以来是否没有被重新获取，一次 relaxed 读取
+  bool isCurrent(const Descriptor &descriptor) const {
+    return descriptor.index < m_elements.size() &&
+           m_elements[descriptor.index]->m_generation.load(
+               std::memory_order_relaxed) == descriptor.generation;
+  }
+
+  /**
+   * @brief 不持有引用地读取描述对应的帧（seqlock 式乐观读）
+   * @param read 以 const T & 调用，应把需要的数据复制出来
+   * @return false 表示槽位在读取前或读取期间被重新获取，复制出的数据必须丢弃
+   *
+   * 前后两次读取代数并以 acquire fence 隔开，与获取时代数递增后的
+   * release fence 配对：只要两次都等于描述中的代数，读取期间就没有新的持有者写入。
+   * 适合读取刚归还、可能很快被复用的帧，不需要延长其生命周期。
+   *
+   * 读取期间新的持有者可能正在写入，普通的读（包括 memcpy）与之构成数据竞争，
+   * 按 C++ 内存模型是未定义行为，即使结果随后被丢弃。因此 read 只能通过原子操作
+   * 访问帧的数据，通常用 loadRelaxed() 复制；持有者写入可能被乐观读取的数据时
+   * 同样要用原子写（storeRelaxed()）。
+   */
+  template <typename F>
+  bool readOptimistic(const Descriptor &descriptor, F &&read) const {
+    if (descriptor.index >= m_elements.size()) {
+      return false;
+    }
+    const Element *element = m_elements[descriptor.index];
+    if (element->m_generation.load(std::memory_order_acquire) !=
+        descriptor.generation) {
+      return false;
+    }
+    read(*element->m_value);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return element->m_generation.load(std::memory_order_relaxed) ==
+           descriptor.generation;
+  }
+
+  /**
+   * @brief 按 relaxed 原子读复制 size 字节，供 readOptimistic() 的 read 使用
+   *
+   * src 的 8 字节对齐部分按 64 位字读取，首尾不对齐的部分按字节读取。
+   */
+  static void loadRelaxed(void *dst, const void *src, size_t size) {
+    auto *out = static_cast<uint8_t *>(dst);
+    auto *in = static_cast<uint8_t *>(const_cast<void *>(src));
+    forEachAtomicUnit(in, size, [&](auto &word) {
+      auto value = std::atomic_ref(word).load(std::memory_order_relaxed);
+      std::memcpy(out, &value, sizeof(value));
+      out += sizeof(value);
+    });
+  }
+
+  // 按 relaxed 原子写复制 size 字节，持有者写入可能被乐观读取的数据时使用
+  static void storeRelaxed(void *dst, const void *src, size_t size) {
+    auto *out = static_cast<uint8_t *>(dst);
+    auto *in = static_cast<const uint8_t *>(src);
+    forEachAtomicUnit(out, size, [&](auto &word) {
+      std::remove_reference_t<decltype(word)> value;
+      std::memcpy(&value, in, sizeof(value));
+      std::atomic_ref(word).store(value, std::memory_order_relaxed);
+      in += sizeof(value);
+    });
+  }
+
+  /**
+   * @brief 当前可用元素数的近似值
+   *
+   * 逐个读取元素状态，不影响获取和归还，结果可能已经过时。
+   * 用于生产者按池的压力调节速率（见 RateController）。
+   */
+  size_t availableApprox() const {
+    size_t available = 0;
+    for (const Element *element : m_elements) {
+      available += element->m_state.load(std::memory_order_relaxed) ==
+                   ElementState::Available;
+    }
+    return available;
+  }
+
+  /**
+   * @brief 元素归还到池中时的回调
+   *
+   * 每次元素从 Acquired 变回 Available 后，在归还线程上调用
+   * hook(context)，用于唤醒等待空闲元素的协程等。tryAcquire() 不受影响，
+   * 仍然是无锁的。池析构之后才归还的元素直接删除，不调用回调。
+   *
+   * 池的析构函数会等待正在执行的回调结束，但 context 指向的对象
+   * 必须比所有归还操作活得更久。需要在任何元素被获取之前设置。
+   */
+  using ReleaseHook = void (*)(void *context);
+  void setReleaseHook(ReleaseHook hook, void *context) {
+    m_releaseContext = context;
+    m_releaseHook = hook;
+  }
+
+private:
+  // 依次把 data 的每个原子访问单元（对齐的 uint64_t 或单个字节）交给 visit
+  template <typename V>
+  static void forEachAtomicUnit(uint8_t *data, size_t size, V &&visit) {
+    static_assert(std::atomic_ref<uint64_t>::is_always_lock_free,
+                  "64-bit atomics must be lock-free");
+    uint8_t *end = data + size;
+    while (data != end &&
+           reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0) {
+      visit(*data++);
+    }
+    for (; end - data >= 8; data += 8) {
+      visit(*reinterpret_cast<uint64_t *>(data));
+    }
+    while (data != end) {
+      visit(*data++);
+    }
+  }
+
+  // 扫描一遍，把第一个可用元素标记为已获取
+  std::shared_ptr<Element> acquireAny() {
     for (Element *element : m_elements) {
       ElementState expected = ElementState::Available;
       if (element->m_state.compare_exchange_strong(
               expected, ElementState::Acquired, std::memory_order_acq_rel)) {
-        // 成功获取元素，创建带有自定义 deleter 的 shared_ptr
-        auto deleter = [](Element *element) {
-          ElementState expected = ElementState::Acquired;
-          if (!element->m_state.compare_exchange_strong(
-                  expected, ElementState::Available,
-                  std::memory_order_acq_rel)) {
-            // 状态不是 Acquired（可能是 Destroyed），删除元素
-            delete element;
-          }
-        };
-        return std::shared_ptr<Element>(element, deleter);
+        // 新持有者的写入不能早于代数递增，乐观读者据此发现槽位被复用
+        element->m_generation.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return std::shared_ptr<Element>(element, [](Element *) {},
+                                        ControlBlockAllocator<Element>(element));
       }
     }
     // 所有元素都不可用
     return nullptr;
   }
 
+  /**
+   * @brief 把 shared_ptr 控制块放进元素内联存储的分配器
+   *
+   * 每个元素同一时刻最多只有一个控制块，所以固定的一块存储就够用。
+   */
+  template <typename U> class ControlBlockAllocator {
+  public:
+    using value_type = U;
+
+    explicit ControlBlockAllocator(Element *element) noexcept
+        : m_element(element) {}
+    template <typename V>
+    ControlBlockAllocator(const ControlBlockAllocator<V> &other) noexcept
+        : m_element(other.m_element) {}
+
+    U *allocate(size_t n) {
+      static_assert(sizeof(U) <= kControlBlockSize,
+                    "shared_ptr control block exceeds inline storage");
+      static_assert(alignof(U) <= alignof(std::max_align_t));
+      assert(n == 1);
+      (void)n;
+      return reinterpret_cast<U *>(m_element->m_controlBlock);
+    }
+
+    /**
+     * 控制块已析构，元素可以归还到池中
+     *
+     * 元素一旦变回 Available，并发的 ~FixedStack 就可能删除它并释放整个池。
+     * 因此先切到 Releasing（析构函数会等待这个状态结束），在此期间把池钉住
+     * （m_releasing 加一），再发布 Available；之后只通过已钉住的 owner
+     * 做占用计数和回调，不再访问元素。
+     */
+    void deallocate(U *, size_t) noexcept {
+      ElementState expected = ElementState::Acquired;
+      if (!m_element->m_state.compare_exchange_strong(
+              expected, ElementState::Releasing, std::memory_order_acq_rel)) {
+        // 状态不是 Acquired（可能是 Destroyed），删除元素
+        delete m_element;
+        return;
+      }
+      FixedStack *owner = m_element->m_owner;
+      owner->m_releasing.fetch_add(1, std::memory_order_relaxed);
+      m_element->m_state.store(ElementState::Available,
+                               std::memory_order_release);
+      if (!owner->m_limits.empty()) {
+        owner->m_inUse.fetch_sub(1, std::memory_order_release);
+      }
+      if (owner->m_releaseHook) {
+        owner->m_releaseHook(owner->m_releaseContext);
+      }
+      owner->m_releasing.fetch_sub(1, std::memory_order_release);
+    }
+
+    template <typename V>
+    bool operator==(const ControlBlockAllocator<V> &other) const noexcept {
+      return m_element == other.m_element;
+    }
+
+  private:
+    Element *m_element;
+    template <typename V> friend class ControlBlockAllocator;
+  };
+
 private:
   // 禁止拷贝构造和拷贝赋值
   FixedStack(const FixedStack &) = delete;
   FixedStack &operator=(const FixedStack &) = delete;
 
   std::vector<Element *> m_elements; // 元素指针数组
+  ReleaseHook m_releaseHook = nullptr;
+  void *m_releaseContext = nullptr;
+
+  // 优先级类别：m_limits[c] 是类别 c 获取时占用计数的上限，为空表示未启用
+  std::vector<size_t> m_limits;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_drops;
+  alignas(64) std::atomic<size_t> m_inUse{0};
+  // 正在做归还后处理（占用计数、回调）的线程数，析构函数等待其归零
+  std::atomic<size_t> m_releasing{0};
 };
+
+#endif // FIXED_STACK_H
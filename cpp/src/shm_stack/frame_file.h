@@ -0,0 +1,46 @@
+#ifndef FRAME_FILE_H
+#define FRAME_FILE_H
+
+#include <cstdint>
+
+/**
+ * @brief FrameRecorder 写出的帧文件格式（小端）
+ *
+ *   帧 0 | 帧 1 | ... | IndexEntry[count] | Trailer
+ *
+ * 每帧是 ShmFrame 的完整内存（带帧头时从 FrameHeader 开始，否则是原始缓冲），
+ * 起始偏移按 kAlignment 对齐，O_DIRECT 可以直接从共享内存写出，读取方可以 mmap 后原地访问。
+ * 索引和尾部在录制结束时写在最后一帧之后，Trailer 固定位于文件末尾。
+ */
+namespace FrameFile {
+
+constexpr uint64_t kAlignment = 4096;
+
+inline uint64_t alignUp(uint64_t value) { return (value + kAlignment - 1) & ~(kAlignment - 1); }
+
+struct IndexEntry
+{
+    uint64_t offset = 0;   // 帧在文件中的偏移，按 kAlignment 对齐
+    uint64_t length = 0;   // 帧的实际字节数（不含对齐填充）
+    uint64_t sequence = 0; // 带帧头时取 FrameHeader::sequence，否则为录制序号
+    int64_t ptsUs = 0;     // 带帧头时取 FrameHeader::ptsUs，否则为写入时刻（steady_clock 微秒）
+};
+static_assert(sizeof(IndexEntry) == 32, "IndexEntry must stay 32 bytes");
+
+struct Trailer
+{
+    static constexpr uint32_t kMagic = 0x49524653; // "SFRI"
+    static constexpr uint16_t kVersion = 1;
+
+    uint32_t magic = kMagic;
+    uint16_t version = kVersion;
+    uint16_t entrySize = sizeof(IndexEntry);
+    uint64_t count = 0;       // 帧数
+    uint64_t indexOffset = 0; // IndexEntry 数组的偏移
+    uint64_t reserved = 0;
+};
+static_assert(sizeof(Trailer) == 32, "Trailer must stay 32 bytes");
+
+} // namespace FrameFile
+
+#endif // FRAME_FILE_H
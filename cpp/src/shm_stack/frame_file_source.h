@@ -0,0 +1,220 @@
+#ifndef FRAME_FILE_SOURCE_H
+#define FRAME_FILE_SOURCE_H
+
+#include "frame_file.h"
+#include "shm_frame.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @brief mmap 一个 FrameRecorder 录制的帧文件，作为压测的数据源
+ *
+ * 替代用 sleep_for 假装解码、从不写像素的生产者：帧内容来自真实录制，
+ * 缓存和内存带宽的影响都能体现出来，而且每次运行完全相同。
+ *
+ * - fill()：把下一帧复制到池中的 ShmFrame，可以直接作为 FramePipeline 的 source
+ * - next()：零拷贝，返回指向映射页的只读帧视图，不经过池
+ *
+ * Pacing::Recorded 按录制的时间戳间隔放出帧，Pacing::MaxSpeed 不等待。
+ * loop 为 true 时读到末尾从头开始，时间戳按录制时长顺延。
+ * fill() / next() 可以由多个线程同时调用，每帧只会被取走一次。
+ * 零拷贝帧的 PlaneView::data 指向只读映射，写入会触发 SIGSEGV。
+ */
+class FrameFileSource
+{
+public:
+    enum class Pacing {
+        Recorded, // 按录制的时间戳间隔
+        MaxSpeed, // 尽可能快
+    };
+
+    /**
+     * @brief 映射页中的一帧，只读，源对象关闭前有效
+     */
+    struct MappedFrame
+    {
+        const FrameHeader *header = nullptr; // 录制的是无类型帧时为空
+        const uint8_t *data = nullptr;       // 像素数据（带帧头时是第一个平面）
+        size_t size = 0;                     // 像素数据字节数，不含帧头
+        uint64_t sequence = 0;               // 录制时的序号
+        int64_t ptsUs = 0;                   // 顺延后的时间戳
+        uint64_t index = 0;                  // 第几次取帧，从 0 开始
+
+        PlaneView plane(uint32_t i) const { return ShmFrame::plane(header, i); }
+    };
+
+    FrameFileSource() = default;
+    ~FrameFileSource() { close(); }
+
+    FrameFileSource(const FrameFileSource &) = delete;
+    FrameFileSource &operator=(const FrameFileSource &) = delete;
+
+    /**
+     * @brief 映射文件并检查尾部和索引
+     * @return 文件不存在、格式不对或索引越界时返回 false
+     */
+    bool open(const char *path, Pacing pacing = Pacing::MaxSpeed, bool loop = false)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FrameFile::Trailer))) {
+            ::close(fd);
+            return false;
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        void *base = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        m_base = static_cast<const uint8_t *>(base);
+        madvise(base, m_size, MADV_SEQUENTIAL);
+
+        FrameFile::Trailer trailer;
+        std::memcpy(&trailer, m_base + m_size - sizeof(trailer), sizeof(trailer));
+        bool ok = trailer.magic == FrameFile::Trailer::kMagic && trailer.entrySize == sizeof(FrameFile::IndexEntry)
+                  && trailer.count > 0 && trailer.indexOffset % alignof(FrameFile::IndexEntry) == 0
+                  && trailer.count <= (m_size - sizeof(trailer)) / sizeof(FrameFile::IndexEntry)
+                  && trailer.indexOffset <= m_size - sizeof(trailer) - trailer.count * sizeof(FrameFile::IndexEntry);
+        if (ok) {
+            m_index = reinterpret_cast<const FrameFile::IndexEntry *>(m_base + trailer.indexOffset);
+            m_count = trailer.count;
+            for (size_t i = 0; i < m_count && ok; ++i) {
+                ok = m_index[i].length > 0 && m_index[i].offset <= trailer.indexOffset
+                     && m_index[i].length <= trailer.indexOffset - m_index[i].offset;
+            }
+        }
+        if (!ok) {
+            close();
+            return false;
+        }
+
+        m_pacing = pacing;
+        m_loop = loop;
+        m_duration = m_count > 1 ? m_index[m_count - 1].ptsUs - m_index[0].ptsUs : 0;
+        // 顺延时再加一个平均帧间隔，避免首尾两帧时间戳相同
+        m_duration += m_count > 1 ? m_duration / static_cast<int64_t>(m_count - 1) : 0;
+        rewind();
+        return true;
+    }
+
+    void close()
+    {
+        if (m_base) {
+            munmap(const_cast<uint8_t *>(m_base), m_size);
+        }
+        m_base = nullptr;
+        m_size = 0;
+        m_index = nullptr;
+        m_count = 0;
+    }
+
+    bool isOpen() const { return m_base != nullptr; }
+    size_t frameCount() const { return m_count; }
+    const FrameFile::IndexEntry &entry(size_t i) const { return m_index[i]; }
+
+    // 从第一帧重新开始，Recorded 节奏的起点设为现在
+    void rewind()
+    {
+        m_next.store(0, std::memory_order_relaxed);
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @brief 零拷贝取下一帧
+     * @return 已经取完（且不循环）时返回 false
+     */
+    bool next(MappedFrame &frame)
+    {
+        uint64_t n = m_next.fetch_add(1, std::memory_order_relaxed);
+        if (!m_base || (!m_loop && n >= m_count)) {
+            return false;
+        }
+        const FrameFile::IndexEntry &e = m_index[n % m_count];
+        const uint8_t *p = m_base + e.offset;
+        // 帧头声明的平面超出录制长度时 validate() 失败，按无类型帧处理
+        frame.header = FrameHeader::validate(p, e.length);
+        frame.data = frame.header ? p + sizeof(FrameHeader) : p;
+        frame.size = frame.header ? e.length - sizeof(FrameHeader) : e.length;
+        frame.sequence = e.sequence;
+        frame.ptsUs = e.ptsUs + static_cast<int64_t>(n / m_count) * m_duration;
+        frame.index = n;
+        pace(frame.ptsUs);
+        return true;
+    }
+
+    /**
+     * @brief 把下一帧复制到池中的帧
+     *
+     * 两边都带帧头且尺寸、格式相同时逐平面复制并带上序号和时间戳；否则按字节复制较短的长度。
+     * 帧数据通过 getData() 原地写入，可以直接作为 FramePipeline 的 SourceFunc。
+     * @return 已经取完（且不循环）时返回 false
+     */
+    bool fill(const ShmFrame &frame)
+    {
+        MappedFrame mapped;
+        if (!next(mapped)) {
+            return false;
+        }
+        FrameHeader *header = frame.header();
+        if (header && mapped.header && header->width == mapped.header->width
+            && header->height == mapped.header->height && header->format == mapped.header->format) {
+            for (uint32_t i = 0; i < header->planeCount; ++i) {
+                PlaneView src = mapped.plane(i);
+                PlaneView dst = frame.plane(i);
+                size_t rowBytes = static_cast<size_t>(src.width) * src.bytesPerPixel;
+                if (src.height == 0) {
+                    continue;
+                }
+                if (src.stride == dst.stride) {
+                    std::memcpy(dst.data, src.data, src.stride * (src.height - 1) + rowBytes);
+                    continue;
+                }
+                for (uint32_t y = 0; y < src.height; ++y) {
+                    std::memcpy(dst.row(y), src.row(y), rowBytes);
+                }
+            }
+            header->sequence = mapped.sequence;
+            header->ptsUs = mapped.ptsUs;
+            return true;
+        }
+        std::memcpy(frame.getData(), mapped.data, std::min(frame.size(), mapped.size));
+        return true;
+    }
+
+private:
+    void pace(int64_t ptsUs)
+    {
+        if (m_pacing != Pacing::Recorded) {
+            return;
+        }
+        auto due = m_start + std::chrono::microseconds(ptsUs - m_index[0].ptsUs);
+        if (due > std::chrono::steady_clock::now()) {
+            std::this_thread::sleep_until(due);
+        }
+    }
+
+    const uint8_t *m_base = nullptr;
+    size_t m_size = 0;
+    const FrameFile::IndexEntry *m_index = nullptr;
+    size_t m_count = 0;
+    Pacing m_pacing = Pacing::MaxSpeed;
+    bool m_loop = false;
+    int64_t m_duration = 0; // 循环一遍顺延的时间
+    std::atomic<uint64_t> m_next{0};
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // FRAME_FILE_SOURCE_H
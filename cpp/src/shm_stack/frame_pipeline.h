@@ -0,0 +1,433 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include "fixed_stack.h"
+#include "mpmc_queue.h"
+#include "thread_placement.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 多级帧处理流水线
+ *
+ * 典型拓扑：decode -> color-convert -> overlay -> render/encode。
+ * - 第一级是 source，从 FixedStack 获取缓冲并填充，池耗尽时阻塞等待，
+ *   这就是整条流水线的背压来源
+ * - 后续每一级有自己的线程数和一个有界无锁输入队列（MpmcQueue）
+ * - 输入队列满时按该级的 OverflowPolicy 处理：阻塞上游、丢弃新帧或丢弃最旧的帧
+ * - 帧在各级之间以 shared_ptr<Element> 传递，最后一级处理完后自动归还到池中
+ *
+ * 每一级统计处理帧数、丢帧数、利用率（处理耗时 / 线程数 * 运行时长）、
+ * 阻塞时长和输入队列深度，利用率最高的一级就是瓶颈。
+ * placement() 可以为刚添加的一级指定 CPU 亲和性和 SCHED_FIFO 优先级。
+ *
+ * 用法：
+ * @code
+ * FramePipeline<ShmFrame> pipeline(pool);
+ * pipeline.source("decode", 1, decode)
+ *     .stage("convert", 2, FramePipeline<ShmFrame>::OverflowPolicy::Block, 4, convert)
+ *     .stage("render", 1, FramePipeline<ShmFrame>::OverflowPolicy::LatestWins, 2, render);
+ * pipeline.start();
+ * ...
+ * pipeline.stop();
+ * @endcode
+ *
+ * @tparam T 池中存储的帧类型
+ */
+template <typename T>
+class FramePipeline
+{
+public:
+    using Element = typename FixedStack<T>::Element;
+    using ElementPtr = std::shared_ptr<Element>;
+
+    // 返回 false 表示数据源已结束，source 线程退出
+    using SourceFunc = std::function<bool(const T &)>;
+    using StageFunc = std::function<void(const T &)>;
+
+    /**
+     * @brief 输入队列满时的处理策略
+     */
+    enum class OverflowPolicy {
+        Block,      // 上游等待队列腾出空位，背压一路传到 source 和池
+        Drop,       // 丢弃新到达的帧
+        LatestWins, // 丢弃队列中最旧的帧，保证下游总是拿到最新的帧
+    };
+
+    struct StageMetrics
+    {
+        std::string name;
+        size_t threads = 0;
+        uint64_t processed = 0;      // 处理完成的帧数
+        uint64_t dropped = 0;        // 在本级输入队列被丢弃的帧数
+        double utilization = 0;      // 处理耗时占 线程数 * 运行时长 的比例
+        double blockedMs = 0;        // 等待池（source）或等待下游队列的总时长
+        double avgQueueDepth = 0;    // 每次取帧时采样的输入队列深度均值
+        size_t maxQueueDepth = 0;    // 输入队列深度最大值
+        size_t pinnedThreads = 0;    // 成功绑定 CPU 的线程数
+        size_t realtimeThreads = 0;  // 成功切换到 SCHED_FIFO 的线程数
+    };
+
+    explicit FramePipeline(FixedStack<T> &pool)
+        : m_pool(pool)
+    {
+    }
+
+    ~FramePipeline() { stop(); }
+
+    FramePipeline(const FramePipeline &) = delete;
+    FramePipeline &operator=(const FramePipeline &) = delete;
+
+    /**
+     * @brief 设置数据源，必须是第一级
+     * @param threads source 线程数
+     * @param func 填充帧数据，返回 false 表示数据源结束
+     */
+    FramePipeline &source(std::string name, size_t threads, SourceFunc func)
+    {
+        auto stage = std::make_unique<Stage>();
+        stage->name = std::move(name);
+        stage->threads = std::max<size_t>(threads, 1);
+        stage->source = std::move(func);
+        m_last = stage.get();
+        m_stages.insert(m_stages.begin(), std::move(stage));
+        return *this;
+    }
+
+    /**
+     * @brief 追加一级处理
+     * @param threads 本级线程数
+     * @param policy 输入队列满时的处理策略
+     * @param queueCapacity 输入队列容量
+     * @param func 处理函数，帧数据可以通过 ShmFrame::getData() 原地修改
+     */
+    FramePipeline &stage(std::string name, size_t threads, OverflowPolicy policy, size_t queueCapacity, StageFunc func)
+    {
+        auto stage = std::make_unique<Stage>();
+        stage->name = std::move(name);
+        stage->threads = std::max<size_t>(threads, 1);
+        stage->policy = policy;
+        stage->process = std::move(func);
+        stage->queue = std::make_unique<MpmcQueue<ElementPtr>>(std::max<size_t>(queueCapacity, 1));
+        m_last = stage.get();
+        m_stages.push_back(std::move(stage));
+        return *this;
+    }
+
+    /**
+     * @brief 为最近添加的一级（source 或 stage）设置线程放置策略，start() 前调用
+     *
+     * 本级第 t 个线程启动时调用 ThreadPlacement::apply(policy, t)，
+     * 实际生效的线程数见 StageMetrics::pinnedThreads / realtimeThreads。
+     */
+    FramePipeline &placement(ThreadPlacement::Policy policy)
+    {
+        if (m_last) {
+            m_last->placement = std::move(policy);
+        }
+        return *this;
+    }
+
+    void start()
+    {
+        if (m_running || m_stages.empty() || !m_stages.front()->source) {
+            return;
+        }
+        m_running = true;
+        m_stopping.store(false, std::memory_order_relaxed);
+        m_start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < m_stages.size(); ++i) {
+            Stage &stage = *m_stages[i];
+            stage.active.store(stage.threads, std::memory_order_relaxed);
+            for (size_t t = 0; t < stage.threads; ++t) {
+                stage.workers.emplace_back([this, i, t] {
+                    place(*m_stages[i], t);
+                    if (i == 0) {
+                        runSource();
+                    } else {
+                        runStage(i);
+                    }
+                });
+            }
+        }
+    }
+
+    /**
+     * @brief 停止 source，等待已经进入流水线的帧全部处理完后返回
+     */
+    void stop()
+    {
+        if (!m_running) {
+            return;
+        }
+        m_stopping.store(true, std::memory_order_release);
+        for (auto &stage : m_stages) {
+            for (auto &worker : stage->workers) {
+                worker.join();
+            }
+            stage->workers.clear();
+        }
+        m_elapsed = std::chrono::steady_clock::now() - m_start;
+        m_running = false;
+    }
+
+    // 等待 source 自行结束（返回 false）并排空流水线
+    void wait()
+    {
+        if (!m_running) {
+            return;
+        }
+        for (auto &worker : m_stages.front()->workers) {
+            worker.join();
+        }
+        m_stages.front()->workers.clear();
+        stop();
+    }
+
+    /**
+     * @brief 各级统计数据，需在 stop() 之后调用
+     */
+    std::vector<StageMetrics> metrics() const
+    {
+        std::vector<StageMetrics> result;
+        double wallNs = std::chrono::duration<double, std::nano>(m_elapsed).count();
+        for (const auto &stage : m_stages) {
+            StageMetrics m;
+            m.name = stage->name;
+            m.threads = stage->threads;
+            m.processed = stage->processed.load();
+            m.dropped = stage->dropped.load();
+            m.utilization = wallNs > 0 ? stage->busyNs.load() / (wallNs * stage->threads) : 0;
+            m.blockedMs = stage->blockedNs.load() / 1e6;
+            uint64_t samples = stage->depthSamples.load();
+            m.avgQueueDepth = samples ? static_cast<double>(stage->depthSum.load()) / samples : 0;
+            m.maxQueueDepth = stage->depthMax.load();
+            m.pinnedThreads = stage->pinned.load();
+            m.realtimeThreads = stage->realtime.load();
+            result.push_back(std::move(m));
+        }
+        return result;
+    }
+
+    // 利用率最高的一级，即当前拓扑的瓶颈
+    std::string bottleneck() const
+    {
+        auto all = metrics();
+        auto it = std::max_element(all.begin(), all.end(), [](const StageMetrics &a, const StageMetrics &b) {
+            return a.utilization < b.utilization;
+        });
+        return it == all.end() ? std::string() : it->name;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stage
+    {
+        std::string name;
+        size_t threads = 1;
+        OverflowPolicy policy = OverflowPolicy::Block;
+        SourceFunc source;
+        StageFunc process;
+        std::unique_ptr<MpmcQueue<ElementPtr>> queue; // source 没有输入队列
+        std::vector<std::thread> workers;
+        std::atomic<size_t> active{0}; // 仍在运行的线程数，下游据此判断上游是否结束
+
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> blockedNs{0};
+        std::atomic<uint64_t> depthSum{0};
+        std::atomic<uint64_t> depthSamples{0};
+        std::atomic<size_t> depthMax{0};
+
+        ThreadPlacement::Policy placement;
+        std::atomic<size_t> pinned{0};
+        std::atomic<size_t> realtime{0};
+    };
+
+    // 先自旋，再让出 CPU，最后短暂休眠，避免空闲线程占满核心
+    class Backoff
+    {
+    public:
+        void pause()
+        {
+            if (m_count < 64) {
+                ++m_count;
+            } else if (m_count < 128) {
+                ++m_count;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+    private:
+        unsigned m_count = 0;
+    };
+
+    static uint64_t nanosSince(Clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    static void place(Stage &stage, size_t threadIndex)
+    {
+        if (stage.placement.cpus.empty() && stage.placement.fifoPriority <= 0) {
+            return;
+        }
+        ThreadPlacement::Result result = ThreadPlacement::apply(stage.placement, threadIndex);
+        stage.pinned += result.pinned ? 1 : 0;
+        stage.realtime += result.realtime ? 1 : 0;
+    }
+
+    void runSource()
+    {
+        Stage &stage = *m_stages.front();
+        uint64_t busyNs = 0;
+        uint64_t blockedNs = 0;
+        uint64_t processed = 0;
+
+        while (!m_stopping.load(std::memory_order_acquire)) {
+            ElementPtr element = m_pool.tryAcquire();
+            if (!element) {
+                // 池耗尽：等待下游归还缓冲
+                auto waitStart = Clock::now();
+                Backoff backoff;
+                while (!element && !m_stopping.load(std::memory_order_acquire)) {
+                    backoff.pause();
+                    element = m_pool.tryAcquire();
+                }
+                blockedNs += nanosSince(waitStart);
+                if (!element) {
+                    break;
+                }
+            }
+
+            auto begin = Clock::now();
+            bool more = stage.source(*element->value());
+            busyNs += nanosSince(begin);
+            if (!more) {
+                break;
+            }
+            ++processed;
+            blockedNs += forward(1, std::move(element));
+        }
+
+        stage.busyNs += busyNs;
+        stage.blockedNs += blockedNs;
+        stage.processed += processed;
+        stage.active.fetch_sub(1, std::memory_order_release);
+    }
+
+    void runStage(size_t index)
+    {
+        Stage &stage = *m_stages[index];
+        Stage &upstream = *m_stages[index - 1];
+        uint64_t busyNs = 0;
+        uint64_t blockedNs = 0;
+        uint64_t processed = 0;
+        uint64_t depthSum = 0;
+        uint64_t depthSamples = 0;
+        size_t depthMax = 0;
+
+        Backoff backoff;
+        while (true) {
+            size_t depth = stage.queue->sizeApprox();
+            ElementPtr element;
+            if (!stage.queue->tryPop(element)) {
+                // 上游全部退出后再确认一次队列为空，才能安全退出
+                if (upstream.active.load(std::memory_order_acquire) == 0 && !stage.queue->tryPop(element)) {
+                    break;
+                }
+                if (!element) {
+                    backoff.pause();
+                    continue;
+                }
+            }
+            backoff = Backoff();
+            depthSum += depth;
+            ++depthSamples;
+            depthMax = std::max(depthMax, depth);
+
+            auto begin = Clock::now();
+            stage.process(*element->value());
+            busyNs += nanosSince(begin);
+            ++processed;
+
+            if (index + 1 < m_stages.size()) {
+                blockedNs += forward(index + 1, std::move(element));
+            }
+            // 最后一级：element 析构时归还到池中
+        }
+
+        stage.busyNs += busyNs;
+        stage.blockedNs += blockedNs;
+        stage.processed += processed;
+        stage.depthSum += depthSum;
+        stage.depthSamples += depthSamples;
+        size_t prevMax = stage.depthMax.load();
+        while (prevMax < depthMax && !stage.depthMax.compare_exchange_weak(prevMax, depthMax)) {
+        }
+        stage.active.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 把帧送入下一级的输入队列
+     * @return 因队列满而阻塞的纳秒数
+     */
+    uint64_t forward(size_t index, ElementPtr element)
+    {
+        if (index >= m_stages.size()) {
+            return 0;
+        }
+        Stage &next = *m_stages[index];
+        if (next.queue->tryPush(std::move(element))) {
+            return 0;
+        }
+
+        switch (next.policy) {
+        case OverflowPolicy::Drop:
+            next.dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        case OverflowPolicy::LatestWins: {
+            ElementPtr oldest;
+            while (!next.queue->tryPush(std::move(element))) {
+                if (next.queue->tryPop(oldest)) {
+                    oldest.reset();
+                    next.dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return 0;
+        }
+        case OverflowPolicy::Block:
+        default: {
+            auto waitStart = Clock::now();
+            Backoff backoff;
+            while (!next.queue->tryPush(std::move(element))) {
+                backoff.pause();
+            }
+            return nanosSince(waitStart);
+        }
+        }
+    }
+
+    FixedStack<T> &m_pool;
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    Stage *m_last = nullptr; // placement() 作用的一级
+    std::atomic<bool> m_stopping{false};
+    bool m_running = false;
+    Clock::time_point m_start;
+    Clock::duration m_elapsed{};
+};
+
+#endif // FRAME_PIPELINE_H
@@ -0,0 +1,620 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include "fixed_stack.h"
+#include "frame_file.h"
+#include "shm_frame.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief 把 FixedStack<ShmFrame> 中流过的帧异步写入文件，供 QA 回放
+ *
+ * 消费者线程调用 write() 交出帧的引用后立即返回，帧在写完之前一直被录制器持有，
+ * 写完成时释放引用，元素随即回到池中。同时在写的帧数不超过 queueDepth，
+ * 录制器最多占用这么多池元素；槽位用完时 write() 等待最早的写完成，等待时长计入 stallMs。
+ *
+ * 两种后端：
+ * - IoUring：直接用 io_uring_setup / io_uring_enter 系统调用（不依赖 liburing），
+ *   每攒够 batch 个 IORING_OP_WRITE 提交一次，独立的收割线程阻塞等待完成。
+ *   batch 不超过 queueDepth / 2：否则要等所有槽位都排满才提交，下一帧只能等整批写完，退化为停等
+ * - ThreadPool：内核不支持或被禁用 io_uring 时，由 WorkStealingPool 的线程执行 pwrite
+ *
+ * direct = true 时另外以 O_DIRECT 打开文件：帧位于页对齐的共享内存时绕过页缓存，
+ * 长度补齐到 4 KB（共享内存段按页分配，补齐部分可读）；其他帧和文件系统不支持 O_DIRECT 时
+ * 走普通写。文件格式见 frame_file.h。
+ *
+ * 索引只包含写成功的帧，写失败的帧在文件中留下空洞。io_uring_enter 出现 EINTR / EAGAIN
+ * 以外的错误时录制停止：在写的帧按失败处理并归还，之后的 write() 返回 false，
+ * close() 仍然写出已成功帧的索引并返回 false，错误码见 Stats::error。
+ *
+ * write() / flush() / close() 只能由同一个线程调用。
+ */
+class FrameRecorder
+{
+public:
+    using Element = FixedStack<ShmFrame>::Element;
+    using ElementPtr = std::shared_ptr<Element>;
+
+    enum class Backend {
+        Auto, // 优先 io_uring，不可用时回退到线程池
+        IoUring,
+        ThreadPool,
+    };
+
+    struct Options
+    {
+        Backend backend = Backend::Auto;
+        bool direct = false;
+        uint32_t queueDepth = 16; // 同时在写的帧数上限
+        uint32_t batch = 4;       // io_uring 每次提交的写请求数，不超过 queueDepth / 2
+        size_t threads = 2;       // 线程池后端的写线程数
+    };
+
+    struct Stats
+    {
+        Backend backend = Backend::Auto;
+        bool direct = false;       // O_DIRECT 是否生效
+        uint64_t frames = 0;
+        uint64_t bytes = 0;        // 帧的实际字节数，不含对齐填充
+        uint64_t directWrites = 0; // 走 O_DIRECT 的帧数
+        uint64_t submits = 0;      // io_uring_enter 提交次数
+        uint64_t retries = 0;      // 异步写失败或写不完整后同步补写的次数
+        uint64_t failures = 0;
+        uint64_t indexed = 0;      // 写入索引的帧数，即写成功的帧数
+        int error = 0;             // 使录制停止的 io_uring_enter 错误码，0 表示没有
+        uint32_t maxInFlight = 0;
+        double stallMs = 0;   // write() 等待空闲槽位的总时长
+        double holdUsAvg = 0; // 帧从 write() 到归还池的平均时长
+        double seconds = 0;   // open() 到 close() 完成
+
+        double gbps() const { return seconds > 0 ? bytes / seconds / 1e9 : 0; }
+    };
+
+    FrameRecorder()
+        : FrameRecorder(Options())
+    {
+    }
+
+    explicit FrameRecorder(Options options)
+        : m_options(options)
+    {
+        m_options.queueDepth = std::max<uint32_t>(m_options.queueDepth, 1);
+        m_options.batch = std::clamp<uint32_t>(m_options.batch, 1, std::max<uint32_t>(m_options.queueDepth / 2, 1));
+    }
+
+    ~FrameRecorder() { close(); }
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    static const char *backendName(Backend backend)
+    {
+        switch (backend) {
+        case Backend::IoUring:
+            return "io_uring";
+        case Backend::ThreadPool:
+            return "thread pool";
+        default:
+            return "auto";
+        }
+    }
+
+    bool open(const char *path)
+    {
+        close();
+        m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            return false;
+        }
+        m_stats = Stats();
+        if (m_options.direct) {
+            m_directFd = ::open(path, O_WRONLY | O_CLOEXEC | O_DIRECT);
+            m_stats.direct = m_directFd >= 0;
+        }
+
+        m_stats.backend = Backend::ThreadPool;
+        if (m_options.backend != Backend::ThreadPool && setupRing()) {
+            m_stats.backend = Backend::IoUring;
+            m_reaper = std::thread([this] { reap(); });
+        } else {
+            m_pool = std::make_unique<WorkStealingPool>(m_options.threads);
+        }
+
+        m_slots.assign(m_options.queueDepth, Slot());
+        m_free.clear();
+        for (uint32_t i = m_options.queueDepth; i > 0; --i) {
+            m_free.push_back(i - 1);
+        }
+        m_index.clear();
+        m_offset = 0;
+        m_written = 0;
+        m_pending = 0;
+        m_error = 0;
+        m_reaperDone = false;
+        m_holdNs = 0;
+        m_start = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    /**
+     * @brief 异步写入一帧，写完成后释放 frame 的引用
+     * @return 录制器未打开、已因错误停止或帧过大时返回 false，frame 立即释放
+     */
+    bool write(ElementPtr frame)
+    {
+        if (m_fd < 0 || !frame || failed()) {
+            return false;
+        }
+        const ShmFrame *value = frame->value();
+        const uint8_t *data = value->header() ? reinterpret_cast<const uint8_t *>(value->header()) : value->getData();
+        uint64_t length = value->header() ? sizeof(FrameHeader) + value->size() : value->size();
+        if (length == 0 || length > kMaxWrite) {
+            return false;
+        }
+
+        FrameFile::IndexEntry entry;
+        entry.offset = m_offset;
+        entry.length = length;
+        if (value->header()) {
+            entry.sequence = value->header()->sequence;
+            entry.ptsUs = value->header()->ptsUs;
+        } else {
+            entry.sequence = m_written;
+            entry.ptsUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now().time_since_epoch())
+                              .count();
+        }
+
+        // 页对齐的共享内存可以补齐长度后走 O_DIRECT
+        bool direct = m_directFd >= 0 && value->shmId() >= 0
+                      && reinterpret_cast<uintptr_t>(data) % FrameFile::kAlignment == 0;
+
+        uint32_t index = 0;
+        if (!acquireSlot(index)) {
+            return false;
+        }
+        m_offset += FrameFile::alignUp(length);
+        ++m_written;
+        Slot &slot = m_slots[index];
+        slot.entry = entry;
+        slot.frame = std::move(frame);
+        slot.data = data;
+        slot.length = length;
+        slot.writeLength = direct ? FrameFile::alignUp(length) : length;
+        slot.offset = entry.offset;
+        slot.fd = direct ? m_directFd : m_fd;
+        slot.begin = std::chrono::steady_clock::now();
+        m_stats.directWrites += direct;
+
+        if (m_stats.backend == Backend::IoUring) {
+            queueWrite(index);
+            if (++m_pending >= m_options.batch) {
+                flush();
+            }
+        } else {
+            m_pool->submit([this, index] { complete(index, writeAll(m_slots[index], 0)); });
+        }
+        return true;
+    }
+
+    // 立即提交已排队的 io_uring 写请求
+    void flush()
+    {
+        if (m_pending > 0) {
+            if (!enter(m_pending, 0, 0)) {
+                fail(errno);
+            }
+            m_pending = 0;
+            ++m_stats.submits;
+        }
+    }
+
+    // 正在写的帧数，也就是录制器当前占用的池元素数
+    uint32_t inFlight() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_options.queueDepth - static_cast<uint32_t>(m_free.size());
+    }
+
+    /**
+     * @brief 等待所有写完成，写入索引并关闭文件
+     * @return 有写失败时返回 false
+     */
+    bool close()
+    {
+        if (m_fd < 0) {
+            return true;
+        }
+        flush();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_slotFreed.wait(lock, [this] { return m_free.size() == m_slots.size() || m_error; });
+        }
+        if (m_pool) {
+            m_pool.reset();
+        }
+        if (m_reaper.joinable()) {
+            // NOP 唤醒收割线程并让它退出；收割线程因错误已经退出时直接回收
+            if (!m_reaperDone.load(std::memory_order_acquire)) {
+                io_uring_sqe *sqe = nextSqe();
+                sqe->opcode = IORING_OP_NOP;
+                sqe->user_data = kStopToken;
+                commitSqe();
+                enter(1, 0, 0);
+            }
+            m_reaper.join();
+        }
+        // 关闭 ring 后内核不再访问帧，出错时尚未收割的帧按失败归还
+        teardownRing();
+        for (uint32_t index = 0; index < m_slots.size(); ++index) {
+            if (m_slots[index].frame) {
+                complete(index, false);
+            }
+        }
+
+        // 完成顺序是乱的，索引按文件偏移（即 write() 的顺序）排列
+        std::sort(m_index.begin(), m_index.end(),
+                  [](const FrameFile::IndexEntry &a, const FrameFile::IndexEntry &b) { return a.offset < b.offset; });
+        FrameFile::Trailer trailer;
+        trailer.count = m_index.size();
+        trailer.indexOffset = m_offset;
+        bool ok = pwriteAll(m_fd, m_index.data(), m_index.size() * sizeof(FrameFile::IndexEntry), m_offset)
+                  && pwriteAll(m_fd, &trailer, sizeof(trailer),
+                               m_offset + m_index.size() * sizeof(FrameFile::IndexEntry));
+        m_stats.failures += ok ? 0 : 1;
+        if (m_directFd >= 0) {
+            ::close(m_directFd);
+            m_directFd = -1;
+        }
+        ::close(m_fd);
+        m_fd = -1;
+
+        m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        m_stats.holdUsAvg = m_stats.frames ? m_holdNs / 1000.0 / m_stats.frames : 0;
+        m_stats.indexed = m_index.size();
+        m_stats.error = m_error;
+        return m_stats.failures == 0 && m_error == 0;
+    }
+
+    // close() 之后调用
+    const Stats &stats() const { return m_stats; }
+
+private:
+    static constexpr uint64_t kStopToken = ~0ull;
+    static constexpr long kReapTimeoutMs = 50;
+    static constexpr uint64_t kMaxWrite = 0x7FFFF000; // 单次 write 的上限
+
+    struct Slot
+    {
+        ElementPtr frame;
+        const uint8_t *data = nullptr;
+        uint64_t length = 0;
+        uint64_t writeLength = 0;
+        uint64_t offset = 0;
+        int fd = -1;
+        FrameFile::IndexEntry entry; // 写成功后加入索引
+        std::chrono::steady_clock::time_point begin;
+    };
+
+    static bool pwriteAll(int fd, const void *data, size_t size, uint64_t offset)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        while (size > 0) {
+            ssize_t written = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            p += written;
+            size -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    // 从 done 字节处写完一帧；O_DIRECT 写到一半的剩余部分改用普通写
+    bool writeAll(const Slot &slot, uint64_t done)
+    {
+        if (done == 0 && pwriteAll(slot.fd, slot.data, slot.writeLength, slot.offset)) {
+            return true;
+        }
+        if (done >= slot.length) {
+            return true;
+        }
+        return pwriteAll(m_fd, slot.data + done, slot.length - done, slot.offset + done);
+    }
+
+    // 录制因错误停止时返回 false
+    bool acquireSlot(uint32_t &index)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_free.empty()) {
+            // 等待之前先提交已排队的请求，否则它们永远不会完成
+            lock.unlock();
+            flush();
+            lock.lock();
+            auto begin = std::chrono::steady_clock::now();
+            m_slotFreed.wait(lock, [this] { return !m_free.empty() || m_error; });
+            m_stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+        if (m_error) {
+            return false;
+        }
+        index = m_free.back();
+        m_free.pop_back();
+        m_stats.maxInFlight =
+            std::max(m_stats.maxInFlight, m_options.queueDepth - static_cast<uint32_t>(m_free.size()));
+        return true;
+    }
+
+    bool failed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_error != 0;
+    }
+
+    // 记录第一个致命错误并唤醒等待槽位的 write() / close()
+    void fail(int error)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = m_error ? m_error : (error ? error : EIO);
+        m_slotFreed.notify_all();
+    }
+
+    // 写线程或收割线程调用：释放帧的引用（元素回到池中），然后归还槽位
+    void complete(uint32_t index, bool ok)
+    {
+        Slot &slot = m_slots[index];
+        uint64_t holdNs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - slot.begin).count());
+        uint64_t length = slot.length;
+        FrameFile::IndexEntry entry = slot.entry;
+        slot.frame.reset();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) {
+            m_index.push_back(entry);
+        }
+        ++m_stats.frames;
+        m_stats.bytes += ok ? length : 0;
+        m_stats.failures += ok ? 0 : 1;
+        m_holdNs += holdNs;
+        m_free.push_back(index);
+        m_slotFreed.notify_all();
+    }
+
+    // ==================== io_uring ====================
+
+    static long enterRing(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                          const void *arg = nullptr, size_t argSize = 0)
+    {
+        return syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argSize);
+    }
+
+    // 等待至少一个完成事件；内核支持 IORING_ENTER_EXT_ARG 时最多等 kReapTimeoutMs，
+    // 收割线程借此发现 write() 一侧记录的错误，不会永远阻塞
+    long waitCompletion()
+    {
+        if (!m_extArg) {
+            return enterRing(m_ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+        }
+        __kernel_timespec timeout{};
+        timeout.tv_nsec = kReapTimeoutMs * 1000000;
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        return enterRing(m_ringFd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+
+    // ETIME 是 waitCompletion() 超时
+    static bool transient(int error) { return error == EINTR || error == EAGAIN || error == ETIME; }
+
+    // 提交 toSubmit 个请求；出现 EINTR / EAGAIN 以外的错误时返回 false，errno 为错误码
+    bool enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        while (toSubmit > 0) {
+            long submitted = enterRing(m_ringFd, toSubmit, minComplete, flags);
+            if (submitted < 0 && transient(errno)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (submitted <= 0) {
+                errno = submitted < 0 ? errno : EIO;
+                return false;
+            }
+            toSubmit -= static_cast<unsigned>(submitted);
+        }
+        return true;
+    }
+
+    bool setupRing()
+    {
+        io_uring_params params{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, m_options.queueDepth + 1, &params));
+        if (fd < 0) {
+            return false;
+        }
+        m_ringFd = fd;
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+        m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        m_cqRing = single ? m_sqRing
+                          : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                 IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+            m_sqes = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe *>(sqes);
+            m_sqRing = m_sqRing == MAP_FAILED ? nullptr : m_sqRing;
+            m_cqRing = m_cqRing == MAP_FAILED ? nullptr : m_cqRing;
+            teardownRing();
+            return false;
+        }
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+        m_extArg = params.features & IORING_FEAT_EXT_ARG;
+        auto sq = static_cast<uint8_t *>(m_sqRing);
+        auto cq = static_cast<uint8_t *>(m_cqRing);
+        m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void teardownRing()
+    {
+        if (m_sqes) {
+            munmap(m_sqes, m_sqesSize);
+        }
+        if (m_cqRing && m_cqRing != m_sqRing) {
+            munmap(m_cqRing, m_cqRingSize);
+        }
+        if (m_sqRing) {
+            munmap(m_sqRing, m_sqRingSize);
+        }
+        if (m_ringFd >= 0) {
+            ::close(m_ringFd);
+        }
+        m_sqes = nullptr;
+        m_sqRing = m_cqRing = nullptr;
+        m_ringFd = -1;
+    }
+
+    // 提交队列只由 write() 所在线程写入；在写的请求不超过 queueDepth，队列不会满
+    io_uring_sqe *nextSqe()
+    {
+        unsigned index = *m_sqTail & m_sqMask;
+        io_uring_sqe *sqe = &m_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        return sqe;
+    }
+
+    void commitSqe() { __atomic_store_n(m_sqTail, *m_sqTail + 1, __ATOMIC_RELEASE); }
+
+    void queueWrite(uint32_t index)
+    {
+        const Slot &slot = m_slots[index];
+        io_uring_sqe *sqe = nextSqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = slot.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(slot.data);
+        sqe->len = static_cast<uint32_t>(slot.writeLength);
+        sqe->off = slot.offset;
+        sqe->user_data = index;
+        commitSqe();
+    }
+
+    // 收割线程：阻塞等待完成事件，写不完整或失败时同步补写；等待出错时停止录制并退出
+    void reap()
+    {
+        while (true) {
+            unsigned head = *m_cqHead;
+            unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                int error = waitCompletion() < 0 && !transient(errno) ? errno : 0;
+                if (error || failed()) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_stats.retries = m_retries;
+                    }
+                    m_reaperDone.store(true, std::memory_order_release);
+                    if (error) {
+                        fail(error);
+                    }
+                    return;
+                }
+                continue;
+            }
+            bool stop = false;
+            for (; head != tail; ++head) {
+                const io_uring_cqe &cqe = m_cqes[head & m_cqMask];
+                if (cqe.user_data == kStopToken) {
+                    stop = true;
+                    continue;
+                }
+                uint32_t index = static_cast<uint32_t>(cqe.user_data);
+                const Slot &slot = m_slots[index];
+                bool ok = cqe.res >= 0 && static_cast<uint64_t>(cqe.res) >= slot.writeLength;
+                if (!ok) {
+                    ++m_retries;
+                    ok = writeAll(slot, cqe.res > 0 ? static_cast<uint64_t>(cqe.res) : 0);
+                }
+                complete(index, ok);
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            if (stop) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.retries = m_retries;
+                m_reaperDone.store(true, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    Options m_options;
+    Stats m_stats;
+    int m_fd = -1;
+    int m_directFd = -1;
+    uint64_t m_offset = 0;
+    uint64_t m_written = 0;                     // write() 接受的帧数
+    std::vector<FrameFile::IndexEntry> m_index; // 写成功的帧，由 m_mutex 保护
+    int m_error = 0;                            // 由 m_mutex 保护
+    std::atomic<bool> m_reaperDone{false};
+    std::chrono::steady_clock::time_point m_start;
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_slotFreed;
+    uint64_t m_holdNs = 0;
+
+    std::unique_ptr<WorkStealingPool> m_pool;
+
+    int m_ringFd = -1;
+    bool m_extArg = false; // 内核支持带超时的等待
+    void *m_sqRing = nullptr;
+    void *m_cqRing = nullptr;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    size_t m_sqesSize = 0;
+    io_uring_sqe *m_sqes = nullptr;
+    io_uring_cqe *m_cqes = nullptr;
+    unsigned *m_sqTail = nullptr;
+    unsigned *m_sqArray = nullptr;
+    unsigned *m_cqHead = nullptr;
+    unsigned *m_cqTail = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_cqMask = 0;
+    unsigned m_pending = 0;
+    uint64_t m_retries = 0; // 只由收割线程修改
+    std::thread m_reaper;
+};
+
+#endif // FRAME_RECORDER_H
@@ -1,15 +1,39 @@
+#include "alloc_counter.h"
+#include "broadcast_ring.h"
+#include "coro_pool.h"
+#include "dirty_region.h"
 #include "fixed_stack.h"
+#include "frame_file.h"
+#include "frame_file_source.h"
+#include "frame_pipeline.h"
+#include "frame_recorder.h"
+#include "mpmc_queue.h"
+#include "perf_counters.h"
+#include "pixel_convert.h"
+#include "rate_controller.h"
+#include "seqlock_snapshot.h"
 #include "shm_frame.h"
+#include "thread_placement.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <numeric>
+#include <random>
+#include <string>
 #include <thread>
 #include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 // ==================== Test Helper Functions ====================
 
@@ -26,33 +50,196 @@ void printTestResult(bool passed, const std::string &name)
     }
 }
 
+// ==================== Benchmarks ====================
+// 基准测试耗时较长且会向 /tmp 写入数 GB 数据，默认跳过；传入 --bench 或设置 SHM_STACK_BENCH=1 后运行
+bool benchmarksEnabled(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--bench") == 0) {
+            return true;
+        }
+    }
+    const char *env = std::getenv("SHM_STACK_BENCH");
+    return env && std::strcmp(env, "0") != 0;
+}
+
+// ==================== Perf Counters ====================
+// 设置环境变量 SHM_STACK_PERF=1 后，并发测试会在测量区间前后读取 perf_event 计数器
+std::unique_ptr<PerfCounters> startPerfCounters()
+{
+    const char *env = std::getenv("SHM_STACK_PERF");
+    if (!env || std::strcmp(env, "0") == 0) {
+        return nullptr;
+    }
+    auto counters = std::make_unique<PerfCounters>();
+    if (!counters->anyAvailable()) {
+        std::cout << "  perf counters unavailable (" << counters->error() << ")\n";
+        return nullptr;
+    }
+    counters->start();
+    return counters;
+}
+
+// 按操作数（生产者的每次 tryAcquire 尝试）平均输出计数器
+void printPerfReport(PerfCounters *counters, size_t ops)
+{
+    if (!counters) {
+        return;
+    }
+    PerfCounters::Sample sample = counters->stop();
+    std::cout << "  perf per op (" << ops << " ops):";
+    for (size_t i = 0; i < PerfCounters::CounterCount; ++i) {
+        auto counter = static_cast<PerfCounters::Counter>(i);
+        std::cout << " " << PerfCounters::name(counter) << "=";
+        if (sample.valid[i] && ops > 0) {
+            std::cout << static_cast<double>(sample.values[i]) / ops;
+        } else {
+            std::cout << "n/a";
+        }
+    }
+    std::cout << "\n";
+    if (!counters->error().empty()) {
+        std::cout << "  (some counters unavailable: " << counters->error() << ")\n";
+    }
+}
+
+// ==================== Steady-State Allocations ====================
+// 统计单个线程在预热帧之后的堆分配次数，必须在同一线程内调用
+class SteadyStateAllocProbe
+{
+public:
+    explicit SteadyStateAllocProbe(size_t warmupFrames)
+        : m_warmupFrames(warmupFrames)
+    {
+    }
+
+    void onFrame()
+    {
+        if (++m_frames == m_warmupFrames) {
+            m_base = AllocCounter::threadAllocations();
+        }
+    }
+
+    uint64_t allocations() const
+    {
+        return m_frames >= m_warmupFrames ? AllocCounter::threadAllocations() - m_base : 0;
+    }
+
+    size_t steadyFrames() const
+    {
+        return m_frames > m_warmupFrames ? m_frames - m_warmupFrames : 0;
+    }
+
+private:
+    size_t m_warmupFrames;
+    size_t m_frames = 0;
+    uint64_t m_base = 0;
+};
+
+void reportSteadyStateAllocations(uint64_t allocations, size_t frames)
+{
+    if (!AllocCounter::enabled()) {
+        std::cout << "  steady-state allocs: alloc counter not compiled in, skipped\n";
+        return;
+    }
+    std::cout << "  steady-state allocs=" << allocations << " ("
+              << (frames ? static_cast<double>(allocations) / frames : 0.0)
+              << " per frame over " << frames << " frames)\n";
+    printTestResult(allocations == 0, "No heap allocations after warmup");
+}
+
 // ==================== FrameQueue ====================
-// 非阻塞线程安全队列，用于生产者和消费者之间传递 Frame
+// 线程安全的有界环形队列，用于生产者和消费者之间传递 Frame
+// 存储在构造时一次性分配，push/pop 不会产生堆分配；
+// 队列中的元素都来自固定大小的池，容量不小于池大小时 push 不会阻塞
 class ElementQueue
 {
 public:
+    explicit ElementQueue(size_t capacity = 64)
+        : m_slots(capacity)
+    {
+    }
+
     void push(std::shared_ptr<FixedStack<ShmFrame>::Element> element)
     {
-        std::lock_guard<std::mutex> lock(m_mtx);
-        m_queue.push(element);
-        m_cv.notify_one();
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_notFull.wait(lock, [this] { return m_size < m_slots.size(); });
+        m_slots[(m_head + m_size) % m_slots.size()] = std::move(element);
+        ++m_size;
+        m_notEmpty.notify_one();
     }
 
+    // 队列关闭且已取空时返回 nullptr
     std::shared_ptr<FixedStack<ShmFrame>::Element> pop()
     {
         std::unique_lock<std::mutex> lock(m_mtx);
-        m_cv.wait(lock, [this] { return !m_queue.empty(); });
-        auto f = m_queue.front();
-        m_queue.pop();
+        m_notEmpty.wait(lock, [this] { return m_size > 0 || m_closed; });
+        if (m_size == 0) {
+            return nullptr;
+        }
+        auto f = std::move(m_slots[m_head]);
+        m_head = (m_head + 1) % m_slots.size();
+        --m_size;
+        m_notFull.notify_one();
         return f;
     }
 
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_size;
+    }
+
+    size_t capacity() const { return m_slots.size(); }
+
+    // 生产者全部退出后调用，唤醒阻塞在 pop() 中的消费者
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
 private:
-    std::queue<std::shared_ptr<FixedStack<ShmFrame>::Element>> m_queue;
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> m_slots;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    bool m_closed = false;
     std::mutex m_mtx;
-    std::condition_variable m_cv;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
 };
 
+// ==================== Test: Alloc Counter ====================
+void testAllocCounter()
+{
+    printSection("Test: Alloc Counter");
+
+    if (!AllocCounter::enabled()) {
+        std::cout << "  alloc counter not compiled in (SHM_STACK_ALLOC_COUNTER or sanitizer build), skipped\n";
+        return;
+    }
+
+    uint64_t before = AllocCounter::threadAllocations();
+    auto value = std::make_unique<int>(42);
+    uint64_t after = AllocCounter::threadAllocations();
+    printTestResult(after > before, "Heap allocation is counted");
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    frames.emplace_back(std::make_unique<ShmFrame>(1024));
+    FixedStack<ShmFrame> stack(std::move(frames));
+    ElementQueue queue(4);
+
+    before = AllocCounter::threadAllocations();
+    for (int i = 0; i < 100; ++i) {
+        auto element = stack.tryAcquire();
+        queue.push(element);
+        element = queue.pop();
+    }
+    after = AllocCounter::threadAllocations();
+    printTestResult(after == before, "tryAcquire/push/pop cycle allocates nothing");
+}
+
 // ==================== Test: ShmFrame Basic ====================
 void testShmFrameBasic()
 {
@@ -104,6 +291,126 @@ void testShmFrameLargeSize()
     printTestResult(success, "ShmFrame large allocation (10MB)");
 }
 
+// ==================== Test: ShmFrame Typed Layout ====================
+void testShmFrameTyped()
+{
+    printSection("Test: ShmFrame Typed Layout");
+
+    const uint32_t W = 322, H = 241; // 奇数尺寸，检查行对齐和色度取整
+    auto aligned = [](const void *p) {
+        return reinterpret_cast<uintptr_t>(p) % FrameHeader::kAlignment == 0;
+    };
+
+    {
+        ShmFrame frame(W, H, PixelFormat::BGRA32);
+        const FrameHeader *header = frame.header();
+        PlaneView view = frame.plane(0);
+        bool ok = header && header->planeCount == 1 && view.width == W && view.height == H
+                  && view.stride % FrameHeader::kAlignment == 0 && view.stride >= W * 4
+                  && aligned(view.data) && view.data == frame.getData()
+                  && frame.size() == static_cast<size_t>(view.stride) * H;
+        printTestResult(ok, "BGRA32 header, aligned stride and size()");
+
+        for (uint32_t y = 0; y < H; ++y) {
+            uint32_t *row = view.rowAs<uint32_t>(y);
+            for (uint32_t x = 0; x < W; ++x) {
+                row[x] = (y << 16) | x;
+            }
+        }
+        bool match = true;
+        for (uint32_t y = 0; y < H && match; ++y) {
+            match = view.rowAs<uint32_t>(y)[W - 1] == ((y << 16) | (W - 1));
+        }
+        printTestResult(match, "Row view write/read");
+    }
+
+    {
+        ShmFrame nv12(W, H, PixelFormat::NV12);
+        PlaneView y = nv12.plane(0), uv = nv12.plane(1);
+        bool ok = nv12.header()->planeCount == 2 && y.width == W && y.bytesPerPixel == 1
+                  && uv.width == (W + 1) / 2 && uv.height == (H + 1) / 2 && uv.bytesPerPixel == 2
+                  && aligned(y.data) && aligned(uv.data) && uv.data >= y.row(H)
+                  && nv12.plane(2).data == nullptr;
+        printTestResult(ok, "NV12 plane layout");
+
+        ShmFrame i420(W, H, PixelFormat::I420);
+        PlaneView u = i420.plane(1), v = i420.plane(2);
+        ok = i420.header()->planeCount == 3 && u.width == (W + 1) / 2 && v.height == (H + 1) / 2
+             && aligned(u.data) && aligned(v.data) && v.data >= u.row(u.height)
+             && v.row(v.height) <= i420.getData() + i420.size();
+        printTestResult(ok, "I420 plane layout");
+    }
+
+    {
+        ShmFrame raw(1024);
+        printTestResult(raw.header() == nullptr && raw.size() == 1024 && raw.plane(0).data == nullptr
+                            && FrameHeader::validate(raw.getData(), raw.size()) == nullptr,
+                        "Untyped frame has no header");
+    }
+
+    {
+        // 模拟另一个进程：通过 shmId 重新 attach，只靠帧头解析元数据
+        ShmFrame frame(64, 32, PixelFormat::RGBA32);
+        frame.header()->sequence = 42;
+        frame.header()->ptsUs = 123456;
+        frame.plane(0).rowAs<uint32_t>(31)[63] = 0xDEADBEEF;
+        if (frame.shmId() < 0) {
+            printTestResult(true, "Cross-mapping read skipped (SysV shm unavailable)");
+        } else {
+            // 另一个进程只知道 shmId，段的大小从 IPC_STAT 取得
+            shmid_ds info{};
+            void *mapping = shmat(frame.shmId(), nullptr, SHM_RDONLY);
+            bool ok = mapping != MAP_FAILED && shmctl(frame.shmId(), IPC_STAT, &info) == 0;
+            if (ok) {
+                const FrameHeader *header = FrameHeader::validate(mapping, info.shm_segsz);
+                PlaneView view = ShmFrame::plane(header, 0);
+                ok = header && header->width == 64 && header->height == 32
+                     && header->format == static_cast<uint32_t>(PixelFormat::RGBA32)
+                     && header->sequence == 42 && header->ptsUs == 123456
+                     && view.rowAs<uint32_t>(31)[63] == 0xDEADBEEF;
+                shmdt(mapping);
+            }
+            printTestResult(ok, "Metadata read through a second mapping");
+        }
+    }
+
+    {
+        // 损坏或恶意的帧头：validate() 必须拒绝，不能让 plane() 给出越界指针
+        ShmFrame frame(64, 32, PixelFormat::NV12);
+        size_t total = sizeof(FrameHeader) + frame.size();
+        FrameHeader good = *frame.header();
+        auto check = [&](const FrameHeader &header, size_t size) {
+            std::vector<uint8_t> copy(std::max(size, sizeof(FrameHeader)));
+            std::memcpy(copy.data(), &header, sizeof(header));
+            return FrameHeader::validate(copy.data(), size) != nullptr;
+        };
+        bool ok = check(good, total) && !check(good, total - 1) && !check(good, sizeof(FrameHeader));
+
+        FrameHeader bad = good;
+        bad.planeOffset[1] = static_cast<uint32_t>(total);
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.planeOffset[0] = 0xFFFFFFC0; // 加上平面大小会超出 32 位
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.planeOffset[0] = 0; // 与帧头重叠
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.planeStride[0] = 32; // 容不下一行
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.height = 0xFFFFFFFF;
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.format = 99;
+        ok = ok && !check(bad, total);
+        bad = good;
+        bad.planeCount = 1; // 与 NV12 的平面数不一致
+        ok = ok && !check(bad, total);
+        printTestResult(ok, "Truncated sizes and bad plane offsets rejected");
+    }
+}
+
 // ==================== Test: FixedStack Edge Cases ====================
 void testFixedStackEdgeCases()
 {
@@ -257,6 +564,7 @@ void testMultiProducerConsumer()
     const size_t NUM_PRODUCERS = 3;
     const size_t NUM_CONSUMERS = 3;
     const size_t RUN_MS = 500;
+    const size_t WARMUP_FRAMES = 10;
 
     std::vector<std::unique_ptr<ShmFrame>> frames;
     for (size_t i = 0; i < POOL_SIZE; ++i) {
@@ -266,6 +574,10 @@ void testMultiProducerConsumer()
     ElementQueue queue;
 
     std::atomic<size_t> produced{0}, consumed{0}, dropped{0};
+    std::atomic<uint64_t> steadyAllocs{0};
+    std::atomic<size_t> steadyFrames{0};
+    // 计数器需在创建线程之前打开，以便被工作线程继承
+    auto perf = startPerfCounters();
     auto start = std::chrono::steady_clock::now();
     std::atomic<bool> stop{false};
 
@@ -273,6 +585,7 @@ void testMultiProducerConsumer()
     std::vector<std::thread> producers;
     for (size_t p = 0; p < NUM_PRODUCERS; ++p) {
         producers.emplace_back([&] {
+            SteadyStateAllocProbe probe(WARMUP_FRAMES);
             while (!stop.load()) {
                 auto now = std::chrono::steady_clock::now();
                 if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -289,7 +602,10 @@ void testMultiProducerConsumer()
                 } else {
                     dropped++;
                 }
+                probe.onFrame();
             }
+            steadyAllocs += probe.allocations();
+            steadyFrames += probe.steadyFrames();
         });
     }
 
@@ -297,6 +613,7 @@ void testMultiProducerConsumer()
     std::vector<std::thread> consumers;
     for (size_t c = 0; c < NUM_CONSUMERS; ++c) {
         consumers.emplace_back([&] {
+            SteadyStateAllocProbe probe(WARMUP_FRAMES);
             while (!stop.load()) {
                 auto now = std::chrono::steady_clock::now();
                 if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -305,19 +622,26 @@ void testMultiProducerConsumer()
                     break;
 
                 auto element = queue.pop();
+                if (!element)
+                    break;
                 consumed++;
+                probe.onFrame();
             }
+            steadyAllocs += probe.allocations();
         });
     }
 
     for (auto &p : producers)
         p.join();
+    queue.close();
     for (auto &c : consumers)
         c.join();
+    printPerfReport(perf.get(), produced);
 
     std::cout << "  Produced: " << produced << ", Consumed: " << consumed
               << ", Dropped: " << dropped << "\n";
     printTestResult(consumed > 0, "Multi-producer/consumer processed frames");
+    reportSteadyStateAllocations(steadyAllocs, steadyFrames);
 }
 
 // ==================== Test: Stress Test ====================
@@ -328,6 +652,7 @@ void testStress()
     const size_t POOL_SIZE = 20;
     const size_t BUF_SIZE = 1024;
     const size_t RUN_MS = 1000;
+    const size_t WARMUP_FRAMES = 100;
 
     std::vector<std::unique_ptr<ShmFrame>> frames;
     for (size_t i = 0; i < POOL_SIZE; ++i) {
@@ -337,9 +662,13 @@ void testStress()
     ElementQueue queue;
 
     std::atomic<size_t> produced{0}, consumed{0}, dropped{0};
+    std::atomic<uint64_t> steadyAllocs{0};
+    std::atomic<size_t> steadyFrames{0};
+    auto perf = startPerfCounters();
     auto start = std::chrono::steady_clock::now();
 
     std::thread producer([&] {
+        SteadyStateAllocProbe probe(WARMUP_FRAMES);
         while (true) {
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -354,10 +683,14 @@ void testStress()
             } else {
                 dropped++;
             }
+            probe.onFrame();
         }
+        steadyAllocs += probe.allocations();
+        steadyFrames += probe.steadyFrames();
     });
 
     std::thread consumer([&] {
+        SteadyStateAllocProbe probe(WARMUP_FRAMES);
         while (true) {
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -366,12 +699,18 @@ void testStress()
                 break;
 
             auto element = queue.pop();
+            if (!element)
+                break;
             consumed++;
+            probe.onFrame();
         }
+        steadyAllocs += probe.allocations();
     });
 
     producer.join();
+    queue.close();
     consumer.join();
+    printPerfReport(perf.get(), produced);
 
     std::cout << "  Produced: " << produced << ", Consumed: " << consumed
               << ", Dropped: " << dropped << "\n";
@@ -381,27 +720,45 @@ void testStress()
 
     size_t throughput = consumed * 1000 / RUN_MS;
     std::cout << "  Throughput: " << throughput << " frames/sec\n";
+    reportSteadyStateAllocations(steadyAllocs, steadyFrames);
 }
 
 // ==================== Test: Original Producer-Consumer ====================
-void runOriginalTest(size_t runMs, size_t decodeTimeMs, size_t renderTimeMs)
+struct OriginalTestResult
+{
+    size_t produced = 0; // 到达的帧数
+    size_t consumed = 0;
+    size_t dropped = 0;  // 解码后拿不到缓冲而丢弃的帧数
+    size_t skipped = 0;  // 由 RateController 在解码前跳过的帧数
+    size_t decodes() const { return produced - skipped; }
+};
+
+// placement 的第 0 个 CPU 给生产者，第 1 个给消费者；默认不绑定。
+// 传入 controller 时，生产者在解码前按池和队列的压力决定是否跳过这一帧，
+// 跳过的帧只等待下一帧到达（同样用 sleep 模拟），不消耗解码时间。
+OriginalTestResult runOriginalTest(size_t runMs, size_t decodeTimeMs, size_t renderTimeMs,
+                                   const ThreadPlacement::Policy &placement = ThreadPlacement::Policy(),
+                                   RateController *controller = nullptr)
 {
     const size_t POOL_SIZE = 5;
     const size_t W = 320, H = 240;
-    const size_t BYTES_PER_PIXEL = 4;
-    const size_t BUF_SIZE = W * H * BYTES_PER_PIXEL;
+    const size_t WARMUP_FRAMES = 5;
 
     std::vector<std::unique_ptr<ShmFrame>> frames;
     for (size_t i = 0; i < POOL_SIZE; ++i) {
-        frames.emplace_back(std::make_unique<ShmFrame>(BUF_SIZE));
+        frames.emplace_back(std::make_unique<ShmFrame>(W, H, PixelFormat::BGRA32));
     }
     FixedStack<ShmFrame> stack(std::move(frames));
     ElementQueue queue;
 
-    std::atomic<size_t> produced{0}, consumed{0}, dropped{0};
+    std::atomic<size_t> produced{0}, consumed{0}, dropped{0}, skipped{0}, outOfOrder{0};
+    std::atomic<uint64_t> steadyAllocs{0};
+    std::atomic<size_t> steadyFrames{0};
     auto start = std::chrono::steady_clock::now();
 
     std::thread producer([&] {
+        ThreadPlacement::apply(placement, 0);
+        SteadyStateAllocProbe probe(WARMUP_FRAMES);
         while (true) {
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -409,19 +766,41 @@ void runOriginalTest(size_t runMs, size_t decodeTimeMs, size_t renderTimeMs)
                 >= runMs)
                 break;
 
+            if (controller) {
+                double occupancy = 1.0 - static_cast<double>(stack.availableApprox()) / stack.size();
+                double fill = static_cast<double>(queue.size()) / queue.capacity();
+                if (!controller->admit(occupancy, fill)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(decodeTimeMs));
+                    produced++;
+                    skipped++;
+                    continue;
+                }
+            }
+
             std::this_thread::sleep_for(std::chrono::milliseconds(decodeTimeMs));
             produced++;
 
             std::shared_ptr<FixedStack<ShmFrame>::Element> element = stack.tryAcquire();
+            probe.onFrame();
             if (!element) {
                 dropped++;
+                if (controller)
+                    controller->onWasted();
                 continue;
             }
+            FrameHeader *header = element->value()->header();
+            header->sequence = produced;
+            header->ptsUs = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
             queue.push(element);
         }
+        steadyAllocs += probe.allocations();
+        steadyFrames += probe.steadyFrames();
     });
 
     std::thread consumer([&] {
+        ThreadPlacement::apply(placement, 1);
+        SteadyStateAllocProbe probe(WARMUP_FRAMES);
+        uint64_t lastSequence = 0;
         while (true) {
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
@@ -430,18 +809,41 @@ void runOriginalTest(size_t runMs, size_t decodeTimeMs, size_t renderTimeMs)
                 break;
 
             auto element = queue.pop();
+            if (!element)
+                break;
+            // 帧序号来自帧头，必须单调递增
+            uint64_t sequence = element->value()->header()->sequence;
+            if (sequence <= lastSequence)
+                outOfOrder++;
+            lastSequence = sequence;
             std::this_thread::sleep_for(std::chrono::milliseconds(renderTimeMs));
             consumed++;
+            probe.onFrame();
         }
+        steadyAllocs += probe.allocations();
     });
 
     producer.join();
+    queue.close();
     consumer.join();
 
     std::cout << "  runMs=" << runMs << " decodeTimeMs=" << decodeTimeMs
               << " renderTimeMs=" << renderTimeMs << "\n";
     std::cout << "  produced=" << produced << " consumed=" << consumed
               << " dropped=" << dropped << "\n";
+    if (controller) {
+        std::cout << "  skipped=" << skipped << " decodes=" << produced - skipped
+                  << " avgRate=" << controller->stats().averageRate() << "\n";
+    }
+    printTestResult(outOfOrder == 0, "Frame header sequence is monotonic");
+    reportSteadyStateAllocations(steadyAllocs, steadyFrames);
+
+    OriginalTestResult result;
+    result.produced = produced;
+    result.consumed = consumed;
+    result.dropped = dropped;
+    result.skipped = skipped;
+    return result;
 }
 
 void testOriginalProducerConsumer()
@@ -457,25 +859,1992 @@ void testOriginalProducerConsumer()
     printTestResult(true, "All original producer-consumer tests completed");
 }
 
-// ==================== Main ====================
-int main()
+// ==================== Test: MpmcQueue ====================
+void testMpmcQueue()
 {
-    std::cout << "========== Running All Tests ==========\n";
+    printSection("Test: MpmcQueue");
 
-    // 单元测试
-    testShmFrameBasic();
-    testShmFrameZeroSize();
-    testShmFrameLargeSize();
-    testFixedStackEdgeCases();
-    testStackDestructionWithElements();
-    testDataIntegrity();
+    {
+        MpmcQueue<int> queue(3);
+        int value = 0;
+        bool ok = queue.tryPush(1) && queue.tryPush(2) && queue.tryPush(3);
+        printTestResult(ok && !queue.tryPush(4), "Push up to capacity, then full");
+        ok = queue.tryPop(value) && value == 1 && queue.tryPop(value) && value == 2;
+        printTestResult(ok, "FIFO order");
+        ok = queue.tryPop(value) && value == 3 && !queue.tryPop(value);
+        printTestResult(ok, "Pop until empty");
+    }
 
-    // 并发测试
-    testMultiProducerConsumer();
-    testStress();
+    // 多生产者多消费者：所有元素恰好被取出一次
+    const size_t PER_PRODUCER = 100000;
+    const size_t NUM_THREADS = 3;
+    MpmcQueue<size_t> queue(64);
+    std::atomic<size_t> popped{0};
+    std::atomic<uint64_t> sum{0};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < NUM_THREADS; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < PER_PRODUCER; ++i) {
+                size_t value = p * PER_PRODUCER + i + 1;
+                while (!queue.tryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < NUM_THREADS; ++c) {
+        threads.emplace_back([&] {
+            size_t value = 0;
+            while (popped.load() < NUM_THREADS * PER_PRODUCER) {
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
 
-    // 原始测试场景
-    testOriginalProducerConsumer();
+    uint64_t n = NUM_THREADS * PER_PRODUCER;
+    printTestResult(sum == n * (n + 1) / 2, "Concurrent push/pop delivers every value once");
+}
+
+// ==================== Test: Frame Pipeline ====================
+void testFramePipeline()
+{
+    printSection("Test: Frame Pipeline");
+
+    const size_t POOL_SIZE = 6;
+    const size_t BUF_SIZE = 320 * 240 * 4;
+    const size_t FRAME_COUNT = 200;
+
+    using Pipeline = FramePipeline<ShmFrame>;
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(BUF_SIZE));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+
+    // decode -> convert(2 线程) -> overlay -> render(最新帧优先)
+    std::atomic<size_t> decoded{0}, rendered{0};
+    std::atomic<bool> corrupted{false};
+    Pipeline pipeline(stack);
+    pipeline
+        .source("decode", 1,
+                [&](const ShmFrame &frame) {
+                    if (decoded >= FRAME_COUNT)
+                        return false;
+                    std::memset(frame.getData(), static_cast<int>(decoded++ & 0xFF), BUF_SIZE);
+                    return true;
+                })
+        .stage("convert", 2, Pipeline::OverflowPolicy::Block, 4,
+               [](const ShmFrame &frame) {
+                   std::this_thread::sleep_for(std::chrono::microseconds(200));
+                   frame.getData()[1] = frame.getData()[0];
+               })
+        .stage("overlay", 1, Pipeline::OverflowPolicy::Block, 4,
+               [](const ShmFrame &frame) { frame.getData()[2] = frame.getData()[0]; })
+        .stage("render", 1, Pipeline::OverflowPolicy::LatestWins, 2,
+               [&](const ShmFrame &frame) {
+                   const uint8_t *data = frame.getData();
+                   if (data[1] != data[0] || data[2] != data[0])
+                       corrupted = true;
+                   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                   rendered++;
+               });
+    pipeline.start();
+    pipeline.wait();
+
+    auto metrics = pipeline.metrics();
+    for (const auto &m : metrics) {
+        std::cout << "  " << m.name << ": threads=" << m.threads << " processed=" << m.processed
+                  << " dropped=" << m.dropped << " util=" << m.utilization
+                  << " blockedMs=" << m.blockedMs << " avgDepth=" << m.avgQueueDepth
+                  << " maxDepth=" << m.maxQueueDepth << "\n";
+    }
+    std::cout << "  bottleneck: " << pipeline.bottleneck() << "\n";
+
+    printTestResult(metrics.size() == 4 && metrics[0].processed == FRAME_COUNT,
+                    "Source produced every frame");
+    printTestResult(metrics[3].processed + metrics[3].dropped == FRAME_COUNT && rendered == metrics[3].processed,
+                    "Every frame rendered or dropped by latest-wins");
+    printTestResult(!corrupted, "Stages see consistent frame data");
+
+    // 流水线停止后所有缓冲都应回到池中
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> all;
+    while (auto element = stack.tryAcquire()) {
+        all.push_back(element);
+    }
+    printTestResult(all.size() == POOL_SIZE, "All buffers returned to pool");
+}
+
+// ==================== Test: Chase-Lev Deque ====================
+void testChaseLevDeque()
+{
+    printSection("Test: Chase-Lev Deque");
+
+    {
+        ChaseLevDeque<size_t *> deque(2);
+        size_t values[4] = {1, 2, 3, 4};
+        for (auto &v : values) {
+            deque.push(&v); // 触发扩容
+        }
+        bool ok = deque.steal() == &values[0] && deque.pop() == &values[3] && deque.pop() == &values[2]
+                  && deque.steal() == &values[1] && deque.pop() == nullptr && deque.steal() == nullptr;
+        printTestResult(ok, "Owner pops LIFO, thieves steal FIFO, growth keeps items");
+    }
+
+    // 所属线程 push/pop 的同时两个线程窃取，每个元素恰好被取走一次
+    const size_t COUNT = 200000;
+    std::vector<size_t> items(COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+        items[i] = i + 1;
+    }
+    ChaseLevDeque<size_t *> deque(64);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 2; ++t) {
+        thieves.emplace_back([&] {
+            uint64_t local = 0;
+            while (!done.load() || !deque.empty()) {
+                if (size_t *item = deque.steal()) {
+                    local += *item;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            sum += local;
+        });
+    }
+    uint64_t ownerSum = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+        deque.push(&items[i]);
+        if (i % 3 == 0) {
+            if (size_t *item = deque.pop()) {
+                ownerSum += *item;
+            }
+        }
+    }
+    while (size_t *item = deque.pop()) {
+        ownerSum += *item;
+    }
+    done = true;
+    for (auto &t : thieves)
+        t.join();
+    sum += ownerSum;
+    printTestResult(sum == static_cast<uint64_t>(COUNT) * (COUNT + 1) / 2,
+                    "Concurrent pop/steal takes every item once");
+}
+
+// ==================== Test: Work-Stealing Pool ====================
+void testWorkStealingPool()
+{
+    printSection("Test: Work-Stealing Pool");
+
+    WorkStealingPool pool(4);
+
+    {
+        std::atomic<uint64_t> sum{0};
+        for (uint64_t i = 1; i <= 10000; ++i) {
+            pool.submit([&sum, i] { sum += i; });
+        }
+        pool.waitIdle();
+        printTestResult(sum == 10000ull * 10001 / 2, "All submitted jobs executed");
+    }
+
+    // 帧任务内部再拆成 tile 子任务
+    {
+        const size_t FRAMES = 32;
+        const size_t TILES = 16;
+        std::vector<std::atomic<size_t>> tilesDone(FRAMES);
+        for (size_t f = 0; f < FRAMES; ++f) {
+            pool.submit([&pool, &tilesDone, f] {
+                pool.parallelFor(TILES, [&tilesDone, f](size_t) { tilesDone[f]++; });
+            });
+        }
+        pool.waitIdle();
+        bool ok = true;
+        for (auto &count : tilesDone) {
+            ok = ok && count == TILES;
+        }
+        printTestResult(ok, "Nested parallelFor runs every tile of every frame");
+    }
+
+    // 乱序完成，按帧序输出
+    {
+        const uint64_t FRAMES = 500;
+        std::vector<uint64_t> order;
+        OrderedCompletion<uint64_t> completion(
+            64, [&order](uint64_t seq, uint64_t &value) { order.push_back(seq == value ? seq : ~0ull); }, &pool);
+        for (uint64_t seq = 0; seq < FRAMES; ++seq) {
+            pool.submit([&completion, seq] {
+                std::this_thread::sleep_for(std::chrono::microseconds((seq * 7919) % 200));
+                completion.complete(seq, seq);
+            });
+        }
+        pool.waitIdle();
+        bool ok = order.size() == FRAMES;
+        for (uint64_t i = 0; ok && i < FRAMES; ++i) {
+            ok = order[i] == i;
+        }
+        printTestResult(ok, "Ordered completion emits frames in sequence");
+    }
+
+    // 工作线程内部提交的任务按 LIFO 执行，序号最大的先完成并超出窗口：
+    // 等待窗口时必须执行队列中的其他任务，否则唯一的工作线程永远等不到缺口被补齐
+    {
+        const uint64_t FRAMES = 64;
+        WorkStealingPool single(1);
+        std::vector<uint64_t> order;
+        OrderedCompletion<uint64_t> completion(
+            4, [&order](uint64_t seq, uint64_t &) { order.push_back(seq); }, &single);
+        single.submit([&single, &completion] {
+            for (uint64_t seq = 0; seq < FRAMES; ++seq) {
+                single.submit([&completion, seq] { completion.complete(seq, seq); });
+            }
+        });
+        // 不调用 waitIdle()：主线程帮忙执行会掩盖工作线程卡住的问题
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (completion.emitted() < FRAMES && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bool ok = completion.emitted() == FRAMES;
+        for (uint64_t i = 0; ok && i < FRAMES; ++i) {
+            ok = order[i] == i;
+        }
+        printTestResult(ok, "Ordered completion runs pending jobs while waiting for the window");
+    }
+}
+
+// ==================== Test: Work-Stealing Render-Bound ====================
+// 对应 runOriginalTest(500, 1, 2)：渲染比解码慢时，用线程池并行渲染，
+// 每帧拆成 tile 子任务，按帧序输出
+void testWorkStealingRenderBound()
+{
+    printSection("Test: Work-Stealing Render-Bound");
+
+    const size_t POOL_SIZE = 5;
+    const size_t W = 320, H = 240;
+    const size_t BYTES_PER_PIXEL = 4;
+    const size_t BUF_SIZE = W * H * BYTES_PER_PIXEL;
+    const size_t TILES = 4;
+    const size_t RUN_MS = 500;
+    const size_t DECODE_MS = 1;
+    const size_t RENDER_MS = 2;
+    const auto tileTime = std::chrono::microseconds(RENDER_MS * 1000 / TILES);
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(BUF_SIZE));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+    WorkStealingPool pool(4);
+
+    size_t produced = 0, dropped = 0;
+    uint64_t consumed = 0;
+    bool inOrder = true;
+    // 每帧在输出前一直持有池元素，在途跨度不超过 POOL_SIZE
+    OrderedCompletion<std::shared_ptr<FixedStack<ShmFrame>::Element>> completion(
+        POOL_SIZE,
+        [&](uint64_t seq, std::shared_ptr<FixedStack<ShmFrame>::Element> &element) {
+            inOrder = inOrder && seq == consumed && element;
+            consumed++;
+            element.reset();
+        },
+        &pool);
+
+    uint64_t sequence = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(RUN_MS)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DECODE_MS));
+        produced++;
+        auto element = stack.tryAcquire();
+        if (!element) {
+            dropped++;
+            continue;
+        }
+        uint64_t seq = sequence++;
+        pool.submit([&pool, &completion, element, seq, tileTime]() mutable {
+            pool.parallelFor(TILES, [tileTime](size_t) { std::this_thread::sleep_for(tileTime); });
+            completion.complete(seq, std::move(element));
+        });
+    }
+    pool.waitIdle();
+
+    std::cout << "  produced=" << produced << " consumed=" << consumed << " dropped=" << dropped << "\n";
+    printTestResult(consumed == sequence && inOrder, "Render-bound frames complete in order");
+}
+
+// ==================== Test: Coroutine Pool/Queue ====================
+using AsyncFramePool = AsyncFixedStack<ShmFrame>;
+using AsyncFrameQueue = AsyncQueue<AsyncFramePool::ElementPtr>;
+
+DetachedTask holdOneFrame(AsyncFramePool *pool, AsyncFramePool::ElementPtr *out, std::atomic<int> *resumed)
+{
+    *out = co_await pool->acquire();
+    (*resumed)++;
+}
+
+DetachedTask produceStream(CoroScheduler *scheduler, AsyncFramePool *pool, AsyncFrameQueue *queue,
+                           size_t frames, std::atomic<size_t> *remainingStreams)
+{
+    co_await scheduler->schedule();
+    for (size_t i = 0; i < frames; ++i) {
+        auto element = co_await pool->acquire();
+        element->value()->getData()[0] = static_cast<uint8_t>(i);
+        // 队列容量不小于池大小，push 不会失败
+        queue->push(std::move(element));
+    }
+    if (--(*remainingStreams) == 0) {
+        queue->close();
+    }
+}
+
+DetachedTask consumeStream(CoroScheduler *scheduler, AsyncFrameQueue *queue, std::atomic<size_t> *consumed,
+                           std::atomic<size_t> *finished)
+{
+    co_await scheduler->schedule();
+    while (auto element = co_await queue->pop()) {
+        (*consumed)++;
+    }
+    (*finished)++;
+}
+
+void testCoroutinePoolAndQueue()
+{
+    printSection("Test: Coroutine Pool/Queue");
+
+    // 无调度器：归还元素的线程内联恢复等待者
+    {
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        frames.emplace_back(std::make_unique<ShmFrame>(1024));
+        FixedStack<ShmFrame> stack(std::move(frames));
+        AsyncFramePool pool(stack);
+
+        std::atomic<int> resumed{0};
+        AsyncFramePool::ElementPtr first, second;
+        holdOneFrame(&pool, &first, &resumed);
+        holdOneFrame(&pool, &second, &resumed);
+        printTestResult(resumed == 1 && first && !second, "Second acquire suspends while pool is empty");
+
+        first.reset();
+        printTestResult(resumed == 2 && second, "Release resumes the waiting coroutine with the element");
+    }
+
+    // 几百个逻辑流跑在两个调度线程上
+    {
+        const size_t POOL_SIZE = 8;
+        const size_t STREAMS = 200;
+        const size_t FRAMES_PER_STREAM = 20;
+        const size_t CONSUMERS = 4;
+
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            frames.emplace_back(std::make_unique<ShmFrame>(1024));
+        }
+        FixedStack<ShmFrame> stack(std::move(frames));
+        CoroScheduler scheduler(2);
+        AsyncFramePool pool(stack, &scheduler);
+        AsyncFrameQueue queue(POOL_SIZE, &scheduler);
+
+        std::atomic<size_t> remainingStreams{STREAMS}, consumed{0}, finished{0};
+        for (size_t c = 0; c < CONSUMERS; ++c) {
+            consumeStream(&scheduler, &queue, &consumed, &finished);
+        }
+        for (size_t s = 0; s < STREAMS; ++s) {
+            produceStream(&scheduler, &pool, &queue, FRAMES_PER_STREAM, &remainingStreams);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (finished < CONSUMERS && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::cout << "  streams=" << STREAMS << " threads=" << scheduler.threadCount()
+                  << " consumed=" << consumed << "\n";
+        printTestResult(finished == CONSUMERS && consumed == STREAMS * FRAMES_PER_STREAM,
+                        "All streams complete on a small scheduler");
+    }
+}
+
+// ==================== Test: Broadcast Ring ====================
+void testBroadcastRing()
+{
+    printSection("Test: Broadcast Ring");
+
+    using Ring = BroadcastRing<ShmFrame>;
+    const size_t POOL_SIZE = 8;
+    const size_t RING_SIZE = 4;
+    const uint32_t FRAMES = 300;
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(1024));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+
+    Ring ring(RING_SIZE);
+    size_t recorder = ring.addConsumer(Ring::SlowConsumerPolicy::Block);
+    size_t renderer = ring.addConsumer(Ring::SlowConsumerPolicy::Drop);
+
+    // 两个消费者记录每个序号拿到的元素地址，用来确认是同一块缓冲而不是拷贝
+    std::vector<const void *> recorded(FRAMES, nullptr), rendered(FRAMES, nullptr);
+    bool recorderInOrder = true, rendererInOrder = true;
+
+    auto consume = [&](size_t consumer, std::vector<const void *> &seen, bool &inOrder,
+                       std::chrono::microseconds work) {
+        int64_t last = -1;
+        while (!ring.finished(consumer)) {
+            auto element = ring.tryNext(consumer);
+            if (!element) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t seq = 0;
+            std::memcpy(&seq, element->value()->getData(), sizeof(seq));
+            inOrder = inOrder && static_cast<int64_t>(seq) > last && seq < FRAMES;
+            last = seq;
+            if (seq < FRAMES)
+                seen[seq] = element.get();
+            std::this_thread::sleep_for(work);
+        }
+    };
+
+    std::thread recorderThread(consume, recorder, std::ref(recorded), std::ref(recorderInOrder),
+                               std::chrono::microseconds(0));
+    std::thread rendererThread(consume, renderer, std::ref(rendered), std::ref(rendererInOrder),
+                               std::chrono::microseconds(300));
+
+    for (uint32_t seq = 0; seq < FRAMES; ++seq) {
+        auto element = stack.tryAcquire();
+        while (!element) {
+            std::this_thread::yield();
+            element = stack.tryAcquire();
+        }
+        std::memcpy(element->value()->getData(), &seq, sizeof(seq));
+        ring.publish(std::move(element));
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ring.close();
+    recorderThread.join();
+    rendererThread.join();
+
+    size_t recordedCount = 0, renderedCount = 0;
+    bool shared = true;
+    for (uint32_t seq = 0; seq < FRAMES; ++seq) {
+        recordedCount += recorded[seq] != nullptr;
+        renderedCount += rendered[seq] != nullptr;
+        if (rendered[seq] && rendered[seq] != recorded[seq])
+            shared = false;
+    }
+    std::cout << "  published=" << ring.published() << " recorded=" << recordedCount
+              << " rendered=" << renderedCount << " rendererDropped=" << ring.dropped(renderer) << "\n";
+
+    printTestResult(recordedCount == FRAMES && recorderInOrder && ring.dropped(recorder) == 0,
+                    "Blocking consumer receives every frame in order");
+    printTestResult(rendererInOrder && renderedCount + ring.dropped(renderer) == FRAMES,
+                    "Dropping consumer receives or drops every frame");
+    printTestResult(shared, "Both consumers see the same pooled frame, no copies");
+
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> all;
+    while (auto element = stack.tryAcquire()) {
+        all.push_back(element);
+    }
+    printTestResult(all.size() == POOL_SIZE, "All frames returned to pool after slowest consumer");
+}
+
+// ==================== Test: Pixel Convert ====================
+void testPixelConvert()
+{
+    printSection("Test: Pixel Convert");
+
+    using namespace PixelConvert;
+
+    bool exact = true;
+    for (uint32_t c = 0; c < 256 && exact; ++c) {
+        for (uint32_t a = 0; a < 256; ++a) {
+            if (detail::mul255(c, a) != (c * a + 127) / 255) {
+                exact = false;
+                break;
+            }
+        }
+    }
+    printTestResult(exact, "mul255 matches round(c * a / 255) for all inputs");
+
+    std::mt19937 rng(2024);
+    const Kernels &scalar = kernels(Isa::Scalar);
+    const size_t MAX_WIDTH = 1031;
+    std::vector<uint8_t> row0(MAX_WIDTH * 4), row1(MAX_WIDTH * 4);
+    for (auto &b : row0) b = static_cast<uint8_t>(rng());
+    for (auto &b : row1) b = static_cast<uint8_t>(rng());
+    // 覆盖 Alpha 的两个端点
+    row0[3] = 0;
+    row0[7] = 255;
+
+    for (Isa isa : {Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+        if (!isaSupported(isa)) {
+            std::cout << "  " << isaName(isa) << " not supported, skipped\n";
+            continue;
+        }
+        const Kernels &k = kernels(isa);
+        bool same = true;
+        for (size_t width = 0; width <= MAX_WIDTH && same; width += (width < 70 ? 1 : 241)) {
+            std::vector<uint8_t> expect(width * 4 + 16, 0xCC), actual(width * 4 + 16, 0xCC);
+            scalar.swapRB(row0.data(), expect.data(), width);
+            k.swapRB(row0.data(), actual.data(), width);
+            same = same && expect == actual;
+            scalar.premultiply(row0.data(), expect.data(), width);
+            k.premultiply(row0.data(), actual.data(), width);
+            same = same && expect == actual;
+            scalar.lumaRow(row0.data(), expect.data(), width, coefficients(PixelFormat::BGRA32));
+            k.lumaRow(row0.data(), actual.data(), width, coefficients(PixelFormat::BGRA32));
+            same = same && expect == actual;
+            for (size_t step : {1, 2}) {
+                scalar.chromaRow(row0.data(), row1.data(), width, expect.data(), expect.data() + (step == 2 ? 1 : width),
+                                 step, coefficients(PixelFormat::RGBA32));
+                k.chromaRow(row0.data(), row1.data(), width, actual.data(), actual.data() + (step == 2 ? 1 : width),
+                            step, coefficients(PixelFormat::RGBA32));
+                same = same && expect == actual;
+            }
+        }
+        printTestResult(same, std::string(isaName(isa)) + " row kernels bit-exact with scalar");
+
+        // 奇数尺寸的整帧转换
+        const uint32_t W = 333, H = 77;
+        ShmFrame src(W, H, PixelFormat::BGRA32);
+        for (uint32_t y = 0; y < H; ++y) {
+            for (uint32_t x = 0; x < W * 4; ++x) {
+                src.plane(0).row(y)[x] = static_cast<uint8_t>(rng());
+            }
+        }
+        bool framesMatch = true;
+        for (PixelFormat format : {PixelFormat::RGBA32, PixelFormat::NV12, PixelFormat::I420}) {
+            ShmFrame expect(W, H, format), actual(W, H, format);
+            framesMatch = framesMatch && convert(src, expect, scalar) && convert(src, actual, k);
+            for (uint32_t p = 0; p < ShmFrame::planeCount(format) && framesMatch; ++p) {
+                PlaneView e = expect.plane(p), a = actual.plane(p);
+                for (uint32_t y = 0; y < e.height; ++y) {
+                    if (std::memcmp(e.row(y), a.row(y), static_cast<size_t>(e.width) * e.bytesPerPixel) != 0) {
+                        framesMatch = false;
+                        break;
+                    }
+                }
+            }
+        }
+        printTestResult(framesMatch, std::string(isaName(isa)) + " frame conversion bit-exact with scalar");
+    }
+
+    {
+        // 已知颜色：白、黑、纯红
+        ShmFrame src(2, 2, PixelFormat::BGRA32), nv12(2, 2, PixelFormat::NV12);
+        const uint8_t colors[3][4] = {{255, 255, 255, 255}, {0, 0, 0, 255}, {0, 0, 255, 255}};
+        bool ok = true;
+        for (const auto &color : colors) {
+            for (uint32_t y = 0; y < 2; ++y) {
+                std::memcpy(src.plane(0).row(y), color, 4);
+                std::memcpy(src.plane(0).row(y) + 4, color, 4);
+            }
+            convert(src, nv12);
+            ok = ok && nv12.plane(0).row(0)[0] == detail::lumaPixel(color, coefficients(PixelFormat::BGRA32));
+        }
+        // 纯红：Y=82 U=90 V=240
+        ok = ok && nv12.plane(0).row(0)[0] == 82 && nv12.plane(1).row(0)[0] == 90 && nv12.plane(1).row(0)[1] == 240;
+        printTestResult(ok, "BT.601 reference colors");
+    }
+
+    {
+        ShmFrame frame(64, 4, PixelFormat::BGRA32), copy(64, 4, PixelFormat::BGRA32);
+        for (uint32_t y = 0; y < 4; ++y) {
+            for (uint32_t x = 0; x < 64; ++x) {
+                uint8_t *p = frame.plane(0).row(y) + 4 * x;
+                p[0] = static_cast<uint8_t>(x * 4);
+                p[1] = static_cast<uint8_t>(y * 60);
+                p[2] = 200;
+                p[3] = 255;
+            }
+        }
+        convert(frame, copy);
+        premultiply(copy, copy);
+        premultiply(copy, copy, true);
+        bool roundTrip = std::memcmp(frame.getData(), copy.getData(), frame.size()) == 0;
+        printTestResult(roundTrip, "Opaque premultiply/unpremultiply round trip in place");
+    }
+
+    {
+        // ARGB32 的 Alpha 在第 1 个字节：结果应与同一像素的 BGRA32 预乘逐字节对应
+        ShmFrame bgra(64, 2, PixelFormat::BGRA32), argb(64, 2, PixelFormat::ARGB32);
+        ShmFrame bgraOut(64, 2, PixelFormat::BGRA32), argbOut(64, 2, PixelFormat::ARGB32);
+        for (uint32_t y = 0; y < 2; ++y) {
+            for (uint32_t x = 0; x < 64; ++x) {
+                uint8_t b = static_cast<uint8_t>(x * 4), g = static_cast<uint8_t>(y * 90 + 17), r = 200;
+                uint8_t a = static_cast<uint8_t>(x * 4 + 3);
+                const uint8_t bgraPixel[4] = {b, g, r, a};
+                const uint8_t argbPixel[4] = {a, r, g, b};
+                std::memcpy(bgra.plane(0).row(y) + 4 * x, bgraPixel, 4);
+                std::memcpy(argb.plane(0).row(y) + 4 * x, argbPixel, 4);
+            }
+        }
+        bool ok = premultiply(bgra, bgraOut) && premultiply(argb, argbOut);
+        for (uint32_t y = 0; y < 2 && ok; ++y) {
+            for (uint32_t x = 0; x < 64 && ok; ++x) {
+                const uint8_t *p = bgraOut.plane(0).row(y) + 4 * x;
+                const uint8_t *q = argbOut.plane(0).row(y) + 4 * x;
+                ok = q[0] == p[3] && q[1] == p[2] && q[2] == p[1] && q[3] == p[0];
+            }
+        }
+        bool inverseOk = premultiply(bgraOut, bgraOut, true) && premultiply(argbOut, argbOut, true);
+        for (uint32_t y = 0; y < 2 && inverseOk; ++y) {
+            for (uint32_t x = 0; x < 64 && inverseOk; ++x) {
+                const uint8_t *p = bgraOut.plane(0).row(y) + 4 * x;
+                const uint8_t *q = argbOut.plane(0).row(y) + 4 * x;
+                inverseOk = q[0] == p[3] && q[1] == p[2] && q[2] == p[1] && q[3] == p[0];
+            }
+        }
+        printTestResult(ok && inverseOk, "ARGB32 premultiply reads alpha from the first byte");
+    }
+}
+
+// ==================== Benchmark: Pixel Convert ====================
+void benchmarkPixelConvert()
+{
+    printSection("Benchmark: Pixel Convert");
+
+    using namespace PixelConvert;
+    struct Resolution
+    {
+        const char *name;
+        uint32_t width, height;
+    };
+    const Resolution resolutions[] = {{"320x240", 320, 240}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+
+    for (const Resolution &r : resolutions) {
+        ShmFrame src(r.width, r.height, PixelFormat::BGRA32);
+        ShmFrame rgba(r.width, r.height, PixelFormat::RGBA32);
+        ShmFrame premultiplied(r.width, r.height, PixelFormat::BGRA32);
+        ShmFrame nv12(r.width, r.height, PixelFormat::NV12);
+        ShmFrame i420(r.width, r.height, PixelFormat::I420);
+        std::memset(src.getData(), 0x5A, src.size());
+        // 每个内核大约处理 64M 像素
+        const size_t iterations = std::max<size_t>(3, (64u << 20) / (static_cast<size_t>(r.width) * r.height));
+        const double megaPixels = static_cast<double>(r.width) * r.height * iterations / 1e6;
+
+        std::cout << "  " << r.name << " (" << iterations << " iterations)\n";
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+            if (!isaSupported(isa)) {
+                continue;
+            }
+            const Kernels &k = kernels(isa);
+            auto measure = [&](auto &&body) {
+                auto begin = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < iterations; ++i) {
+                    body();
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                return megaPixels / seconds;
+            };
+            double swap = measure([&] { convert(src, rgba, k); });
+            double premul = measure([&] { premultiply(src, premultiplied, false, k); });
+            double toNv12 = measure([&] { convert(src, nv12, k); });
+            double toI420 = measure([&] { convert(src, i420, k); });
+            std::cout << "    " << std::left << std::setw(8) << isaName(isa) << std::right << std::fixed
+                      << std::setprecision(0) << " swapRB " << std::setw(6) << swap << " MP/s, premultiply "
+                      << std::setw(6) << premul << " MP/s, NV12 " << std::setw(6) << toNv12 << " MP/s, I420 "
+                      << std::setw(6) << toI420 << " MP/s\n";
+        }
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+// ==================== Test: Dirty Region ====================
+void testDirtyRegion()
+{
+    printSection("Test: Dirty Region");
+
+    {
+        // 所有 ISA 的哈希一致，且对条带顺序敏感
+        std::mt19937 rng(7);
+        std::vector<uint8_t> data(4099);
+        for (auto &b : data) b = static_cast<uint8_t>(rng());
+        bool same = true;
+        for (size_t length : {0, 1, 63, 64, 65, 256, 1000, 4099}) {
+            uint64_t expect = StripeHash::hash(data.data(), length, StripeHash::detail::accumulateScalar);
+            same = same && StripeHash::hash(data.data(), length) == expect;
+#ifdef STRIPE_HASH_X86
+            same = same && StripeHash::hash(data.data(), length, StripeHash::detail::accumulateSse2) == expect;
+            if (__builtin_cpu_supports("avx2")) {
+                same = same && StripeHash::hash(data.data(), length, StripeHash::detail::accumulateAvx2) == expect;
+            }
+#endif
+        }
+        printTestResult(same, "StripeHash SIMD paths match scalar");
+
+        std::vector<uint8_t> swapped(data.begin(), data.begin() + 256);
+        std::swap_ranges(swapped.begin(), swapped.begin() + 64, swapped.begin() + 64);
+        printTestResult(StripeHash::hash(swapped.data(), 256) != StripeHash::hash(data.data(), 256),
+                        "StripeHash detects swapped stripes");
+    }
+
+    const uint32_t W = 1000, H = 500;
+    ShmFrame frame(W, H, PixelFormat::BGRA32);
+    PlaneView view = frame.plane(0);
+    std::memset(frame.getData(), 0x20, frame.size());
+    auto poke = [&](uint32_t x, uint32_t y) { view.row(y)[4 * x + 1] ^= 0xFF; };
+
+    DirtyRegionDetector detector(W, H);
+    bool changed = detector.detect(frame);
+    bool ok = changed && detector.dirtyRects().size() == 1 && detector.dirtyRects()[0].width == W
+              && detector.dirtyRects()[0].height == H
+              && detector.changedTiles().size() == detector.tilesX() * detector.tilesY();
+    printTestResult(ok, "First frame is fully dirty");
+
+    printTestResult(!detector.detect(frame) && detector.dirtyRects().empty(), "Unchanged frame reports nothing");
+
+    poke(100, 70);
+    ok = detector.detect(frame) && detector.dirtyRects().size() == 1 && detector.changedTiles().size() == 1
+         && detector.changedTiles()[0].index == 1 * detector.tilesX() + 1;
+    if (ok) {
+        const auto &r = detector.dirtyRects()[0];
+        ok = r.x == 64 && r.y == 64 && r.width == 64 && r.height == 64;
+    }
+    printTestResult(ok, "Single pixel change marks one tile");
+
+    // 跨 2x2 个 tile 的块合并为一个矩形，另一个孤立 tile 单独一个矩形
+    for (uint32_t y = 120; y < 140; ++y) {
+        for (uint32_t x = 120; x < 140; ++x) {
+            poke(x, y);
+        }
+    }
+    poke(999, 499);
+    ok = detector.detect(frame) && detector.dirtyRects().size() == 2 && detector.changedTiles().size() == 5;
+    if (ok) {
+        const auto &block = detector.dirtyRects()[0];
+        const auto &edge = detector.dirtyRects()[1];
+        ok = block.x == 64 && block.y == 64 && block.width == 128 && block.height == 128 && edge.x == 960
+             && edge.y == 448 && edge.width == 40 && edge.height == 52;
+    }
+    printTestResult(ok, "Adjacent tiles merge and edge tiles are clipped");
+
+    // 交换 tile 内的两行
+    std::vector<uint8_t> rowA(view.row(10), view.row(10) + 256);
+    poke(3, 11);
+    detector.detect(frame);
+    std::memcpy(view.row(10), view.row(11), 256);
+    std::memcpy(view.row(11), rowA.data(), 256);
+    printTestResult(detector.detect(frame) && detector.changedTiles().size() == 1, "Swapped rows are detected");
+
+    {
+        // 尺寸或格式不同的平面被拒绝，检测器随后对原尺寸的帧报告整帧
+        ShmFrame smaller(W / 2, H, PixelFormat::BGRA32);
+        ShmFrame taller(W, H + 64, PixelFormat::BGRA32);
+        ShmFrame nv12(W, H, PixelFormat::NV12);
+        detector.detect(frame);
+        ok = !detector.detect(smaller) && detector.dirtyRects().empty() && detector.changedTiles().empty()
+             && !detector.detect(taller) && !detector.detect(nv12.plane(0)) && !detector.detect(PlaneView());
+        ok = ok && detector.detect(frame)
+             && detector.changedTiles().size() == detector.tilesX() * detector.tilesY();
+        printTestResult(ok, "Planes with other dimensions are rejected and reset the detector");
+    }
+
+    {
+        WorkStealingPool pool(4);
+        DirtyRegionDetector serial(W, H), parallel(W, H, 4, 64, &pool);
+        serial.detect(frame);
+        parallel.detect(frame);
+        bool same = true;
+        std::mt19937 rng(11);
+        for (int round = 0; round < 20 && same; ++round) {
+            for (int i = 0; i < 5; ++i) {
+                poke(rng() % W, rng() % H);
+            }
+            same = serial.detect(frame) == parallel.detect(frame)
+                   && serial.changedTiles().size() == parallel.changedTiles().size()
+                   && serial.dirtyRects().size() == parallel.dirtyRects().size();
+            for (size_t i = 0; same && i < serial.changedTiles().size(); ++i) {
+                same = serial.changedTiles()[i].index == parallel.changedTiles()[i].index
+                       && serial.changedTiles()[i].hash == parallel.changedTiles()[i].hash;
+            }
+        }
+        printTestResult(same, "Pool-parallel detection matches serial");
+    }
+
+    {
+        detector.reset();
+        uint64_t before = AllocCounter::threadAllocations();
+        detector.detect(frame);
+        poke(500, 250);
+        detector.detect(frame);
+        uint64_t after = AllocCounter::threadAllocations();
+        if (AllocCounter::enabled()) {
+            printTestResult(after == before, "Serial detection allocates nothing");
+        }
+    }
+}
+
+// ==================== Benchmark: Dirty Region ====================
+void benchmarkDirtyRegion()
+{
+    printSection("Benchmark: Dirty Region (1080p)");
+
+    const uint32_t W = 1920, H = 1080;
+    const int FRAMES = 200;
+    ShmFrame frame(W, H, PixelFormat::BGRA32);
+    std::mt19937 rng(3);
+    for (size_t i = 0; i < frame.size(); ++i) {
+        frame.getData()[i] = static_cast<uint8_t>(rng());
+    }
+
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    WorkStealingPool pool(threads);
+    for (WorkStealingPool *p : {static_cast<WorkStealingPool *>(nullptr), &pool}) {
+        DirtyRegionDetector detector(W, H, 4, 64, p);
+        detector.detect(frame);
+        size_t changedFrames = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < FRAMES; ++i) {
+            // 每 4 帧改动一个小区域，其余帧不变
+            if (i % 4 == 0) {
+                frame.plane(0).row(rng() % H)[4 * (rng() % W)] ^= 0x1;
+            }
+            changedFrames += detector.detect(frame);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "  " << (p ? "pool x" + std::to_string(threads) : std::string("serial")) << ": " << std::fixed
+                  << std::setprecision(3) << ms / FRAMES << " ms/frame, "
+                  << std::setprecision(2) << (static_cast<double>(W) * H * 4 * FRAMES / 1e6) / ms
+                  << " GB/s, changed frames " << changedFrames << "/" << FRAMES << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+// ==================== Test: Seqlock Snapshot ====================
+void testSeqlockSnapshot()
+{
+    printSection("Test: Seqlock Snapshot");
+
+    // 快照内容全部由版本号推导，读到新旧混合的数据即可发现
+    struct Payload
+    {
+        uint64_t version;
+        uint64_t words[6];
+        uint32_t tail[3];
+    };
+    auto make = [](uint64_t version) {
+        Payload p{};
+        p.version = version;
+        for (int i = 0; i < 6; ++i)
+            p.words[i] = version * 0x9E3779B97F4A7C15ull + i;
+        for (int i = 0; i < 3; ++i)
+            p.tail[i] = static_cast<uint32_t>(version) ^ (0xA5A5A5A5u + i);
+        return p;
+    };
+    auto consistent = [&](const Payload &p) {
+        Payload expect = make(p.version);
+        return std::equal(p.words, p.words + 6, expect.words) && std::equal(p.tail, p.tail + 3, expect.tail);
+    };
+
+    SeqlockSnapshot<Payload> snapshot(make(0));
+    Payload value{};
+    uint64_t last = 0;
+    bool ok = snapshot.version() == 0 && snapshot.read(value) == 0 && consistent(value) && value.version == 0;
+    ok = ok && !snapshot.readIfNewer(last, value);
+    ok = ok && snapshot.publish(make(1)) == 1 && snapshot.readIfNewer(last, value) && last == 1 && value.version == 1;
+    ok = ok && !snapshot.readIfNewer(last, value);
+    printTestResult(ok, "Versions start at 0 and readIfNewer() only copies new snapshots");
+
+    // 压力测试：1 个写者连续发布，4 个读者不停读取
+    const uint64_t PUBLISHES = 300000;
+    const int READERS = 4;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> torn{0}, backwards{0}, mismatched{0}, reads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([&, r]() {
+            uint64_t previous = 0, count = 0;
+            Payload p{};
+            while (!done.load(std::memory_order_acquire)) {
+                uint64_t version = 0;
+                if (r % 2 == 0) {
+                    version = snapshot.read(p);
+                } else {
+                    uint64_t seen = previous;
+                    if (!snapshot.readIfNewer(seen, p))
+                        continue;
+                    version = seen;
+                }
+                ++count;
+                if (!consistent(p))
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                if (version < previous)
+                    backwards.fetch_add(1, std::memory_order_relaxed);
+                if (p.version != version)
+                    mismatched.fetch_add(1, std::memory_order_relaxed);
+                previous = version;
+            }
+            reads.fetch_add(count, std::memory_order_relaxed);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t v = 2; v <= PUBLISHES; ++v) {
+        snapshot.publish(make(v));
+        if (v % 1024 == 0)
+            std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers)
+        t.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "  publishes=" << PUBLISHES << " reads=" << reads.load() << " retries=" << snapshot.retries()
+              << " time=" << std::fixed << std::setprecision(1) << ms << "ms\n";
+    std::cout.unsetf(std::ios::floatfield);
+
+    printTestResult(torn.load() == 0, "Readers never observe a torn snapshot");
+    printTestResult(backwards.load() == 0 && mismatched.load() == 0,
+                    "Each reader sees versions move forward and match the payload");
+    printTestResult(snapshot.version() == PUBLISHES && snapshot.read(value) == PUBLISHES && value.version == PUBLISHES,
+                    "Final snapshot is the last publish");
+}
+
+// ==================== Test: Frame Recorder ====================
+// 从池中取帧、写入序号后交给录制器，返回等待池的总时长（毫秒）
+double recordFrames(FixedStack<ShmFrame> &stack, FrameRecorder &recorder, size_t count, bool fill)
+{
+    double waitMs = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        auto element = stack.tryAcquire();
+        while (!element) {
+            std::this_thread::yield();
+            element = stack.tryAcquire();
+        }
+        waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        const ShmFrame &frame = *element->value();
+        frame.header()->sequence = i;
+        frame.header()->ptsUs = static_cast<int64_t>(i) * 16667;
+        if (fill) {
+            std::memset(frame.getData(), static_cast<int>(i & 0xFF), frame.size());
+        }
+        recorder.write(std::move(element));
+    }
+    return waitMs;
+}
+
+void testFrameRecorder()
+{
+    printSection("Test: Frame Recorder");
+
+    const size_t POOL_SIZE = 6;
+    const size_t FRAME_COUNT = 60;
+    const std::string path = "/tmp/shm_stack_recorder_test.frames";
+
+    using Backend = FrameRecorder::Backend;
+    for (Backend backend : {Backend::IoUring, Backend::ThreadPool}) {
+        for (bool direct : {false, true}) {
+            std::vector<std::unique_ptr<ShmFrame>> frames;
+            for (size_t i = 0; i < POOL_SIZE; ++i) {
+                frames.emplace_back(std::make_unique<ShmFrame>(320, 240, PixelFormat::BGRA32));
+            }
+            FixedStack<ShmFrame> stack(std::move(frames));
+            const size_t frameBytes = sizeof(FrameHeader) + stack.tryAcquire()->value()->size();
+
+            FrameRecorder::Options options;
+            options.backend = backend;
+            options.direct = direct;
+            options.queueDepth = 4;
+            options.batch = 2;
+            FrameRecorder recorder(options);
+            bool ok = recorder.open(path.c_str());
+            recordFrames(stack, recorder, FRAME_COUNT, true);
+            ok = recorder.close() && ok;
+            const FrameRecorder::Stats &stats = recorder.stats();
+            std::cout << "  requested " << FrameRecorder::backendName(backend) << (direct ? " + O_DIRECT" : "")
+                      << ": backend=" << FrameRecorder::backendName(stats.backend) << " direct=" << stats.direct
+                      << " directWrites=" << stats.directWrites << " submits=" << stats.submits
+                      << " maxInFlight=" << stats.maxInFlight << " holdUs=" << std::fixed << std::setprecision(1)
+                      << stats.holdUsAvg << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+
+            // 读回：尾部、索引、每帧的帧头和内容
+            int fd = ::open(path.c_str(), O_RDONLY);
+            off_t fileSize = lseek(fd, 0, SEEK_END);
+            FrameFile::Trailer trailer;
+            ok = ok && pread(fd, &trailer, sizeof(trailer), fileSize - off_t(sizeof(trailer))) == sizeof(trailer)
+                 && trailer.magic == FrameFile::Trailer::kMagic && trailer.count == FRAME_COUNT;
+            std::vector<FrameFile::IndexEntry> index(FRAME_COUNT);
+            ok = ok && pread(fd, index.data(), index.size() * sizeof(index[0]), off_t(trailer.indexOffset))
+                           == ssize_t(index.size() * sizeof(index[0]));
+            std::vector<uint8_t> buffer(frameBytes);
+            for (size_t i = 0; i < FRAME_COUNT && ok; ++i) {
+                ok = index[i].offset % FrameFile::kAlignment == 0 && index[i].length == frameBytes
+                     && index[i].sequence == i && index[i].ptsUs == int64_t(i) * 16667
+                     && pread(fd, buffer.data(), frameBytes, off_t(index[i].offset)) == ssize_t(frameBytes);
+                const FrameHeader *header = FrameHeader::validate(buffer.data(), buffer.size());
+                ok = ok && header && header->sequence == i && buffer[sizeof(FrameHeader)] == (i & 0xFF)
+                     && buffer.back() == (i & 0xFF);
+            }
+            ::close(fd);
+            std::remove(path.c_str());
+
+            std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> all;
+            while (auto element = stack.tryAcquire()) {
+                all.push_back(element);
+            }
+            ok = ok && stats.frames == FRAME_COUNT && stats.indexed == FRAME_COUNT && stats.failures == 0
+                 && stats.error == 0 && stats.maxInFlight <= 4 && all.size() == POOL_SIZE;
+            printTestResult(ok, std::string("Recorded frames read back, buffers returned (") +
+                                    FrameRecorder::backendName(backend) + (direct ? ", O_DIRECT)" : ")"));
+        }
+    }
+
+    // 每次写都失败（/dev/full 返回 ENOSPC）：帧照常归还，失败的帧不进入索引
+    for (Backend backend : {Backend::IoUring, Backend::ThreadPool}) {
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            frames.emplace_back(std::make_unique<ShmFrame>(320, 240, PixelFormat::BGRA32));
+        }
+        FixedStack<ShmFrame> stack(std::move(frames));
+        FrameRecorder::Options options;
+        options.backend = backend;
+        options.queueDepth = 4;
+        FrameRecorder recorder(options);
+        bool ok = recorder.open("/dev/full");
+        recordFrames(stack, recorder, 10, false);
+        ok = ok && !recorder.close();
+        const FrameRecorder::Stats &stats = recorder.stats();
+        ok = ok && stats.frames == 10 && stats.failures >= 10 && stats.indexed == 0 && stack.availableApprox() == POOL_SIZE;
+        printTestResult(ok, std::string("Failed writes are not indexed (") + FrameRecorder::backendName(stats.backend) + ")");
+    }
+
+    // io_uring_enter 持续失败：把 ring 的 fd 换成 /dev/null 模拟，录制停止而不是无限重试，
+    // 在写的帧按失败归还，文件中只有出错前写成功的帧
+    {
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            frames.emplace_back(std::make_unique<ShmFrame>(320, 240, PixelFormat::BGRA32));
+        }
+        FixedStack<ShmFrame> stack(std::move(frames));
+        FrameRecorder::Options options;
+        options.backend = Backend::IoUring;
+        options.queueDepth = 4;
+        options.batch = 2;
+        FrameRecorder recorder(options);
+        bool ok = recorder.open(path.c_str());
+        recordFrames(stack, recorder, 8, true);
+        recorder.flush();
+
+        int ringFd = -1;
+        for (int fd = 0; fd < 1024 && ringFd < 0; ++fd) {
+            char link[64] = {};
+            std::string proc = "/proc/self/fd/" + std::to_string(fd);
+            if (readlink(proc.c_str(), link, sizeof(link) - 1) > 0 && std::strstr(link, "io_uring")) {
+                ringFd = fd;
+            }
+        }
+        if (!ok || ringFd < 0) {
+            recorder.close();
+            std::remove(path.c_str());
+            printTestResult(true, "io_uring failure handling skipped (io_uring unavailable)");
+        } else {
+            // 等已提交的写完成，之后 ring 才失效
+            while (recorder.inFlight() > 0) {
+                std::this_thread::yield();
+            }
+            int null = ::open("/dev/null", O_WRONLY);
+            ok = null >= 0 && dup2(null, ringFd) == ringFd;
+            ::close(null);
+            size_t accepted = 0;
+            for (size_t i = 0; i < 64 && ok; ++i) {
+                auto element = stack.tryAcquire();
+                while (!element) {
+                    std::this_thread::yield();
+                    element = stack.tryAcquire();
+                }
+                if (!recorder.write(std::move(element))) {
+                    break;
+                }
+                ++accepted;
+            }
+            ok = ok && accepted < 64 && !recorder.close();
+            const FrameRecorder::Stats &stats = recorder.stats();
+
+            int fd = ::open(path.c_str(), O_RDONLY);
+            off_t fileSize = lseek(fd, 0, SEEK_END);
+            FrameFile::Trailer trailer;
+            ok = ok && pread(fd, &trailer, sizeof(trailer), fileSize - off_t(sizeof(trailer))) == sizeof(trailer)
+                 && trailer.magic == FrameFile::Trailer::kMagic && trailer.count == 8;
+            ::close(fd);
+            std::remove(path.c_str());
+            std::cout << "  ring failure: error=" << stats.error << " accepted after failure=" << accepted
+                      << " frames=" << stats.frames << " indexed=" << stats.indexed << "\n";
+            ok = ok && stats.error != 0 && stats.indexed == 8 && stats.frames == 8 + accepted
+                 && stack.availableApprox() == POOL_SIZE;
+            printTestResult(ok, "io_uring_enter errors stop recording and keep only completed frames");
+        }
+    }
+}
+
+// ==================== Benchmark: Frame Recorder ====================
+// avg held 为录制器平均占用的池元素数（Little 定律：平均持有时长 * 帧率）
+void benchmarkFrameRecorder()
+{
+    printSection("Benchmark: Frame Recorder");
+
+    const size_t POOL_SIZE = 8;
+    const size_t FRAME_COUNT = 60;
+    const std::string path = "/tmp/shm_stack_recorder_bench.frames";
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(1920, 1080, PixelFormat::BGRA32));
+        std::memset(frames.back()->getData(), 0x5A, frames.back()->size());
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+    std::cout << "  " << FRAME_COUNT << " frames of 1920x1080 BGRA, pool of " << POOL_SIZE << ", queue depth 4\n";
+
+    using Backend = FrameRecorder::Backend;
+    for (Backend backend : {Backend::IoUring, Backend::ThreadPool}) {
+        for (bool direct : {false, true}) {
+            FrameRecorder::Options options;
+            options.backend = backend;
+            options.direct = direct;
+            options.queueDepth = 4;
+            FrameRecorder recorder(options);
+            if (!recorder.open(path.c_str())) {
+                std::cout << "  cannot open " << path << "\n";
+                return;
+            }
+            double waitMs = recordFrames(stack, recorder, FRAME_COUNT, false);
+            recorder.close();
+            std::remove(path.c_str());
+            const FrameRecorder::Stats &stats = recorder.stats();
+            std::cout << "  " << std::left << std::setw(12) << FrameRecorder::backendName(stats.backend)
+                      << std::setw(9) << (stats.direct ? "O_DIRECT" : "buffered") << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(6) << stats.gbps() << " GB/s, hold "
+                      << std::setprecision(0) << std::setw(6) << stats.holdUsAvg << " us/frame, pool wait "
+                      << std::setprecision(1) << std::setw(7) << waitMs << " ms, recorder stall " << std::setw(7)
+                      << stats.stallMs << " ms, avg held " << std::setprecision(2)
+                      << stats.holdUsAvg * stats.frames / (stats.seconds * 1e6) << " of " << POOL_SIZE << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+// ==================== Test: Frame File Source ====================
+// 用 FrameRecorder 录制 count 帧（帧 i 的内容为 i & 0xFF，时间戳间隔 16667us）
+bool recordFrameFile(const std::string &path, uint32_t width, uint32_t height, size_t count)
+{
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < 4; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(width, height, PixelFormat::BGRA32));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+    FrameRecorder recorder;
+    bool ok = recorder.open(path.c_str());
+    recordFrames(stack, recorder, count, true);
+    return recorder.close() && ok;
+}
+
+void testFrameFileSource()
+{
+    printSection("Test: Frame File Source");
+
+    const size_t POOL_SIZE = 4;
+    const size_t FRAME_COUNT = 30;
+    const std::string path = "/tmp/shm_stack_source_test.frames";
+    bool recorded = recordFrameFile(path, 320, 240, FRAME_COUNT);
+
+    // 作为流水线的 source 逐帧复制到池中
+    FrameFileSource source;
+    bool opened = recorded && source.open(path.c_str());
+    printTestResult(opened && source.frameCount() == FRAME_COUNT, "Recorded file opens with full index");
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(320, 240, PixelFormat::BGRA32));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+    using Pipeline = FramePipeline<ShmFrame>;
+    std::atomic<size_t> checked{0};
+    std::atomic<bool> corrupted{false};
+    Pipeline pipeline(stack);
+    pipeline.source("replay", 1, [&](const ShmFrame &frame) { return source.fill(frame); })
+        .stage("verify", 1, Pipeline::OverflowPolicy::Block, 2, [&](const ShmFrame &frame) {
+            const FrameHeader *header = frame.header();
+            uint8_t expected = static_cast<uint8_t>(header->sequence & 0xFF);
+            if (header->ptsUs != static_cast<int64_t>(header->sequence) * 16667 || frame.getData()[0] != expected
+                || frame.getData()[frame.size() - 1] != expected)
+                corrupted = true;
+            checked++;
+        });
+    pipeline.start();
+    pipeline.wait();
+    printTestResult(checked == FRAME_COUNT && !corrupted, "Pipeline source replays every frame intact");
+
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> all;
+    while (auto element = stack.tryAcquire()) {
+        all.push_back(element);
+    }
+    printTestResult(all.size() == POOL_SIZE, "All buffers returned to pool");
+
+    // 零拷贝视图：指向映射页，不循环时取完返回 false，循环时时间戳继续递增
+    FrameFileSource::MappedFrame mapped;
+    bool viewsOk = source.open(path.c_str(), FrameFileSource::Pacing::MaxSpeed, true);
+    int64_t lastPts = -1;
+    for (size_t i = 0; i < FRAME_COUNT * 2 && viewsOk; ++i) {
+        viewsOk = source.next(mapped) && mapped.header && mapped.sequence == i % FRAME_COUNT
+                  && mapped.ptsUs > lastPts && mapped.plane(0).width == 320 && mapped.plane(0).height == 240
+                  && mapped.data[0] == (i % FRAME_COUNT & 0xFF);
+        lastPts = mapped.ptsUs;
+    }
+    printTestResult(viewsOk, "Zero-copy views loop with increasing timestamps");
+
+    bool endOk = source.open(path.c_str());
+    for (size_t i = 0; i < FRAME_COUNT && endOk; ++i) {
+        endOk = source.next(mapped);
+    }
+    printTestResult(endOk && !source.next(mapped), "Source ends after last frame without loop");
+
+    // Recorded 节奏：10 帧至少需要 9 个帧间隔
+    source.open(path.c_str(), FrameFileSource::Pacing::Recorded);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < 10; ++i) {
+        source.next(mapped);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  10 frames at recorded pace: " << std::fixed << std::setprecision(1) << ms << "ms\n";
+    std::cout.unsetf(std::ios::floatfield);
+    printTestResult(ms >= 9 * 16.667 - 1, "Recorded pacing follows timestamps");
+
+    // 截断的文件（尾部丢失）和不存在的文件都应拒绝
+    source.close();
+    bool truncated = truncate(path.c_str(), static_cast<off_t>(FrameFile::kAlignment)) == 0;
+    printTestResult(truncated && !source.open(path.c_str()) && !source.isOpen(), "Truncated file rejected");
+    std::remove(path.c_str());
+    printTestResult(!source.open(path.c_str()), "Missing file rejected");
+}
+
+// ==================== Benchmark: Frame File Source ====================
+void benchmarkFrameFileSource()
+{
+    printSection("Benchmark: Frame File Source");
+
+    const size_t FRAME_COUNT = 60;
+    const size_t PASSES = 3;
+    const std::string path = "/tmp/shm_stack_source_bench.frames";
+    if (!recordFrameFile(path, 1920, 1080, FRAME_COUNT)) {
+        std::cout << "  cannot record " << path << "\n";
+        return;
+    }
+
+    ShmFrame target(1920, 1080, PixelFormat::BGRA32);
+    FrameFileSource source;
+    source.open(path.c_str(), FrameFileSource::Pacing::MaxSpeed, true);
+    FrameFileSource::MappedFrame mapped;
+    source.next(mapped); // 预热页缓存和映射
+    for (size_t i = 1; i < FRAME_COUNT; ++i) {
+        source.next(mapped);
+    }
+
+    source.rewind();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FRAME_COUNT * PASSES; ++i) {
+        source.fill(target);
+    }
+    double copySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    source.rewind();
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FRAME_COUNT * PASSES; ++i) {
+        source.next(mapped);
+        checksum += mapped.data[(i * 4096) % mapped.size];
+    }
+    double viewSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove(path.c_str());
+
+    double frames = FRAME_COUNT * PASSES;
+    std::cout << "  " << FRAME_COUNT << " frames of 1920x1080 BGRA x " << PASSES << " passes\n";
+    std::cout << std::fixed << std::setprecision(2) << "  fill (copy):  " << std::setw(9) << frames / copySec
+              << " frames/s, " << frames * target.size() / copySec / 1e9 << " GB/s\n";
+    std::cout << "  next (view):  " << std::setw(9) << frames / viewSec << " frames/s (checksum " << checksum
+              << ")\n";
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+// ==================== Test: Thread Placement ====================
+// 2 个 LLC，每个 LLC 2 个核心，每个核心 2 个超线程：cpu 0-7
+CpuTopology makeTopology(int caches, int coresPerCache, int threadsPerCore)
+{
+    CpuTopology topology;
+    int id = 0;
+    for (int c = 0; c < caches; ++c) {
+        for (int core = 0; core < coresPerCache; ++core) {
+            for (int t = 0; t < threadsPerCore; ++t) {
+                CpuTopology::Cpu cpu;
+                cpu.id = id++;
+                cpu.core = c * coresPerCache + core;
+                cpu.package = c;
+                cpu.llc = c * coresPerCache * threadsPerCore;
+                topology.cpus.push_back(cpu);
+            }
+        }
+    }
+    return topology;
+}
+
+void testThreadPlacement()
+{
+    printSection("Test: Thread Placement");
+
+    using Layout = ThreadPlacement::Layout;
+    const Layout layouts[] = {Layout::Floating, Layout::SameCpu, Layout::SiblingThreads, Layout::SameCache,
+                              Layout::CrossCache};
+
+    CpuTopology host = CpuTopology::detect();
+    std::cout << "  host: " << host.describe() << "\n";
+    bool hostOk = !host.cpus.empty();
+    for (Layout layout : layouts) {
+        ThreadPlacement::Policy policy;
+        if (ThreadPlacement::plan(host, layout, 2, policy)) {
+            for (int cpu : policy.cpus) {
+                hostOk = hostOk && std::any_of(host.cpus.begin(), host.cpus.end(),
+                                               [cpu](const CpuTopology::Cpu &c) { return c.id == cpu; });
+            }
+        }
+    }
+    printTestResult(hostOk, "Host topology plans only use allowed CPUs");
+
+    CpuTopology wide = makeTopology(2, 2, 2);
+    auto cpu = [&](int id) { return wide.cpus[id]; };
+    ThreadPlacement::Policy siblings, sameCache, crossCache, floating;
+    bool ok = ThreadPlacement::plan(wide, Layout::SiblingThreads, 2, siblings) && siblings.cpus.size() == 2
+              && cpu(siblings.cpus[0]).core == cpu(siblings.cpus[1]).core;
+    ok = ok && ThreadPlacement::plan(wide, Layout::SameCache, 2, sameCache) && sameCache.cpus.size() == 2
+         && cpu(sameCache.cpus[0]).llc == cpu(sameCache.cpus[1]).llc
+         && cpu(sameCache.cpus[0]).core != cpu(sameCache.cpus[1]).core;
+    ok = ok && ThreadPlacement::plan(wide, Layout::CrossCache, 2, crossCache) && crossCache.cpus.size() == 2
+         && cpu(crossCache.cpus[0]).llc != cpu(crossCache.cpus[1]).llc;
+    ok = ok && ThreadPlacement::plan(wide, Layout::Floating, 2, floating) && floating.cpus.empty();
+    printTestResult(ok && wide.coreCount() == 4 && wide.cacheCount() == 2, "Layouts pick siblings, cores and caches");
+
+    // 单 CPU：只剩 Floating 和 SameCpu
+    CpuTopology single = makeTopology(1, 1, 1);
+    ThreadPlacement::Policy policy;
+    ok = ThreadPlacement::plan(single, Layout::Floating, 2, policy)
+         && ThreadPlacement::plan(single, Layout::SameCpu, 2, policy) && policy.cpus == std::vector<int>{0};
+    ok = ok && !ThreadPlacement::plan(single, Layout::SiblingThreads, 2, policy)
+         && !ThreadPlacement::plan(single, Layout::SameCache, 2, policy)
+         && !ThreadPlacement::plan(single, Layout::CrossCache, 2, policy);
+    printTestResult(ok, "Single CPU falls back to floating or same-cpu");
+
+    // 绑定和实时优先级在独立线程上尝试，不影响测试主线程
+    ThreadPlacement::plan(host, Layout::SameCpu, 2, policy);
+    policy.fifoPriority = 1;
+    ThreadPlacement::Result result;
+    int ranOn = -1, schedPolicy = -1;
+    std::thread probe([&] {
+        result = ThreadPlacement::apply(policy, 0);
+        ranOn = sched_getcpu();
+        sched_param param{};
+        pthread_getschedparam(pthread_self(), &schedPolicy, &param);
+    });
+    probe.join();
+    std::cout << "  pinned=" << result.pinned << " realtime=" << result.realtime
+              << (result.realtime ? "" : std::string(" (") + std::strerror(result.error) + ")") << "\n";
+    printTestResult(result.pinned && ranOn == policy.cpus[0], "Thread pinned to planned CPU");
+    printTestResult(result.realtime ? schedPolicy == SCHED_FIFO : schedPolicy == SCHED_OTHER,
+                    "SCHED_FIFO applied when permitted, otherwise normal scheduling kept");
+
+    // 流水线各级按策略放置
+    const size_t POOL_SIZE = 4;
+    const size_t FRAME_COUNT = 200;
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(4096));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+    using Pipeline = FramePipeline<ShmFrame>;
+    ThreadPlacement::Policy pinned;
+    ThreadPlacement::plan(host, Layout::SameCpu, 2, pinned);
+    std::atomic<size_t> produced{0}, rendered{0};
+    Pipeline pipeline(stack);
+    pipeline.source("decode", 1, [&](const ShmFrame &) { return produced++ < FRAME_COUNT; })
+        .placement(pinned)
+        .stage("render", 2, Pipeline::OverflowPolicy::Block, 2, [&](const ShmFrame &) { rendered++; })
+        .placement(pinned);
+    pipeline.start();
+    pipeline.wait();
+    auto metrics = pipeline.metrics();
+    printTestResult(rendered == FRAME_COUNT && metrics[0].pinnedThreads == 1 && metrics[1].pinnedThreads == 2,
+                    "Pipeline stages pinned by placement policy");
+}
+
+// ==================== Benchmark: Thread Placement ====================
+// 每种布局的单向交接延迟（普通调度 / SCHED_FIFO），以及原始生产者-消费者场景在该布局下的结果
+void benchmarkThreadPlacement()
+{
+    printSection("Benchmark: Thread Placement");
+
+    using Layout = ThreadPlacement::Layout;
+    const size_t ROUNDS = 20000;
+    CpuTopology host = CpuTopology::detect();
+    std::cout << "  host: " << host.describe() << ", " << ROUNDS << " handoffs per run\n";
+
+    for (Layout layout : {Layout::Floating, Layout::SameCpu, Layout::SiblingThreads, Layout::SameCache,
+                          Layout::CrossCache}) {
+        for (int priority : {0, 1}) {
+            ThreadPlacement::HandoffStats stats = ThreadPlacement::measureHandoff(host, layout, ROUNDS, priority);
+            std::cout << "  " << std::left << std::setw(12) << ThreadPlacement::layoutName(layout) << std::setw(7)
+                      << (priority ? "fifo" : "normal") << std::right;
+            if (!stats.available) {
+                std::cout << "not available on this host\n";
+                break;
+            }
+            if (priority && !stats.realtime) {
+                std::cout << "SCHED_FIFO not permitted\n";
+                continue;
+            }
+            std::cout << std::fixed << std::setprecision(0) << "p50 " << std::setw(8) << stats.p50Ns << " ns, p99 "
+                      << std::setw(9) << stats.p99Ns << " ns, max " << std::setw(10) << stats.maxNs << " ns"
+                      << (stats.pinned ? "" : " (not pinned)") << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+
+    for (Layout layout : {Layout::Floating, Layout::SameCpu, Layout::SameCache}) {
+        ThreadPlacement::Policy policy;
+        if (ThreadPlacement::plan(host, layout, 2, policy)) {
+            std::cout << "  original scenario (300ms, decode 1ms, render 2ms), " << ThreadPlacement::layoutName(layout)
+                      << ":\n";
+            runOriginalTest(300, 1, 2, policy);
+        }
+    }
+}
+
+// ==================== Test: FixedStack Priority Classes ====================
+void testFixedStackPriority()
+{
+    printSection("Test: FixedStack Priority Classes");
+
+    auto makeStack = [] {
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        for (int i = 0; i < 6; ++i) {
+            frames.emplace_back(std::make_unique<ShmFrame>(1024));
+        }
+        return std::make_unique<FixedStack<ShmFrame>>(std::move(frames));
+    };
+
+    auto stack = makeStack();
+    printTestResult(!stack->setPriorityClasses({}) && !stack->setPriorityClasses({0, 4, 3})
+                        && stack->priorityClasses() == 0,
+                    "Empty or oversized reservations rejected");
+
+    // bulk / normal（预留 2）/ keyframe（预留 1）
+    const size_t BULK = 0, NORMAL = 1, KEY = 2;
+    printTestResult(stack->setPriorityClasses({0, 2, 1}) && stack->priorityClasses() == 3,
+                    "Priority classes configured");
+
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> held;
+    while (auto element = stack->tryAcquire(BULK)) {
+        held.push_back(element);
+    }
+    bool ok = held.size() == 3 && stack->drops(BULK) == 1 && stack->tryAcquire() == nullptr
+              && stack->drops(BULK) == 2;
+    printTestResult(ok, "Bulk stops at unreserved capacity, plain tryAcquire() is bulk");
+
+    while (auto element = stack->tryAcquire(NORMAL)) {
+        held.push_back(element);
+    }
+    ok = held.size() == 5 && stack->drops(NORMAL) == 1;
+    auto key = stack->tryAcquire(KEY);
+    ok = ok && key && stack->tryAcquire(KEY) == nullptr && stack->drops(KEY) == 1 && stack->inUse() == 6;
+    printTestResult(ok, "Higher classes use their reserve, drops counted per class");
+
+    // 超出范围的类别按最高类别获取，丢弃也记在最高类别上
+    ok = stack->tryAcquire(99) == nullptr && stack->drops(KEY) == 2 && stack->drops(99) == 2;
+    printTestResult(ok, "Out-of-range priorities are clamped in drops() like in tryAcquire()");
+
+    key.reset();
+    held.pop_back();
+    ok = stack->inUse() == 4 && stack->tryAcquire(BULK) == nullptr && stack->tryAcquire(99) != nullptr;
+    held.clear();
+    ok = ok && stack->inUse() == 0 && stack->tryAcquire(BULK) != nullptr;
+    printTestResult(ok, "Released elements return to the shared capacity");
+
+    // 未设置类别时 tryAcquire(priority) 与 tryAcquire() 相同
+    auto plain = makeStack();
+    for (int i = 0; i < 6; ++i) {
+        held.push_back(plain->tryAcquire(KEY));
+    }
+    printTestResult(held.back() && !plain->tryAcquire(KEY) && plain->drops(KEY) == 0,
+                    "Without classes every caller shares the whole pool");
+}
+
+// ==================== Test: Priority Under Overload ====================
+// 批量生产者不停抢占池，关键帧线程每毫秒取一帧：有预留时关键帧不应被丢弃
+void testPriorityUnderOverload()
+{
+    printSection("Test: Priority Under Overload");
+
+    const size_t POOL_SIZE = 8;
+    const size_t BULK_THREADS = 3;
+    const auto RUN_TIME = std::chrono::milliseconds(300);
+    const size_t KEY = 1;
+
+    for (bool reserve : {false, true}) {
+        std::vector<std::unique_ptr<ShmFrame>> frames;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            frames.emplace_back(std::make_unique<ShmFrame>(4096));
+        }
+        FixedStack<ShmFrame> stack(std::move(frames));
+        if (reserve) {
+            stack.setPriorityClasses({0, 2});
+        }
+
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> bulkFrames{0}, bulkDrops{0};
+        std::vector<std::thread> bulk;
+        for (size_t t = 0; t < BULK_THREADS; ++t) {
+            bulk.emplace_back([&] {
+                std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> holding;
+                while (!done.load(std::memory_order_relaxed)) {
+                    if (auto element = stack.tryAcquire()) {
+                        holding.push_back(std::move(element));
+                        bulkFrames++;
+                    } else {
+                        bulkDrops++;
+                    }
+                    // 每个线程最多持有 3 帧，3 个线程合计超过池容量
+                    if (holding.size() >= 3) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(200));
+                        holding.erase(holding.begin());
+                    }
+                }
+            });
+        }
+
+        uint64_t keyFrames = 0, keyDrops = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < RUN_TIME) {
+            if (auto element = stack.tryAcquire(KEY)) {
+                element->value()->getData()[0] = 1;
+                keyFrames++;
+            } else {
+                keyDrops++;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        done = true;
+        for (auto &t : bulk)
+            t.join();
+
+        std::cout << "  " << (reserve ? "reserved 2 for keyframes" : "no reservation        ")
+                  << ": key frames=" << keyFrames << " dropped=" << keyDrops << ", bulk frames=" << bulkFrames
+                  << " failed=" << bulkDrops << "\n";
+        if (reserve) {
+            printTestResult(keyDrops == 0 && stack.drops(KEY) == 0 && stack.drops(0) > 0,
+                            "Keyframes never dropped while bulk producers overload the pool");
+            printTestResult(stack.inUse() == 0, "Occupancy count returns to zero");
+        }
+    }
+}
+
+// ==================== Test: Rate Controller ====================
+void testRateController()
+{
+    printSection("Test: Rate Controller");
+
+    // 没有压力时每帧都处理
+    RateController idle;
+    size_t admitted = 0;
+    for (int i = 0; i < 100; ++i) {
+        admitted += idle.admit(0.2, 0.0);
+    }
+    printTestResult(admitted == 100 && idle.rate() == 1.0, "Low pressure admits every frame");
+
+    // 持续高压：每 holdFrames 帧减半，直到下限
+    RateController::Options options;
+    RateController busy(options);
+    for (int i = 0; i < 4; ++i) {
+        busy.admit(0.9, 0.0);
+    }
+    bool ok = busy.rate() == 0.5 && busy.stats().decreases == 1;
+    for (int i = 0; i < 100; ++i) {
+        busy.admit(0.9, 0.0);
+    }
+    printTestResult(ok && busy.rate() == options.minRate, "Sustained pressure decreases multiplicatively to the floor");
+
+    // 压力解除后线性恢复，每帧 +increase
+    for (int i = 0; i < 5; ++i) {
+        busy.admit(0.3, 0.1);
+    }
+    printTestResult(std::abs(busy.rate() - (options.minRate + 5 * options.increase)) < 1e-9,
+                    "Relief increases additively");
+
+    // 速率 0.25 时均匀抽帧：每 4 帧处理 1 帧；队列压力与池压力等效
+    RateController decimate;
+    for (int i = 0; i < 8; ++i) {
+        decimate.admit(0.0, 0.85);
+    }
+    ok = decimate.rate() == 0.25;
+    admitted = 0; // 0.6 介于 lowWater 和 highWater 之间，速率保持不变
+    for (int i = 0; i < 40; ++i) {
+        admitted += decimate.admit(0.6, 0.0);
+    }
+    printTestResult(ok && admitted == 10, "Queue depth counts as pressure, frames decimated evenly");
+
+    // 池已满时直接跳过；解码后被丢弃立即减速
+    RateController full;
+    ok = !full.admit(1.0, 0.0) && full.stats().skipped == 1;
+    full.onWasted();
+    printTestResult(ok && full.rate() == 0.5 && full.stats().wasted == 1 && full.stats().wasteRatio() == 0,
+                    "Full pool skips, wasted decode backs off immediately");
+}
+
+// ==================== Test: Adaptive Producer Rate ====================
+// 同一场景分别以固定速率和 RateController 运行，比较解码次数、丢帧率和渲染帧数。
+// sleep 驱动的时序受调度影响很大，对比结果只输出不断言，控制策略由 testRateController 确定性地验证
+void testAdaptiveProducerRate()
+{
+    printSection("Test: Adaptive Producer Rate");
+
+    const size_t RUN_MS = 500;
+    struct Scenario
+    {
+        size_t decodeMs;
+        size_t renderMs;
+    };
+    for (Scenario scenario : {Scenario{1, 2}, Scenario{2, 1}}) {
+        std::cout << "  fixed rate:\n";
+        OriginalTestResult fixed = runOriginalTest(RUN_MS, scenario.decodeMs, scenario.renderMs);
+        std::cout << "  adaptive rate:\n";
+        RateController controller;
+        OriginalTestResult adaptive =
+            runOriginalTest(RUN_MS, scenario.decodeMs, scenario.renderMs, ThreadPlacement::Policy(), &controller);
+
+        double fixedDropRate = static_cast<double>(fixed.dropped) / std::max<size_t>(fixed.decodes(), 1);
+        double adaptiveDropRate = static_cast<double>(adaptive.dropped) / std::max<size_t>(adaptive.decodes(), 1);
+        size_t savedMs = (fixed.decodes() > adaptive.decodes() ? fixed.decodes() - adaptive.decodes() : 0)
+                         * scenario.decodeMs;
+        std::cout << std::fixed << std::setprecision(1) << "  decode " << scenario.decodeMs << "ms / render "
+                  << scenario.renderMs << "ms: decode work " << fixed.decodes() * scenario.decodeMs << "ms -> "
+                  << adaptive.decodes() * scenario.decodeMs << "ms (saved " << savedMs << "ms), drop rate "
+                  << fixedDropRate * 100 << "% -> " << adaptiveDropRate * 100 << "%, rendered " << fixed.consumed
+                  << " -> " << adaptive.consumed << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+
+        // 与调度无关的记账：控制器的计数必须与生产者实际的处理结果一致
+        const RateController::Stats &stats = controller.stats();
+        printTestResult(stats.offered == adaptive.produced && stats.admitted == adaptive.decodes()
+                            && stats.skipped == adaptive.skipped && stats.wasted == adaptive.dropped,
+                        "Controller counters match the producer's decisions");
+    }
+}
+
+// ==================== Test: Frame Generations ====================
+void testFrameGenerations()
+{
+    printSection("Test: Frame Generations");
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (int i = 0; i < 3; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(1024));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> held;
+    bool ok = true;
+    for (uint32_t i = 0; i < 3; ++i) {
+        held.push_back(stack.tryAcquire());
+        auto descriptor = held.back()->descriptor();
+        ok = ok && descriptor.index == i && descriptor.generation == 1 && stack.isCurrent(descriptor);
+    }
+    printTestResult(ok, "Descriptors carry slot index and first generation");
+
+    // 归还后未被重新获取：描述仍然有效，可以乐观读取
+    held[0]->value()->getData()[0] = 42;
+    auto descriptor = held[0]->descriptor();
+    held.clear();
+    uint8_t seen = 0;
+    ok = stack.isCurrent(descriptor)
+         && stack.readOptimistic(descriptor,
+                                 [&](const ShmFrame &frame) {
+                                     FixedStack<ShmFrame>::loadRelaxed(&seen, frame.getData(), 1);
+                                 })
+         && seen == 42;
+    printTestResult(ok, "Released frame readable until reacquired");
+
+    // 槽位被重新获取后，旧描述失效
+    std::vector<std::shared_ptr<FixedStack<ShmFrame>::Element>> again;
+    while (auto element = stack.tryAcquire()) {
+        again.push_back(element);
+    }
+    bool called = false;
+    ok = !stack.isCurrent(descriptor) && again[0]->descriptor().generation == 2
+         && !stack.readOptimistic(descriptor, [&](const ShmFrame &) { called = true; }) && !called;
+    FixedStack<ShmFrame>::Descriptor bogus;
+    bogus.index = 7;
+    printTestResult(ok && !stack.isCurrent(bogus) && !stack.readOptimistic(bogus, [](const ShmFrame &) {}),
+                    "Stale and out-of-range descriptors rejected");
+
+    // 原子复制：首尾不对齐的部分按字节，其余按 64 位字
+    std::vector<uint8_t> source(64), target(64);
+    std::iota(source.begin(), source.end(), 1);
+    ok = true;
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size : {0, 1, 7, 8, 9, 29, 56}) {
+            std::fill(target.begin(), target.end(), 0);
+            FixedStack<ShmFrame>::storeRelaxed(target.data() + offset, source.data() + offset, size);
+            ok = ok && std::equal(source.begin() + offset, source.begin() + offset + size, target.begin() + offset)
+                 && std::count(target.begin(), target.end(), 0) == static_cast<ptrdiff_t>(64 - size);
+            std::vector<uint8_t> loaded(size + 1, 0);
+            FixedStack<ShmFrame>::loadRelaxed(loaded.data() + 1, target.data() + offset, size);
+            ok = ok && std::equal(loaded.begin() + 1, loaded.end(), source.begin() + offset);
+        }
+    }
+    printTestResult(ok, "Relaxed atomic copies handle unaligned heads and tails");
+}
+
+// ==================== Test: Optimistic Frame Reads ====================
+// 生产者写完一帧后发布描述并立即归还，读者不持有引用地读取刚归还的帧：
+// 通过验证的读取必须看到完整的一帧，槽位被复用时读取被拒绝
+void testOptimisticFrameReads()
+{
+    printSection("Test: Optimistic Frame Reads");
+
+    const size_t POOL_SIZE = 2;
+    const size_t BUF_SIZE = 64 * 1024;
+    const size_t FRAME_COUNT = 20000;
+    const size_t READERS = 2;
+
+    std::vector<std::unique_ptr<ShmFrame>> frames;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        frames.emplace_back(std::make_unique<ShmFrame>(BUF_SIZE));
+    }
+    FixedStack<ShmFrame> stack(std::move(frames));
+
+    // 描述打包为 generation << 8 | index，0 表示尚未发布
+    std::atomic<uint64_t> latest{0};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> accepted{0}, rejected{0}, torn{0};
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < READERS; ++r) {
+        readers.emplace_back([&] {
+            std::vector<uint8_t> copy(BUF_SIZE);
+            while (!done.load(std::memory_order_relaxed)) {
+                uint64_t packed = latest.load(std::memory_order_acquire);
+                if (packed == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                FixedStack<ShmFrame>::Descriptor descriptor;
+                descriptor.index = static_cast<uint32_t>(packed & 0xFF);
+                descriptor.generation = packed >> 8;
+                bool ok = stack.readOptimistic(
+                    descriptor, [&](const ShmFrame &frame) {
+                        FixedStack<ShmFrame>::loadRelaxed(copy.data(), frame.getData(), BUF_SIZE);
+                    });
+                if (!ok) {
+                    rejected++;
+                    continue;
+                }
+                accepted++;
+                if (std::count(copy.begin(), copy.end(), copy[0]) != static_cast<ptrdiff_t>(BUF_SIZE))
+                    torn++;
+            }
+        });
+    }
+
+    // 读者可能仍在乐观读取刚被重新获取的帧，写入同样使用原子操作
+    std::vector<uint8_t> pattern(BUF_SIZE);
+    for (size_t i = 0; i < FRAME_COUNT; ++i) {
+        auto element = stack.tryAcquire();
+        std::fill(pattern.begin(), pattern.end(), static_cast<uint8_t>(i));
+        FixedStack<ShmFrame>::storeRelaxed(element->value()->getData(), pattern.data(), BUF_SIZE);
+        auto descriptor = element->descriptor();
+        latest.store(descriptor.generation << 8 | descriptor.index, std::memory_order_release);
+        element.reset();
+        if (i % 64 == 0)
+            std::this_thread::yield();
+    }
+    done = true;
+    for (auto &t : readers)
+        t.join();
+
+    // 开销：获取+归还一次，以及一次 isCurrent()
+    const size_t OPS = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < OPS; ++i) {
+        auto element = stack.tryAcquire();
+    }
+    double acquireNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / OPS;
+    auto descriptor = stack.tryAcquire()->descriptor();
+    size_t current = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < OPS; ++i) {
+        current += stack.isCurrent(descriptor);
+    }
+    double checkNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / OPS;
+
+    std::cout << "  frames=" << FRAME_COUNT << " accepted=" << accepted << " rejected=" << rejected
+              << " torn=" << torn << std::fixed << std::setprecision(1) << " acquire+release=" << acquireNs
+              << "ns isCurrent=" << checkNs << "ns\n";
+    std::cout.unsetf(std::ios::floatfield);
+    printTestResult(torn == 0 && accepted > 0, "Validated optimistic reads never see a torn frame");
+    printTestResult(current == OPS, "Descriptor stays current while no one reacquires the slot");
+}
+
+// ==================== Test: Stack Destruction During Release ====================
+// 统计存活实例数，并记录实例在哪个线程上被删除
+struct TrackedValue
+{
+    static std::atomic<int64_t> live;
+    static std::atomic<uint64_t> deletedByOwner; // 在 ownerThread 上删除（池的析构函数）
+    static std::thread::id ownerThread;
+
+    TrackedValue() { live.fetch_add(1); }
+    ~TrackedValue()
+    {
+        live.fetch_sub(1);
+        if (std::this_thread::get_id() == ownerThread)
+            deletedByOwner.fetch_add(1);
+    }
+};
+std::atomic<int64_t> TrackedValue::live{0};
+std::atomic<uint64_t> TrackedValue::deletedByOwner{0};
+std::thread::id TrackedValue::ownerThread;
+
+// 归还线程和析构函数并发：析构函数必须等正在做计数和回调的归还完成后才释放池。
+// 回调的约定：归还在析构之前完成（元素回到池中）时恰好调用一次，之后由析构函数删除元素；
+// 析构之后才归还的元素不调用回调，由归还线程删除。因此每轮
+//   回调次数 == 析构函数删除的元素数，且回调次数 + 归还线程删除的元素数 == 归还次数
+void testStackDestructionDuringRelease()
+{
+    printSection("Test: Stack Destruction During Release");
+
+    const size_t ROUNDS = 200;
+    const size_t POOL_SIZE = 8;
+    const size_t THREADS = 4;
+
+    TrackedValue::ownerThread = std::this_thread::get_id();
+    std::atomic<uint64_t> hookCalls{0};
+    uint64_t released = 0, totalHooks = 0, afterDestruction = 0;
+    bool exact = true;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        std::vector<std::unique_ptr<TrackedValue>> values;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            values.emplace_back(std::make_unique<TrackedValue>());
+        }
+        auto stack = std::make_unique<FixedStack<TrackedValue>>(std::move(values));
+        stack->setPriorityClasses({0, 1});
+        // 回调中让出 CPU，拉长归还后处理的窗口
+        stack->setReleaseHook(
+            [](void *context) {
+                static_cast<std::atomic<uint64_t> *>(context)->fetch_add(1);
+                std::this_thread::yield();
+            },
+            &hookCalls);
+
+        std::vector<std::shared_ptr<FixedStack<TrackedValue>::Element>> held;
+        for (size_t i = 0; i < POOL_SIZE; ++i) {
+            held.push_back(stack->tryAcquire(1));
+        }
+        hookCalls = 0;
+        TrackedValue::deletedByOwner = 0;
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREADS; ++t) {
+            std::vector<std::shared_ptr<FixedStack<TrackedValue>::Element>> mine(
+                held.begin() + t * POOL_SIZE / THREADS, held.begin() + (t + 1) * POOL_SIZE / THREADS);
+            threads.emplace_back([&go, mine = std::move(mine)]() mutable {
+                while (!go.load(std::memory_order_acquire)) {
+                }
+                mine.clear();
+            });
+        }
+        released += held.size();
+        held.clear();
+        go.store(true, std::memory_order_release);
+        // 每轮让归还线程先跑不同的时长，覆盖归还前、归还中和归还后析构
+        for (size_t i = 0; i < round % 8; ++i) {
+            std::this_thread::yield();
+        }
+        stack.reset();
+        // 析构函数返回时回调都已结束，之后不会再有回调
+        uint64_t hooks = hookCalls.load();
+        uint64_t byOwner = TrackedValue::deletedByOwner.load();
+        for (auto &t : threads)
+            t.join();
+        uint64_t byReleasers = POOL_SIZE - byOwner;
+        exact = exact && hooks == byOwner && hookCalls.load() == hooks && TrackedValue::live.load() == 0;
+        totalHooks += hooks;
+        afterDestruction += byReleasers;
+    }
+
+    std::cout << "  rounds=" << ROUNDS << " released=" << released << " hooks=" << totalHooks
+              << " releasedAfterDestruction=" << afterDestruction << "\n";
+    printTestResult(exact && totalHooks + afterDestruction == released,
+                    "Every release either runs the hook before destruction or deletes its element afterwards");
+    printTestResult(TrackedValue::live.load() == 0, "No pooled value outlives the pool and its handles");
+}
+
+// ==================== Main ====================
+int main(int argc, char **argv)
+{
+    std::cout << "========== Running All Tests ==========\n";
+
+    // 单元测试
+    testAllocCounter();
+    testShmFrameBasic();
+    testShmFrameZeroSize();
+    testShmFrameLargeSize();
+    testShmFrameTyped();
+    testFixedStackEdgeCases();
+    testStackDestructionWithElements();
+    testDataIntegrity();
+    testMpmcQueue();
+    testChaseLevDeque();
+    testPixelConvert();
+    testDirtyRegion();
+    testFixedStackPriority();
+    testRateController();
+    testFrameGenerations();
+
+    // 并发测试
+    testMultiProducerConsumer();
+    testStress();
+    testFramePipeline();
+    testWorkStealingPool();
+    testCoroutinePoolAndQueue();
+    testBroadcastRing();
+    testSeqlockSnapshot();
+    testFrameRecorder();
+    testFrameFileSource();
+    testThreadPlacement();
+    testPriorityUnderOverload();
+    testOptimisticFrameReads();
+    testStackDestructionDuringRelease();
+
+    // 原始测试场景
+    testOriginalProducerConsumer();
+    testWorkStealingRenderBound();
+    testAdaptiveProducerRate();
+
+    // 基准测试
+    if (benchmarksEnabled(argc, argv)) {
+        benchmarkPixelConvert();
+        benchmarkDirtyRegion();
+        benchmarkFrameRecorder();
+        benchmarkFrameFileSource();
+        benchmarkThreadPlacement();
+    } else {
+        std::cout << "\n(benchmarks skipped, pass --bench or set SHM_STACK_BENCH=1)\n";
+    }
 
     std::cout << "\n========== All Tests Finished ==========\n";
     return 0;
@@ -0,0 +1,126 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief 有界无锁多生产者多消费者队列
+ *
+ * 基于 Dmitry Vyukov 的 bounded MPMC queue：每个槽位带一个序号，
+ * 生产者和消费者各自用 CAS 推进 m_enqueuePos / m_dequeuePos，
+ * 通过比较槽位序号判断槽位是空闲还是已写入，不需要任何锁。
+ *
+ * 所有槽位在构造时一次性分配，tryPush/tryPop 不会产生堆分配。
+ *
+ * @tparam T 元素类型，需要可默认构造和移动
+ */
+template <typename T>
+class MpmcQueue
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 队列容量，会向上取整到 2 的幂
+     */
+    explicit MpmcQueue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_capacity = capacity;
+        m_cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    /**
+     * @brief 尝试入队
+     * @return 队列已满（达到构造时的容量）返回 false，value 保持不变
+     */
+    bool tryPush(T &&value)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            // 容量不是 2 的幂时按构造时的容量限制；pos 可能已过期，用有符号差值比较
+            auto used = static_cast<std::ptrdiff_t>(pos - m_dequeuePos.load(std::memory_order_acquire));
+            if (used >= static_cast<std::ptrdiff_t>(m_capacity)) {
+                return false;
+            }
+            Cell &cell = m_cells[pos & m_mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // 槽位还没被消费者取走，队列已满
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 尝试出队
+     * @return 队列为空返回 false
+     */
+    bool tryPop(T &value)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = m_cells[pos & m_mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // 槽位还没被写入，队列为空
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 近似长度，仅用于统计
+    size_t sizeApprox() const
+    {
+        size_t enqueue = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t dequeue = m_dequeuePos.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    size_t m_capacity = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+};
+
+#endif // MPMC_QUEUE_H
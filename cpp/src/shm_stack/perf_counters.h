@@ -0,0 +1,162 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief 基于 perf_event_open 的性能计数器组
+ *
+ * 用于在基准测试的测量区间前后读取 cycles、instructions、cache misses、
+ * context switches 和 page faults，从而解释吞吐量变化的原因。
+ *
+ * 计数器以 inherit 方式打开，并且必须在创建工作线程之前构造：
+ * 之后创建的线程会继承计数器，线程退出（join）时计数会累加回本计数器。
+ * 因此 stop() 应在所有工作线程 join 之后调用。
+ *
+ * 容器或 perf_event_paranoid 较高时，部分或全部计数器可能无法打开，
+ * 此时对应计数器被标记为不可用，start()/stop() 仍然可以安全调用。
+ */
+class PerfCounters
+{
+public:
+    enum Counter {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        ContextSwitches,
+        PageFaults,
+        CounterCount,
+    };
+
+    struct Sample
+    {
+        std::array<uint64_t, CounterCount> values{};
+        std::array<bool, CounterCount> valid{};
+    };
+
+    PerfCounters()
+    {
+        static const std::array<std::pair<uint32_t, uint64_t>, CounterCount> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        }};
+
+        for (size_t i = 0; i < CounterCount; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            // 硬件计数器只统计用户态（paranoid=2 时也允许打开），
+            // 上下文切换和缺页本身发生在内核中，软件计数器不能排除内核
+            attr.exclude_kernel = attr.type == PERF_TYPE_HARDWARE;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            m_fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (m_fds[i] < 0 && m_error.empty()) {
+                m_error = std::string(name(static_cast<Counter>(i))) + ": " + std::strerror(errno);
+            }
+        }
+    }
+
+    ~PerfCounters()
+    {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available(Counter counter) const { return m_fds[counter] >= 0; }
+
+    bool anyAvailable() const
+    {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 第一个打开失败的计数器及其原因，全部成功时为空
+    const std::string &error() const { return m_error; }
+
+    void start()
+    {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    Sample stop()
+    {
+        Sample sample;
+        for (size_t i = 0; i < CounterCount; ++i) {
+            int fd = m_fds[i];
+            if (fd < 0) {
+                continue;
+            }
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+            // value, time_enabled, time_running
+            uint64_t data[3] = {};
+            if (read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+                continue;
+            }
+            // 计数器被复用时按运行时间比例放大
+            if (data[2] < data[1]) {
+                data[0] = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+            }
+            sample.values[i] = data[0];
+            sample.valid[i] = true;
+        }
+        return sample;
+    }
+
+    static const char *name(Counter counter)
+    {
+        switch (counter) {
+        case Cycles:
+            return "cycles";
+        case Instructions:
+            return "instructions";
+        case CacheMisses:
+            return "cache-misses";
+        case ContextSwitches:
+            return "context-switches";
+        case PageFaults:
+            return "page-faults";
+        default:
+            return "unknown";
+        }
+    }
+
+private:
+    std::array<int, CounterCount> m_fds{-1, -1, -1, -1, -1};
+    std::string m_error;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,662 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include "shm_frame.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_CONVERT_X86 1
+#endif
+
+/**
+ * @brief 直接作用在 ShmFrame 缓冲上的像素格式转换内核
+ *
+ * - swapRB：BGRA32 <-> RGBA32
+ * - premultiply / unpremultiply：Alpha 在第 4 个字节的 32 位像素（BGRA32 即 Qt 的 ARGB32）
+ *   与预乘格式之间互转；Alpha 在第 1 个字节的 ARGB32 帧走单独的标量实现
+ * - BGRA32 / RGBA32 -> NV12 / I420，BT.601 有限范围，色度取 2x2 平均
+ *
+ * 每个内核都有标量参考实现，以及 SSE2 / AVX2 / AVX-512 版本，运行时按 CPUID 选择。
+ * 所有 SIMD 版本与标量版本逐字节一致。
+ */
+namespace PixelConvert {
+
+enum class Isa {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+inline const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    case Isa::AVX512:
+        return "AVX-512";
+    default:
+        return "Scalar";
+    }
+}
+
+// 亮度 / 色度系数，按像素内存中的字节顺序排列（第 4 个字节是 Alpha，系数为 0）
+struct Coefficients
+{
+    int16_t y[4];
+    int16_t u[4];
+    int16_t v[4];
+};
+
+// BT.601 有限范围：Y = ((66R + 129G + 25B + 128) >> 8) + 16
+inline const Coefficients &coefficients(PixelFormat format)
+{
+    static const Coefficients bgra{{25, 129, 66, 0}, {112, -74, -38, 0}, {-18, -94, 112, 0}};
+    static const Coefficients rgba{{66, 129, 25, 0}, {-38, -74, 112, 0}, {112, -94, -18, 0}};
+    return format == PixelFormat::RGBA32 ? rgba : bgra;
+}
+
+/**
+ * @brief 一组内核的函数指针
+ *
+ * lumaRow 把一行 width 个像素转换成 Y；chromaRow 把两行像素转换成 (width + 1) / 2 个色度样本，
+ * U 和 V 分别写到 u、v，每个样本之间间隔 step 字节（I420 为 1，NV12 为 2 且 v = u + 1）。
+ */
+struct Kernels
+{
+    Isa isa;
+    void (*swapRB)(const uint8_t *src, uint8_t *dst, size_t pixels);
+    void (*premultiply)(const uint8_t *src, uint8_t *dst, size_t pixels);
+    void (*unpremultiply)(const uint8_t *src, uint8_t *dst, size_t pixels);
+    void (*lumaRow)(const uint8_t *src, uint8_t *y, size_t width, const Coefficients &c);
+    void (*chromaRow)(const uint8_t *row0, const uint8_t *row1, size_t width, uint8_t *u, uint8_t *v, size_t step,
+                      const Coefficients &c);
+};
+
+namespace detail {
+
+// ==================== 标量实现 ====================
+
+// round(c * a / 255)，对所有 8 位输入精确
+inline uint8_t mul255(uint32_t c, uint32_t a)
+{
+    uint32_t t = c * a + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+inline void swapRBScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        uint8_t c0 = src[4 * i], c1 = src[4 * i + 1], c2 = src[4 * i + 2], a = src[4 * i + 3];
+        dst[4 * i] = c2;
+        dst[4 * i + 1] = c1;
+        dst[4 * i + 2] = c0;
+        dst[4 * i + 3] = a;
+    }
+}
+
+inline void premultiplyScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        uint8_t a = src[4 * i + 3];
+        dst[4 * i] = mul255(src[4 * i], a);
+        dst[4 * i + 1] = mul255(src[4 * i + 1], a);
+        dst[4 * i + 2] = mul255(src[4 * i + 2], a);
+        dst[4 * i + 3] = a;
+    }
+}
+
+// 除法没有合适的整数 SIMD 指令，所有 ISA 共用这个实现
+inline void unpremultiplyScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        uint32_t a = src[4 * i + 3];
+        for (int c = 0; c < 3; ++c) {
+            dst[4 * i + c] = a ? static_cast<uint8_t>(std::min<uint32_t>(255, (src[4 * i + c] * 255u + a / 2) / a)) : 0;
+        }
+        dst[4 * i + 3] = static_cast<uint8_t>(a);
+    }
+}
+
+// ARGB32（内存顺序 A R G B）：Alpha 在第 1 个字节，只用于帧级接口，不区分 ISA
+inline void premultiplyAlphaFirstScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        uint8_t a = src[4 * i];
+        dst[4 * i] = a;
+        dst[4 * i + 1] = mul255(src[4 * i + 1], a);
+        dst[4 * i + 2] = mul255(src[4 * i + 2], a);
+        dst[4 * i + 3] = mul255(src[4 * i + 3], a);
+    }
+}
+
+inline void unpremultiplyAlphaFirstScalar(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        uint32_t a = src[4 * i];
+        dst[4 * i] = static_cast<uint8_t>(a);
+        for (int c = 1; c < 4; ++c) {
+            dst[4 * i + c] = a ? static_cast<uint8_t>(std::min<uint32_t>(255, (src[4 * i + c] * 255u + a / 2) / a)) : 0;
+        }
+    }
+}
+
+inline uint8_t lumaPixel(const uint8_t *p, const Coefficients &c)
+{
+    int sum = c.y[0] * p[0] + c.y[1] * p[1] + c.y[2] * p[2] + 128;
+    return static_cast<uint8_t>((sum >> 8) + 16);
+}
+
+inline void lumaRowScalar(const uint8_t *src, uint8_t *y, size_t width, const Coefficients &c)
+{
+    for (size_t x = 0; x < width; ++x) {
+        y[x] = lumaPixel(src + 4 * x, c);
+    }
+}
+
+// 从第 begin 个色度样本开始处理剩余部分，奇数宽度时最后一列重复使用
+inline void chromaTail(const uint8_t *row0, const uint8_t *row1, size_t width, size_t begin, uint8_t *u, uint8_t *v,
+                       size_t step, const Coefficients &c)
+{
+    size_t chromaWidth = (width + 1) / 2;
+    for (size_t i = begin; i < chromaWidth; ++i) {
+        size_t x0 = 2 * i;
+        size_t x1 = std::min(x0 + 1, width - 1);
+        int avg[3];
+        for (int ch = 0; ch < 3; ++ch) {
+            int sum = row0[4 * x0 + ch] + row0[4 * x1 + ch] + row1[4 * x0 + ch] + row1[4 * x1 + ch];
+            avg[ch] = (sum + 2) >> 2;
+        }
+        int su = c.u[0] * avg[0] + c.u[1] * avg[1] + c.u[2] * avg[2] + 128;
+        int sv = c.v[0] * avg[0] + c.v[1] * avg[1] + c.v[2] * avg[2] + 128;
+        u[i * step] = static_cast<uint8_t>((su >> 8) + 128);
+        v[i * step] = static_cast<uint8_t>((sv >> 8) + 128);
+    }
+}
+
+inline void chromaRowScalar(const uint8_t *row0, const uint8_t *row1, size_t width, uint8_t *u, uint8_t *v, size_t step,
+                            const Coefficients &c)
+{
+    chromaTail(row0, row1, width, 0, u, v, step, c);
+}
+
+#ifdef PIXEL_CONVERT_X86
+
+// ==================== SSE2 ====================
+
+__attribute__((target("sse2"))) inline void swapRBSse2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m128i agMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+    const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+        __m128i rb = _mm_and_si128(x, rbMask);
+        rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), _mm_or_si128(_mm_and_si128(x, agMask), rb));
+    }
+    swapRBScalar(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+// 16 位通道上计算 round(c * a / 255)，alpha 为每个像素广播后的 Alpha
+__attribute__((target("sse2"))) inline __m128i mul255Sse2(__m128i c, __m128i alpha)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse2"))) inline void premultiplySse2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+        __m128i lo = _mm_unpacklo_epi8(x, zero);
+        __m128i hi = _mm_unpackhi_epi8(x, zero);
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        __m128i result = _mm_packus_epi16(mul255Sse2(lo, alo), mul255Sse2(hi, ahi));
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(x, alphaMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), result);
+    }
+    premultiplyScalar(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+// 4 个 16 位像素和系数做点积，得到 [p0, p1, p2, p3] 的 32 位和（不含舍入）
+__attribute__((target("sse2"))) inline __m128i dot4Sse2(__m128i lo, __m128i hi, __m128i coef)
+{
+    __m128i a = _mm_madd_epi16(lo, coef);
+    __m128i b = _mm_madd_epi16(hi, coef);
+    a = _mm_add_epi32(a, _mm_srli_epi64(a, 32));
+    b = _mm_add_epi32(b, _mm_srli_epi64(b, 32));
+    a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi64(a, b);
+}
+
+__attribute__((target("sse2"))) inline __m128i coefSse2(const int16_t *c)
+{
+    return _mm_setr_epi16(c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3]);
+}
+
+__attribute__((target("sse2"))) inline void lumaRowSse2(const uint8_t *src, uint8_t *y, size_t width,
+                                                         const Coefficients &c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coef = coefSse2(c.y);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i offset = _mm_set1_epi16(16);
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * x));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * x + 16));
+        __m128i s0 = _mm_srai_epi32(_mm_add_epi32(dot4Sse2(_mm_unpacklo_epi8(p0, zero), _mm_unpackhi_epi8(p0, zero), coef), round), 8);
+        __m128i s1 = _mm_srai_epi32(_mm_add_epi32(dot4Sse2(_mm_unpacklo_epi8(p1, zero), _mm_unpackhi_epi8(p1, zero), coef), round), 8);
+        __m128i luma = _mm_add_epi16(_mm_packs_epi32(s0, s1), offset);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(y + x), _mm_packus_epi16(luma, luma));
+    }
+    lumaRowScalar(src + 4 * x, y + x, width - x, c);
+}
+
+// 两行各 4 个像素 -> 2 个 2x2 块的平均值，16 位 [B G R A, B G R A]
+__attribute__((target("sse2"))) inline __m128i blockAverageSse2(__m128i r0, __m128i r1)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    __m128i sum = _mm_unpacklo_epi64(lo, hi);
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+// 写出 n 个（4 或 8）色度样本，u16/v16 为未加偏移的 16 位结果
+__attribute__((target("sse2"))) inline void storeChromaSse2(__m128i u16, __m128i v16, size_t n, uint8_t *u,
+                                                             uint8_t *v, size_t step)
+{
+    u16 = _mm_add_epi16(u16, _mm_set1_epi16(128));
+    v16 = _mm_add_epi16(v16, _mm_set1_epi16(128));
+    if (step == 2 && v == u + 1) {
+        __m128i lo = _mm_unpacklo_epi16(u16, v16);
+        __m128i hi = _mm_unpackhi_epi16(u16, v16);
+        if (n == 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(u), _mm_packus_epi16(lo, hi));
+        } else {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(u), _mm_packus_epi16(lo, lo));
+        }
+        return;
+    }
+    alignas(16) uint8_t bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(bytes), _mm_packus_epi16(u16, v16));
+    for (size_t i = 0; i < n; ++i) {
+        u[i * step] = bytes[i];
+        v[i * step] = bytes[8 + i];
+    }
+}
+
+__attribute__((target("sse2"))) inline void chromaRowSse2(const uint8_t *row0, const uint8_t *row1, size_t width,
+                                                           uint8_t *u, uint8_t *v, size_t step, const Coefficients &c)
+{
+    const __m128i coefU = coefSse2(c.u);
+    const __m128i coefV = coefSse2(c.v);
+    const __m128i round = _mm_set1_epi32(128);
+    size_t i = 0; // 色度样本下标
+    for (; 2 * i + 8 <= width; i += 4) {
+        const uint8_t *p0 = row0 + 8 * i;
+        const uint8_t *p1 = row1 + 8 * i;
+        __m128i a = blockAverageSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p0)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1)));
+        __m128i b = blockAverageSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p0 + 16)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1 + 16)));
+        __m128i su = _mm_srai_epi32(_mm_add_epi32(dot4Sse2(a, b, coefU), round), 8);
+        __m128i sv = _mm_srai_epi32(_mm_add_epi32(dot4Sse2(a, b, coefV), round), 8);
+        storeChromaSse2(_mm_packs_epi32(su, su), _mm_packs_epi32(sv, sv), 4, u + i * step, v + i * step, step);
+    }
+    chromaTail(row0, row1, width, i, u, v, step, c);
+}
+
+// ==================== AVX2 ====================
+
+__attribute__((target("avx2"))) inline void swapRBAvx2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                             2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), _mm256_shuffle_epi8(x, shuffle));
+    }
+    swapRBSse2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i mul255Avx2(__m256i c, __m256i alpha)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(c, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2"))) inline void premultiplyAvx2(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i));
+        __m256i lo = _mm256_unpacklo_epi8(x, zero);
+        __m256i hi = _mm256_unpackhi_epi8(x, zero);
+        __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+        __m256i result = _mm256_packus_epi16(mul255Avx2(lo, alo), mul255Avx2(hi, ahi));
+        result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(x, alphaMask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), result);
+    }
+    premultiplySse2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+// 与 dot4Sse2 相同，每个 128 位通道独立计算
+__attribute__((target("avx2"))) inline __m256i dot4Avx2(__m256i lo, __m256i hi, __m256i coef)
+{
+    __m256i a = _mm256_madd_epi16(lo, coef);
+    __m256i b = _mm256_madd_epi16(hi, coef);
+    a = _mm256_add_epi32(a, _mm256_srli_epi64(a, 32));
+    b = _mm256_add_epi32(b, _mm256_srli_epi64(b, 32));
+    a = _mm256_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+    b = _mm256_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm256_unpacklo_epi64(a, b);
+}
+
+__attribute__((target("avx2"))) inline __m256i coefAvx2(const int16_t *c)
+{
+    return _mm256_setr_epi16(c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3], c[0], c[1],
+                             c[2], c[3]);
+}
+
+__attribute__((target("avx2"))) inline void lumaRowAvx2(const uint8_t *src, uint8_t *y, size_t width,
+                                                         const Coefficients &c)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coef = coefAvx2(c.y);
+    const __m256i round = _mm256_set1_epi32(128);
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * x));
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * x + 32));
+        // 每个通道 4 个连续像素，结果按像素顺序排列
+        __m256i s0 = _mm256_srai_epi32(
+            _mm256_add_epi32(dot4Avx2(_mm256_unpacklo_epi8(p0, zero), _mm256_unpackhi_epi8(p0, zero), coef), round), 8);
+        __m256i s1 = _mm256_srai_epi32(
+            _mm256_add_epi32(dot4Avx2(_mm256_unpacklo_epi8(p1, zero), _mm256_unpackhi_epi8(p1, zero), coef), round), 8);
+        __m128i lo = _mm_packs_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+        __m128i hi = _mm_packs_epi32(_mm256_castsi256_si128(s1), _mm256_extracti128_si256(s1, 1));
+        lo = _mm_add_epi16(lo, _mm_set1_epi16(16));
+        hi = _mm_add_epi16(hi, _mm_set1_epi16(16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x), _mm_packus_epi16(lo, hi));
+    }
+    lumaRowSse2(src + 4 * x, y + x, width - x, c);
+}
+
+__attribute__((target("avx2"))) inline __m256i blockAverageAvx2(__m256i r0, __m256i r1)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(r0, zero), _mm256_unpacklo_epi8(r1, zero));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(r0, zero), _mm256_unpackhi_epi8(r1, zero));
+    lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+    hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+    __m256i sum = _mm256_unpacklo_epi64(lo, hi);
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+__attribute__((target("avx2"))) inline void chromaRowAvx2(const uint8_t *row0, const uint8_t *row1, size_t width,
+                                                           uint8_t *u, uint8_t *v, size_t step, const Coefficients &c)
+{
+    const __m256i coefU = coefAvx2(c.u);
+    const __m256i coefV = coefAvx2(c.v);
+    const __m256i round = _mm256_set1_epi32(128);
+    // dot4Avx2 的结果在两个通道间交错：[0 1 4 5 | 2 3 6 7]
+    const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+    size_t i = 0;
+    for (; 2 * i + 16 <= width; i += 8) {
+        const uint8_t *p0 = row0 + 8 * i;
+        const uint8_t *p1 = row1 + 8 * i;
+        __m256i a = blockAverageAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p0)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p1)));
+        __m256i b = blockAverageAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p0 + 32)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p1 + 32)));
+        __m256i su = _mm256_srai_epi32(_mm256_add_epi32(dot4Avx2(a, b, coefU), round), 8);
+        __m256i sv = _mm256_srai_epi32(_mm256_add_epi32(dot4Avx2(a, b, coefV), round), 8);
+        su = _mm256_permutevar8x32_epi32(su, order);
+        sv = _mm256_permutevar8x32_epi32(sv, order);
+        __m128i u16 = _mm_packs_epi32(_mm256_castsi256_si128(su), _mm256_extracti128_si256(su, 1));
+        __m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(sv), _mm256_extracti128_si256(sv, 1));
+        storeChromaSse2(u16, v16, 8, u + i * step, v + i * step, step);
+    }
+    chromaTail(row0, row1, width, i, u, v, step, c);
+}
+
+// ==================== AVX-512 ====================
+
+// GCC 12 的 AVX-512 intrinsic 用自初始化的 _mm512_undefined_*() 作为直通值，会误报未初始化
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw"))) inline void swapRBAvx512(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    const __m512i shuffle =
+        _mm512_broadcast_i32x4(_mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        __m512i x = _mm512_loadu_si512(src + 4 * i);
+        _mm512_storeu_si512(dst + 4 * i, _mm512_shuffle_epi8(x, shuffle));
+    }
+    swapRBAvx2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline __m512i mul255Avx512(__m512i c, __m512i alpha)
+{
+    __m512i t = _mm512_add_epi16(_mm512_mullo_epi16(c, alpha), _mm512_set1_epi16(128));
+    return _mm512_srli_epi16(_mm512_add_epi16(t, _mm512_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline void premultiplyAvx512(const uint8_t *src, uint8_t *dst,
+                                                                           size_t pixels)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i alphaMask = _mm512_set1_epi32(static_cast<int>(0xFF000000u));
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        __m512i x = _mm512_loadu_si512(src + 4 * i);
+        __m512i lo = _mm512_unpacklo_epi8(x, zero);
+        __m512i hi = _mm512_unpackhi_epi8(x, zero);
+        __m512i alo = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m512i ahi = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(hi, 0xFF), 0xFF);
+        __m512i result = _mm512_packus_epi16(mul255Avx512(lo, alo), mul255Avx512(hi, ahi));
+        result = _mm512_or_si512(_mm512_andnot_si512(alphaMask, result), _mm512_and_si512(x, alphaMask));
+        _mm512_storeu_si512(dst + 4 * i, result);
+    }
+    premultiplyAvx2(src + 4 * i, dst + 4 * i, pixels - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline void lumaRowAvx512(const uint8_t *src, uint8_t *y, size_t width,
+                                                                       const Coefficients &c)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i coef = _mm512_broadcast_i32x4(coefSse2(c.y));
+    const __m512i round = _mm512_set1_epi32(128);
+    const __m512i offset = _mm512_set1_epi32(16);
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i p = _mm512_loadu_si512(src + 4 * x);
+        __m512i a = _mm512_madd_epi16(_mm512_unpacklo_epi8(p, zero), coef);
+        __m512i b = _mm512_madd_epi16(_mm512_unpackhi_epi8(p, zero), coef);
+        a = _mm512_add_epi32(a, _mm512_srli_epi64(a, 32));
+        b = _mm512_add_epi32(b, _mm512_srli_epi64(b, 32));
+        a = _mm512_shuffle_epi32(a, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(3, 1, 2, 0)));
+        b = _mm512_shuffle_epi32(b, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(3, 1, 2, 0)));
+        __m512i s = _mm512_srai_epi32(_mm512_add_epi32(_mm512_unpacklo_epi64(a, b), round), 8);
+        // Y 总在 16..235 之间，直接截断为字节
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x), _mm512_cvtepi32_epi8(_mm512_add_epi32(s, offset)));
+    }
+    lumaRowAvx2(src + 4 * x, y + x, width - x, c);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // PIXEL_CONVERT_X86
+
+} // namespace detail
+
+inline const Kernels &kernels(Isa isa)
+{
+    static const Kernels scalar{Isa::Scalar, detail::swapRBScalar, detail::premultiplyScalar,
+                                detail::unpremultiplyScalar, detail::lumaRowScalar, detail::chromaRowScalar};
+#ifdef PIXEL_CONVERT_X86
+    static const Kernels sse2{Isa::SSE2, detail::swapRBSse2, detail::premultiplySse2, detail::unpremultiplyScalar,
+                              detail::lumaRowSse2, detail::chromaRowSse2};
+    static const Kernels avx2{Isa::AVX2, detail::swapRBAvx2, detail::premultiplyAvx2, detail::unpremultiplyScalar,
+                              detail::lumaRowAvx2, detail::chromaRowAvx2};
+    // 色度的 2x2 平均在 AVX-512 上没有明显收益，沿用 AVX2 版本
+    static const Kernels avx512{Isa::AVX512, detail::swapRBAvx512, detail::premultiplyAvx512,
+                                detail::unpremultiplyScalar, detail::lumaRowAvx512, detail::chromaRowAvx2};
+    switch (isa) {
+    case Isa::SSE2:
+        return sse2;
+    case Isa::AVX2:
+        return avx2;
+    case Isa::AVX512:
+        return avx512;
+    default:
+        break;
+    }
+#endif
+    (void)isa;
+    return scalar;
+}
+
+// 当前 CPU 支持的 ISA
+inline bool isaSupported(Isa isa)
+{
+#ifdef PIXEL_CONVERT_X86
+    switch (isa) {
+    case Isa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case Isa::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    default:
+        return true;
+    }
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+// 按 CPUID 选出的最优内核，首次调用时检测
+inline const Kernels &kernels()
+{
+    static const Kernels &best = [] () -> const Kernels & {
+        for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE2}) {
+            if (isaSupported(isa)) {
+                return kernels(isa);
+            }
+        }
+        return kernels(Isa::Scalar);
+    }();
+    return best;
+}
+
+/**
+ * @brief 按帧头中的格式在两个带帧头的 ShmFrame 之间转换
+ *
+ * 支持 BGRA32 <-> RGBA32、同格式拷贝，以及 BGRA32 / RGBA32 -> NV12 / I420。
+ * src 和 dst 可以是同一帧（仅限 32 位格式之间）。
+ *
+ * @return 格式不支持或尺寸不一致时返回 false
+ */
+inline bool convert(const ShmFrame &src, ShmFrame &dst, const Kernels &k = kernels())
+{
+    const FrameHeader *sh = src.header();
+    const FrameHeader *dh = dst.header();
+    if (!sh || !dh || sh->width != dh->width || sh->height != dh->height) {
+        return false;
+    }
+    auto sf = static_cast<PixelFormat>(sh->format);
+    auto df = static_cast<PixelFormat>(dh->format);
+    bool srcPacked = sf == PixelFormat::BGRA32 || sf == PixelFormat::RGBA32;
+    if (!srcPacked) {
+        return false;
+    }
+    PlaneView in = src.plane(0);
+
+    if (df == sf || df == PixelFormat::BGRA32 || df == PixelFormat::RGBA32) {
+        PlaneView out = dst.plane(0);
+        for (uint32_t y = 0; y < in.height; ++y) {
+            if (df == sf) {
+                if (out.row(y) != in.row(y)) {
+                    std::memcpy(out.row(y), in.row(y), static_cast<size_t>(in.width) * 4);
+                }
+            } else {
+                k.swapRB(in.row(y), out.row(y), in.width);
+            }
+        }
+        return true;
+    }
+
+    if (df != PixelFormat::NV12 && df != PixelFormat::I420) {
+        return false;
+    }
+    const Coefficients &c = coefficients(sf);
+    PlaneView luma = dst.plane(0);
+    for (uint32_t y = 0; y < in.height; ++y) {
+        k.lumaRow(in.row(y), luma.row(y), in.width, c);
+    }
+    PlaneView cu = dst.plane(1);
+    PlaneView cv = df == PixelFormat::I420 ? dst.plane(2) : cu;
+    for (uint32_t y = 0; y < cu.height; ++y) {
+        const uint8_t *row0 = in.row(2 * y);
+        const uint8_t *row1 = 2 * y + 1 < in.height ? in.row(2 * y + 1) : row0;
+        if (df == PixelFormat::NV12) {
+            k.chromaRow(row0, row1, in.width, cu.row(y), cu.row(y) + 1, 2, c);
+        } else {
+            k.chromaRow(row0, row1, in.width, cu.row(y), cv.row(y), 1, c);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 对 32 位帧做预乘 / 反预乘，src 和 dst 可以是同一帧
+ *
+ * BGRA32 / RGBA32 使用 k 中的内核；ARGB32 的 Alpha 在第 1 个字节，使用标量实现。
+ */
+inline bool premultiply(const ShmFrame &src, ShmFrame &dst, bool inverse = false, const Kernels &k = kernels())
+{
+    const FrameHeader *sh = src.header();
+    const FrameHeader *dh = dst.header();
+    if (!sh || !dh || sh->width != dh->width || sh->height != dh->height || sh->format != dh->format
+        || ShmFrame::planeCount(static_cast<PixelFormat>(sh->format)) != 1) {
+        return false;
+    }
+    auto kernel = inverse ? k.unpremultiply : k.premultiply;
+    if (static_cast<PixelFormat>(sh->format) == PixelFormat::ARGB32) {
+        kernel = inverse ? detail::unpremultiplyAlphaFirstScalar : detail::premultiplyAlphaFirstScalar;
+    }
+    PlaneView in = src.plane(0);
+    PlaneView out = dst.plane(0);
+    for (uint32_t y = 0; y < in.height; ++y) {
+        kernel(in.row(y), out.row(y), in.width);
+    }
+    return true;
+}
+
+} // namespace PixelConvert
+
+#endif // PIXEL_CONVERT_H
@@ -0,0 +1,117 @@
+#ifndef RATE_CONTROLLER_H
+#define RATE_CONTROLLER_H
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief 根据池和队列的压力调节生产者速率（AIMD）
+ *
+ * 渲染跟不上时，生产者照常解码，然后在 tryAcquire() 失败时把解码结果扔掉，
+ * 这部分 CPU 完全浪费。RateController 在解码之前决定是否处理这一帧：
+ *
+ * - 压力 = max(池占用比例, 队列填充比例)
+ * - 压力不低于 highWater 时速率乘以 decrease（每 holdFrames 帧最多一次），
+ *   不高于 lowWater 时速率加上 increase，上限为 1
+ * - 解码后仍拿不到缓冲（onWasted()）相当于丢包，立即乘法减速
+ * - 池已满时直接跳过；否则按速率做均匀抽帧（累加 rate，满 1 处理一帧）
+ *
+ * 每个生产者线程使用自己的实例，不是线程安全的。
+ */
+class RateController
+{
+public:
+    struct Options
+    {
+        double minRate = 0.05;   // 速率下限，保证压力解除后能尽快探测到
+        double highWater = 0.8;  // 压力不低于此值时乘法减速
+        double lowWater = 0.5;   // 压力不高于此值时加法加速
+        double increase = 0.05;  // 每帧加速量
+        double decrease = 0.5;   // 减速系数
+        uint32_t holdFrames = 4; // 两次乘法减速之间至少间隔的帧数，等待上一次减速生效
+    };
+
+    struct Stats
+    {
+        uint64_t offered = 0;  // 调用 admit() 的帧数
+        uint64_t admitted = 0; // 允许解码的帧数
+        uint64_t skipped = 0;  // 解码前跳过的帧数，即节省的解码次数
+        uint64_t wasted = 0;   // 解码后因拿不到缓冲而丢弃的帧数
+        uint64_t decreases = 0;
+        double rateSum = 0;    // 用于计算平均速率
+
+        double averageRate() const { return offered ? rateSum / offered : 1.0; }
+        // 解码后被丢弃的比例
+        double wasteRatio() const { return admitted ? static_cast<double>(wasted) / admitted : 0; }
+    };
+
+    RateController()
+        : RateController(Options())
+    {
+    }
+
+    explicit RateController(const Options &options)
+        : m_options(options)
+    {
+    }
+
+    /**
+     * @brief 一帧到达时调用，决定是否解码
+     * @param poolOccupancy 池中被占用元素的比例，0..1
+     * @param queueFill 下游队列的填充比例，0..1
+     * @return false 表示跳过这一帧，不要解码
+     */
+    bool admit(double poolOccupancy, double queueFill)
+    {
+        double pressure = std::max(poolOccupancy, queueFill);
+        ++m_sinceDecrease;
+        if (pressure >= m_options.highWater) {
+            decrease();
+        } else if (pressure <= m_options.lowWater) {
+            m_rate = std::min(1.0, m_rate + m_options.increase);
+        }
+
+        ++m_stats.offered;
+        m_stats.rateSum += m_rate;
+        bool admitted = false;
+        if (poolOccupancy < 1.0) {
+            m_credit += m_rate;
+            if (m_credit >= 1.0) {
+                m_credit -= 1.0;
+                admitted = true;
+            }
+        }
+        ++(admitted ? m_stats.admitted : m_stats.skipped);
+        return admitted;
+    }
+
+    // 解码后 tryAcquire() 失败，解码结果被丢弃
+    void onWasted()
+    {
+        ++m_stats.wasted;
+        m_sinceDecrease = m_options.holdFrames;
+        decrease();
+    }
+
+    double rate() const { return m_rate; }
+    const Stats &stats() const { return m_stats; }
+
+private:
+    void decrease()
+    {
+        if (m_sinceDecrease < m_options.holdFrames) {
+            return;
+        }
+        m_rate = std::max(m_options.minRate, m_rate * m_options.decrease);
+        m_sinceDecrease = 0;
+        ++m_stats.decreases;
+    }
+
+    Options m_options;
+    double m_rate = 1.0;
+    double m_credit = 0;
+    uint32_t m_sinceDecrease = 0;
+    Stats m_stats;
+};
+
+#endif // RATE_CONTROLLER_H
@@ -0,0 +1,122 @@
+#ifndef SEQLOCK_SNAPSHOT_H
+#define SEQLOCK_SNAPSHOT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief 单写者、多读者的版本化快照（双缓冲 seqlock，即 Linux 的 seqcount latch）
+ *
+ * 写者每次 publish() 把序号加 2：第一次加 1 后读者转向槽位 1，写者更新槽位 0；
+ * 第二次加 1 后读者回到已更新的槽位 0，写者再更新槽位 1。读者按序号的最低位选择槽位，
+ * 复制后再检查序号，序号变化说明复制期间发生了发布，重试即可。
+ *
+ * - 写者从不等待读者，读者之间互不影响，不需要任何锁
+ * - 读者只在复制期间恰好有发布时重试，重试次数受写者发布频率限制
+ * - version() 为已完成的发布次数，读者用 readIfNewer() 判断自上次读取后是否有变化
+ *
+ * 槽位按 64 位原子字逐字复制（relaxed），避免并发读写的数据竞争。
+ *
+ * @tparam T 可平凡复制的快照类型
+ */
+template <typename T>
+class SeqlockSnapshot
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockSnapshot requires a trivially copyable type");
+
+public:
+    explicit SeqlockSnapshot(const T &initial = T())
+    {
+        store(m_slots[0], initial);
+        store(m_slots[1], initial);
+    }
+
+    SeqlockSnapshot(const SeqlockSnapshot &) = delete;
+    SeqlockSnapshot &operator=(const SeqlockSnapshot &) = delete;
+
+    /**
+     * @brief 发布新快照，只能由单个写者线程调用
+     * @return 新快照的版本号
+     */
+    uint64_t publish(const T &value)
+    {
+        uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store(m_slots[0], value);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+        store(m_slots[1], value);
+        return (sequence + 2) >> 1;
+    }
+
+    /**
+     * @brief 读取一致的快照
+     * @return 快照的版本号，尚未发布过时为 0（返回构造时的初始值）
+     */
+    uint64_t read(T &value) const
+    {
+        while (true) {
+            uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+            load(m_slots[sequence & 1], value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == sequence) {
+                return sequence >> 1;
+            }
+            m_retries.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 版本号大于 lastVersion 时读取快照并更新 lastVersion
+     * @return 没有新版本时返回 false，不复制
+     */
+    bool readIfNewer(uint64_t &lastVersion, T &value) const
+    {
+        if (version() <= lastVersion) {
+            return false;
+        }
+        lastVersion = read(value);
+        return true;
+    }
+
+    uint64_t version() const { return m_sequence.load(std::memory_order_acquire) >> 1; }
+
+    // 所有读者累计的重试次数，用于观察读写冲突
+    uint64_t retries() const { return m_retries.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> words[kWords];
+    };
+
+    static void store(Slot &slot, const T &value)
+    {
+        uint64_t buffer[kWords] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            slot.words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    static void load(const Slot &slot, T &value)
+    {
+        uint64_t buffer[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, buffer, sizeof(T));
+    }
+
+    alignas(64) std::atomic<uint64_t> m_sequence{0};
+    Slot m_slots[2];
+    alignas(64) mutable std::atomic<uint64_t> m_retries{0};
+};
+
+#endif // SEQLOCK_SNAPSHOT_H
@@ -1,46 +1,287 @@
+#ifndef SHM_FRAME_H
+#define SHM_FRAME_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
 #include <stdint.h>
 #include <sys/ipc.h>
 #include <sys/mman.h>
 #include <sys/shm.h>
 
+/**
+ * @brief 帧像素格式
+ */
+enum class PixelFormat : uint32_t {
+  Unknown = 0,
+  BGRA32 = 1, // 内存顺序 B G R A，即小端 ARGB32
+  RGBA32 = 2, // 内存顺序 R G B A
+  ARGB32 = 3, // 内存顺序 A R G B
+  NV12 = 4,   // Y 平面 + 交错 UV 平面，色度 2x2 下采样
+  I420 = 5,   // Y、U、V 三个平面，色度 2x2 下采样
+};
+
+/**
+ * @brief 存放在共享内存开头的固定布局帧头
+ *
+ * 其他进程 attach 同一块共享内存后，只需要 FrameHeader::validate()
+ * 就能解析出尺寸、格式、各平面位置和时间戳，不需要额外的消息。
+ * 所有偏移都相对于帧头起始地址，平面起始地址和行跨度都按 kAlignment 对齐。
+ */
+struct FrameHeader {
+  static constexpr uint32_t kMagic = 0x464D4853; // "SHMF"
+  static constexpr uint16_t kVersion = 1;
+  static constexpr uint32_t kMaxPlanes = 4;
+  static constexpr uint32_t kAlignment = 64;
+
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t width;
+  uint32_t height;
+  uint32_t format; // PixelFormat
+  uint32_t planeCount;
+  uint32_t planeOffset[kMaxPlanes];
+  uint32_t planeStride[kMaxPlanes];
+  uint64_t sequence; // 帧序号，由生产者写入
+  int64_t ptsUs;     // 显示时间戳（微秒），由生产者写入
+  uint8_t reserved[56];
+
+  /**
+   * @brief 检查一块内存是否以合法的帧头开始
+   * @param size 这块内存的总字节数（含帧头）
+   * @return 合法时返回帧头指针，否则返回 nullptr
+   *
+   * 除魔数和版本外还检查格式已知、平面数与格式一致、每个平面的行跨度
+   * 容得下一行像素，且所有平面都落在 size 之内，通过后 ShmFrame::plane()
+   * 返回的视图不会越界。其他进程的帧头不可信，这里的运算都按 64 位进行，不会溢出。
+   */
+  static const FrameHeader *validate(const void *data, size_t size);
+};
+static_assert(sizeof(FrameHeader) == 128, "FrameHeader layout is shared across processes");
+static_assert(sizeof(FrameHeader) % FrameHeader::kAlignment == 0);
+
+/**
+ * @brief 单个平面的视图，按行访问像素
+ */
+struct PlaneView {
+  uint8_t *data = nullptr;
+  uint32_t width = 0;  // 每行像素（或色度样本）数
+  uint32_t height = 0; // 行数
+  uint32_t stride = 0; // 行跨度（字节），按 FrameHeader::kAlignment 对齐
+  uint32_t bytesPerPixel = 0;
+
+  uint8_t *row(uint32_t y) const { return data + static_cast<size_t>(y) * stride; }
+
+  template <typename P> P *rowAs(uint32_t y) const {
+    return reinterpret_cast<P *>(row(y));
+  }
+};
+
 class ShmFrame {
 public:
+  /**
+   * @brief 无类型帧：size 字节的原始缓冲，没有帧头
+   */
   explicit ShmFrame(size_t size) {
+    allocate(size);
+    m_size = size;
+  }
+
+  /**
+   * @brief 带帧头的帧：共享内存开头是 FrameHeader，后面是按格式排列的各个平面
+   */
+  ShmFrame(uint32_t width, uint32_t height, PixelFormat format) {
+    FrameHeader header{};
+    size_t total = layout(width, height, format, header);
+    allocate(total);
+    std::memcpy(m_base, &header, sizeof(header));
+    m_header = reinterpret_cast<FrameHeader *>(m_base);
+    m_data = m_base + sizeof(FrameHeader);
+    m_size = total - sizeof(FrameHeader);
+  }
+
+  ~ShmFrame() {
+    if (m_isShm) {
+      shmdt(m_base);
+      shmctl(m_shmId, IPC_RMID, nullptr);
+    } else {
+      ::operator delete[](m_base, std::align_val_t(FrameHeader::kAlignment));
+    }
+  }
+
+  ShmFrame(const ShmFrame &) = delete;
+  ShmFrame &operator=(const ShmFrame &) = delete;
+
+  // 像素数据起始地址，带帧头时是第一个平面
+  uint8_t *getData() const { return m_data; }
+  // 像素数据字节数（不含帧头）
+  size_t size() const { return m_size; }
+  // 共享内存 id，回退到堆内存时为 -1
+  int shmId() const { return m_shmId; }
+
+  // 无类型帧返回 nullptr
+  FrameHeader *header() const { return m_header; }
+
+  PlaneView plane(uint32_t index) const {
+    PlaneView view;
+    if (!m_header || index >= m_header->planeCount) {
+      return view;
+    }
+    view.data = m_base + m_header->planeOffset[index];
+    view.stride = m_header->planeStride[index];
+    planeGeometry(m_header->width, m_header->height,
+                  static_cast<PixelFormat>(m_header->format), index,
+                  view.width, view.height, view.bytesPerPixel);
+    return view;
+  }
+
+  /**
+   * @brief 从另一进程 attach 得到的内存中解析平面视图
+   */
+  static PlaneView plane(const FrameHeader *header, uint32_t index) {
+    PlaneView view;
+    if (!header || index >= header->planeCount) {
+      return view;
+    }
+    view.data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(header)) +
+                header->planeOffset[index];
+    view.stride = header->planeStride[index];
+    planeGeometry(header->width, header->height,
+                  static_cast<PixelFormat>(header->format), index, view.width,
+                  view.height, view.bytesPerPixel);
+    return view;
+  }
+
+  static uint32_t planeCount(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::BGRA32:
+    case PixelFormat::RGBA32:
+    case PixelFormat::ARGB32:
+      return 1;
+    case PixelFormat::NV12:
+      return 2;
+    case PixelFormat::I420:
+      return 3;
+    default:
+      return 0;
+    }
+  }
+
+private:
+  friend struct FrameHeader;
+
+  void allocate(size_t size) {
     m_shmId = shmget(IPC_PRIVATE, size, IPC_CREAT | 0666);
     if (m_shmId >= 0) {
       void *ptr = shmat(m_shmId, nullptr, 0);
       if (ptr != MAP_FAILED) {
-        m_data = static_cast<uint8_t *>(ptr);
+        // shmat 返回页对齐地址
+        m_base = static_cast<uint8_t *>(ptr);
         m_isShm = true;
       } else {
         shmctl(m_shmId, IPC_RMID, nullptr);
-        m_data = new uint8_t[size];
         m_shmId = -1;
-        m_isShm = false;
       }
-    } else {
-      m_data = new uint8_t[size];
+    }
+    if (!m_isShm) {
+      m_base = static_cast<uint8_t *>(::operator new[](
+          size, std::align_val_t(FrameHeader::kAlignment)));
       m_shmId = -1;
-      m_isShm = false;
     }
+    m_data = m_base;
   }
 
-  ~ShmFrame() {
-    if (m_isShm) {
-      shmdt(m_data);
-      shmctl(m_shmId, IPC_RMID, nullptr);
-    } else {
-      delete[] m_data;
+  static uint32_t alignUp(uint32_t value) {
+    return (value + FrameHeader::kAlignment - 1) & ~(FrameHeader::kAlignment - 1);
+  }
+
+  static void planeGeometry(uint32_t width, uint32_t height, PixelFormat format,
+                            uint32_t index, uint32_t &planeWidth,
+                            uint32_t &planeHeight, uint32_t &bytesPerPixel) {
+    uint32_t chromaWidth = (width + 1) / 2;
+    uint32_t chromaHeight = (height + 1) / 2;
+    switch (format) {
+    case PixelFormat::BGRA32:
+    case PixelFormat::RGBA32:
+    case PixelFormat::ARGB32:
+      planeWidth = width;
+      planeHeight = height;
+      bytesPerPixel = 4;
+      break;
+    case PixelFormat::NV12:
+      planeWidth = index == 0 ? width : chromaWidth;
+      planeHeight = index == 0 ? height : chromaHeight;
+      bytesPerPixel = index == 0 ? 1 : 2;
+      break;
+    case PixelFormat::I420:
+      planeWidth = index == 0 ? width : chromaWidth;
+      planeHeight = index == 0 ? height : chromaHeight;
+      bytesPerPixel = 1;
+      break;
+    default:
+      planeWidth = planeHeight = bytesPerPixel = 0;
+      break;
     }
   }
 
-  ShmFrame(const ShmFrame &) = delete;
-  ShmFrame &operator=(const ShmFrame &) = delete;
+  // 填充帧头并返回帧头加全部平面的总字节数
+  static size_t layout(uint32_t width, uint32_t height, PixelFormat format,
+                       FrameHeader &header) {
+    header.magic = FrameHeader::kMagic;
+    header.version = FrameHeader::kVersion;
+    header.headerSize = sizeof(FrameHeader);
+    header.width = width;
+    header.height = height;
+    header.format = static_cast<uint32_t>(format);
+    header.planeCount = planeCount(format);
 
-  uint8_t *getData() const { return m_data; }
+    size_t offset = sizeof(FrameHeader);
+    for (uint32_t i = 0; i < header.planeCount; ++i) {
+      uint32_t planeWidth = 0, planeHeight = 0, bytesPerPixel = 0;
+      planeGeometry(width, height, format, i, planeWidth, planeHeight, bytesPerPixel);
+      header.planeOffset[i] = static_cast<uint32_t>(offset);
+      header.planeStride[i] = alignUp(planeWidth * bytesPerPixel);
+      offset += static_cast<size_t>(header.planeStride[i]) * planeHeight;
+    }
+    return offset;
+  }
 
-private:
+  uint8_t *m_base = nullptr; // 共享内存或堆内存起始地址
   uint8_t *m_data = nullptr;
+  size_t m_size = 0;
+  FrameHeader *m_header = nullptr;
   int m_shmId = -1;
   bool m_isShm = false;
 };
+
+inline const FrameHeader *FrameHeader::validate(const void *data, size_t size) {
+  if (!data || size < sizeof(FrameHeader)) {
+    return nullptr;
+  }
+  auto header = static_cast<const FrameHeader *>(data);
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->headerSize != sizeof(FrameHeader)) {
+    return nullptr;
+  }
+  auto format = static_cast<PixelFormat>(header->format);
+  uint32_t planes = ShmFrame::planeCount(format);
+  if (planes == 0 || header->planeCount != planes) {
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < planes; ++i) {
+    uint32_t planeWidth = 0, planeHeight = 0, bytesPerPixel = 0;
+    ShmFrame::planeGeometry(header->width, header->height, format, i,
+                            planeWidth, planeHeight, bytesPerPixel);
+    uint64_t rowBytes = static_cast<uint64_t>(planeWidth) * bytesPerPixel;
+    uint64_t end = header->planeOffset[i] +
+                   static_cast<uint64_t>(header->planeStride[i]) * planeHeight;
+    if (header->planeOffset[i] < sizeof(FrameHeader) ||
+        rowBytes > header->planeStride[i] || end > size) {
+      return nullptr;
+    }
+  }
+  return header;
+}
+
+#endif // SHM_FRAME_H
@@ -0,0 +1,187 @@
+#ifndef STRIPE_HASH_H
+#define STRIPE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRIPE_HASH_X86 1
+#endif
+
+/**
+ * @brief 按 64 字节条带计算的 64 位哈希（XXH3 风格的累加器）
+ *
+ * 8 个 64 位累加器，每个条带：dk = data ^ key，acc[i] += lo32(dk) * hi32(dk)，
+ * acc[i ^ 1] += data。key 随条带序号递增，因此交换两个条带（例如交换两行）会改变哈希。
+ * 不足 64 字节的尾部补零后作为一个完整条带处理。
+ *
+ * 用于检测缓冲区是否变化，不是加密哈希。标量、SSE2、AVX2 版本结果完全相同，
+ * 运行时按 CPUID 选择。
+ */
+namespace StripeHash {
+
+constexpr size_t kStripe = 64;
+
+struct State
+{
+    uint64_t acc[8];
+    uint64_t stripes; // 已处理的条带数，决定下一个条带的 key
+    uint64_t length;
+};
+
+using AccumulateFn = void (*)(State &state, const uint8_t *data, size_t stripes);
+
+namespace detail {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kKeyStep = 0x27D4EB2F165667C5ull;
+
+alignas(64) constexpr uint64_t kKey[8] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+    0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+};
+
+inline void accumulateScalar(State &state, const uint8_t *data, size_t stripes)
+{
+    for (size_t s = 0; s < stripes; ++s, data += kStripe) {
+        uint64_t offset = state.stripes++ * kKeyStep;
+        for (size_t i = 0; i < 8; ++i) {
+            uint64_t d;
+            std::memcpy(&d, data + 8 * i, sizeof(d));
+            uint64_t dk = d ^ (kKey[i] + offset);
+            state.acc[i] += (dk & 0xFFFFFFFFull) * (dk >> 32);
+            state.acc[i ^ 1] += d;
+        }
+    }
+}
+
+#ifdef STRIPE_HASH_X86
+
+__attribute__((target("sse2"))) inline void accumulateSse2(State &state, const uint8_t *data, size_t stripes)
+{
+    __m128i acc[4], key[4];
+    const __m128i step = _mm_set1_epi64x(static_cast<long long>(kKeyStep));
+    const __m128i offset = _mm_set1_epi64x(static_cast<long long>(state.stripes * kKeyStep));
+    for (int i = 0; i < 4; ++i) {
+        acc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state.acc) + i);
+        key[i] = _mm_add_epi64(_mm_load_si128(reinterpret_cast<const __m128i *>(kKey) + i), offset);
+    }
+    for (size_t s = 0; s < stripes; ++s, data += kStripe) {
+        for (int i = 0; i < 4; ++i) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data) + i);
+            __m128i dk = _mm_xor_si128(d, key[i]);
+            __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+            key[i] = _mm_add_epi64(key[i], step);
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state.acc) + i, acc[i]);
+    }
+    state.stripes += stripes;
+}
+
+__attribute__((target("avx2"))) inline void accumulateAvx2(State &state, const uint8_t *data, size_t stripes)
+{
+    __m256i acc[2], key[2];
+    const __m256i step = _mm256_set1_epi64x(static_cast<long long>(kKeyStep));
+    const __m256i offset = _mm256_set1_epi64x(static_cast<long long>(state.stripes * kKeyStep));
+    for (int i = 0; i < 2; ++i) {
+        acc[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state.acc) + i);
+        key[i] = _mm256_add_epi64(_mm256_load_si256(reinterpret_cast<const __m256i *>(kKey) + i), offset);
+    }
+    for (size_t s = 0; s < stripes; ++s, data += kStripe) {
+        for (int i = 0; i < 2; ++i) {
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data) + i);
+            __m256i dk = _mm256_xor_si256(d, key[i]);
+            __m256i product = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+            __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            acc[i] = _mm256_add_epi64(acc[i], _mm256_add_epi64(product, swapped));
+            key[i] = _mm256_add_epi64(key[i], step);
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(state.acc) + i, acc[i]);
+    }
+    state.stripes += stripes;
+}
+
+#endif // STRIPE_HASH_X86
+
+inline uint64_t avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace detail
+
+// 按 CPUID 选择的累加实现，首次调用时检测
+inline AccumulateFn bestAccumulate()
+{
+    static const AccumulateFn best = [] {
+#ifdef STRIPE_HASH_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return &detail::accumulateAvx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return &detail::accumulateSse2;
+        }
+#endif
+        return &detail::accumulateScalar;
+    }();
+    return best;
+}
+
+inline void init(State &state)
+{
+    for (size_t i = 0; i < 8; ++i) {
+        state.acc[i] = detail::kPrime1 * (i + 1);
+    }
+    state.stripes = 0;
+    state.length = 0;
+}
+
+// 追加一段数据，尾部不足一个条带的部分补零处理
+inline void update(State &state, const uint8_t *data, size_t length, AccumulateFn accumulate = bestAccumulate())
+{
+    size_t full = length / kStripe;
+    accumulate(state, data, full);
+    size_t rest = length - full * kStripe;
+    if (rest) {
+        alignas(64) uint8_t tail[kStripe] = {};
+        std::memcpy(tail, data + full * kStripe, rest);
+        accumulate(state, tail, 1);
+    }
+    state.length += length;
+}
+
+inline uint64_t finalize(const State &state)
+{
+    uint64_t h = state.length * detail::kPrime1;
+    for (size_t i = 0; i < 8; ++i) {
+        h = (h ^ detail::avalanche(state.acc[i])) * detail::kPrime2 + detail::kPrime3;
+    }
+    return detail::avalanche(h);
+}
+
+inline uint64_t hash(const void *data, size_t length, AccumulateFn accumulate = bestAccumulate())
+{
+    State state;
+    init(state);
+    update(state, static_cast<const uint8_t *>(data), length, accumulate);
+    return finalize(state);
+}
+
+} // namespace StripeHash
+
+#endif // STRIPE_HASH_H
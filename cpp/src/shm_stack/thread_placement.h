@@ -0,0 +1,347 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief 当前进程可用 CPU 的拓扑：核心、封装和末级缓存（LLC）
+ *
+ * 从 /sys/devices/system/cpu 读取，只包含 sched_getaffinity 允许的 CPU。
+ * sysfs 不可读时（部分容器）每个 CPU 视为独立核心、共享同一个 LLC。
+ */
+struct CpuTopology
+{
+    struct Cpu
+    {
+        int id = 0;
+        int core = 0;    // 核心编号，超线程兄弟相同（已按封装区分）
+        int package = 0; // 物理封装
+        int llc = 0;     // 末级缓存编号：共享该缓存的第一个 CPU
+    };
+
+    std::vector<Cpu> cpus;
+    bool fromSysfs = false;
+
+    static CpuTopology detect()
+    {
+        CpuTopology topology;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            CPU_SET(0, &allowed);
+        }
+
+        topology.fromSysfs = true;
+        for (int id = 0; id < CPU_SETSIZE; ++id) {
+            if (!CPU_ISSET(id, &allowed)) {
+                continue;
+            }
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+            Cpu cpu;
+            cpu.id = id;
+            int coreId = -1;
+            bool ok = readInt(base + "/topology/core_id", coreId)
+                      && readInt(base + "/topology/physical_package_id", cpu.package);
+            cpu.core = ok ? (cpu.package << 16) | coreId : id;
+            cpu.package = ok ? cpu.package : 0;
+            cpu.llc = ok ? lastLevelCache(base, id) : 0;
+            topology.fromSysfs = topology.fromSysfs && ok;
+            topology.cpus.push_back(cpu);
+        }
+        return topology;
+    }
+
+    size_t coreCount() const { return distinct(&Cpu::core); }
+    size_t cacheCount() const { return distinct(&Cpu::llc); }
+
+    // 例如 "4 cpus, 2 cores, 1 LLC (sysfs)"
+    std::string describe() const
+    {
+        std::ostringstream out;
+        out << cpus.size() << " cpus, " << coreCount() << " cores, " << cacheCount() << " LLC"
+            << (fromSysfs ? " (sysfs)" : " (fallback)");
+        return out.str();
+    }
+
+private:
+    size_t distinct(int Cpu::*field) const
+    {
+        std::set<int> values;
+        for (const Cpu &cpu : cpus) {
+            values.insert(cpu.*field);
+        }
+        return values.size();
+    }
+
+    static bool readInt(const std::string &path, int &value)
+    {
+        std::ifstream in(path);
+        return static_cast<bool>(in >> value);
+    }
+
+    // 级别最高的缓存的 shared_cpu_list 中的第一个 CPU，例如 "0-7,16-23" -> 0
+    static int lastLevelCache(const std::string &base, int self)
+    {
+        int bestLevel = -1;
+        int llc = self;
+        for (int index = 0;; ++index) {
+            std::string dir = base + "/cache/index" + std::to_string(index);
+            int level = 0;
+            if (!readInt(dir + "/level", level)) {
+                break;
+            }
+            int first = self;
+            std::ifstream list(dir + "/shared_cpu_list");
+            if (level > bestLevel && list >> first) {
+                bestLevel = level;
+                llc = first;
+            }
+        }
+        return llc;
+    }
+};
+
+/**
+ * @brief 线程放置策略：CPU 亲和性和 SCHED_FIFO 优先级
+ *
+ * plan() 按布局从拓扑中为一组线程挑选 CPU（通常是一个生产者和一个消费者），
+ * 线程启动后调用 apply() 绑定到自己的 CPU 并按需切换到 SCHED_FIFO。
+ * 没有权限（EPERM）时实时优先级静默降级为普通调度，结果中 realtime 为 false。
+ *
+ * 单 CPU 的主机上只有 Floating 和 SameCpu 可用，其余布局 plan() 返回 false，
+ * 调用方据此跳过或退回 Floating。
+ * measureHandoff() 测量某个布局下两个线程之间的单向交接延迟，用来比较主机上的各种布局。
+ */
+class ThreadPlacement
+{
+public:
+    enum class Layout {
+        Floating,       // 不绑定，由调度器决定
+        SameCpu,        // 全部绑在同一个 CPU 上
+        SiblingThreads, // 同一核心的超线程兄弟
+        SameCache,      // 共享 LLC 的不同核心
+        CrossCache,     // 不同 LLC（通常是不同封装/CCX）
+    };
+
+    struct Policy
+    {
+        std::vector<int> cpus; // 第 i 个线程绑到 cpus[i % size]，为空时不绑定
+        int fifoPriority = 0;  // 大于 0 时尝试 SCHED_FIFO
+    };
+
+    struct Result
+    {
+        bool pinned = false;
+        bool realtime = false;
+        int error = 0; // 最后一次失败的 errno
+    };
+
+    struct HandoffStats
+    {
+        Layout layout = Layout::Floating;
+        bool available = false; // 拓扑是否支持该布局
+        bool pinned = false;
+        bool realtime = false;
+        size_t rounds = 0;
+        double p50Ns = 0;
+        double p99Ns = 0;
+        double maxNs = 0;
+    };
+
+    static const char *layoutName(Layout layout)
+    {
+        switch (layout) {
+        case Layout::Floating:
+            return "floating";
+        case Layout::SameCpu:
+            return "same-cpu";
+        case Layout::SiblingThreads:
+            return "sibling-smt";
+        case Layout::SameCache:
+            return "same-llc";
+        case Layout::CrossCache:
+            return "cross-llc";
+        default:
+            return "unknown";
+        }
+    }
+
+    /**
+     * @brief 为 threads 个线程挑选 CPU
+     * @return 拓扑无法满足该布局时返回 false（例如没有超线程或只有一个 LLC）
+     */
+    static bool plan(const CpuTopology &topology, Layout layout, size_t threads, Policy &policy)
+    {
+        policy.cpus.clear();
+        if (topology.cpus.empty()) {
+            return layout == Layout::Floating;
+        }
+
+        // llc -> core -> cpus，均按编号排序
+        std::map<int, std::map<int, std::vector<int>>> caches;
+        for (const CpuTopology::Cpu &cpu : topology.cpus) {
+            caches[cpu.llc][cpu.core].push_back(cpu.id);
+        }
+
+        switch (layout) {
+        case Layout::Floating:
+            return true;
+        case Layout::SameCpu:
+            policy.cpus.push_back(topology.cpus.front().id);
+            return true;
+        case Layout::SiblingThreads:
+            for (const auto &cache : caches) {
+                for (const auto &core : cache.second) {
+                    if (core.second.size() >= 2) {
+                        policy.cpus = core.second;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        case Layout::SameCache:
+            for (const auto &cache : caches) {
+                if (cache.second.size() >= 2) {
+                    for (const auto &core : cache.second) {
+                        policy.cpus.push_back(core.second.front());
+                    }
+                    policy.cpus.resize(std::min(policy.cpus.size(), std::max<size_t>(threads, 2)));
+                    return true;
+                }
+            }
+            return false;
+        case Layout::CrossCache:
+            if (caches.size() < 2) {
+                return false;
+            }
+            for (const auto &cache : caches) {
+                policy.cpus.push_back(cache.second.begin()->second.front());
+            }
+            policy.cpus.resize(std::min(policy.cpus.size(), std::max<size_t>(threads, 2)));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief 对调用线程应用策略
+     * @param threadIndex 线程在本组中的序号，决定绑定到哪个 CPU
+     */
+    static Result apply(const Policy &policy, size_t threadIndex)
+    {
+        Result result;
+        if (!policy.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(policy.cpus[threadIndex % policy.cpus.size()], &set);
+            int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            result.pinned = rc == 0;
+            result.error = rc;
+        }
+        if (policy.fifoPriority > 0) {
+            sched_param param{};
+            param.sched_priority = std::min(policy.fifoPriority, sched_get_priority_max(SCHED_FIFO));
+            int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            result.realtime = rc == 0;
+            result.error = rc ? rc : result.error;
+        }
+        return result;
+    }
+
+    // 把调用线程恢复为普通调度、可在所有允许的 CPU 上运行
+    static void reset(const CpuTopology &topology)
+    {
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const CpuTopology::Cpu &cpu : topology.cpus) {
+            CPU_SET(cpu.id, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    /**
+     * @brief 测量两个线程在某个布局下的单向交接延迟
+     *
+     * 生产者写入时间戳后发布序号，消费者看到序号时记录 now - 时间戳，再回应确认，如此往返 rounds 次。
+     * 等待方先短暂自旋再 yield，同一个 CPU 上的两个线程（包括 SCHED_FIFO）也能轮流推进。
+     */
+    static HandoffStats measureHandoff(const CpuTopology &topology, Layout layout, size_t rounds, int fifoPriority = 0)
+    {
+        HandoffStats stats;
+        stats.layout = layout;
+        Policy policy;
+        policy.fifoPriority = fifoPriority;
+        stats.available = plan(topology, layout, 2, policy);
+        if (!stats.available || rounds == 0) {
+            return stats;
+        }
+
+        std::atomic<uint64_t> turn{0};
+        std::atomic<int64_t> stamp{0};
+        std::vector<int64_t> samples(rounds);
+        Result results[2];
+
+        std::thread consumer([&] {
+            results[1] = apply(policy, 1);
+            for (size_t i = 0; i < rounds; ++i) {
+                waitFor(turn, 2 * i + 1);
+                samples[i] = nowNs() - stamp.load(std::memory_order_relaxed);
+                turn.store(2 * i + 2, std::memory_order_release);
+            }
+        });
+        std::thread producer([&] {
+            results[0] = apply(policy, 0);
+            for (size_t i = 0; i < rounds; ++i) {
+                waitFor(turn, 2 * i);
+                stamp.store(nowNs(), std::memory_order_relaxed);
+                turn.store(2 * i + 1, std::memory_order_release);
+            }
+        });
+        producer.join();
+        consumer.join();
+
+        std::sort(samples.begin(), samples.end());
+        stats.pinned = policy.cpus.empty() || (results[0].pinned && results[1].pinned);
+        stats.realtime = results[0].realtime && results[1].realtime;
+        stats.rounds = rounds;
+        stats.p50Ns = static_cast<double>(samples[rounds / 2]);
+        stats.p99Ns = static_cast<double>(samples[std::min(rounds - 1, rounds * 99 / 100)]);
+        stats.maxNs = static_cast<double>(samples.back());
+        return stats;
+    }
+
+private:
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void waitFor(const std::atomic<uint64_t> &turn, uint64_t value)
+    {
+        for (unsigned spins = 0; turn.load(std::memory_order_acquire) != value; ++spins) {
+            if (spins >= 256) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+#endif // THREAD_PLACEMENT_H
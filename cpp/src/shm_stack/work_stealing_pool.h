@@ -0,0 +1,450 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include "mpmc_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Chase-Lev 工作窃取双端队列
+ *
+ * 只有所属线程可以 push/pop 底部，其他线程只能从顶部 steal。
+ * 实现参照 Lê 等人的 C11 内存序版本（"Correct and Efficient Work-Stealing
+ * for Weak Memory Models"）。容量不足时按 2 倍扩容，旧数组保留到析构，
+ * 因此正在 steal 的线程读到旧数组也是安全的。
+ *
+ * @tparam T 指针类型，空指针表示没有取到元素
+ */
+template <typename T>
+class ChaseLevDeque
+{
+public:
+    explicit ChaseLevDeque(size_t capacity = 256)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_arrays.emplace_back(std::make_unique<Array>(size));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque &) = delete;
+    ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+    // 仅所属线程调用
+    void push(T value)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        Array *array = m_array.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(array->mask)) {
+            array = grow(array, top, bottom);
+        }
+        array->put(bottom, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // 仅所属线程调用，LIFO
+    T pop()
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array *array = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        T value = nullptr;
+        if (top <= bottom) {
+            value = array->get(bottom);
+            if (top == bottom) {
+                // 只剩最后一个元素，和窃取者竞争
+                if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    value = nullptr;
+                }
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+        } else {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    // 任意线程调用，FIFO
+    T steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top < bottom) {
+            Array *array = m_array.load(std::memory_order_acquire);
+            T value = array->get(top);
+            if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return value;
+            }
+        }
+        return nullptr;
+    }
+
+    bool empty() const
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array
+    {
+        explicit Array(size_t size)
+            : mask(size - 1)
+            , slots(new std::atomic<T>[size])
+        {
+        }
+
+        T get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Array *grow(Array *array, int64_t top, int64_t bottom)
+    {
+        auto bigger = std::make_unique<Array>((array->mask + 1) * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, array->get(i));
+        }
+        Array *result = bigger.get();
+        m_arrays.push_back(std::move(bigger));
+        m_array.store(result, std::memory_order_release);
+        return result;
+    }
+
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    std::atomic<Array *> m_array{nullptr};
+    std::vector<std::unique_ptr<Array>> m_arrays; // 仅所属线程修改
+};
+
+/**
+ * @brief 工作窃取线程池
+ *
+ * 每个工作线程有自己的 ChaseLevDeque，工作线程内部提交的任务进入自己的队列，
+ * 外部线程提交的任务进入无锁注入队列。空闲线程依次尝试：自己的队列、
+ * 注入队列、随机窃取其他线程的队列，整个调度过程没有全局锁。
+ *
+ * 既可以提交整帧任务（submit），也可以把一帧拆成若干 tile 子任务并行执行
+ * （parallelFor，调用线程会参与执行直到全部完成）。
+ * 需要按帧序输出时配合 OrderedCompletion 使用。
+ */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(size_t threads = std::thread::hardware_concurrency())
+        : m_injected(1024)
+    {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            m_deques.emplace_back(std::make_unique<ChaseLevDeque<Job *>>());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            m_workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    /**
+     * @brief 析构前等待所有已提交的任务完成
+     */
+    ~WorkStealingPool()
+    {
+        waitIdle();
+        m_stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_sleepCv.notify_all();
+        }
+        for (auto &worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    size_t threadCount() const { return m_workers.size(); }
+
+    void submit(std::function<void()> func)
+    {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        enqueue(new Job{std::move(func), nullptr});
+    }
+
+    /**
+     * @brief 并行执行 body(0) .. body(count - 1)，全部完成后返回
+     *
+     * 调用线程会一起执行任务，因此可以在工作线程内部嵌套调用，
+     * 例如一个帧任务内再把帧拆成 tile 子任务。
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &body)
+    {
+        if (count == 0) {
+            return;
+        }
+        std::atomic<size_t> remaining{count};
+        for (size_t i = 1; i < count; ++i) {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            enqueue(new Job{[&body, i] { body(i); }, &remaining});
+        }
+        body(0);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+
+        // 帮助执行任务，直到所有子任务完成
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (Job *job = findJob()) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // 取出一个待执行的任务在调用线程执行，没有任务时返回 false
+    bool runPending()
+    {
+        Job *job = findJob();
+        if (job) {
+            execute(job);
+        }
+        return job != nullptr;
+    }
+
+    // 等待所有已提交的任务执行完毕
+    void waitIdle()
+    {
+        while (m_pending.load(std::memory_order_acquire) > 0) {
+            if (Job *job = findJob()) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> func;
+        std::atomic<size_t> *remaining; // parallelFor 的完成计数，submit 的任务为空
+    };
+
+    static WorkStealingPool *&currentPool()
+    {
+        static thread_local WorkStealingPool *pool = nullptr;
+        return pool;
+    }
+
+    static size_t &currentIndex()
+    {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    bool isWorker() const { return currentPool() == this; }
+
+    void enqueue(Job *job)
+    {
+        if (isWorker()) {
+            m_deques[currentIndex()]->push(job);
+        } else {
+            while (!m_injected.tryPush(std::move(job))) {
+                // 注入队列满时帮忙执行任务腾出空间
+                if (Job *other = findJob()) {
+                    execute(other);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        if (m_sleepers.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_sleepCv.notify_one();
+        }
+    }
+
+    Job *findJob()
+    {
+        Job *job = nullptr;
+        if (isWorker()) {
+            job = m_deques[currentIndex()]->pop();
+            if (job) {
+                return job;
+            }
+        }
+        if (m_injected.tryPop(job)) {
+            return job;
+        }
+
+        thread_local std::minstd_rand random(static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        size_t count = m_deques.size();
+        size_t start = random() % count;
+        for (size_t i = 0; i < count; ++i) {
+            size_t victim = (start + i) % count;
+            if (isWorker() && victim == currentIndex()) {
+                continue;
+            }
+            job = m_deques[victim]->steal();
+            if (job) {
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void execute(Job *job)
+    {
+        job->func();
+        if (job->remaining) {
+            job->remaining->fetch_sub(1, std::memory_order_acq_rel);
+        }
+        delete job;
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void run(size_t index)
+    {
+        currentPool() = this;
+        currentIndex() = index;
+
+        unsigned idleRounds = 0;
+        while (true) {
+            if (Job *job = findJob()) {
+                execute(job);
+                idleRounds = 0;
+                continue;
+            }
+            if (m_stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (++idleRounds < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            // 长时间空闲后休眠，超时兜底防止错过唤醒
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepers.fetch_add(1, std::memory_order_acq_rel);
+            m_sleepCv.wait_for(lock, std::chrono::milliseconds(1));
+            m_sleepers.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        currentPool() = nullptr;
+    }
+
+    std::vector<std::unique_ptr<ChaseLevDeque<Job *>>> m_deques;
+    MpmcQueue<Job *> m_injected;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_pending{0};
+    std::atomic<bool> m_stopping{false};
+    std::atomic<int> m_sleepers{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+};
+
+/**
+ * @brief 按序号顺序输出乱序完成的结果
+ *
+ * 帧任务在线程池中乱序完成，complete(seq, value) 把结果放入重排窗口，
+ * 恰好补齐下一个序号的线程负责按顺序调用 sink，直到遇到缺口。
+ * 同一时刻只有一个线程在调用 sink，sink 内部不需要加锁。
+ *
+ * 序号超出窗口时 complete() 等待窗口滑动。在线程池的任务中调用时应传入 pool，
+ * 等待期间执行池中的其他任务：否则所有工作线程都可能卡在 complete() 中，
+ * 而补齐缺口的任务还在队列里，没有线程去执行。
+ * 缺口任务位于同一线程的调用栈下方时（例如在 parallelFor 帮忙执行期间取到了后面的帧）
+ * 仍然无法推进，调用方应保证在途的序号跨度不超过 window，例如每帧持有一个池元素、window 不小于池的大小。
+ *
+ * @tparam T 结果类型
+ */
+template <typename T>
+class OrderedCompletion
+{
+public:
+    using Sink = std::function<void(uint64_t, T &)>;
+
+    OrderedCompletion(size_t window, Sink sink, WorkStealingPool *pool = nullptr)
+        : m_slots(std::max<size_t>(window, 1))
+        , m_sink(std::move(sink))
+        , m_pool(pool)
+    {
+    }
+
+    void complete(uint64_t sequence, T value)
+    {
+        // 等待窗口滑动到可以容纳该序号，期间帮忙执行池中的任务
+        while (sequence >= m_next.load(std::memory_order_acquire) + m_slots.size()) {
+            if (!m_pool || !m_pool->runPending()) {
+                std::this_thread::yield();
+            }
+        }
+        Slot &slot = m_slots[sequence % m_slots.size()];
+        slot.value = std::move(value);
+        slot.ready.store(sequence + 1);
+        drain();
+    }
+
+    // 已按顺序输出的结果数
+    uint64_t emitted() const { return m_next.load(std::memory_order_acquire); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> ready{0}; // 存放序号 + 1，0 表示空
+        T value{};
+    };
+
+    // 标志和就绪序号之间是 store-load 顺序，这里统一使用 seq_cst，
+    // 保证释放标志后的复查一定能看到并发 complete() 写入的结果
+    void drain()
+    {
+        while (true) {
+            if (m_draining.exchange(true)) {
+                // 其他线程正在输出，它释放标志后会再检查一次
+                return;
+            }
+            uint64_t next = m_next.load();
+            while (true) {
+                Slot &slot = m_slots[next % m_slots.size()];
+                if (slot.ready.load() != next + 1) {
+                    break;
+                }
+                m_sink(next, slot.value);
+                slot.value = T{};
+                slot.ready.store(0);
+                m_next.store(++next);
+            }
+            m_draining.store(false);
+
+            // 释放标志前下一个结果可能刚好到达，需要重新检查
+            Slot &slot = m_slots[next % m_slots.size()];
+            if (slot.ready.load() != next + 1) {
+                return;
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    Sink m_sink;
+    WorkStealingPool *m_pool;
+    std::atomic<uint64_t> m_next{0};
+    std::atomic<bool> m_draining{false};
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -3,12 +3,31 @@ set_version("0.1.0")
 
 add_rules("mode.debug", "mode.release")
 
+-- 替换 malloc 系列函数统计堆分配，用于断言热路径不分配；
+-- 使用 ASan/TSan 或非 glibc 工具链出问题时用 xmake f --alloc_counter=n 关闭
+option("alloc_counter")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Count heap allocations in the fixed_stack tests")
+    add_defines("SHM_STACK_ALLOC_COUNTER")
+option_end()
+
 target("fixed_stack")
     set_kind("binary")
     set_languages("c++20")
     set_plat("linux")
     set_arch("x86_64")
     add_files("src/shm_stack/*.cpp")
+    add_options("alloc_counter")
+
+target("cursor_shape")
+    set_kind("binary")
+    set_languages("c++20")
+    set_plat("linux")
+    set_arch("x86_64")
+    add_files("src/cursor_shape/*.cpp")
+    add_includedirs("src/shm_stack")
+    add_syslinks("z")
 
 target("dxgi_pointer_monitor")
     set_kind("binary")
@@ -20,4 +39,5 @@ target("dxgi_pointer_monitor")
 
     add_files("src/dxgi_pointer_monitor/*.cpp")
     add_files("src/dxgi_pointer_monitor/*.h")
+    add_includedirs("src/cursor_shape", "src/shm_stack")
     add_syslinks("d3d11")